@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "ComponentLabeling.h"
+
+namespace iseg {
+
+unsigned ComponentLabeling::find(unsigned i)
+{
+	// path halving, the parent of a run is never after the run
+	while (_parent[i] != i)
+	{
+		_parent[i] = _parent[_parent[i]];
+		i = _parent[i];
+	}
+	return i;
+}
+
+void ComponentLabeling::unite(unsigned a, unsigned b)
+{
+	a = find(a);
+	b = find(b);
+	if (a < b)
+		_parent[b] = a;
+	else if (b < a)
+		_parent[a] = b;
+}
+
+void ComponentLabeling::finalize()
+{
+	_components.clear();
+	std::size_t i = 0;
+	for (unsigned short z = 0; z < _depth; z++)
+	{
+		for (unsigned short y = 0; y < _height; y++)
+		{
+			std::size_t const end = _row_start[size_t(z) * _height + y + 1];
+			for (; i < end; i++)
+			{
+				Run& run = _runs[i];
+				// the parent of a run was already set to its root
+				unsigned const root = _parent[_parent[i]];
+				_parent[i] = root;
+				if (root == i)
+				{
+					run.label = static_cast<unsigned>(_components.size());
+					Component c;
+					c.size = 0;
+					c.slice = z;
+					c.offset = unsigned(y) * _width + run.begin;
+					c.min[0] = run.begin;
+					c.min[1] = c.max[1] = y;
+					c.min[2] = c.max[2] = z;
+					c.max[0] = run.end - 1;
+					c.at_border = false;
+					_components.push_back(c);
+				}
+				else
+				{
+					run.label = _runs[root].label;
+				}
+
+				Component& c = _components[run.label];
+				c.size += run.end - run.begin;
+				c.min[0] = std::min(c.min[0], run.begin);
+				c.max[0] = std::max(c.max[0], static_cast<unsigned short>(run.end - 1));
+				c.max[1] = std::max(c.max[1], y);
+				c.max[2] = z;
+				c.at_border = c.at_border || run.begin == 0 || run.end == _width || y == 0 || y + 1 == _height || (_depth > 1 && (z == 0 || z + 1 == _depth));
+			}
+		}
+	}
+
+	std::vector<unsigned>().swap(_parent);
+}
+
+} // namespace iseg
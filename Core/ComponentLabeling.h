@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Connected component labeling of a slice or a stack of slices
+ *
+ * Neighboring pixels are connected if the functor 'key' maps their values to
+ * equal keys, e.g. the value itself, or whether it is a given tissue. Each row
+ * is encoded as runs of equal keys and the runs are merged with union-find,
+ * so the memory needed grows with the number of runs, not of pixels.
+ * Slices (or blocks of rows of a single slice) are labeled in parallel and
+ * then merged pairwise.
+ *
+ * Every pixel belongs to a component, also the pixels of keys the caller is
+ * not interested in. The components are numbered in raster order of their
+ * first pixel.
+ */
+class ISEG_CORE_API ComponentLabeling
+{
+public:
+	enum eConnectivity {
+		kFaces, // 4 neighbors in 2D, 6 in 3D
+		kEdges, // 8 neighbors in 2D, 18 in 3D
+		kVertices // 8 neighbors in 2D, 26 in 3D
+	};
+
+	/// Pixels [begin, end) of a row with equal key
+	struct Run
+	{
+		unsigned short begin;
+		unsigned short end;
+		unsigned label;
+	};
+
+	struct Component
+	{
+		std::size_t size; // number of pixels
+		unsigned short slice; // slice and offset in the slice of the first pixel
+		unsigned offset;
+		unsigned short min[3]; // bounding box in x, y, z
+		unsigned short max[3];
+		bool at_border; // touches the border of the stack, for a single slice only the border of the slice
+	};
+
+	template<typename T, typename TKey>
+	ComponentLabeling(const std::vector<const T*>& slices, unsigned short width, unsigned short height, eConnectivity connectivity, TKey key);
+
+	template<typename T, typename TKey>
+	ComponentLabeling(const T* slice, unsigned short width, unsigned short height, eConnectivity connectivity, TKey key)
+			: ComponentLabeling(std::vector<const T*>(1, slice), width, height, connectivity, key)
+	{
+	}
+
+	unsigned number_of_components() const { return static_cast<unsigned>(_components.size()); }
+	const Component& component(unsigned label) const { return _components[label]; }
+
+	/// Runs of row y in slice z
+	const Run* runs_begin(unsigned short z, unsigned short y) const { return _runs.data() + _row_start[size_t(z) * _height + y]; }
+	const Run* runs_end(unsigned short z, unsigned short y) const { return _runs.data() + _row_start[size_t(z) * _height + y + 1]; }
+
+	/// Writes map(label) to the pixels of slice z
+	template<typename TOut, typename TMap>
+	void write_slice(unsigned short z, TOut* out, TMap map) const;
+
+private:
+	enum { kRowsPerBlock = 64 };
+
+	unsigned find(unsigned i);
+	void unite(unsigned a, unsigned b);
+	/// Numbers the roots in order, collects the statistics and releases the union-find forest
+	void finalize();
+
+	unsigned short _width;
+	unsigned short _height;
+	unsigned short _depth;
+	std::vector<std::size_t> _row_start; // first run of each row, rows of all slices are consecutive
+	std::vector<Run> _runs;
+	std::vector<unsigned> _parent;
+	std::vector<Component> _components;
+};
+
+template<typename T, typename TKey>
+ComponentLabeling::ComponentLabeling(const std::vector<const T*>& slices, unsigned short width, unsigned short height, eConnectivity connectivity, TKey key)
+		: _width(width), _height(height), _depth(static_cast<unsigned short>(slices.size()))
+{
+	int const rows = static_cast<int>(_depth) * height;
+	auto row_data = [&](int r) { return slices[r / height] + size_t(r % height) * width; };
+
+	// count the runs, then store them
+	_row_start.assign(rows + 1, 0);
+#pragma omp parallel for
+	for (int r = 0; r < rows; r++)
+	{
+		const T* data = row_data(r);
+		std::size_t count = (width > 0) ? 1 : 0;
+		for (unsigned short x = 1; x < width; x++)
+		{
+			if (!(key(data[x]) == key(data[x - 1])))
+				count++;
+		}
+		_row_start[r + 1] = count;
+	}
+	std::partial_sum(_row_start.begin(), _row_start.end(), _row_start.begin());
+
+	_runs.resize(_row_start.back());
+#pragma omp parallel for
+	for (int r = 0; r < rows; r++)
+	{
+		const T* data = row_data(r);
+		Run* run = _runs.data() + _row_start[r];
+		unsigned short begin = 0;
+		for (unsigned x = 1; x <= width; x++)
+		{
+			if (x == width || !(key(data[x]) == key(data[begin])))
+			{
+				*run++ = Run{begin, static_cast<unsigned short>(x), 0};
+				begin = static_cast<unsigned short>(x);
+			}
+		}
+	}
+
+	_parent.resize(_runs.size());
+	std::iota(_parent.begin(), _parent.end(), 0u);
+
+	// unites the runs of rows a and b which overlap (or touch diagonally) and have equal keys
+	auto connect = [&](int a, int b, bool diagonal) {
+		const T* data_a = row_data(a);
+		const T* data_b = row_data(b);
+		int const d = diagonal ? 1 : 0;
+		std::size_t j = _row_start[b];
+		for (std::size_t i = _row_start[a]; i < _row_start[a + 1]; i++)
+		{
+			Run const& ra = _runs[i];
+			while (j < _row_start[b + 1] && _runs[j].end + d <= ra.begin)
+				j++;
+			for (std::size_t k = j; k < _row_start[b + 1] && _runs[k].begin < ra.end + d; k++)
+			{
+				if (key(data_a[ra.begin]) == key(data_b[_runs[k].begin]))
+					unite(static_cast<unsigned>(i), static_cast<unsigned>(k));
+			}
+		}
+	};
+	auto connect_row = [&](int r, bool in_slice, bool across_slices) {
+		int const y = r % height;
+		if (in_slice && y > 0)
+		{
+			connect(r, r - 1, connectivity != kFaces);
+		}
+		if (across_slices && r >= height)
+		{
+			connect(r, r - height, connectivity != kFaces);
+			if (connectivity != kFaces && y > 0)
+				connect(r, r - height - 1, connectivity == kVertices);
+			if (connectivity != kFaces && y + 1 < height)
+				connect(r, r - height + 1, connectivity == kVertices);
+		}
+	};
+
+	// blocks are the slices, or groups of rows of a single slice
+	int const rows_per_block = (_depth > 1) ? static_cast<int>(height) : static_cast<int>(kRowsPerBlock);
+	int const blocks = (rows + rows_per_block - 1) / rows_per_block;
+#pragma omp parallel for
+	for (int b = 0; b < blocks; b++)
+	{
+		int const end = std::min(rows, (b + 1) * rows_per_block);
+		for (int r = b * rows_per_block + 1; r < end; r++)
+		{
+			connect_row(r, true, false);
+		}
+	}
+
+	// merge block b with b-1, the groups of blocks merged at one level are disjoint
+	for (int step = 1; step < blocks; step *= 2)
+	{
+#pragma omp parallel for
+		for (int b = step; b < blocks; b += 2 * step)
+		{
+			int const first = b * rows_per_block;
+			if (_depth > 1)
+			{
+				for (int r = first; r < first + rows_per_block; r++)
+				{
+					connect_row(r, false, true);
+				}
+			}
+			else
+			{
+				connect_row(first, true, false);
+			}
+		}
+	}
+
+	finalize();
+}
+
+template<typename TOut, typename TMap>
+void ComponentLabeling::write_slice(unsigned short z, TOut* out, TMap map) const
+{
+	for (unsigned short y = 0; y < _height; y++)
+	{
+		TOut* row = out + size_t(y) * _width;
+		for (const Run* run = runs_begin(z, y); run != runs_end(z, y); ++run)
+		{
+			std::fill(row + run->begin, row + run->end, static_cast<TOut>(map(run->label)));
+		}
+	}
+}
+
+} // namespace iseg
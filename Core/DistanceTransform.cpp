@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "DistanceTransform.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace iseg { namespace DistanceTransform {
+
+namespace {
+/// Lower envelope of the parabolas (x - q*spacing)^2 + f[q], buffers are reused between lines
+class Envelope
+{
+public:
+	explicit Envelope(unsigned n) : _in(n), _v(n), _h(n), _z(n + 1) {}
+
+	/// Input of the current line, filled by the caller
+	float* line() { return _in.data(); }
+
+	/** \brief Writes the envelope to out[q * stride], optionally the sample of the minimum to arg[q]
+	 *
+	 * Returns false if the line has no finite sample, 'out' and 'arg' are not written then.
+	 */
+	bool transform(float* out, size_t stride, float spacing, unsigned* arg = nullptr)
+	{
+		unsigned const n = static_cast<unsigned>(_in.size());
+		int k = -1;
+		for (unsigned q = 0; q < n; q++)
+		{
+			if (!(_in[q] < kInfinity))
+				continue;
+
+			double const pq = q * double(spacing);
+			double const hq = _in[q] + pq * pq;
+			double s = 0;
+			while (k >= 0)
+			{
+				double const pv = _v[k] * double(spacing);
+				s = (hq - _h[k]) / (2.0 * (pq - pv));
+				if (s > _z[k])
+					break;
+				k--;
+			}
+			k++;
+			_v[k] = q;
+			_h[k] = hq;
+			_z[k] = (k == 0) ? -std::numeric_limits<double>::infinity() : s;
+		}
+		if (k < 0)
+			return false;
+		_z[k + 1] = std::numeric_limits<double>::infinity();
+
+		int j = 0;
+		for (unsigned q = 0; q < n; q++)
+		{
+			double const pq = q * double(spacing);
+			while (_z[j + 1] < pq)
+				j++;
+			double const d = pq - _v[j] * double(spacing);
+			out[q * stride] = static_cast<float>(d * d + _in[_v[j]]);
+			if (arg)
+				arg[q] = _v[j];
+		}
+		return true;
+	}
+
+private:
+	std::vector<float> _in;
+	std::vector<unsigned> _v; // samples of the parabolas in the envelope
+	std::vector<double> _h; // f[v] + (v*spacing)^2
+	std::vector<double> _z; // boundaries between the parabolas
+};
+
+void transform_rows(float* f, unsigned width, unsigned height, float dx, unsigned* nearest)
+{
+	int const h = static_cast<int>(height);
+#pragma omp parallel
+	{
+		Envelope env(width);
+#pragma omp for
+		for (int y = 0; y < h; y++)
+		{
+			float* row = f + size_t(y) * width;
+			std::copy(row, row + width, env.line());
+			unsigned* arg = nearest ? nearest + size_t(y) * width : nullptr;
+			if (env.transform(row, 1, dx, arg) && arg)
+			{
+				for (unsigned x = 0; x < width; x++)
+				{
+					arg[x] += y * width;
+				}
+			}
+			else if (arg)
+			{
+				std::fill(arg, arg + width, width * height);
+			}
+		}
+	}
+}
+
+void transform_columns(float* f, unsigned width, unsigned height, float dy, unsigned* nearest)
+{
+	int const w = static_cast<int>(width);
+#pragma omp parallel
+	{
+		Envelope env(height);
+		std::vector<unsigned> arg(nearest ? height : 0), row_nearest(arg.size());
+#pragma omp for
+		for (int x = 0; x < w; x++)
+		{
+			for (unsigned y = 0; y < height; y++)
+			{
+				env.line()[y] = f[size_t(y) * width + x];
+			}
+			if (!nearest)
+			{
+				env.transform(f + x, width, dy);
+				continue;
+			}
+
+			for (unsigned y = 0; y < height; y++)
+			{
+				row_nearest[y] = nearest[size_t(y) * width + x];
+			}
+			if (env.transform(f + x, width, dy, arg.data()))
+			{
+				for (unsigned y = 0; y < height; y++)
+				{
+					nearest[size_t(y) * width + x] = row_nearest[arg[y]];
+				}
+			}
+		}
+	}
+}
+} // namespace
+
+void SquaredDistance2D(float* f, unsigned width, unsigned height, float dx, float dy, unsigned* nearest)
+{
+	if (width == 0 || height == 0)
+		return;
+
+	transform_rows(f, width, height, dx, nearest);
+	transform_columns(f, width, height, dy, nearest);
+}
+
+void SquaredDistance3D(const std::vector<float*>& slices, unsigned width, unsigned height, float dx, float dy, float dz)
+{
+	if (width == 0 || height == 0 || slices.empty())
+		return;
+
+	for (float* slice : slices)
+	{
+		transform_rows(slice, width, height, dx, nullptr);
+		transform_columns(slice, width, height, dy, nullptr);
+	}
+
+	unsigned const n = static_cast<unsigned>(slices.size());
+	int const area = static_cast<int>(width * height);
+#pragma omp parallel
+	{
+		Envelope env(n);
+		std::vector<float> out(n);
+#pragma omp for
+		for (int i = 0; i < area; i++)
+		{
+			for (unsigned z = 0; z < n; z++)
+			{
+				env.line()[z] = slices[z][i];
+			}
+			if (env.transform(out.data(), 1, dz))
+			{
+				for (unsigned z = 0; z < n; z++)
+				{
+					slices[z][i] = out[z];
+				}
+			}
+		}
+	}
+}
+
+}} // namespace iseg::DistanceTransform
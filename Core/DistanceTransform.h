@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Exact Euclidean distance transform (Felzenszwalb & Huttenlocher)
+ *
+ * The input holds 0 at the feature pixels and kInfinity elsewhere, the output
+ * is the squared distance to the closest feature, in units of the spacing.
+ * Pixels which cannot reach a feature keep kInfinity. The transform is
+ * separable, each axis is a lower envelope of parabolas computed in linear
+ * time, the rows/columns of an axis are processed in parallel.
+ */
+namespace DistanceTransform {
+
+/// Marks pixels that are not a feature
+constexpr float kInfinity = 1e20f;
+
+/** \brief 2D transform of a slice stored row by row, in place
+ *
+ * If 'nearest' is given, it receives the index of the closest feature pixel,
+ * or width*height if there is no feature.
+ */
+ISEG_CORE_API void SquaredDistance2D(float* f, unsigned width, unsigned height, float dx = 1.f, float dy = 1.f, unsigned* nearest = nullptr);
+
+/// 3D transform of a stack of slices, in place
+ISEG_CORE_API void SquaredDistance3D(const std::vector<float*>& slices, unsigned width, unsigned height, float dx, float dy, float dz);
+
+/// Minimum number of slices per slab, see SquaredDistance3DSlabs
+constexpr unsigned kSlabSlices = 32;
+
+/** \brief 3D transform of n slices, computed slab by slab
+ *
+ * Only squared distances up to max_d2 are exact, larger ones may be too large.
+ * Each slab is extended by the slices within reach of max_d2, so only a few
+ * slices of distances are held in memory. is_feature(k, i) tells whether pixel
+ * i of slice k is a feature, visit(k, d2) receives the squared distances of
+ * slice k. The slices of a slab are visited in parallel, after the features of
+ * the next slab were read, so visit may modify the input of slice k.
+ */
+template<typename TFeature, typename TVisit>
+void SquaredDistance3DSlabs(unsigned n, unsigned width, unsigned height, float dx, float dy, float dz, float max_d2, TFeature is_feature, TVisit visit)
+{
+	if (width == 0 || height == 0 || n == 0)
+		return;
+
+	unsigned const area = width * height;
+	// a slab is at least as thick as the extension, reading the next slab never sees visited slices
+	unsigned const halo = (dz > 0) ? static_cast<unsigned>(std::min(std::sqrt(std::max(max_d2, 0.f)) / dz, float(n))) : n;
+	unsigned const slab = std::max(kSlabSlices, halo);
+
+	struct Slab
+	{
+		unsigned begin, end; // visited slices
+		unsigned lo, hi; // slices in 'dist'
+		std::vector<float> dist;
+	};
+	auto load = [&](unsigned begin, Slab& s) {
+		s.begin = begin;
+		s.end = std::min(n, begin + slab);
+		s.lo = begin > halo ? begin - halo : 0;
+		s.hi = std::min(n, s.end + halo);
+		s.dist.resize(size_t(s.hi - s.lo) * area);
+		int const slices = static_cast<int>(s.hi - s.lo);
+#pragma omp parallel for
+		for (int k = 0; k < slices; k++)
+		{
+			float* d = s.dist.data() + size_t(k) * area;
+			for (unsigned i = 0; i < area; i++)
+			{
+				d[i] = is_feature(s.lo + k, i) ? 0.f : kInfinity;
+			}
+		}
+	};
+	auto transform = [&](Slab& s) {
+		std::vector<float*> slices;
+		for (unsigned k = s.lo; k < s.hi; k++)
+		{
+			slices.push_back(s.dist.data() + size_t(k - s.lo) * area);
+		}
+		SquaredDistance3D(slices, width, height, dx, dy, dz);
+	};
+
+	Slab cur, next;
+	load(0, cur);
+	transform(cur);
+	while (true)
+	{
+		bool const more = cur.end < n;
+		if (more)
+		{
+			load(cur.end, next);
+		}
+
+		int const begin = static_cast<int>(cur.begin), end = static_cast<int>(cur.end);
+#pragma omp parallel for
+		for (int k = begin; k < end; k++)
+		{
+			visit(static_cast<unsigned>(k), static_cast<const float*>(cur.dist.data() + size_t(k - cur.lo) * area));
+		}
+
+		if (!more)
+			break;
+		transform(next);
+		std::swap(cur, next);
+	}
+}
+
+} // namespace DistanceTransform
+
+} // namespace iseg
@@ -13,6 +13,11 @@
 
 #include <hdf5.h>
 
+#ifdef ISEG_HDF5_DIRECT_CHUNK_WRITE
+#include <itk_zlib.h>
+#endif
+
+#include <algorithm>
 #include <sstream>
 
 namespace iseg {
@@ -76,6 +81,90 @@ bool HDF5IO::close(handle_id_type file)
 	return true;
 }
 
+HDF5IO::handle_id_type HDF5IO::createDataset(handle_id_type file, const std::string& name,
+		handle_id_type type, size_t size, size_t chunk) const
+{
+	int rank = 1;
+	hsize_t dimsf[1] = {size};
+	hid_t dataspace = H5Screate_simple(rank, dimsf, 0);
+
+	// Modify dataset creation properties by enable chunking and gzip compression
+	hid_t properties = H5Pcreate(H5P_DATASET_CREATE);
+	hsize_t dim_chunks[1] = {std::max<hsize_t>(std::min<hsize_t>(chunk, size), 1)};
+	H5Pset_chunk(properties, rank, dim_chunks);
+	if (CompressionLevel > 0) // disable filter when compression <= 0
+	{
+#ifdef USE_HDF5_BLOSC
+		if (BloscEnabled())
+		{
+			unsigned int cd_values[7];
+			cd_values[4] = CompressionLevel; /* compression level */
+			cd_values[5] = 1;           /* 0: shuffle not active, 1: shuffle active */
+			cd_values[6] = BLOSC_BLOSCLZ; /* the actual compressor to use */
+			H5Pset_filter(properties, FILTER_BLOSC, H5Z_FLAG_OPTIONAL, 7, cd_values);
+		}
+		else
+#endif
+		{
+			H5Pset_deflate(properties, std::min(CompressionLevel, 9));
+		}
+	}
+
+	// Define datatype for the data in the file.
+	// We will store little endian numbers.
+	hid_t datatype = H5Tcopy(type);
+	H5Tset_order(datatype, H5T_ORDER_LE);
+
+	hid_t dataset = H5Dcreate(file, name.c_str(), datatype, dataspace, properties);
+
+	H5Tclose(datatype);
+	H5Pclose(properties);
+	H5Sclose(dataspace);
+	return dataset;
+}
+
+bool HDF5IO::directChunkWrite() const
+{
+#ifdef ISEG_HDF5_DIRECT_CHUNK_WRITE
+	// the Blosc filter is applied by HDF5
+	return CompressionLevel <= 0 || !BloscEnabled();
+#else
+	return false;
+#endif
+}
+
+bool HDF5IO::compressChunk(const void* data, size_t size, std::vector<unsigned char>& out) const
+{
+#ifdef ISEG_HDF5_DIRECT_CHUNK_WRITE
+	if (CompressionLevel <= 0)
+		return false;
+
+	// same format as the HDF5 deflate filter (zlib stream)
+	uLongf len = compressBound(static_cast<uLong>(size));
+	out.resize(len);
+	if (compress2(out.data(), &len, static_cast<const Bytef*>(data), static_cast<uLong>(size), std::min(CompressionLevel, 9)) != Z_OK || len >= size)
+	{
+		return false;
+	}
+	out.resize(len);
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool HDF5IO::writeChunk(handle_id_type dataset, size_t offset, const void* data, size_t size, bool compressed) const
+{
+#ifdef ISEG_HDF5_DIRECT_CHUNK_WRITE
+	hsize_t chunk_offset[1] = {offset};
+	// bit 0 set: skip the deflate filter when reading this chunk
+	uint32_t filter_mask = (CompressionLevel > 0 && !compressed) ? 1 : 0;
+	return H5Dwrite_chunk(dataset, H5P_DEFAULT, filter_mask, chunk_offset, size, data) >= 0;
+#else
+	return false;
+#endif
+}
+
 std::string HDF5IO::dumpErrorStack()
 {
 	std::stringstream ss;
@@ -20,6 +20,14 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
+
+// write pre-compressed chunks directly, bypassing the (single threaded) filter pipeline
+#ifdef H5_VERSION_GE
+#if H5_VERSION_GE(1, 10, 2)
+#define ISEG_HDF5_DIRECT_CHUNK_WRITE
+#endif
+#endif
 
 namespace iseg {
 
@@ -47,14 +55,38 @@ public:
 	bool readData(handle_id_type file_id, const std::string& name,
 			size_t arg_offset, size_t arg_length, T* data_out);
 
+	/// Read consecutive slices, the dataset is opened once with a chunk cache large enough for one chunk
+	template<typename T>
+	bool readData(handle_id_type file_id, const std::string& name,
+			T** slice_data, size_t num_slices, size_t slice_size,
+			size_t offset = 0);
+
 	template<typename T>
 	bool writeData(handle_id_type file_id, const std::string& name,
 			T** const slice_data, size_t num_slices, size_t slice_size,
 			size_t offset = 0);
 
+	/** \brief Write slices to a new dataset with chunks of 'slices_per_chunk' slices
+	 *
+	 * Chunks are gathered and compressed in parallel, while the previous batch
+	 * of chunks is written to the file. The dataset is 1D as with writeData.
+	 */
+	template<typename T>
+	bool writeVolume(handle_id_type file_id, const std::string& name,
+			T** const slice_data, size_t num_slices, size_t slice_size,
+			size_t slices_per_chunk);
+
 	static std::string dumpErrorStack();
 
 protected:
+	handle_id_type createDataset(handle_id_type file_id, const std::string& name,
+			handle_id_type type, size_t size, size_t chunk) const;
+	/// True if chunks can be compressed by compressChunk and written with writeChunk
+	bool directChunkWrite() const;
+	/// Deflate a chunk, returns false if the data is incompressible
+	bool compressChunk(const void* data, size_t size, std::vector<unsigned char>& out) const;
+	bool writeChunk(handle_id_type dataset, size_t offset, const void* data, size_t size, bool compressed) const;
+
 	int CompressionLevel;
 };
 
@@ -1,5 +1,9 @@
 #include "HDF5IO.h"
 
+#include <algorithm>
+#include <future>
+#include <thread>
+
 namespace iseg {
 
 template<typename T>
@@ -112,7 +116,6 @@ bool HDF5IO::writeData(handle_id_type file, const std::string& name,
 		T** const slice_data, size_t num_slices,
 		size_t slice_size, size_t offset)
 {
-	hid_t properties = -1, datatype = -1;
 	hid_t dataspace = -1, dataset = -1;
 	herr_t status = 0;
 
@@ -120,44 +123,16 @@ bool HDF5IO::writeData(handle_id_type file, const std::string& name,
 	// datatype and default dataset creation properties.
 	if (H5Lexists(file, name.c_str(), H5P_DEFAULT) <= 0)
 	{
-		// Describe the size of the array and create the data space for fixed
-		// size dataset.
-		int rank = 1;
-		hsize_t dimsf[1] = {num_slices * slice_size};
-		dataspace = H5Screate_simple(rank, dimsf, 0);
-
-		// Modify dataset creation properties by enable chunking and gzip compression
-		properties = H5Pcreate(H5P_DATASET_CREATE);
-
 		// Limit chunk size to 1GB, not sure if a much smaller number would be better
 		hsize_t const mega = 1024 * 1024;
 		hsize_t const giga = 1024 * mega;
-		hsize_t dim_chunks[1] = {chunk_size == 0 ? std::min<hsize_t>(slice_size, giga / sizeof(T)) : chunk_size};
-		H5Pset_chunk(properties, rank, dim_chunks);
-		if (CompressionLevel > 0) // disable filter when compression <= 0
+		hsize_t const chunk = chunk_size == 0 ? std::min<hsize_t>(slice_size, giga / sizeof(T)) : chunk_size;
+
+		dataset = createDataset(file, name, getTypeValue<T>(), num_slices * slice_size, chunk);
+		if (dataset >= 0)
 		{
-#ifdef USE_HDF5_BLOSC
-			if (BloscEnabled())
-			{
-				unsigned int cd_values[7];
-				cd_values[4] = CompressionLevel; /* compression level */
-				cd_values[5] = 1;           /* 0: shuffle not active, 1: shuffle active */
-	    		cd_values[6] = BLOSC_BLOSCLZ; /* the actual compressor to use */
-				H5Pset_filter(properties, FILTER_BLOSC, H5Z_FLAG_OPTIONAL, 7, cd_values);
-			}
-			else
-#endif
-			{
-				H5Pset_deflate(properties, std::min(CompressionLevel, 9));
-			}
+			dataspace = H5Dget_space(dataset);
 		}
-
-		// Define datatype for the data in the file.
-		// We will store little endian numbers.
-		datatype = H5Tcopy(getTypeValue<T>());
-		status = H5Tset_order(datatype, H5T_ORDER_LE);
-
-		dataset = H5Dcreate(file, name.c_str(), datatype, dataspace, properties);
 	}
 	else // open existing
 	{
@@ -216,12 +191,173 @@ bool HDF5IO::writeData(handle_id_type file, const std::string& name,
 		H5Sclose(dataspace);
 	if (dataset >= 0)
 		H5Dclose(dataset);
-	if (datatype >= 0)
-		H5Tclose(datatype);
-	if (properties >= 0)
-		H5Pclose(properties);
 
 	return (status >= 0);
 }
 
+template<typename T>
+bool HDF5IO::readData(handle_id_type file, const std::string& name,
+		T** slice_data, size_t num_slices, size_t slice_size, size_t offset)
+{
+	hid_t dataset = H5Dopen2(file, name.c_str(), H5P_DEFAULT);
+	if (dataset < 0)
+		return false;
+
+	// the default chunk cache (1MB) would decompress multi-slice chunks once per slice
+	hid_t const dcpl = H5Dget_create_plist(dataset);
+	hsize_t chunk_dims[1] = {0};
+	if (H5Pget_layout(dcpl) == H5D_CHUNKED && H5Pget_chunk(dcpl, 1, chunk_dims) == 1)
+	{
+		size_t const chunk_bytes = static_cast<size_t>(chunk_dims[0]) * sizeof(T);
+		if (chunk_bytes > (size_t(1) << 20))
+		{
+			hid_t const dapl = H5Pcreate(H5P_DATASET_ACCESS);
+			H5Pset_chunk_cache(dapl, 521, 2 * chunk_bytes, 1.0);
+			H5Dclose(dataset);
+			dataset = H5Dopen2(file, name.c_str(), dapl);
+			H5Pclose(dapl);
+		}
+	}
+	H5Pclose(dcpl);
+	if (dataset < 0)
+		return false;
+
+	hid_t dataspace = H5Dget_space(dataset);
+	hsize_t dim_mem[1] = {slice_size};
+	hid_t memspace = H5Screate_simple(1, dim_mem, NULL);
+
+	herr_t status = (dataspace >= 0 && memspace >= 0) ? 0 : -1;
+	size_t current_offset = offset;
+	for (size_t i = 0; i < num_slices && status >= 0; i++, current_offset += slice_size)
+	{
+		if (slice_data[i] == nullptr)
+			continue;
+
+		hsize_t dim_offset[1] = {current_offset};
+		hsize_t dim_slab[1] = {slice_size};
+		status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, dim_offset, NULL, dim_slab, NULL);
+		if (status >= 0)
+		{
+			status = H5Dread(dataset, getTypeValue<T>(), memspace, dataspace, H5P_DEFAULT, slice_data[i]);
+		}
+	}
+
+	if (memspace >= 0)
+		H5Sclose(memspace);
+	if (dataspace >= 0)
+		H5Sclose(dataspace);
+	H5Dclose(dataset);
+
+	return (status >= 0);
+}
+
+template<typename T>
+bool HDF5IO::writeVolume(handle_id_type file, const std::string& name,
+		T** const slice_data, size_t num_slices, size_t slice_size,
+		size_t slices_per_chunk)
+{
+	if (num_slices == 0 || slice_size == 0 || H5Lexists(file, name.c_str(), H5P_DEFAULT) > 0)
+	{
+		return writeData(file, name, slice_data, num_slices, slice_size);
+	}
+
+	slices_per_chunk = std::max<size_t>(1, std::min(slices_per_chunk, num_slices));
+	size_t const chunk_size = slices_per_chunk * slice_size;
+	size_t const num_chunks = (num_slices + slices_per_chunk - 1) / slices_per_chunk;
+	size_t const total_size = num_slices * slice_size;
+
+	hid_t dataset = createDataset(file, name, getTypeValue<T>(), total_size, chunk_size);
+	if (dataset < 0)
+	{
+		return false;
+	}
+	hid_t dataspace = H5Dget_space(dataset);
+
+	struct Chunk
+	{
+		size_t index;
+		bool compressed;
+		std::vector<T> data;
+		std::vector<unsigned char> packed;
+	};
+
+	bool const direct = directChunkWrite();
+
+	// only this function calls HDF5, one batch at a time
+	auto write_batch = [&](std::vector<Chunk>* chunks, size_t n) {
+		herr_t status = 0;
+		for (size_t i = 0; i < n && status >= 0; i++)
+		{
+			const Chunk& c = (*chunks)[i];
+			size_t const offset = c.index * chunk_size;
+			if (direct)
+			{
+				bool const ok = c.compressed
+														? writeChunk(dataset, offset, c.packed.data(), c.packed.size(), true)
+														: writeChunk(dataset, offset, c.data.data(), chunk_size * sizeof(T), false);
+				status = ok ? 0 : -1;
+			}
+			else
+			{
+				hsize_t dim_offset[1] = {offset};
+				hsize_t dim_slab[1] = {std::min(chunk_size, total_size - offset)};
+				hid_t memspace = H5Screate_simple(1, dim_slab, NULL);
+				status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, dim_offset, NULL, dim_slab, NULL);
+				if (status >= 0 && memspace >= 0)
+				{
+					status = H5Dwrite(dataset, getTypeValue<T>(), memspace, dataspace, H5P_DEFAULT, c.data.data());
+				}
+				if (memspace >= 0)
+					H5Sclose(memspace);
+			}
+		}
+		return status >= 0;
+	};
+
+	// double buffered: gather & compress a batch while the previous batch is written
+	size_t const batch_size = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	std::vector<Chunk> buffers[2];
+	buffers[0].resize(batch_size);
+	buffers[1].resize(batch_size);
+
+	bool ok = true;
+	std::future<bool> pending;
+	for (size_t first = 0, b = 0; first < num_chunks && ok; first += batch_size, b = 1 - b)
+	{
+		std::vector<Chunk>& chunks = buffers[b];
+		int const n = static_cast<int>(std::min(batch_size, num_chunks - first));
+
+#pragma omp parallel for
+		for (int i = 0; i < n; i++)
+		{
+			Chunk& c = chunks[i];
+			c.index = first + i;
+			c.data.assign(chunk_size, T(0));
+			size_t const k0 = c.index * slices_per_chunk;
+			size_t const k1 = std::min(k0 + slices_per_chunk, num_slices);
+			for (size_t k = k0; k < k1; k++)
+			{
+				if (slice_data[k])
+					std::copy(slice_data[k], slice_data[k] + slice_size, c.data.begin() + (k - k0) * slice_size);
+			}
+			c.compressed = direct && compressChunk(c.data.data(), chunk_size * sizeof(T), c.packed);
+		}
+
+		if (pending.valid())
+		{
+			ok = pending.get();
+		}
+		pending = std::async(std::launch::async, write_batch, &chunks, static_cast<size_t>(n));
+	}
+	if (pending.valid())
+	{
+		ok = pending.get() && ok;
+	}
+
+	H5Sclose(dataspace);
+	H5Dclose(dataset);
+
+	return ok;
+}
+
 } // namespace iseg
@@ -479,6 +479,18 @@ int HDF5Reader::read(unsigned short* data, size_type offset,
 	return HDF5IO().readData(file, name, offset, length, data) ? 1 : 0;
 }
 
+int HDF5Reader::read(float** slices, size_type num_slices, size_type slice_size,
+					 const std::string& name)
+{
+	return HDF5IO().readData(file, name, slices, num_slices, slice_size) ? 1 : 0;
+}
+
+int HDF5Reader::read(unsigned short** slices, size_type num_slices,
+					 size_type slice_size, const std::string& name)
+{
+	return HDF5IO().readData(file, name, slices, num_slices, slice_size) ? 1 : 0;
+}
+
 int HDF5Reader::readData(const std::string& name)
 {
 	if (file < 0)
@@ -59,6 +59,11 @@ public:
 			 const std::string& name);
 	int read(unsigned short* data, size_type offset, size_type length,
 			 const std::string& name);
+	/// Read consecutive slices starting at slice 0
+	int read(float** slices, size_type num_slices, size_type slice_size,
+			 const std::string& name);
+	int read(unsigned short** slices, size_type num_slices, size_type slice_size,
+			 const std::string& name);
 
 	template<class T>
 	static int read2(std::vector<T>& array, const std::string& path)
@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "HDF5IO.h"
+#include "HDF5SliceCache.h"
+
+#include "Data/Logger.h"
+
+#include <hdf5.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace iseg {
+
+namespace {
+// a block never spans more slices than this, independent of the chunk size
+const size_t kMaxBlockSlices = 64;
+} // namespace
+
+HDF5SliceCache::HDF5SliceCache()
+		: _file(-1), _num_slices(0), _slice_size(0), _budget(size_t(256) << 20), _bytes(0)
+{
+	static_assert(sizeof(hid_type) == sizeof(hid_t), "hid_t mismatch. this will lead to runtime errors.");
+}
+
+HDF5SliceCache::~HDF5SliceCache() { close(); }
+
+bool HDF5SliceCache::open(const std::string& file_name, size_t num_slices, size_t slice_size,
+		const std::string& source, const std::string& target, const std::string& tissue)
+{
+	close();
+
+	HDF5IO io;
+	_file = io.open(file_name);
+	if (_file < 0)
+	{
+		ISEG_ERROR("opening " << file_name);
+		return false;
+	}
+	_num_slices = num_slices;
+	_slice_size = slice_size;
+
+	const std::string* names[kNumberOfChannels] = {&source, &target, &tissue};
+	size_t const element_sizes[kNumberOfChannels] = {sizeof(float), sizeof(float), sizeof(tissues_size_t)};
+	for (int c = 0; c < kNumberOfChannels; c++)
+	{
+		Channel& channel = _channels[c];
+		if (names[c]->empty() || H5Lexists(_file, names[c]->c_str(), H5P_DEFAULT) <= 0)
+			continue;
+
+		channel.dataset = H5Dopen2(_file, names[c]->c_str(), H5P_DEFAULT);
+		if (channel.dataset < 0)
+		{
+			ISEG_ERROR("opening dataset " << *names[c]);
+			continue;
+		}
+		channel.element_size = element_sizes[c];
+
+		// read whole chunks at once
+		channel.block_slices = 1;
+		hid_t const dcpl = H5Dget_create_plist(channel.dataset);
+		hsize_t chunk_dims[1] = {0};
+		if (H5Pget_layout(dcpl) == H5D_CHUNKED && H5Pget_chunk(dcpl, 1, chunk_dims) == 1)
+		{
+			size_t const chunk_slices = static_cast<size_t>(chunk_dims[0]) / slice_size;
+			channel.block_slices = std::max<size_t>(1, std::min(chunk_slices, kMaxBlockSlices));
+		}
+		H5Pclose(dcpl);
+	}
+	return true;
+}
+
+void HDF5SliceCache::close()
+{
+	for (auto& channel : _channels)
+	{
+		if (channel.dataset >= 0)
+			H5Dclose(channel.dataset);
+		channel = Channel();
+	}
+	if (_file >= 0)
+	{
+		H5Fclose(_file);
+		_file = -1;
+	}
+	_lru.clear();
+	_index.clear();
+	_bytes = 0;
+}
+
+void HDF5SliceCache::set_budget(size_t bytes)
+{
+	_budget = bytes;
+	trim();
+}
+
+void HDF5SliceCache::trim()
+{
+	// the most recent block is kept, even if it exceeds the budget
+	while (_bytes > _budget && _lru.size() > 1)
+	{
+		_bytes -= _lru.back().data.size();
+		_index.erase(_lru.back().key);
+		_lru.pop_back();
+	}
+}
+
+const unsigned char* HDF5SliceCache::block(eChannel c, size_t slice)
+{
+	const Channel& channel = _channels[c];
+	size_t const b = slice / channel.block_slices;
+	key_type const key(c, b);
+
+	auto found = _index.find(key);
+	if (found != _index.end())
+	{
+		_lru.splice(_lru.begin(), _lru, found->second);
+		return _lru.front().data.data();
+	}
+
+	size_t const first = b * channel.block_slices;
+	size_t const n = std::min(channel.block_slices, _num_slices - first);
+
+	Block entry;
+	entry.key = key;
+	entry.data.resize(n * _slice_size * channel.element_size);
+
+	HDF5IO io;
+	hid_t const mem_type = (c == kTissue) ? io.getTypeValue<tissues_size_t>() : io.getTypeValue<float>();
+	hid_t const dataspace = H5Dget_space(channel.dataset);
+	hsize_t dim_offset[1] = {first * _slice_size};
+	hsize_t dim_count[1] = {n * _slice_size};
+	hid_t const memspace = H5Screate_simple(1, dim_count, NULL);
+	herr_t status = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, dim_offset, NULL, dim_count, NULL);
+	if (status >= 0)
+	{
+		status = H5Dread(channel.dataset, mem_type, memspace, dataspace, H5P_DEFAULT, entry.data.data());
+	}
+	H5Sclose(memspace);
+	H5Sclose(dataspace);
+	if (status < 0)
+	{
+		ISEG_ERROR("reading slices " << first << "-" << first + n - 1 << ": " << HDF5IO::dumpErrorStack());
+		return nullptr;
+	}
+
+	_bytes += entry.data.size();
+	_lru.push_front(std::move(entry));
+	_index[key] = _lru.begin();
+	trim();
+	return _lru.front().data.data();
+}
+
+bool HDF5SliceCache::read(size_t slice, float* source, float* target, tissues_size_t* tissues)
+{
+	if (_file < 0 || slice >= _num_slices)
+		return false;
+
+	void* buffers[kNumberOfChannels] = {source, target, tissues};
+	bool ok = true;
+	for (int c = 0; c < kNumberOfChannels; c++)
+	{
+		const Channel& channel = _channels[c];
+		if (buffers[c] == nullptr || channel.dataset < 0)
+			continue;
+
+		const unsigned char* data = block(static_cast<eChannel>(c), slice);
+		if (data == nullptr)
+		{
+			ok = false;
+			continue;
+		}
+		size_t const slice_bytes = _slice_size * channel.element_size;
+		std::memcpy(buffers[c], data + (slice % channel.block_slices) * slice_bytes, slice_bytes);
+	}
+	return ok;
+}
+
+} // namespace iseg
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include "Data/Types.h"
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Reads slices of an image file on demand
+ *
+ * The Source, Target and Tissue datasets stay open. Slices are read in blocks
+ * aligned to the HDF5 chunks, so a chunk is decompressed once even if it holds
+ * several slices. Decompressed blocks are kept in a least-recently-used cache
+ * limited by a byte budget.
+ *
+ * The class is not thread-safe, see SliceVector.
+ */
+class ISEG_CORE_API HDF5SliceCache
+{
+public:
+	typedef long long hid_type;
+
+	enum eChannel { kSource = 0,
+		kTarget,
+		kTissue,
+		kNumberOfChannels };
+
+	HDF5SliceCache();
+	~HDF5SliceCache();
+
+	/// Open the file and the datasets, an empty dataset name skips the channel
+	bool open(const std::string& file_name, size_t num_slices, size_t slice_size,
+			const std::string& source, const std::string& target, const std::string& tissue);
+	void close();
+	bool is_open() const { return _file >= 0; }
+
+	bool has(eChannel channel) const { return _channels[channel].dataset >= 0; }
+	size_t num_slices() const { return _num_slices; }
+	size_t slice_size() const { return _slice_size; }
+
+	/// Copy a slice into the non-null buffers, channels missing in the file are left untouched
+	bool read(size_t slice, float* source, float* target, tissues_size_t* tissues);
+
+	/// Budget for decompressed blocks in bytes
+	void set_budget(size_t bytes);
+	size_t budget() const { return _budget; }
+	/// Bytes currently held by the cache
+	size_t bytes() const { return _bytes; }
+
+private:
+	HDF5SliceCache(const HDF5SliceCache&) = delete;
+	HDF5SliceCache& operator=(const HDF5SliceCache&) = delete;
+
+	struct Channel
+	{
+		hid_type dataset = -1;
+		size_t element_size = 0;
+		size_t block_slices = 1;
+	};
+
+	typedef std::pair<int, size_t> key_type; // channel, block
+	struct Block
+	{
+		key_type key;
+		std::vector<unsigned char> data;
+	};
+
+	const unsigned char* block(eChannel channel, size_t slice);
+	void trim();
+
+	hid_type _file;
+	size_t _num_slices;
+	size_t _slice_size;
+	Channel _channels[kNumberOfChannels];
+
+	size_t _budget;
+	size_t _bytes;
+	std::list<Block> _lru; // most recently used first
+	std::map<key_type, std::list<Block>::iterator> _index;
+};
+
+} // namespace iseg
@@ -193,6 +193,16 @@ int HDF5Writer::write(unsigned short** const slice_data, size_type num_slices, s
 	return HDF5IO(compression).writeData(file, name, slice_data, num_slices, slice_size, offset) ? 1 : 0;
 }
 
+int HDF5Writer::writeVolume(float** const slice_data, size_type num_slices, size_type slice_size, const std::string& name, size_type slices_per_chunk)
+{
+	return HDF5IO(compression).writeVolume(file, name, slice_data, num_slices, slice_size, slices_per_chunk) ? 1 : 0;
+}
+
+int HDF5Writer::writeVolume(unsigned short** const slice_data, size_type num_slices, size_type slice_size, const std::string& name, size_type slices_per_chunk)
+{
+	return HDF5IO(compression).writeVolume(file, name, slice_data, num_slices, slice_size, slices_per_chunk) ? 1 : 0;
+}
+
 int HDF5Writer::write(const double* data, const std::vector<size_type>& dims, const std::string& name)
 {
 	const std::string type = "double";
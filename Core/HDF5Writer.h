@@ -52,6 +52,11 @@ public:
 			  const std::string& name, size_t offset = 0);
 	int write(unsigned short** const slices, size_type num_slices,
 			  size_type slice_size, const std::string& name, size_t offset = 0);
+	/// Write slices as one volume, chunks of slices_per_chunk slices are compressed in parallel
+	int writeVolume(float** const slices, size_type num_slices, size_type slice_size,
+			  const std::string& name, size_type slices_per_chunk);
+	int writeVolume(unsigned short** const slices, size_type num_slices,
+			  size_type slice_size, const std::string& name, size_type slices_per_chunk);
 	int flush();
 
 	int compression;
@@ -12,9 +12,12 @@
 #include "Data/Point.h"
 
 #include "Core/IndexPriorityQueue.h"
+#include "Core/IndexRadixHeap.h"
 
 #include <algorithm>
 #include <functional>
+#include <memory>
+#include <vector>
 
 namespace iseg {
 
@@ -27,7 +30,14 @@ struct coef
 
 inline bool operator!=(coef c, unsigned short f) { return c.a != f; }
 
-template<typename T>
+/** \brief Image foresting transform, Queue is the priority queue over the pixel indices
+ *
+ * Queue must provide the interface of IndexPriorityQueue used below (insert,
+ * make_smaller, in_queue, pop, empty, clear). IndexRadixHeap is faster but
+ * requires path costs which do not decrease along a path.
+ * The buffers are kept between IFTinit calls of the same slice size.
+ */
+template<typename T, typename Queue = IndexPriorityQueue>
 class ImageForestingTransform
 {
 public:
@@ -37,17 +47,16 @@ public:
 		width = w;
 		height = h;
 		area = (unsigned)width * height;
-		parent = (unsigned*)malloc(sizeof(unsigned) * area);
-		pf = (float*)malloc(sizeof(float) * area);
-		Q = new IndexPriorityQueue(area, pf);
-		processed = (bool*)malloc(sizeof(bool) * area);
-		lb = (T*)malloc(sizeof(T) * area);
-		directivity_bits = (float*)malloc(sizeof(float) * area);
-		E_bits = (float*)malloc(sizeof(float) * area);
-		for (unsigned i = 0; i < area; i++)
+		parent.resize(area);
+		pf.resize(area);
+		processed.resize(area);
+		lb.resize(area);
+		if (Q == nullptr || directivity_bits.size() != area)
 		{
-			directivity_bits[i] = directivity_bit[i];
+			Q.reset(new Queue(area, pf.data()));
 		}
+		directivity_bits.assign(directivity_bit, directivity_bit + area);
+		E_bits.resize(area);
 
 		reinit(lbl, E_bit, connectivity);
 	}
@@ -97,9 +106,9 @@ public:
 			}
 		}
 	}
-	void reinit(T* lbl, bool connectivity, std::vector<unsigned> pts)
+	void reinit(T* lbl, bool connectivity, const std::vector<unsigned>& pts)
 	{
-		std::vector<unsigned>::iterator it = pts.begin();
+		auto it = pts.begin();
 		for (unsigned i = 0; i < area; i++)
 		{
 			lb[i] = lbl[i];
@@ -154,30 +163,24 @@ public:
 	}
 	void reinit(T* lbl, float* E_bit, bool connectivity)
 	{
-		if (E_bits != E_bit)
+		if (E_bits.data() != E_bit)
 		{
-			for (unsigned i = 0; i < area; i++)
-			{
-				E_bits[i] = E_bit[i];
-			}
+			std::copy(E_bit, E_bit + area, E_bits.begin());
 		}
 
 		reinit(lbl, connectivity);
 	}
-	void reinit(T* lbl, float* E_bit, bool connectivity, std::vector<unsigned> pts)
+	void reinit(T* lbl, float* E_bit, bool connectivity, const std::vector<unsigned>& pts)
 	{
-		if (E_bits != E_bit)
+		if (E_bits.data() != E_bit)
 		{
-			for (unsigned i = 0; i < area; i++)
-			{
-				E_bits[i] = E_bit[i];
-			}
+			std::copy(E_bit, E_bit + area, E_bits.begin());
 		}
 
 		reinit(lbl, connectivity, pts);
 	}
-	float* return_pf() { return pf; }
-	T* return_lb() { return lb; }
+	float* return_pf() { return pf.data(); }
+	T* return_lb() { return lb.data(); }
 	void return_path(Point p, std::vector<Point>* Pt_vec)
 	{
 		Point p1;
@@ -212,30 +215,21 @@ public:
 
 		return;
 	}
-	virtual ~ImageForestingTransform()
-	{
-		free(pf);
-		free(lb);
-		free(parent);
-		free(processed);
-		free(E_bits);
-		free(directivity_bits);
-		free(Q);
-	}
+	virtual ~ImageForestingTransform() = default;
 
 protected:
-	float* pf; //path-function value
-	float* directivity_bits;
-	float* E_bits;
-	T* lb;
-	bool* processed;
-	short unsigned width;
-	short unsigned height;
-	unsigned area;
+	std::vector<float> pf; //path-function value
+	std::vector<float> directivity_bits;
+	std::vector<float> E_bits;
+	std::vector<T> lb;
+	std::vector<unsigned char> processed;
+	short unsigned width = 0;
+	short unsigned height = 0;
+	unsigned area = 0;
 
 private:
-	IndexPriorityQueue* Q;
-	unsigned* parent;
+	std::unique_ptr<Queue> Q;
+	std::vector<unsigned> parent;
 	inline void update_step(unsigned p, unsigned q, float direction)
 	{
 		float tmp;
@@ -273,7 +267,7 @@ private:
 };
 
 class ImageForestingTransformRegionGrowing
-		: public ImageForestingTransform<float>
+		: public ImageForestingTransform<float, IndexRadixHeap>
 {
 public:
 	void rg_init(unsigned short w, unsigned short h, float* gradient,
@@ -291,18 +285,16 @@ private:
 };
 
 class ImageForestingTransformLivewire
-		: public ImageForestingTransform<unsigned short>
+		: public ImageForestingTransform<unsigned short, IndexRadixHeap>
 {
 public:
 	void lw_init(unsigned short w, unsigned short h, float* E_bits,
 			float* direction, Point p)
 	{
-		lbl = (unsigned short*)malloc((unsigned)w * h * sizeof(unsigned short));
-		for (unsigned i = 0; i < unsigned(w) * h; i++)
-			lbl[i] = 0;
+		lbl.assign((unsigned)w * h, 0);
 		pt = p.px + p.py * w;
 		lbl[pt] = 1;
-		IFTinit(w, h, E_bits, direction, lbl, true);
+		IFTinit(w, h, E_bits, direction, lbl.data(), true);
 		return;
 	}
 	void change_pt(Point p)
@@ -310,21 +302,20 @@ public:
 		lbl[pt] = 0;
 		pt = p.px + p.py * width;
 		lbl[pt] = 1;
-		reinit(lbl, E_bits, true);
+		reinit(lbl.data(), E_bits.data(), true);
 		return;
 	}
-	void change_pt(unsigned p, std::vector<unsigned> pts)
+	void change_pt(unsigned p, const std::vector<unsigned>& pts)
 	{
 		lbl[pt] = 0;
 		pt = p;
 		lbl[pt] = 1;
-		reinit(lbl, E_bits, true, pts);
+		reinit(lbl.data(), E_bits.data(), true, pts);
 		return;
 	}
-	~ImageForestingTransformLivewire() { free(lbl); }
 
 private:
-	unsigned short* lbl;
+	std::vector<unsigned short> lbl;
 	unsigned pt;
 	inline float compute_pf(unsigned p, unsigned q, float direction)
 	{
@@ -338,7 +329,7 @@ private:
 	}
 };
 
-class ImageForestingTransformAdaptFuzzy : public ImageForestingTransform<float>
+class ImageForestingTransformAdaptFuzzy : public ImageForestingTransform<float, IndexRadixHeap>
 {
 public:
 	void fuzzy_init(unsigned short w, unsigned short h, float* E_bits, Point p,
@@ -347,19 +338,17 @@ public:
 		m1 = 2 * fm1;
 		s1 = -1 / (fs1 * fs1 * 8);
 		s2 = -1 / (fs2 * 2);
-		lbl = (float*)malloc((unsigned)w * h * sizeof(float));
-		for (unsigned i = 0; i < unsigned(w) * h; i++)
-			lbl[i] = 0;
+		lbl.assign((unsigned)w * h, 0.f);
 		pt = p.px + p.py * (unsigned)w;
 		lbl[pt] = 1;
-		IFTinit(w, h, E_bits, E_bits, lbl, false);
+		IFTinit(w, h, E_bits, E_bits, lbl.data(), false);
 	}
 	void change_pt(Point p)
 	{
 		lbl[pt] = 0;
 		pt = p.px + p.py * width;
 		lbl[pt] = 1;
-		reinit(lbl, true);
+		reinit(lbl.data(), true);
 		return;
 	}
 	void change_param(float fm1, float fs1, float fs2)
@@ -369,12 +358,10 @@ public:
 		s2 = -1 / (fs2 * 2);
 	}
 
-	~ImageForestingTransformAdaptFuzzy() { free(lbl); }
-
 private:
 	unsigned pt;
 	float m1, s1, s2;
-	float* lbl;
+	std::vector<float> lbl;
 	inline float compute_pf(unsigned p, unsigned q, float /* direction */)
 	{
 		float h1 = exp((E_bits[p] + E_bits[q] - m1) *
@@ -390,8 +377,8 @@ public:
 	void fastmarch_init(unsigned short w, unsigned short h, float* E_bits,
 			float* lbl)
 	{
-		Ebits = (float*)malloc((unsigned)w * h * sizeof(float));
-		lb1 = (coef*)malloc((unsigned)w * h * sizeof(coef));
+		Ebits.resize((unsigned)w * h);
+		lb1.resize((unsigned)w * h);
 		for (unsigned i = 0; i < unsigned(w) * h; i++)
 		{
 			if (E_bits[i] != 0)
@@ -408,18 +395,13 @@ public:
 			}
 			lb1[i].b = lb1[i].c = 0;
 		}
-		IFTinit(w, h, Ebits, Ebits, lb1, false);
+		IFTinit(w, h, Ebits.data(), Ebits.data(), lb1.data(), false);
 		return;
 	}
-	~ImageForestingTransformFastMarching()
-	{
-		free(Ebits);
-		free(lb1);
-	}
 
 private:
-	float* Ebits;
-	coef* lb1;
+	std::vector<float> Ebits;
+	std::vector<coef> lb1;
 	inline float compute_pf(unsigned p, unsigned q, float /* direction */)
 	{
 		(lb[q].a)++;
@@ -443,7 +425,7 @@ class ImageForestingTransformDistance : public ImageForestingTransform<coef>
 public:
 	void distance_init(unsigned short w, unsigned short h, float f, float* lbl)
 	{
-		lbel = (coef*)malloc((unsigned)w * h * sizeof(coef));
+		lbel.resize((unsigned)w * h);
 		unsigned i = 0;
 		for (unsigned short j = 0; j < h; j++)
 		{
@@ -495,14 +477,12 @@ public:
 		}
 		//			float f1;
 
-		IFTinit(w, h, lbl, lbl, lbel, false);
+		IFTinit(w, h, lbl, lbl, lbel.data(), false);
 		return;
 	}
-	~ImageForestingTransformDistance() { free(lbel); }
 
 private:
-	float* Ebits;
-	coef* lbel;
+	std::vector<coef> lbel;
 	inline float compute_pf(unsigned p, unsigned q, float /* direction */)
 	{
 		float x = float(q % width);
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "IndexRadixHeap.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace iseg {
+
+IndexRadixHeap::IndexRadixHeap(unsigned size, float* valuemap)
+		: _valuemap(valuemap), _keys(size, 0), _bucket_of(size, kNone), _slot(size, 0), _last(0), _count(0), _size(size)
+{
+}
+
+std::uint32_t IndexRadixHeap::key(float value)
+{
+	// the bits of a non-negative float are ordered like its value
+	if (!(value > 0.f))
+		return 0;
+	std::uint32_t k;
+	std::memcpy(&k, &value, sizeof(k));
+	return k;
+}
+
+unsigned IndexRadixHeap::bucket(std::uint32_t k) const
+{
+	std::uint32_t diff = k ^ _last;
+	unsigned b = 0;
+	while (diff != 0)
+	{
+		diff >>= 1;
+		b++;
+	}
+	return b;
+}
+
+void IndexRadixHeap::push(unsigned pos, std::uint32_t k)
+{
+	unsigned const b = bucket(k);
+	_keys[pos] = k;
+	_bucket_of[pos] = static_cast<unsigned char>(b);
+	_slot[pos] = static_cast<unsigned>(_buckets[b].size());
+	_buckets[b].push_back(pos);
+}
+
+void IndexRadixHeap::erase(unsigned pos)
+{
+	auto& b = _buckets[_bucket_of[pos]];
+	unsigned const moved = b.back();
+	b[_slot[pos]] = moved;
+	_slot[moved] = _slot[pos];
+	b.pop_back();
+	_bucket_of[pos] = kNone;
+}
+
+void IndexRadixHeap::insert(unsigned pos, float value)
+{
+	if (_count == 0)
+	{
+		_last = 0;
+	}
+	if (in_queue(pos))
+	{
+		erase(pos);
+	}
+	else
+	{
+		_count++;
+	}
+	_valuemap[pos] = value;
+	push(pos, std::max(key(value), _last));
+}
+
+void IndexRadixHeap::make_smaller(unsigned pos, float value)
+{
+	if (!in_queue(pos))
+		return;
+
+	_valuemap[pos] = value;
+	std::uint32_t const k = std::max(key(value), _last);
+	if (k != _keys[pos])
+	{
+		erase(pos);
+		push(pos, k);
+	}
+}
+
+unsigned IndexRadixHeap::pop()
+{
+	if (_count == 0)
+		return _size;
+
+	if (_buckets[0].empty())
+	{
+		// move the first non-empty bucket to lower buckets, relative to its minimum
+		unsigned i = 1;
+		while (_buckets[i].empty())
+			i++;
+		auto& b = _buckets[i];
+		_last = _keys[*std::min_element(b.begin(), b.end(), [this](unsigned l, unsigned r) { return _keys[l] < _keys[r]; })];
+		for (unsigned pos : b)
+		{
+			push(pos, _keys[pos]);
+		}
+		b.clear();
+	}
+
+	unsigned const pos = _buckets[0].back();
+	_buckets[0].pop_back();
+	_bucket_of[pos] = kNone;
+	_count--;
+	return pos;
+}
+
+void IndexRadixHeap::clear()
+{
+	for (auto& b : _buckets)
+	{
+		for (unsigned pos : b)
+			_bucket_of[pos] = kNone;
+		b.clear();
+	}
+	_count = 0;
+	_last = 0;
+}
+
+} // namespace iseg
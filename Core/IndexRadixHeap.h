@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Monotone priority queue over the indices [0, size) with non-negative float values
+ *
+ * Drop-in replacement for IndexPriorityQueue when the popped values never
+ * decrease, as for max or sum path costs. The values are bucketed by the
+ * highest bit in which their IEEE representation differs from the last popped
+ * value, so insert/make_smaller are O(1) and pop is amortized O(32).
+ * Values smaller than the last popped value are treated as equal to it.
+ */
+class ISEG_CORE_API IndexRadixHeap
+{
+public:
+	IndexRadixHeap(unsigned size, float* valuemap);
+
+	unsigned pop();
+	unsigned size() const { return _count; }
+	void insert(unsigned pos, float value);
+	void make_smaller(unsigned pos, float value);
+	bool empty() const { return _count == 0; }
+	void clear();
+	bool in_queue(unsigned pos) const { return _bucket_of[pos] != kNone; }
+
+private:
+	enum { kNone = 0xff,
+		kBuckets = 33 };
+
+	static std::uint32_t key(float value);
+	unsigned bucket(std::uint32_t k) const;
+	void push(unsigned pos, std::uint32_t k);
+	void erase(unsigned pos);
+
+	float* _valuemap;
+	std::vector<std::uint32_t> _keys;
+	std::vector<unsigned char> _bucket_of;
+	std::vector<unsigned> _slot; // position of the index in its bucket
+	std::array<std::vector<unsigned>, kBuckets> _buckets;
+	std::uint32_t _last;
+	unsigned _count;
+	unsigned _size;
+};
+
+} // namespace iseg
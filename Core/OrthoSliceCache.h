@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+namespace iseg {
+
+/** \brief Extracts planes orthogonal to the slices
+ *
+ * A plane x=const holds height values per slice, a plane y=const holds width
+ * values per slice, i.e. plane[z * n + i].
+ *
+ * Reading a column of a slice touches one cache line per value, so planes
+ * x=const are extracted in blocks of kBlock neighbouring planes: each cache line
+ * is read once and filled into all planes of the block. Slices are processed
+ * in parallel.
+ *
+ * Extracted planes are kept in a least-recently-used cache limited by a byte
+ * budget. Modified slices are reported with invalidate and only their rows are
+ * extracted again on the next access.
+ */
+template<typename T>
+class OrthoSliceCache
+{
+public:
+	enum eAxis { kXAxis = 0,
+		kYAxis = 1 };
+
+	/// x=const planes extracted together, 16 floats are one cache line
+	enum { kBlock = 16 };
+
+	explicit OrthoSliceCache(size_t budget = size_t(64) << 20) : _budget(budget), _bytes(0), _width(0), _height(0) {}
+
+	/// Budget in bytes for cached planes, the requested plane is kept even if larger
+	void set_budget(size_t bytes)
+	{
+		_budget = bytes;
+		shrink(0);
+	}
+	size_t budget() const { return _budget; }
+	/// Bytes currently held by the cache
+	size_t bytes() const { return _bytes; }
+	size_t num_planes() const { return _planes.size(); }
+
+	void clear()
+	{
+		_planes.clear();
+		_bytes = 0;
+	}
+
+	/// Slice 'slicenr' was modified
+	void invalidate(size_t slicenr)
+	{
+		for (auto& plane : _planes)
+		{
+			if (slicenr < plane.stale.size())
+				plane.stale[slicenr] = 1;
+		}
+	}
+
+	/** \brief Copy the plane 'coord' along 'axis' into 'result'
+	 *
+	 * 'slices' are the slices of the volume, 'result' holds height (kXAxis) or
+	 * width (kYAxis) values per slice. Slices whose buffer changed since the
+	 * last call are extracted again.
+	 */
+	void get(const std::vector<T*>& slices, unsigned width, unsigned height, eAxis axis, unsigned coord, T* result)
+	{
+		if (width != _width || height != _height || slices.size() != _slices.size())
+		{
+			clear();
+			_width = width;
+			_height = height;
+			_slices = slices;
+		}
+		else
+		{
+			for (size_t z = 0; z < slices.size(); z++)
+			{
+				if (slices[z] != _slices[z])
+				{
+					invalidate(z);
+					_slices[z] = slices[z];
+				}
+			}
+		}
+
+		auto plane = find(axis, coord);
+		if (plane == _planes.end())
+		{
+			extract(axis, coord);
+			plane = find(axis, coord);
+		}
+		else
+		{
+			refresh(*plane);
+		}
+
+		// most recently used first
+		_planes.splice(_planes.begin(), _planes, plane);
+		std::copy(plane->data.begin(), plane->data.end(), result);
+	}
+
+	/// Gather planes x0 ... x0+count-1 of slices [z0, z1)
+	static void extract_x(T* const* slices, unsigned width, unsigned height, std::int64_t z0, std::int64_t z1,
+			unsigned x0, unsigned count, T* const* planes)
+	{
+#pragma omp parallel for
+		for (std::int64_t z = z0; z < z1; z++)
+		{
+			T const* slice = slices[z];
+			size_t const offset = size_t(z) * height;
+			for (unsigned y = 0; y < height; y++)
+			{
+				T const* row = slice + size_t(y) * width + x0;
+				for (unsigned k = 0; k < count; k++)
+				{
+					planes[k][offset + y] = row[k];
+				}
+			}
+		}
+	}
+
+	/// Copy row y of slices [z0, z1), rows are contiguous
+	static void extract_y(T* const* slices, unsigned width, std::int64_t z0, std::int64_t z1, unsigned y, T* plane)
+	{
+#pragma omp parallel for
+		for (std::int64_t z = z0; z < z1; z++)
+		{
+			T const* row = slices[z] + size_t(y) * width;
+			std::copy(row, row + width, plane + size_t(z) * width);
+		}
+	}
+
+private:
+	struct Plane
+	{
+		eAxis axis;
+		unsigned coord;
+		std::vector<T> data;
+		std::vector<unsigned char> stale; // per slice
+	};
+	typedef typename std::list<Plane>::iterator iterator;
+
+	iterator find(eAxis axis, unsigned coord)
+	{
+		return std::find_if(_planes.begin(), _planes.end(), [&](const Plane& p) {
+			return p.axis == axis && p.coord == coord;
+		});
+	}
+
+	size_t plane_size(eAxis axis) const { return size_t(axis == kXAxis ? _height : _width) * _slices.size(); }
+
+	/// Evict least recently used planes until 'extra' bytes fit into the budget
+	void shrink(size_t extra)
+	{
+		while (!_planes.empty() && _bytes + extra > _budget)
+		{
+			_bytes -= _planes.back().data.size() * sizeof(T);
+			_planes.pop_back();
+		}
+	}
+
+	void extract(eAxis axis, unsigned coord)
+	{
+		size_t const n = plane_size(axis);
+		size_t const plane_bytes = n * sizeof(T);
+
+		// planes of the aligned block which are not cached yet
+		std::vector<unsigned> coords;
+		if (axis == kXAxis && kBlock * plane_bytes <= _budget)
+		{
+			unsigned const x0 = coord / kBlock * kBlock;
+			unsigned const x1 = std::min<unsigned>(x0 + kBlock, _width);
+			for (unsigned x = x0; x < x1; x++)
+			{
+				if (x == coord || find(axis, x) == _planes.end())
+					coords.push_back(x);
+			}
+		}
+		else
+		{
+			coords.push_back(coord);
+		}
+
+		shrink(coords.size() * plane_bytes);
+
+		std::vector<T*> data;
+		for (auto c : coords)
+		{
+			Plane plane;
+			plane.axis = axis;
+			plane.coord = c;
+			plane.data.resize(n);
+			plane.stale.assign(_slices.size(), 0);
+			_planes.push_front(std::move(plane));
+			data.push_back(_planes.front().data.data());
+			_bytes += plane_bytes;
+		}
+
+		std::int64_t const nrslices = static_cast<std::int64_t>(_slices.size());
+		if (axis == kXAxis)
+		{
+			// the coordinates are consecutive except where a cached plane was skipped
+			size_t i = 0;
+			while (i < coords.size())
+			{
+				size_t j = i + 1;
+				while (j < coords.size() && coords[j] == coords[j - 1] + 1)
+					j++;
+				extract_x(_slices.data(), _width, _height, 0, nrslices, coords[i], static_cast<unsigned>(j - i), data.data() + i);
+				i = j;
+			}
+		}
+		else
+		{
+			extract_y(_slices.data(), _width, 0, nrslices, coord, data.front());
+		}
+	}
+
+	void refresh(Plane& plane)
+	{
+		T* data = plane.data.data();
+		for (size_t z = 0; z < plane.stale.size(); z++)
+		{
+			if (plane.stale[z])
+			{
+				std::int64_t const z0 = static_cast<std::int64_t>(z);
+				if (plane.axis == kXAxis)
+					extract_x(_slices.data(), _width, _height, z0, z0 + 1, plane.coord, 1, &data);
+				else
+					extract_y(_slices.data(), _width, z0, z0 + 1, plane.coord, data);
+				plane.stale[z] = 0;
+			}
+		}
+	}
+
+	size_t _budget;
+	size_t _bytes;
+	unsigned _width;
+	unsigned _height;
+	std::vector<T*> _slices;
+	std::list<Plane> _planes;
+};
+
+} // namespace iseg
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "SeparableFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	include <xmmintrin.h>
+#	define ISEG_SEPARABLE_SSE
+#endif
+
+namespace iseg { namespace SeparableFilter {
+
+namespace {
+/// Weighted sum of the rows 'rows[l]' at [x0, x1)
+inline void combine_rows(const float* const* rows, const float* kernel, unsigned n, float* out, unsigned x0, unsigned x1)
+{
+	unsigned x = x0;
+#ifdef ISEG_SEPARABLE_SSE
+	for (; x + 4 <= x1; x += 4)
+	{
+		__m128 acc = _mm_setzero_ps();
+		for (unsigned l = 0; l < n; l++)
+		{
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(kernel[l]), _mm_loadu_ps(rows[l] + x)));
+		}
+		_mm_storeu_ps(out + x, acc);
+	}
+#endif
+	for (; x < x1; x++)
+	{
+		float acc = 0;
+		for (unsigned l = 0; l < n; l++)
+		{
+			acc += kernel[l] * rows[l][x];
+		}
+		out[x] = acc;
+	}
+}
+
+/// One step of the recursion along y: cur = B * cur + b1 * p1 + b2 * p2 + b3 * p3
+inline void recurse_rows(float* cur, const float* p1, const float* p2, const float* p3, unsigned width, float B, float b1, float b2, float b3)
+{
+	unsigned x = 0;
+#ifdef ISEG_SEPARABLE_SSE
+	__m128 const vB = _mm_set1_ps(B), v1 = _mm_set1_ps(b1), v2 = _mm_set1_ps(b2), v3 = _mm_set1_ps(b3);
+	for (; x + 4 <= width; x += 4)
+	{
+		__m128 acc = _mm_mul_ps(vB, _mm_loadu_ps(cur + x));
+		acc = _mm_add_ps(acc, _mm_mul_ps(v1, _mm_loadu_ps(p1 + x)));
+		acc = _mm_add_ps(acc, _mm_mul_ps(v2, _mm_loadu_ps(p2 + x)));
+		acc = _mm_add_ps(acc, _mm_mul_ps(v3, _mm_loadu_ps(p3 + x)));
+		_mm_storeu_ps(cur + x, acc);
+	}
+#endif
+	for (; x < width; x++)
+	{
+		cur[x] = B * cur[x] + b1 * p1[x] + b2 * p2[x] + b3 * p3[x];
+	}
+}
+} // namespace
+
+void ConvolveRows(const float* src, float* dst, unsigned width, unsigned height, const float* kernel, unsigned n, eBorder border)
+{
+	int const w = static_cast<int>(width);
+	int const r = static_cast<int>(n / 2);
+	// pixels whose kernel window is inside the row
+	int const x_begin = std::min(r, w);
+	int const x_end = std::max(w - r, x_begin);
+
+	// the taps of pixel x are src[x - r + l], i.e. rows shifted by l
+	std::vector<const float*> taps(n);
+	for (unsigned y = 0; y < height; y++)
+	{
+		const float* in = src + size_t(y) * width;
+		float* out = dst + size_t(y) * width;
+
+		for (unsigned l = 0; l < n; l++)
+		{
+			taps[l] = in + static_cast<int>(l) - r;
+		}
+		combine_rows(taps.data(), kernel, n, out, x_begin, x_end);
+
+		auto border_pixel = [&](int x) {
+			if (border == kClearBorder)
+				return 0.f;
+			float acc = 0;
+			for (unsigned l = 0; l < n; l++)
+			{
+				acc += kernel[l] * in[std::min(std::max(x - r + static_cast<int>(l), 0), w - 1)];
+			}
+			return acc;
+		};
+		for (int x = 0; x < x_begin; x++)
+		{
+			out[x] = border_pixel(x);
+		}
+		for (int x = x_end; x < w; x++)
+		{
+			out[x] = border_pixel(x);
+		}
+	}
+}
+
+void ConvolveColumns(const float* src, float* dst, unsigned width, unsigned height, const float* kernel, unsigned n, eBorder border)
+{
+	int const h = static_cast<int>(height);
+	int const r = static_cast<int>(n / 2);
+
+	std::vector<const float*> rows(n);
+	for (int y = 0; y < h; y++)
+	{
+		float* out = dst + size_t(y) * width;
+		if (border == kClearBorder && (y < r || y + r >= h))
+		{
+			std::fill(out, out + width, 0.f);
+			continue;
+		}
+
+		for (unsigned l = 0; l < n; l++)
+		{
+			int const yl = std::min(std::max(y - r + static_cast<int>(l), 0), h - 1);
+			rows[l] = src + size_t(yl) * width;
+		}
+		combine_rows(rows.data(), kernel, n, out, 0, width);
+	}
+}
+
+void RecursiveGaussian(const float* src, float* dst, unsigned width, unsigned height, float sigma)
+{
+	if (dst != src)
+	{
+		std::copy(src, src + size_t(width) * height, dst);
+	}
+	if (sigma < 0.5f || width == 0 || height == 0)
+	{
+		return;
+	}
+
+	// I.T. Young, L.J. van Vliet, Recursive implementation of the Gaussian filter, 1995
+	double const q = (sigma >= 2.5) ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+	double const q2 = q * q, q3 = q2 * q;
+	double const b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+	float const b1 = static_cast<float>((2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0);
+	float const b2 = static_cast<float>(-(1.4281 * q2 + 1.26661 * q3) / b0);
+	float const b3 = static_cast<float>(0.422205 * q3 / b0);
+	float const B = 1.f - (b1 + b2 + b3);
+
+	// along x, the state is initialized with the border pixel
+	for (unsigned y = 0; y < height; y++)
+	{
+		float* p = dst + size_t(y) * width;
+		float w1 = p[0], w2 = p[0], w3 = p[0];
+		for (unsigned x = 0; x < width; x++)
+		{
+			float const v = B * p[x] + b1 * w1 + b2 * w2 + b3 * w3;
+			w3 = w2;
+			w2 = w1;
+			w1 = p[x] = v;
+		}
+		w1 = w2 = w3 = p[width - 1];
+		for (unsigned x = width; x-- > 0;)
+		{
+			float const v = B * p[x] + b1 * w1 + b2 * w2 + b3 * w3;
+			w3 = w2;
+			w2 = w1;
+			w1 = p[x] = v;
+		}
+	}
+
+	// along y, whole rows at once, rows before the first/after the last repeat the border row
+	auto row = [&](int y) { return dst + size_t(std::min(std::max(y, 0), static_cast<int>(height) - 1)) * width; };
+	for (int y = 0; y < static_cast<int>(height); y++)
+	{
+		recurse_rows(row(y), row(y - 1), row(y - 2), row(y - 3), width, B, b1, b2, b3);
+	}
+	for (int y = static_cast<int>(height) - 1; y >= 0; y--)
+	{
+		recurse_rows(row(y), row(y + 1), row(y + 2), row(y + 3), width, B, b1, b2, b3);
+	}
+}
+
+}} // namespace iseg::SeparableFilter
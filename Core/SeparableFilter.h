@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+namespace iseg {
+
+/** \brief Separable 1D filter passes over a slice stored row by row
+ *
+ * The kernels have an odd number of taps n, the output pixel is aligned with
+ * tap n/2. The passes use SSE if available and run over whole rows, the
+ * column pass combines n rows instead of striding through memory.
+ */
+namespace SeparableFilter {
+
+enum eBorder {
+	kClearBorder, // output pixels whose kernel window leaves the slice are set to 0
+	kReplicate // pixels outside the slice repeat the closest border pixel
+};
+
+/// Filter along x, 'dst' must not overlap 'src'
+ISEG_CORE_API void ConvolveRows(const float* src, float* dst, unsigned width, unsigned height, const float* kernel, unsigned n, eBorder border);
+
+/// Filter along y, 'dst' must not overlap 'src'
+ISEG_CORE_API void ConvolveColumns(const float* src, float* dst, unsigned width, unsigned height, const float* kernel, unsigned n, eBorder border);
+
+/** \brief Recursive Gaussian (Young & van Vliet), cost is independent of sigma
+ *
+ * Borders are replicated. 'dst' may be equal to 'src'.
+ */
+ISEG_CORE_API void RecursiveGaussian(const float* src, float* dst, unsigned width, unsigned height, float sigma);
+
+} // namespace SeparableFilter
+
+} // namespace iseg
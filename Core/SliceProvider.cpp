@@ -10,6 +10,7 @@
 #include "Precompiled.h"
 
 #include "SliceProvider.h"
+#include "VolumeStorage.h"
 
 #include <cstdlib>
 
@@ -19,6 +20,7 @@ SliceProvider::SliceProvider(unsigned area1) { area = area1; }
 
 SliceProvider::~SliceProvider()
 {
+	std::lock_guard<std::mutex> lock(slicestack_mutex);
 	while (!slicestack.empty())
 	{
 		free(slicestack.top());
@@ -28,30 +30,39 @@ SliceProvider::~SliceProvider()
 
 float* SliceProvider::give_me()
 {
-	if (slicestack.empty())
 	{
-		return (float*)malloc(sizeof(float) * area);
-	}
-	else
-	{
-		float* result = slicestack.top();
-		slicestack.pop();
-		return result;
+		std::lock_guard<std::mutex> lock(slicestack_mutex);
+		if (!slicestack.empty())
+		{
+			float* result = slicestack.top();
+			slicestack.pop();
+			return result;
+		}
 	}
+	// allocate outside of lock, malloc is thread-safe
+	return (float*)malloc(sizeof(float) * area);
 }
 
 void SliceProvider::take_back(float* slice)
 {
-	if (slice != nullptr)
+	// slices bound to a VolumeStorage are owned by the slab
+	if (slice != nullptr && !VolumeStorage::owns(slice))
+	{
+		std::lock_guard<std::mutex> lock(slicestack_mutex);
 		slicestack.push(slice);
+	}
 }
 
 void SliceProvider::merge(SliceProvider* sp)
 {
-	if (area == sp->return_area())
+	if (area == sp->return_area() && sp != this)
 	{
+		std::lock_guard<std::mutex> lock(slicestack_mutex);
 		while (!slicestack.empty())
-			sp->take_back(give_me());
+		{
+			sp->take_back(slicestack.top());
+			slicestack.pop();
+		}
 	}
 }
 
@@ -59,6 +70,7 @@ unsigned SliceProvider::return_area() { return area; }
 
 unsigned short SliceProvider::return_nrslices()
 {
+	std::lock_guard<std::mutex> lock(slicestack_mutex);
 	return (unsigned short)slicestack.size();
 }
 
@@ -87,6 +99,7 @@ bool SliceProviderInstaller::unused() { return counter == 0; }
 
 SliceProvider* SliceProviderInstaller::install(unsigned area1)
 {
+	std::lock_guard<std::mutex> lock(splist_mutex);
 	auto it = splist.begin();
 
 	while (it != splist.end() && (it->area != area1))
@@ -110,6 +123,7 @@ SliceProvider* SliceProviderInstaller::install(unsigned area1)
 
 void SliceProviderInstaller::uninstall(SliceProvider* sp)
 {
+	std::lock_guard<std::mutex> lock(splist_mutex);
 	auto it = splist.begin();
 	while (it != splist.end() && (it->area != sp->return_area()))
 		it++;
@@ -13,10 +13,16 @@
 
 #include <cstdlib>
 #include <list>
+#include <mutex>
 #include <stack>
 
 namespace iseg {
 
+/** \brief Pool of slice-sized float buffers
+ *
+ * give_me/take_back are thread-safe, so per-slice filters can borrow scratch
+ * slices from a shared provider inside parallel loops.
+ */
 class ISEG_CORE_API SliceProvider
 {
 public:
@@ -31,6 +37,7 @@ public:
 private:
 	unsigned area;
 	std::stack<float*> slicestack;
+	std::mutex slicestack_mutex;
 };
 
 struct spobj
@@ -56,6 +63,7 @@ private:
 	static SliceProviderInstaller* inst;
 	static unsigned short counter;
 	std::list<spobj> splist;
+	std::mutex splist_mutex;
 	bool delete_unused = true;
 	SliceProviderInstaller(){};
 	SliceProviderInstaller(SliceProviderInstaller const&);
@@ -11,34 +11,17 @@
 
 #include "UndoElem.h"
 
-#include <cstdlib>
 #include <vector>
 
 namespace iseg {
 
 UndoElem::UndoElem()
 {
-	bmp_old = work_old = bmp_new = work_new = nullptr;
-	tissue_old = tissue_new = nullptr;
 	mode1_old = mode1_new = mode2_old = mode2_new = 0;
 	multi = false;
 }
 
-UndoElem::~UndoElem()
-{
-	if (bmp_old != nullptr)
-		free(bmp_old);
-	if (work_old != nullptr)
-		free(work_old);
-	if (tissue_old != nullptr)
-		free(tissue_old);
-	if (bmp_new != nullptr)
-		free(bmp_new);
-	if (work_new != nullptr)
-		free(work_new);
-	if (tissue_new != nullptr)
-		free(tissue_new);
-}
+UndoElem::~UndoElem() {}
 
 void UndoElem::merge(UndoElem* ue)
 {
@@ -46,35 +29,21 @@ void UndoElem::merge(UndoElem* ue)
 	{
 		if (ue->dataSelection.bmp)
 		{
-			if (dataSelection.bmp)
-				free(bmp_new);
-			else
-			{
-				bmp_old = ue->bmp_old;
+			if (!dataSelection.bmp)
 				mode1_old = ue->mode1_old;
-			}
 			mode1_new = ue->mode1_new;
-			bmp_new = ue->bmp_new;
+			bmp.merge(ue->bmp);
 		}
 		if (ue->dataSelection.work)
 		{
-			if (dataSelection.work)
-				free(work_new);
-			else
-			{
-				work_old = ue->work_old;
+			if (!dataSelection.work)
 				mode2_old = ue->mode2_old;
-			}
 			mode2_new = ue->mode2_new;
-			work_new = ue->work_new;
+			work.merge(ue->work);
 		}
 		if (ue->dataSelection.tissues)
 		{
-			if (dataSelection.tissues)
-				free(tissue_new);
-			else
-				tissue_old = ue->tissue_old;
-			tissue_new = ue->tissue_new;
+			tissue.merge(ue->tissue);
 		}
 		if (ue->dataSelection.vvm)
 		{
@@ -108,83 +77,82 @@ void UndoElem::merge(UndoElem* ue)
 		}
 		dataSelection.CombineSelection(ue->dataSelection);
 	}
-	/*	if(bmp_new!=nullptr) free(bmp_new);
-		if(work_new!=nullptr) free(work_new);
-		if(tissue_new!=nullptr) free(tissue_new);
-		bmp_new=ue->bmp_new;
-		work_new=ue->work_new;
-		tissue_new=ue->tissue_new;
-		vvm_new.clear();
-		limits_new.clear();
-		marks_new.clear();
-		vvm_new=ue->vvm_new;
-		limits_new=ue->limits_new;
-		marks_new=ue->marks_new;*/
 }
 
-unsigned UndoElem::arraynr()
+size_t UndoElem::bytes() const
 {
-	unsigned i = 0;
-	const unsigned added = 1;
-
-	if (dataSelection.bmp)
-	{
-		i += added;
-	}
-	if (dataSelection.work)
-	{
-		i += added;
-	}
-	if (dataSelection.tissues)
-	{
-		i += added;
-	}
+	return bmp.bytes() + work.bytes() + tissue.bytes();
+}
 
-	return i;
+size_t UndoElem::disk_bytes() const
+{
+	return bmp.disk_bytes() + work.disk_bytes() + tissue.disk_bytes();
 }
 
-MultiUndoElem::MultiUndoElem() { multi = true; }
+bool UndoElem::spill(UndoScratchFile& file)
+{
+	return bmp.spill(file) && work.spill(file) && tissue.spill(file);
+}
 
-MultiUndoElem::~MultiUndoElem()
+void UndoElem::restore()
 {
-	std::vector<float*>::iterator itf;
-	std::vector<tissues_size_t*>::iterator it8;
-
-	for (itf = vbmp_old.begin(); itf != vbmp_old.end(); itf++)
-		free(*itf);
-	for (itf = vwork_old.begin(); itf != vwork_old.end(); itf++)
-		free(*itf);
-	for (it8 = vtissue_old.begin(); it8 != vtissue_old.end(); it8++)
-		free(*it8);
-	for (itf = vbmp_new.begin(); itf != vbmp_new.end(); itf++)
-		free(*itf);
-	for (itf = vwork_new.begin(); itf != vwork_new.end(); itf++)
-		free(*itf);
-	for (it8 = vtissue_new.begin(); it8 != vtissue_new.end(); it8++)
-		free(*it8);
+	bmp.restore();
+	work.restore();
+	tissue.restore();
 }
 
+MultiUndoElem::MultiUndoElem() { multi = true; }
+
+MultiUndoElem::~MultiUndoElem() {}
+
 void MultiUndoElem::merge(UndoElem* ue) {}
 
-unsigned MultiUndoElem::arraynr()
+size_t MultiUndoElem::bytes() const
 {
-	unsigned i = 0;
-	const unsigned added = 1;
+	size_t n = 0;
+	for (const auto& s : vbmp)
+		n += s.bytes();
+	for (const auto& s : vwork)
+		n += s.bytes();
+	for (const auto& s : vtissue)
+		n += s.bytes();
+	return n;
+}
 
-	if (dataSelection.bmp)
-	{
-		i += added;
-	}
-	if (dataSelection.work)
-	{
-		i += added;
-	}
-	if (dataSelection.tissues)
-	{
-		i += added;
-	}
+size_t MultiUndoElem::disk_bytes() const
+{
+	size_t n = 0;
+	for (const auto& s : vbmp)
+		n += s.disk_bytes();
+	for (const auto& s : vwork)
+		n += s.disk_bytes();
+	for (const auto& s : vtissue)
+		n += s.disk_bytes();
+	return n;
+}
 
-	return i * vslicenr.size();
+bool MultiUndoElem::spill(UndoScratchFile& file)
+{
+	for (auto& s : vbmp)
+		if (!s.spill(file))
+			return false;
+	for (auto& s : vwork)
+		if (!s.spill(file))
+			return false;
+	for (auto& s : vtissue)
+		if (!s.spill(file))
+			return false;
+	return true;
+}
+
+void MultiUndoElem::restore()
+{
+	for (auto& s : vbmp)
+		s.restore();
+	for (auto& s : vwork)
+		s.restore();
+	for (auto& s : vtissue)
+		s.restore();
 }
 
 } // namespace iseg
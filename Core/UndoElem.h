@@ -16,24 +16,30 @@
 #include "Data/Point.h"
 #include "Data/Types.h"
 
+#include "UndoSlice.h"
+
 #include <vector>
 
 namespace iseg {
 
+/** \brief Undo step of a single slice
+ *
+ * Image channels are stored as compressed tile diffs (see UndoSlice), which
+ * hold the state that is not currently in the slice: before undo the old
+ * state, after undo the new state. Older steps can be spilled to disk by the
+ * UndoQueue and must be restored before use.
+ */
 class ISEG_CORE_API UndoElem
 {
 public:
 	bool multi;
 	DataSelection dataSelection;
-	float* bmp_old;
-	float* work_old;
-	tissues_size_t* tissue_old;
+	UndoSlice bmp;
+	UndoSlice work;
+	UndoSlice tissue;
 	std::vector<std::vector<Mark>> vvm_old;
 	std::vector<std::vector<Point>> limits_old;
 	std::vector<Mark> marks_old;
-	float* bmp_new;
-	float* work_new;
-	tissues_size_t* tissue_new;
 	std::vector<std::vector<Mark>> vvm_new;
 	std::vector<std::vector<Point>> limits_new;
 	std::vector<Mark> marks_new;
@@ -44,7 +50,14 @@ public:
 	UndoElem();
 	virtual ~UndoElem();
 	void merge(UndoElem* ue);
-	virtual unsigned arraynr();
+	/// Memory used by the stored image data
+	virtual size_t bytes() const;
+	/// Size of the image data spilled to the scratch file
+	virtual size_t disk_bytes() const;
+	/// Move image data to the scratch file, returns false if it is full
+	virtual bool spill(UndoScratchFile& file);
+	/// Load spilled image data back into memory
+	virtual void restore();
 };
 
 class ISEG_CORE_API MultiUndoElem : public UndoElem
@@ -52,15 +65,12 @@ class ISEG_CORE_API MultiUndoElem : public UndoElem
 public:
 	//abcd vector<unsigned short> vslicenr;
 	std::vector<unsigned> vslicenr;
-	std::vector<float*> vbmp_old;
-	std::vector<float*> vwork_old;
-	std::vector<tissues_size_t*> vtissue_old;
+	std::vector<UndoSlice> vbmp;
+	std::vector<UndoSlice> vwork;
+	std::vector<UndoSlice> vtissue;
 	std::vector<std::vector<std::vector<Mark>>> vvvm_old;
 	std::vector<std::vector<std::vector<Point>>> vlimits_old;
 	std::vector<std::vector<Mark>> vmarks_old;
-	std::vector<float*> vbmp_new;
-	std::vector<float*> vwork_new;
-	std::vector<tissues_size_t*> vtissue_new;
 	std::vector<std::vector<std::vector<Mark>>> vvvm_new;
 	std::vector<std::vector<std::vector<Point>>> vlimits_new;
 	std::vector<std::vector<Mark>> vmarks_new;
@@ -71,7 +81,10 @@ public:
 	MultiUndoElem();
 	virtual ~MultiUndoElem();
 	void merge(UndoElem* ue);
-	virtual unsigned arraynr();
+	size_t bytes() const override;
+	size_t disk_bytes() const override;
+	bool spill(UndoScratchFile& file) override;
+	void restore() override;
 };
 
 } // namespace iseg
@@ -11,13 +11,17 @@
 
 #include "UndoQueue.h"
 
+#include "Data/Logger.h"
+
+#include <algorithm>
+
 namespace iseg {
 
 UndoQueue::UndoQueue()
 {
-	first = nrnow = nrin = nrundoarrays = 0;
+	first = nrnow = nrin = 0;
 	nrundo = 50;
-	nrundoarraysmax = 20;
+	undobytesmax = size_t(512) << 20;
 	undos.resize(nrundo);
 }
 
@@ -27,87 +31,159 @@ UndoQueue::~UndoQueue()
 		delete undos[(first + i) % nrundo];
 }
 
-void UndoQueue::sub_add_undo(UndoElem* ue)
+bool UndoQueue::spill_one(size_t& bytes)
 {
-	if (nrnow == nrundo)
+	// oldest undo steps first, then the redo steps furthest away,
+	// the steps next to the current position stay in memory
+	std::vector<unsigned> order;
+	for (unsigned i = 0; i + 1 < nrnow; i++)
+		order.push_back(i);
+	for (unsigned i = nrin; i > nrnow + 1; i--)
+		order.push_back(i - 1);
+
+	for (auto i : order)
 	{
-		nrundoarrays = (nrundoarrays + ue->arraynr()) - undos[first]->arraynr();
-		delete undos[first];
-		undos[first] = ue;
-		first = (first + 1) % nrundo;
-		while (nrundoarrays > nrundoarraysmax)
+		UndoElem* ue = undos[(first + i) % nrundo];
+		size_t const before = ue->bytes();
+		if (before == 0)
+			continue;
+
+		ue->spill(scratch);
+		size_t const after = ue->bytes();
+		bytes -= before - after;
+		return after < before;
+	}
+	return false;
+}
+
+void UndoQueue::trim(const UndoElem* keep)
+{
+	// sizes change when undo/redo exchange the stored data, so always sum up
+	size_t bytes = return_undobytes();
+
+	while (bytes > undobytesmax || scratch.used() > scratch.capacity())
+	{
+		if (scratch.used() <= scratch.capacity() && spill_one(bytes))
+			continue;
+
+		// drop the oldest step, the steps next to the current position last
+		if (nrnow > 1)
 		{
-			nrundoarrays -= undos[first]->arraynr();
+			bytes -= undos[first]->bytes();
 			delete undos[first];
 			first = (first + 1) % nrundo;
+			nrin--;
 			nrnow--;
 		}
-	}
-	else
-	{
-		nrundoarrays += ue->arraynr();
-
-		for (unsigned i = nrnow; i < nrin; i++)
+		else if (nrin > nrnow + 1)
 		{
-			nrundoarrays -= undos[(first + i) % nrundo]->arraynr();
+			nrin--;
+			bytes -= undos[(first + nrin) % nrundo]->bytes();
+			delete undos[(first + nrin) % nrundo];
+		}
+		else if (nrin > 0)
+		{
+			// a single step exceeds the budgets, e.g. after merging or lowering the
+			// budget. The step just returned by undo/redo is kept until the next call.
+			unsigned i = nrin - 1;
+			if (undos[(first + i) % nrundo] == keep)
+			{
+				if (i == 0)
+					break;
+				i = 0;
+			}
+			ISEG_WARNING_MSG("undo step exceeds the undo memory budget and was dropped");
+			bytes -= undos[(first + i) % nrundo]->bytes();
 			delete undos[(first + i) % nrundo];
+			if (i == 0)
+			{
+				first = (first + 1) % nrundo;
+				nrnow = nrnow > 0 ? nrnow - 1 : 0;
+			}
+			nrin--;
+			nrnow = std::min(nrnow, nrin);
 		}
-		undos[(first + nrnow) % nrundo] = ue;
-		nrnow++;
-
-		while (nrundoarrays > nrundoarraysmax)
+		else
 		{
-			nrundoarrays -= undos[first]->arraynr();
-			delete undos[first];
-			first = (first + 1) % nrundo;
-			nrnow--;
+			break;
 		}
 	}
+
+	if (scratch.used() == 0)
+	{
+		scratch.close();
+	}
+}
+
+void UndoQueue::sub_add_undo(UndoElem* ue)
+{
+	for (unsigned i = nrnow; i < nrin; i++)
+		delete undos[(first + i) % nrundo];
+	nrin = nrnow;
+
+	if (nrnow == nrundo)
+	{
+		delete undos[first];
+		undos[first] = ue;
+		first = (first + 1) % nrundo;
+	}
+	else
+	{
+		undos[(first + nrnow) % nrundo] = ue;
+		nrnow++;
+	}
 	nrin = nrnow;
+
+	trim();
 }
 
 void UndoQueue::merge_undo(UndoElem* ue)
 {
-	if (!ue->multi)
+	UndoElem* last = nrnow > 0 ? undos[(first + nrnow - 1) % nrundo] : nullptr;
+	if (!ue->multi && last != nullptr && !last->multi &&
+			last->dataSelection.sliceNr == ue->dataSelection.sliceNr)
 	{
-		if (nrin > 0)
-		{
-			nrundoarrays -= undos[(first + nrin - 1) % nrundo]->arraynr();
-			undos[(first + nrin - 1) % nrundo]->merge(ue);
-			nrundoarrays += undos[(first + nrin - 1) % nrundo]->arraynr();
-
-			while (nrundoarrays > nrundoarraysmax)
-			{
-				nrundoarrays -= undos[first]->arraynr();
-				delete undos[first];
-				first = (first + 1) % nrundo;
-				nrnow--;
-			}
-		}
+		for (unsigned i = nrnow; i < nrin; i++)
+			delete undos[(first + i) % nrundo];
 		nrin = nrnow;
+
+		last->restore();
+		last->merge(ue);
+		delete ue;
+
+		trim();
+	}
+	else
+	{
+		sub_add_undo(ue);
 	}
 }
 
-void UndoQueue::add_undo(UndoElem* ue) { sub_add_undo(ue); }
-
-bool UndoQueue::add_undo(MultiUndoElem* ue)
+bool UndoQueue::add_undo(UndoElem* ue)
 {
-	if (ue->arraynr() < nrundoarraysmax)
+	// the newest step is never spilled, so it has to fit into memory
+	if (ue->bytes() <= undobytesmax)
 	{
 		sub_add_undo(ue);
 		return true;
 	}
 	else
 	{
+		ISEG_WARNING_MSG("undo step exceeds the undo memory budget");
 		return false;
 	}
 }
 
+bool UndoQueue::add_undo(MultiUndoElem* ue) { return add_undo(static_cast<UndoElem*>(ue)); }
+
 UndoElem* UndoQueue::undo()
 {
 	if (nrnow > 0)
 	{
-		return undos[((--nrnow) + first) % nrundo];
+		UndoElem* ue = undos[((--nrnow) + first) % nrundo];
+		ue->restore();
+		trim(ue);
+		return ue;
 	}
 	else
 		return nullptr;
@@ -117,17 +193,23 @@ UndoElem* UndoQueue::redo()
 {
 	if (nrnow < nrin)
 	{
-		return undos[((nrnow++) + first) % nrundo];
+		UndoElem* ue = undos[((nrnow++) + first) % nrundo];
+		ue->restore();
+		trim(ue);
+		return ue;
 	}
 	else
 		return nullptr;
 }
 
+void UndoQueue::end_exchange(const UndoElem* ue) { trim(ue); }
+
 void UndoQueue::clear_undo()
 {
 	for (unsigned i = 0; i < nrin; i++)
 		delete undos[(first + i) % nrundo];
-	first = nrnow = nrin = nrundoarrays = 0;
+	first = nrnow = nrin = 0;
+	scratch.close();
 	return;
 }
 
@@ -135,31 +217,37 @@ unsigned UndoQueue::return_nrundo() { return nrnow; }
 
 unsigned UndoQueue::return_nrredo() { return nrin - nrnow; }
 
-unsigned UndoQueue::return_nrundoarraysmax() { return nrundoarraysmax; }
-
 unsigned UndoQueue::return_nrundomax() { return nrundo; }
 
-void UndoQueue::set_nrundoarraysmax(unsigned nr)
+size_t UndoQueue::return_undobytesmax() const { return undobytesmax; }
+
+size_t UndoQueue::return_undobytes() const
+{
+	size_t bytes = 0;
+	for (unsigned i = 0; i < nrin; i++)
+		bytes += undos[(first + i) % nrundo]->bytes();
+	return bytes;
+}
+
+void UndoQueue::set_undobytesmax(size_t bytes)
 {
-	if (nrundoarraysmax != nr)
+	if (undobytesmax != bytes)
 	{
-		nrundoarraysmax = nr;
+		undobytesmax = bytes;
+		trim();
+	}
+}
 
-		while (nrundoarrays > nrundoarraysmax && nrnow > 0)
-		{
-			nrundoarrays -= undos[first]->arraynr();
-			delete undos[first];
-			first = (first + 1) % nrundo;
-			nrin--;
-			nrnow--;
-		}
+size_t UndoQueue::return_diskbytesmax() const { return scratch.capacity(); }
 
-		while (nrundoarrays > nrundoarraysmax && nrin > 0)
-		{
-			nrin--;
-			nrundoarrays -= undos[(first + nrin) % nrundo]->arraynr();
-			delete undos[(first + nrin) % nrundo];
-		}
+size_t UndoQueue::return_diskbytes() const { return scratch.used(); }
+
+void UndoQueue::set_diskbytesmax(size_t bytes)
+{
+	if (scratch.capacity() != bytes)
+	{
+		scratch.set_capacity(bytes);
+		trim();
 	}
 }
 
@@ -169,7 +257,6 @@ void UndoQueue::set_nrundo(unsigned nr)
 	{
 		while (nrin > nr && nrnow > 0)
 		{
-			nrundoarrays -= undos[first]->arraynr();
 			delete undos[first];
 			first = (first + 1) % nrundo;
 			nrnow--;
@@ -179,7 +266,6 @@ void UndoQueue::set_nrundo(unsigned nr)
 		while (nrin > nr)
 		{
 			nrin--;
-			nrundoarrays -= undos[(first + nrin) % nrundo]->arraynr();
 			delete undos[(first + nrin) % nrundo];
 		}
 
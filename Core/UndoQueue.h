@@ -12,33 +12,58 @@
 #include "iSegCore.h"
 
 #include "UndoElem.h"
+#include "UndoScratchFile.h"
 
 namespace iseg {
 
+/** \brief Ring buffer of undo steps
+ *
+ * The number of steps and the memory used by the stored image data are bounded.
+ * If a disk budget is set, steps exceeding the memory budget are spilled to a
+ * scratch file (oldest first) and loaded back on undo/redo. Only when both
+ * budgets are exhausted, the oldest steps are dropped, the steps next to the
+ * current position last.
+ */
 class ISEG_CORE_API UndoQueue
 {
 public:
 	UndoQueue();
 	~UndoQueue();
-	void add_undo(UndoElem* ue);
+	/// Returns false (and does not take ownership) if ue exceeds the memory budget
+	bool add_undo(UndoElem* ue);
+	/// Merge into the last step, takes ownership of ue. The step is dropped if it exceeds the memory budget.
 	void merge_undo(UndoElem* ue);
+	/// Returns false (and does not take ownership) if ue exceeds the memory budget
 	bool add_undo(MultiUndoElem* ue);
 	UndoElem* undo();
 	UndoElem* redo();
+	/// Call after exchanging the data of the step returned by undo/redo, which changes its size. Spills or drops other steps until the budgets are met.
+	void end_exchange(const UndoElem* ue);
 	void clear_undo();
 	unsigned return_nrredo();
 	unsigned return_nrundo();
-	unsigned return_nrundoarraysmax();
 	unsigned return_nrundomax();
-	void set_nrundoarraysmax(unsigned nr);
+	/// Memory budget in bytes
+	size_t return_undobytesmax() const;
+	/// Memory currently used by undo and redo steps
+	size_t return_undobytes() const;
+	void set_undobytesmax(size_t bytes);
+	/// Disk budget in bytes, 0 disables spilling
+	size_t return_diskbytesmax() const;
+	/// Disk space currently used by spilled steps
+	size_t return_diskbytes() const;
+	void set_diskbytesmax(size_t bytes);
 	void set_nrundo(unsigned nr);
 	void reverse_undosliceorder(unsigned short nrslices);
 
 private:
 	unsigned nrundo;
-	unsigned nrundoarraysmax;
+	size_t undobytesmax;
 	void sub_add_undo(UndoElem* ue);
-	unsigned nrundoarrays;
+	/// Spills or drops steps until the budgets are met, never drops 'keep'
+	void trim(const UndoElem* keep = nullptr);
+	bool spill_one(size_t& bytes);
+	UndoScratchFile scratch;
 	std::vector<UndoElem*> undos;
 	unsigned first;
 	unsigned nrnow;
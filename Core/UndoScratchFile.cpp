@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "UndoScratchFile.h"
+
+#include "Data/Logger.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace fs = boost::filesystem;
+namespace bip = boost::interprocess;
+
+namespace iseg {
+
+namespace {
+// grow the file in steps of at least 64MB to limit remapping
+const size_t kGrowSize = size_t(64) << 20;
+} // namespace
+
+struct UndoScratchFile::Mapping
+{
+	bip::file_mapping file;
+	bip::mapped_region region;
+};
+
+UndoScratchFile::UndoScratchFile()
+		: _capacity(0), _used(0), _end(0), _file_size(0)
+{
+}
+
+UndoScratchFile::~UndoScratchFile() { close(); }
+
+void UndoScratchFile::close()
+{
+	_mapping.reset();
+	if (!_path.empty())
+	{
+		boost::system::error_code ec;
+		fs::remove(_path, ec);
+		_path.clear();
+	}
+	_used = _end = _file_size = 0;
+	_free.clear();
+}
+
+bool UndoScratchFile::grow(size_t file_size)
+{
+	try
+	{
+		if (_path.empty())
+		{
+			_path = (fs::temp_directory_path() / fs::unique_path("iSeg-undo-%%%%-%%%%-%%%%.tmp")).string();
+			std::ofstream create(_path.c_str(), std::ios::binary);
+		}
+
+		// the file cannot be resized while it is mapped
+		_mapping.reset();
+		fs::resize_file(_path, file_size);
+
+		std::unique_ptr<Mapping> mapping(new Mapping);
+		mapping->file = bip::file_mapping(_path.c_str(), bip::read_write);
+		mapping->region = bip::mapped_region(mapping->file, bip::read_write);
+		_mapping = std::move(mapping);
+		_file_size = file_size;
+		return true;
+	}
+	catch (std::exception& e)
+	{
+		ISEG_ERROR("Undo scratch file: " << e.what());
+		_mapping.reset();
+		return false;
+	}
+}
+
+bool UndoScratchFile::allocate(size_t size, size_t& offset)
+{
+	if (size == 0 || _used + size > _capacity)
+		return false;
+
+	// first fit in released blocks
+	for (auto it = _free.begin(); it != _free.end(); ++it)
+	{
+		if (it->second >= size)
+		{
+			offset = it->first;
+			if (it->second > size)
+				_free[offset + size] = it->second - size;
+			_free.erase(it);
+			_used += size;
+			return true;
+		}
+	}
+
+	if (_end + size > _file_size || !_mapping)
+	{
+		size_t const file_size = std::min(std::max(_end + size, _file_size + kGrowSize), std::max(_capacity, _end + size));
+		if (!grow(file_size))
+			return false;
+	}
+
+	offset = _end;
+	_end += size;
+	_used += size;
+	return true;
+}
+
+void UndoScratchFile::release(size_t offset, size_t size)
+{
+	if (size == 0)
+		return;
+	_used -= size;
+
+	auto it = _free.insert(std::make_pair(offset, size)).first;
+	auto next = std::next(it);
+	if (next != _free.end() && it->first + it->second == next->first)
+	{
+		it->second += next->second;
+		_free.erase(next);
+	}
+	if (it != _free.begin())
+	{
+		auto prev = std::prev(it);
+		if (prev->first + prev->second == it->first)
+		{
+			prev->second += it->second;
+			_free.erase(it);
+			it = prev;
+		}
+	}
+	// the last block is returned to the unused tail of the file
+	if (it->first + it->second == _end)
+	{
+		_end = it->first;
+		_free.erase(it);
+	}
+}
+
+unsigned char* UndoScratchFile::data(size_t offset)
+{
+	return static_cast<unsigned char*>(_mapping->region.get_address()) + offset;
+}
+
+} // namespace iseg
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace iseg {
+
+/** \brief Memory-mapped temporary file holding undo data spilled from RAM
+ *
+ * The file is created in the temp directory on first use, grows in chunks up to
+ * the capacity (disk budget) and is removed in the destructor. Blocks are
+ * addressed by offset, pointers returned by data() are invalidated by allocate().
+ */
+class ISEG_CORE_API UndoScratchFile
+{
+public:
+	UndoScratchFile();
+	~UndoScratchFile();
+
+	/// Disk budget in bytes, 0 disables spilling
+	void set_capacity(size_t bytes) { _capacity = bytes; }
+	size_t capacity() const { return _capacity; }
+	/// Bytes currently allocated
+	size_t used() const { return _used; }
+
+	/// Reserve a block of 'size' bytes, returns false if the budget is exhausted or the file could not be mapped
+	bool allocate(size_t size, size_t& offset);
+	void release(size_t offset, size_t size);
+
+	unsigned char* data(size_t offset);
+
+	/// Unmap and remove the file, all blocks must have been released
+	void close();
+
+private:
+	UndoScratchFile(const UndoScratchFile&) = delete;
+	UndoScratchFile& operator=(const UndoScratchFile&) = delete;
+
+	bool grow(size_t file_size);
+
+	struct Mapping;
+	std::unique_ptr<Mapping> _mapping;
+	std::string _path;
+	size_t _capacity;
+	size_t _used;
+	size_t _end;
+	size_t _file_size;
+	std::map<size_t, size_t> _free; // offset -> size
+};
+
+} // namespace iseg
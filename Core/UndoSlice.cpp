@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "UndoSlice.h"
+#include "UndoScratchFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace iseg {
+
+namespace {
+// run: [uint16 count][element]
+typedef std::uint16_t run_count_t;
+} // namespace
+
+UndoSlice::UndoSlice()
+		: _size(0), _element_size(0), _bytes(0), _file(nullptr), _file_offset(0)
+{
+}
+
+UndoSlice::UndoSlice(UndoSlice&& other)
+		: _size(other._size), _element_size(other._element_size), _bytes(other._bytes), _tiles(std::move(other._tiles)), _file(other._file), _file_offset(other._file_offset)
+{
+	other._tiles.clear();
+	other._file = nullptr;
+	other.clear();
+}
+
+UndoSlice& UndoSlice::operator=(UndoSlice&& other)
+{
+	if (this != &other)
+	{
+		clear();
+		std::swap(_size, other._size);
+		std::swap(_element_size, other._element_size);
+		std::swap(_bytes, other._bytes);
+		std::swap(_file, other._file);
+		std::swap(_file_offset, other._file_offset);
+		_tiles.swap(other._tiles);
+	}
+	return *this;
+}
+
+UndoSlice::~UndoSlice() { clear(); }
+
+void UndoSlice::clear()
+{
+	if (_file)
+	{
+		_file->release(_file_offset, _bytes);
+		_file = nullptr;
+	}
+	_tiles.clear();
+	_size = 0;
+	_bytes = 0;
+}
+
+size_t UndoSlice::tile_length(size_t index) const
+{
+	return std::min<size_t>(kTileSize, _size - index * kTileSize);
+}
+
+void UndoSlice::encode(const unsigned char* src, size_t n, size_t element_size, Tile& tile)
+{
+	size_t const raw_size = n * element_size;
+	size_t const run_size = sizeof(run_count_t) + element_size;
+
+	tile.data.clear();
+	tile.data.reserve(raw_size);
+	tile.rle = true;
+
+	size_t i = 0;
+	while (i < n)
+	{
+		const unsigned char* value = src + i * element_size;
+		size_t j = i + 1;
+		while (j < n && std::memcmp(src + j * element_size, value, element_size) == 0)
+			j++;
+
+		if (tile.data.size() + run_size > raw_size)
+		{
+			// incompressible, store raw
+			tile.rle = false;
+			tile.data.assign(src, src + raw_size);
+			break;
+		}
+
+		run_count_t count = static_cast<run_count_t>(j - i);
+		size_t const pos = tile.data.size();
+		tile.data.resize(pos + run_size);
+		std::memcpy(&tile.data[pos], &count, sizeof(run_count_t));
+		std::memcpy(&tile.data[pos + sizeof(run_count_t)], value, element_size);
+		i = j;
+	}
+	tile.data.shrink_to_fit();
+	tile.size = tile.data.size();
+}
+
+void UndoSlice::decode(const Tile& tile, size_t n, size_t element_size, unsigned char* dst)
+{
+	if (!tile.rle)
+	{
+		std::memcpy(dst, tile.data.data(), n * element_size);
+		return;
+	}
+
+	size_t const run_size = sizeof(run_count_t) + element_size;
+	for (size_t pos = 0; pos + run_size <= tile.data.size(); pos += run_size)
+	{
+		run_count_t count;
+		std::memcpy(&count, &tile.data[pos], sizeof(run_count_t));
+		const unsigned char* value = &tile.data[pos + sizeof(run_count_t)];
+		for (run_count_t k = 0; k < count; k++, dst += element_size)
+			std::memcpy(dst, value, element_size);
+	}
+}
+
+void UndoSlice::snapshot_bytes(const void* data, size_t n, size_t element_size)
+{
+	clear();
+	_size = n;
+	_element_size = element_size;
+
+	auto src = static_cast<const unsigned char*>(data);
+	size_t const nr_tiles = (n + kTileSize - 1) / kTileSize;
+	_tiles.resize(nr_tiles);
+	for (size_t t = 0; t < nr_tiles; t++)
+	{
+		_tiles[t].index = t;
+		encode(src + t * kTileSize * element_size, tile_length(t), element_size, _tiles[t]);
+		_bytes += _tiles[t].size;
+	}
+}
+
+void UndoSlice::prune_bytes(const void* data, size_t element_size)
+{
+	auto src = static_cast<const unsigned char*>(data);
+	std::vector<unsigned char> buffer(kTileSize * element_size);
+
+	auto unchanged = [&](const Tile& tile) {
+		size_t const n = tile_length(tile.index);
+		decode(tile, n, element_size, buffer.data());
+		return std::memcmp(buffer.data(), src + tile.index * kTileSize * element_size, n * element_size) == 0;
+	};
+	_tiles.erase(std::remove_if(_tiles.begin(), _tiles.end(), unchanged), _tiles.end());
+
+	_bytes = 0;
+	for (const auto& tile : _tiles)
+		_bytes += tile.size;
+}
+
+void UndoSlice::exchange_bytes(void* data, size_t element_size)
+{
+	auto dst = static_cast<unsigned char*>(data);
+	Tile current;
+
+	_bytes = 0;
+	for (auto& tile : _tiles)
+	{
+		size_t const n = tile_length(tile.index);
+		unsigned char* p = dst + tile.index * kTileSize * element_size;
+		current.index = tile.index;
+		encode(p, n, element_size, current);
+		decode(tile, n, element_size, p);
+		std::swap(tile.rle, current.rle);
+		std::swap(tile.size, current.size);
+		tile.data.swap(current.data);
+		_bytes += tile.size;
+	}
+}
+
+void UndoSlice::merge(UndoSlice& later)
+{
+	if (later.empty())
+		return;
+	if (empty())
+	{
+		std::swap(_size, later._size);
+		std::swap(_element_size, later._element_size);
+		std::swap(_bytes, later._bytes);
+		_tiles.swap(later._tiles);
+		later.clear();
+		return;
+	}
+
+	// both tile lists are sorted by index
+	std::vector<Tile> tiles;
+	tiles.reserve(_tiles.size() + later._tiles.size());
+	auto a = _tiles.begin();
+	auto b = later._tiles.begin();
+	while (a != _tiles.end() || b != later._tiles.end())
+	{
+		if (b == later._tiles.end() || (a != _tiles.end() && a->index <= b->index))
+		{
+			if (b != later._tiles.end() && b->index == a->index)
+				++b;
+			tiles.push_back(std::move(*a++));
+		}
+		else
+		{
+			_bytes += b->size;
+			tiles.push_back(std::move(*b++));
+		}
+	}
+	_tiles.swap(tiles);
+	later.clear();
+}
+
+bool UndoSlice::spill(UndoScratchFile& file)
+{
+	if (_file || _bytes == 0)
+		return true;
+
+	size_t offset;
+	if (!file.allocate(_bytes, offset))
+		return false;
+
+	unsigned char* dst = file.data(offset);
+	for (auto& tile : _tiles)
+	{
+		std::memcpy(dst, tile.data.data(), tile.size);
+		dst += tile.size;
+		std::vector<unsigned char>().swap(tile.data);
+	}
+	_file = &file;
+	_file_offset = offset;
+	return true;
+}
+
+void UndoSlice::restore()
+{
+	if (_file == nullptr)
+		return;
+
+	const unsigned char* src = _file->data(_file_offset);
+	for (auto& tile : _tiles)
+	{
+		tile.data.assign(src, src + tile.size);
+		src += tile.size;
+	}
+	_file->release(_file_offset, _bytes);
+	_file = nullptr;
+}
+
+} // namespace iseg
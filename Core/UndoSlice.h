@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace iseg {
+
+class UndoScratchFile;
+
+/** \brief Compressed, sparse undo payload of one slice channel
+ *
+ * The slice is split into tiles of kTileSize elements. At the start of an
+ * operation all tiles are stored run-length encoded (snapshot), at the end
+ * the tiles which the operation did not modify are dropped (prune), i.e.
+ * they are shared with the live slice. Undo and redo are the same operation:
+ * the stored tiles are exchanged with the corresponding tiles of the slice.
+ *
+ * The tiles can be moved to an UndoScratchFile (spill) and must be loaded
+ * back (restore) before any other operation.
+ */
+class ISEG_CORE_API UndoSlice
+{
+public:
+	enum { kTileSize = 4096 };
+
+	UndoSlice();
+	UndoSlice(UndoSlice&& other);
+	UndoSlice& operator=(UndoSlice&& other);
+	~UndoSlice();
+
+	/// Store all tiles of 'data' (n elements)
+	template<typename T>
+	void snapshot(const T* data, size_t n)
+	{
+		snapshot_bytes(data, n, sizeof(T));
+	}
+
+	/// Drop tiles which are identical in 'data'
+	template<typename T>
+	void prune(const T* data)
+	{
+		prune_bytes(data, sizeof(T));
+	}
+
+	/// Exchange stored tiles with the corresponding tiles of 'data'
+	template<typename T>
+	void exchange(T* data)
+	{
+		exchange_bytes(data, sizeof(T));
+	}
+
+	/** \brief Combine with the payload of a subsequent operation on the same slice
+	 *
+	 * Tiles stored in this object take precedence, since they hold the older state.
+	 */
+	void merge(UndoSlice& later);
+
+	/// Move the tiles to the scratch file, returns false if it is full
+	bool spill(UndoScratchFile& file);
+	/// Load spilled tiles back into memory
+	void restore();
+	bool spilled() const { return _file != nullptr; }
+
+	void clear();
+	bool empty() const { return _tiles.empty(); }
+	size_t num_tiles() const { return _tiles.size(); }
+	/// Memory used by the stored tiles
+	size_t bytes() const { return _file ? 0 : _bytes; }
+	/// Size of the tiles in the scratch file
+	size_t disk_bytes() const { return _file ? _bytes : 0; }
+
+private:
+	UndoSlice(const UndoSlice&) = delete;
+	UndoSlice& operator=(const UndoSlice&) = delete;
+
+	struct Tile
+	{
+		size_t index;
+		bool rle;
+		size_t size; // encoded size, data is empty while spilled
+		std::vector<unsigned char> data;
+	};
+
+	void snapshot_bytes(const void* data, size_t n, size_t element_size);
+	void prune_bytes(const void* data, size_t element_size);
+	void exchange_bytes(void* data, size_t element_size);
+
+	size_t tile_length(size_t index) const;
+	static void encode(const unsigned char* src, size_t n, size_t element_size, Tile& tile);
+	static void decode(const Tile& tile, size_t n, size_t element_size, unsigned char* dst);
+
+	size_t _size;
+	size_t _element_size;
+	size_t _bytes;
+	std::vector<Tile> _tiles;
+	UndoScratchFile* _file;
+	size_t _file_offset;
+};
+
+} // namespace iseg
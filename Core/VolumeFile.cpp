@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "VolumeFile.h"
+
+#include "Data/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace iseg {
+
+namespace {
+const char kMagic[8] = {'i', 'S', 'e', 'g', 'V', 'O', 'L', '\0'};
+
+std::uint64_t align(std::uint64_t offset)
+{
+	return (offset + VolumeFile::kAlignment - 1) / VolumeFile::kAlignment * VolumeFile::kAlignment;
+}
+
+void pad(std::ostream& out, std::uint64_t offset)
+{
+	static const char zeros[VolumeFile::kAlignment] = {0};
+	std::uint64_t const pos = static_cast<std::uint64_t>(out.tellp());
+	if (offset > pos)
+		out.write(zeros, static_cast<std::streamsize>(offset - pos));
+}
+
+template<typename T>
+void write_slab(std::ostream& out, T* const* slices, unsigned short nrslices, size_t slice_size)
+{
+	for (unsigned short k = 0; k < nrslices && out; k++)
+	{
+		out.write(reinterpret_cast<const char*>(slices[k]), slice_size * sizeof(T));
+	}
+}
+} // namespace
+
+VolumeFile::Header VolumeFile::make_header(unsigned short width, unsigned short height, unsigned short nrslices)
+{
+	Header header;
+	std::memset(&header, 0, sizeof(Header));
+	std::memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = kVersion;
+	header.tissue_size = sizeof(tissues_size_t);
+	header.width = width;
+	header.height = height;
+	header.nrslices = nrslices;
+	header.flags = kComplete;
+
+	std::uint64_t const n = std::uint64_t(width) * height * nrslices;
+	header.source_offset = align(sizeof(Header));
+	header.target_offset = align(header.source_offset + n * sizeof(float));
+	header.tissue_offset = align(header.target_offset + n * sizeof(float));
+	header.file_size = header.tissue_offset + n * sizeof(tissues_size_t);
+	return header;
+}
+
+bool VolumeFile::read_header(const std::string& file_name, Header& header)
+{
+	std::ifstream in(file_name.c_str(), std::ios::binary);
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(Header)))
+	{
+		ISEG_ERROR("cannot read " << file_name);
+		return false;
+	}
+	if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+	{
+		ISEG_ERROR(file_name << " is not an iSEG volume file");
+		return false;
+	}
+	if (header.version > kVersion)
+	{
+		ISEG_ERROR(file_name << " was written by a newer version of iSEG");
+		return false;
+	}
+	if (header.tissue_size != sizeof(tissues_size_t))
+	{
+		ISEG_ERROR(file_name << " uses " << 8 * header.tissue_size << " bit tissue labels, expected " << 8 * sizeof(tissues_size_t));
+		return false;
+	}
+
+	in.seekg(0, std::ios::end);
+	if (static_cast<std::uint64_t>(in.tellg()) < header.file_size)
+	{
+		ISEG_ERROR(file_name << " is truncated");
+		return false;
+	}
+	return true;
+}
+
+bool VolumeFile::create(const std::string& file_name, unsigned short width, unsigned short height, unsigned short nrslices)
+{
+	Header header = make_header(width, height, nrslices);
+	header.flags = 0;
+
+	std::ofstream out(file_name.c_str(), std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	if (header.file_size > sizeof(Header))
+	{
+		// extend the file without writing the slabs
+		out.seekp(static_cast<std::streamoff>(header.file_size - 1));
+		out.put('\0');
+	}
+	out.close();
+
+	if (!out)
+	{
+		ISEG_ERROR("creating " << file_name);
+		return false;
+	}
+	return true;
+}
+
+bool VolumeFile::set_complete(const std::string& file_name)
+{
+	Header header;
+	if (!read_header(file_name, header))
+		return false;
+
+	header.flags |= kComplete;
+	std::fstream out(file_name.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	out.close();
+	return !out.fail();
+}
+
+bool VolumeFile::write(const std::string& file_name, unsigned short width, unsigned short height, unsigned short nrslices,
+		float* const* source, float* const* target, tissues_size_t* const* tissues)
+{
+	Header const header = make_header(width, height, nrslices);
+	size_t const slice_size = size_t(width) * height;
+
+	std::ofstream out(file_name.c_str(), std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	pad(out, header.source_offset);
+	write_slab(out, source, nrslices, slice_size);
+	pad(out, header.target_offset);
+	write_slab(out, target, nrslices, slice_size);
+	pad(out, header.tissue_offset);
+	write_slab(out, tissues, nrslices, slice_size);
+	out.close();
+
+	if (!out)
+	{
+		ISEG_ERROR("writing " << file_name);
+		return false;
+	}
+	return true;
+}
+
+bool VolumeFile::update(const std::string& file_name, unsigned short width, unsigned short height, unsigned short nrslices,
+		float* const* source, float* const* target, tissues_size_t* const* tissues,
+		const std::vector<unsigned char>& dirty)
+{
+	Header header;
+	if (!read_header(file_name, header))
+		return false;
+	if (header.width != width || header.height != height || header.nrslices != nrslices || dirty.size() < nrslices)
+	{
+		ISEG_ERROR("cannot update " << file_name << ": dimensions differ");
+		return false;
+	}
+
+	size_t const slice_size = size_t(width) * height;
+	std::fstream out(file_name.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+	for (unsigned short k = 0; k < nrslices && out; k++)
+	{
+		if (dirty[k] & kSource)
+		{
+			out.seekp(static_cast<std::streamoff>(header.source_offset + k * slice_size * sizeof(float)));
+			out.write(reinterpret_cast<const char*>(source[k]), slice_size * sizeof(float));
+		}
+		if (dirty[k] & kTarget)
+		{
+			out.seekp(static_cast<std::streamoff>(header.target_offset + k * slice_size * sizeof(float)));
+			out.write(reinterpret_cast<const char*>(target[k]), slice_size * sizeof(float));
+		}
+		if (dirty[k] & kTissue)
+		{
+			out.seekp(static_cast<std::streamoff>(header.tissue_offset + k * slice_size * sizeof(tissues_size_t)));
+			out.write(reinterpret_cast<const char*>(tissues[k]), slice_size * sizeof(tissues_size_t));
+		}
+	}
+	out.close();
+
+	if (!out)
+	{
+		ISEG_ERROR("updating " << file_name);
+		return false;
+	}
+	return true;
+}
+
+bool VolumeFile::update(const std::string& file_name, const VolumeSnapshot& snapshot)
+{
+	return update(file_name, snapshot.width(), snapshot.height(), snapshot.num_slices(),
+			snapshot.source(), snapshot.target(), snapshot.tissues(), snapshot.dirty());
+}
+
+VolumeSnapshot::VolumeSnapshot() : _width(0), _height(0), _nrslices(0), _size_in_bytes(0) {}
+
+VolumeSnapshot::~VolumeSnapshot() { release(); }
+
+void VolumeSnapshot::release()
+{
+	for (auto p : _source)
+		delete[] p;
+	for (auto p : _target)
+		delete[] p;
+	for (auto p : _tissues)
+		delete[] p;
+	_source.clear();
+	_target.clear();
+	_tissues.clear();
+	_dirty.clear();
+	_size_in_bytes = 0;
+}
+
+void VolumeSnapshot::reset(unsigned short width, unsigned short height, unsigned short nrslices)
+{
+	release();
+	_width = width;
+	_height = height;
+	_nrslices = nrslices;
+	_dirty.assign(nrslices, 0);
+	_source.assign(nrslices, nullptr);
+	_target.assign(nrslices, nullptr);
+	_tissues.assign(nrslices, nullptr);
+}
+
+void VolumeSnapshot::add(unsigned short slicenr, unsigned char channels, const float* source, const float* target, const tissues_size_t* tissues)
+{
+	if (slicenr >= _nrslices)
+		return;
+
+	size_t const n = size_t(_width) * _height;
+	if ((channels & VolumeFile::kSource) && !_source[slicenr])
+	{
+		_source[slicenr] = new float[n];
+		std::copy(source, source + n, _source[slicenr]);
+		_size_in_bytes += n * sizeof(float);
+	}
+	if ((channels & VolumeFile::kTarget) && !_target[slicenr])
+	{
+		_target[slicenr] = new float[n];
+		std::copy(target, target + n, _target[slicenr]);
+		_size_in_bytes += n * sizeof(float);
+	}
+	if ((channels & VolumeFile::kTissue) && !_tissues[slicenr])
+	{
+		_tissues[slicenr] = new tissues_size_t[n];
+		std::copy(tissues, tissues + n, _tissues[slicenr]);
+		_size_in_bytes += n * sizeof(tissues_size_t);
+	}
+	_dirty[slicenr] |= channels;
+}
+
+} // namespace iseg
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include "Data/Types.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace iseg {
+
+class VolumeSnapshot;
+
+/** \brief Native image container of a project (*.isv)
+ *
+ * The file starts with a fixed header, followed by the source, target and
+ * tissue slabs. Each slab starts at a multiple of kAlignment and holds the
+ * slices consecutively, i.e. the layout matches VolumeStorage and the file can
+ * be mapped and used in place (see VolumeStorage::map).
+ *
+ * Since slices are at fixed offsets, modified slices can be overwritten without
+ * rewriting the file (see update).
+ */
+class ISEG_CORE_API VolumeFile
+{
+public:
+	enum { kVersion = 1,
+		kAlignment = 4096 };
+
+	/// Channels of a slice, combined as bit mask
+	enum eChannel { kSource = 1,
+		kTarget = 2,
+		kTissue = 4,
+		kAllChannels = 7 };
+
+	enum eFlags { kComplete = 1 }; // all slices have been written
+
+	struct Header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t tissue_size; // sizeof(tissues_size_t)
+		std::uint16_t width;
+		std::uint16_t height;
+		std::uint16_t nrslices;
+		std::uint16_t flags; // eFlags
+		std::uint64_t source_offset;
+		std::uint64_t target_offset;
+		std::uint64_t tissue_offset;
+		std::uint64_t file_size;
+	};
+
+	/// Header for a volume of the given size, with slab offsets
+	static Header make_header(unsigned short width, unsigned short height, unsigned short nrslices);
+
+	/// Read and validate the header
+	static bool read_header(const std::string& file_name, Header& header);
+
+	/// Create a file of the right size, slices are written later with update
+	static bool create(const std::string& file_name, unsigned short width, unsigned short height, unsigned short nrslices);
+
+	/// Mark a file created with 'create' as holding all slices
+	static bool set_complete(const std::string& file_name);
+
+	/// Write all slices to a new file
+	static bool write(const std::string& file_name, unsigned short width, unsigned short height, unsigned short nrslices,
+			float* const* source, float* const* target, tissues_size_t* const* tissues);
+
+	/** \brief Overwrite modified slices of an existing file
+	 *
+	 * dirty[k] is a combination of eChannel flags for slice k. The file must
+	 * have the same dimensions.
+	 */
+	static bool update(const std::string& file_name, unsigned short width, unsigned short height, unsigned short nrslices,
+			float* const* source, float* const* target, tissues_size_t* const* tissues,
+			const std::vector<unsigned char>& dirty);
+
+	/// Overwrite the slices held by 'snapshot'
+	static bool update(const std::string& file_name, const VolumeSnapshot& snapshot);
+};
+
+/** \brief Copies of modified slices
+ *
+ * Used to write slices from a background thread while the slices themselves
+ * can be modified, see VolumeFile::update.
+ */
+class ISEG_CORE_API VolumeSnapshot
+{
+public:
+	VolumeSnapshot();
+	~VolumeSnapshot();
+
+	void reset(unsigned short width, unsigned short height, unsigned short nrslices);
+	/// Copy the channels (VolumeFile::eChannel flags) of slice 'slicenr'
+	void add(unsigned short slicenr, unsigned char channels, const float* source, const float* target, const tissues_size_t* tissues);
+
+	bool empty() const { return _size_in_bytes == 0; }
+	size_t size_in_bytes() const { return _size_in_bytes; }
+
+	unsigned short width() const { return _width; }
+	unsigned short height() const { return _height; }
+	unsigned short num_slices() const { return _nrslices; }
+	const std::vector<unsigned char>& dirty() const { return _dirty; }
+	float* const* source() const { return _source.data(); }
+	float* const* target() const { return _target.data(); }
+	tissues_size_t* const* tissues() const { return _tissues.data(); }
+
+private:
+	VolumeSnapshot(const VolumeSnapshot&) = delete;
+	VolumeSnapshot& operator=(const VolumeSnapshot&) = delete;
+
+	void release();
+
+	unsigned short _width;
+	unsigned short _height;
+	unsigned short _nrslices;
+	size_t _size_in_bytes;
+	std::vector<unsigned char> _dirty;
+	std::vector<float*> _source;
+	std::vector<float*> _target;
+	std::vector<tissues_size_t*> _tissues;
+};
+
+} // namespace iseg
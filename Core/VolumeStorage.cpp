@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "VolumeFile.h"
+#include "VolumeStorage.h"
+
+#include "Data/Logger.h"
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace bip = boost::interprocess;
+
+namespace iseg {
+
+namespace {
+// address ranges [begin, end) of all live slabs, a free slot has begin == 0.
+// Writers are serialized by _slab_mutex, owns() reads the table without locking.
+struct SlabRange
+{
+	std::atomic<std::uintptr_t> begin;
+	std::atomic<std::uintptr_t> end;
+};
+enum { kMaxSlabs = 256 };
+SlabRange _slab_ranges[kMaxSlabs];
+std::atomic<int> _slab_slots(0); // slots [0, _slab_slots) have been used
+std::mutex _slab_mutex;
+
+bool register_slab(const void* p, size_t size)
+{
+	auto begin = reinterpret_cast<std::uintptr_t>(p);
+	std::lock_guard<std::mutex> lock(_slab_mutex);
+	for (int i = 0; i < kMaxSlabs; i++)
+	{
+		if (_slab_ranges[i].begin.load(std::memory_order_relaxed) == 0)
+		{
+			// publish end before begin, readers only look at end of a non-free slot
+			_slab_ranges[i].end.store(begin + size, std::memory_order_relaxed);
+			_slab_ranges[i].begin.store(begin, std::memory_order_release);
+			if (i >= _slab_slots.load(std::memory_order_relaxed))
+			{
+				_slab_slots.store(i + 1, std::memory_order_release);
+			}
+			return true;
+		}
+	}
+	ISEG_ERROR_MSG("too many volume slabs");
+	return false;
+}
+
+void unregister_slab(const void* p)
+{
+	auto begin = reinterpret_cast<std::uintptr_t>(p);
+	std::lock_guard<std::mutex> lock(_slab_mutex);
+	for (int i = 0; i < _slab_slots.load(std::memory_order_relaxed); i++)
+	{
+		if (_slab_ranges[i].begin.load(std::memory_order_relaxed) == begin)
+		{
+			_slab_ranges[i].begin.store(0, std::memory_order_release);
+			_slab_ranges[i].end.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+template<typename T>
+T* allocate_slab(size_t n)
+{
+	size_t const bytes = std::max<size_t>(n * sizeof(T), 1);
+	T* slab = static_cast<T*>(aligned_malloc(bytes, VolumeStorage::kAlignment));
+	if (slab && !register_slab(slab, bytes))
+	{
+		aligned_free(slab);
+		slab = nullptr;
+	}
+	return slab;
+}
+
+template<typename T>
+void free_slab(T*& slab)
+{
+	if (slab)
+	{
+		unregister_slab(slab);
+		aligned_free(slab);
+		slab = nullptr;
+	}
+}
+} // namespace
+
+void* aligned_malloc(size_t size, size_t alignment)
+{
+	// over-allocate and store the original pointer in front of the aligned block
+	void* raw = malloc(size + alignment + sizeof(void*));
+	if (raw == nullptr)
+		return nullptr;
+
+	auto base = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+	auto aligned = (base + alignment - 1) & ~(std::uintptr_t(alignment) - 1);
+	reinterpret_cast<void**>(aligned)[-1] = raw;
+	return reinterpret_cast<void*>(aligned);
+}
+
+void aligned_free(void* p)
+{
+	if (p != nullptr)
+	{
+		free(reinterpret_cast<void**>(p)[-1]);
+	}
+}
+
+struct VolumeStorage::Mapping
+{
+	bip::file_mapping file;
+	bip::mapped_region region;
+};
+
+VolumeStorage::VolumeStorage()
+		: _width(0), _height(0), _nrslices(0), _source(nullptr), _target(nullptr), _tissues(nullptr)
+{
+}
+
+VolumeStorage::~VolumeStorage() { release(); }
+
+bool VolumeStorage::allocate(unsigned short width, unsigned short height, unsigned short nrslices)
+{
+	release();
+
+	size_t const n = size_t(width) * height * nrslices;
+	_source = allocate_slab<float>(n);
+	_target = allocate_slab<float>(n);
+	_tissues = allocate_slab<tissues_size_t>(n);
+	if (_source == nullptr || _target == nullptr || _tissues == nullptr)
+	{
+		release();
+		return false;
+	}
+
+	_width = width;
+	_height = height;
+	_nrslices = nrslices;
+	return true;
+}
+
+bool VolumeStorage::map(const std::string& file_name)
+{
+	release();
+
+	VolumeFile::Header header;
+	if (!VolumeFile::read_header(file_name, header))
+		return false;
+
+	std::unique_ptr<Mapping> mapping(new Mapping);
+	try
+	{
+		mapping->file = bip::file_mapping(file_name.c_str(), bip::read_only);
+		mapping->region = bip::mapped_region(mapping->file, bip::copy_on_write, 0, static_cast<size_t>(header.file_size));
+	}
+	catch (std::exception& e)
+	{
+		ISEG_ERROR("cannot map " << file_name << ": " << e.what());
+		return false;
+	}
+
+	auto base = static_cast<char*>(mapping->region.get_address());
+	size_t const n = size_t(header.width) * header.height * header.nrslices;
+	_source = reinterpret_cast<float*>(base + header.source_offset);
+	_target = reinterpret_cast<float*>(base + header.target_offset);
+	_tissues = reinterpret_cast<tissues_size_t*>(base + header.tissue_offset);
+	_mapping = std::move(mapping);
+	if (!register_slab(_source, std::max<size_t>(n * sizeof(float), 1)) ||
+			!register_slab(_target, std::max<size_t>(n * sizeof(float), 1)) ||
+			!register_slab(_tissues, std::max<size_t>(n * sizeof(tissues_size_t), 1)))
+	{
+		release();
+		return false;
+	}
+
+	_file_name = file_name;
+	_width = header.width;
+	_height = header.height;
+	_nrslices = header.nrslices;
+	return true;
+}
+
+void VolumeStorage::release()
+{
+	if (_mapping)
+	{
+		for (const void* slab : {static_cast<const void*>(_source), static_cast<const void*>(_target), static_cast<const void*>(_tissues)})
+		{
+			unregister_slab(slab);
+		}
+		_source = _target = nullptr;
+		_tissues = nullptr;
+		_mapping.reset();
+		_file_name.clear();
+	}
+	free_slab(_source);
+	free_slab(_target);
+	free_slab(_tissues);
+	_width = _height = _nrslices = 0;
+}
+
+size_t VolumeStorage::size_in_bytes() const
+{
+	return slice_size() * _nrslices * (2 * sizeof(float) + sizeof(tissues_size_t));
+}
+
+bool VolumeStorage::contains(const void* p) const
+{
+	auto in_slab = [p, this](const void* slab, size_t element_size) {
+		auto addr = reinterpret_cast<std::uintptr_t>(p);
+		auto begin = reinterpret_cast<std::uintptr_t>(slab);
+		return slab && addr >= begin && addr < begin + element_size * slice_size() * _nrslices;
+	};
+	return in_slab(_source, sizeof(float)) || in_slab(_target, sizeof(float)) || in_slab(_tissues, sizeof(tissues_size_t));
+}
+
+bool VolumeStorage::owns(const void* p)
+{
+	auto addr = reinterpret_cast<std::uintptr_t>(p);
+	int const slots = _slab_slots.load(std::memory_order_acquire);
+	for (int i = 0; i < slots; i++)
+	{
+		auto begin = _slab_ranges[i].begin.load(std::memory_order_acquire);
+		if (begin != 0 && addr >= begin && addr < _slab_ranges[i].end.load(std::memory_order_relaxed))
+			return true;
+	}
+	return false;
+}
+
+} // namespace iseg
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "iSegCore.h"
+
+#include "Data/Types.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace iseg {
+
+/// Allocate memory aligned to 'alignment' bytes (must be a power of two)
+ISEG_CORE_API void* aligned_malloc(size_t size, size_t alignment);
+/// Release memory allocated with aligned_malloc
+ISEG_CORE_API void aligned_free(void* p);
+
+/** \brief Volume-contiguous storage for source, target and tissue channels
+ *
+ * Each channel is a single 64-byte aligned slab of width*height*nrslices elements,
+ * slice k starting at slab + k*width*height. bmphandler slices can be bound to
+ * these slabs (see bmphandler::bind_storage), i.e. they become views into the
+ * volume and ITK, HDF5 or SIMD code can operate on the slab without copying.
+ *
+ * Memory owned by a slab is never returned to a SliceProvider or freed by a
+ * slice, see VolumeStorage::owns.
+ *
+ * Instead of allocating, the slabs can be mapped from a VolumeFile (copy on
+ * write). Pages are read when first accessed and modifications are not written
+ * back to the file.
+ */
+class ISEG_CORE_API VolumeStorage
+{
+public:
+	enum { kAlignment = 64 };
+
+	VolumeStorage();
+	~VolumeStorage();
+
+	/// Allocate slabs, returns false if memory could not be allocated
+	bool allocate(unsigned short width, unsigned short height, unsigned short nrslices);
+	/// Map the slabs of a VolumeFile, returns false if the file is invalid or cannot be mapped
+	bool map(const std::string& file_name);
+	void release();
+
+	bool is_mapped() const { return _mapping != nullptr; }
+	/// File the slabs are mapped from, empty if allocated
+	const std::string& file_name() const { return _file_name; }
+
+	bool empty() const { return _source == nullptr; }
+	unsigned short width() const { return _width; }
+	unsigned short height() const { return _height; }
+	unsigned short num_slices() const { return _nrslices; }
+	size_t slice_size() const { return size_t(_width) * _height; }
+	size_t size_in_bytes() const;
+
+	float* source(unsigned short slice = 0) { return _source + slice * slice_size(); }
+	float* target(unsigned short slice = 0) { return _target + slice * slice_size(); }
+	tissues_size_t* tissues(unsigned short slice = 0) { return _tissues + slice * slice_size(); }
+
+	/// True if p points into one of the slabs of this storage
+	bool contains(const void* p) const;
+	/// True if p points into a slab of any live VolumeStorage, does not lock
+	static bool owns(const void* p);
+
+	/// True if slices[k] == slices[0] + k*slice_size for all k
+	template<typename T>
+	static bool is_contiguous(T* const* slices, size_t nrslices, size_t slice_size)
+	{
+		for (size_t k = 1; k < nrslices; k++)
+		{
+			if (slices[k] != slices[0] + k * slice_size)
+				return false;
+		}
+		return nrslices > 0;
+	}
+
+private:
+	VolumeStorage(const VolumeStorage&) = delete;
+	VolumeStorage& operator=(const VolumeStorage&) = delete;
+
+	struct Mapping;
+	std::unique_ptr<Mapping> _mapping;
+	std::string _file_name;
+
+	unsigned short _width;
+	unsigned short _height;
+	unsigned short _nrslices;
+	float* _source;
+	float* _target;
+	tissues_size_t* _tissues;
+};
+
+} // namespace iseg
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../ComponentLabeling.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+/// Flood fill labeling, numbered in raster order of the first voxel
+std::vector<unsigned> naive_labels(const std::vector<std::vector<unsigned char>>& volume, int w, int h, ComponentLabeling::eConnectivity connectivity)
+{
+	int const d = static_cast<int>(volume.size());
+	int const max_nonzero = connectivity == ComponentLabeling::kFaces ? 1 : (connectivity == ComponentLabeling::kEdges ? 2 : 3);
+	std::vector<unsigned> labels(size_t(w) * h * d, unsigned(-1));
+	unsigned next = 0;
+	for (int start = 0; start < w * h * d; start++)
+	{
+		if (labels[start] != unsigned(-1))
+			continue;
+		std::vector<int> stack(1, start);
+		labels[start] = next;
+		while (!stack.empty())
+		{
+			int const p = stack.back();
+			stack.pop_back();
+			int const x = p % w, y = (p / w) % h, z = p / (w * h);
+			for (int dz = -1; dz <= 1; dz++)
+				for (int dy = -1; dy <= 1; dy++)
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int const nonzero = std::abs(dx) + std::abs(dy) + std::abs(dz);
+						int const nx = x + dx, ny = y + dy, nz = z + dz;
+						if (nonzero == 0 || nonzero > max_nonzero || nx < 0 || ny < 0 || nz < 0 || nx >= w || ny >= h || nz >= d)
+							continue;
+						int const q = (nz * h + ny) * w + nx;
+						if (labels[q] == unsigned(-1) && volume[nz][ny * w + nx] == volume[z][y * w + x])
+						{
+							labels[q] = next;
+							stack.push_back(q);
+						}
+					}
+		}
+		next++;
+	}
+	return labels;
+}
+
+void check_labels(const std::vector<std::vector<unsigned char>>& volume, int w, int h, ComponentLabeling::eConnectivity connectivity)
+{
+	std::vector<const unsigned char*> slices;
+	for (auto& slice : volume)
+	{
+		slices.push_back(slice.data());
+	}
+	ComponentLabeling labeling(slices, w, h, connectivity, [](unsigned char v) { return v; });
+
+	auto expected = naive_labels(volume, w, h, connectivity);
+	std::vector<unsigned> labels(expected.size());
+	for (unsigned short z = 0; z < volume.size(); z++)
+	{
+		labeling.write_slice(z, labels.data() + size_t(z) * w * h, [](unsigned l) { return l; });
+	}
+	BOOST_REQUIRE(labels == expected);
+
+	std::vector<std::size_t> sizes(labeling.number_of_components(), 0);
+	for (unsigned l : expected)
+	{
+		sizes[l]++;
+	}
+	for (unsigned l = 0; l < labeling.number_of_components(); l++)
+	{
+		auto const& c = labeling.component(l);
+		BOOST_CHECK_EQUAL(c.size, sizes[l]);
+		BOOST_CHECK_EQUAL(expected[size_t(c.slice) * w * h + c.offset], l);
+	}
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(ComponentLabeling_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/ComponentLabeling_suite --log_level=message
+BOOST_AUTO_TEST_CASE(MatchesFloodFill)
+{
+	std::mt19937 gen(11);
+	std::bernoulli_distribution dist(0.45);
+	auto random_volume = [&](int w, int h, int d) {
+		std::vector<std::vector<unsigned char>> volume(d, std::vector<unsigned char>(w * h));
+		for (auto& slice : volume)
+			for (auto& v : slice)
+				v = dist(gen) ? 1 : 0;
+		return volume;
+	};
+
+	// a single slice with more rows than a block
+	auto slice = random_volume(23, 150, 1);
+	auto volume = random_volume(13, 11, 9);
+	for (auto connectivity : {ComponentLabeling::kFaces, ComponentLabeling::kEdges, ComponentLabeling::kVertices})
+	{
+		check_labels(slice, 23, 150, connectivity);
+		check_labels(volume, 13, 11, connectivity);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Statistics)
+{
+	// a hole in a ring, and an island touching the border
+	unsigned short const w = 6, h = 5;
+	unsigned char const image[] = {
+			0, 0, 0, 0, 0, 1,
+			0, 1, 1, 1, 0, 0,
+			0, 1, 0, 1, 0, 0,
+			0, 1, 1, 1, 0, 0,
+			0, 0, 0, 0, 0, 0};
+	ComponentLabeling labeling(image, w, h, ComponentLabeling::kFaces, [](unsigned char v) { return v != 0; });
+	BOOST_REQUIRE_EQUAL(labeling.number_of_components(), 4);
+
+	auto const& background = labeling.component(0);
+	BOOST_CHECK_EQUAL(background.size, 20);
+	BOOST_CHECK(background.at_border);
+
+	auto const& island = labeling.component(1);
+	BOOST_CHECK_EQUAL(island.size, 1);
+	BOOST_CHECK(island.at_border);
+
+	auto const& ring = labeling.component(2);
+	BOOST_CHECK_EQUAL(ring.size, 8);
+	BOOST_CHECK(!ring.at_border);
+	BOOST_CHECK_EQUAL(ring.min[0], 1);
+	BOOST_CHECK_EQUAL(ring.max[0], 3);
+	BOOST_CHECK_EQUAL(ring.min[1], 1);
+	BOOST_CHECK_EQUAL(ring.max[1], 3);
+
+	auto const& hole = labeling.component(3);
+	BOOST_CHECK_EQUAL(hole.size, 1);
+	BOOST_CHECK_EQUAL(hole.offset, 2 * w + 2);
+	BOOST_CHECK(!hole.at_border);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
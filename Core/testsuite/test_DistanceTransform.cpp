@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../DistanceTransform.h"
+
+#include <random>
+#include <vector>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(DistanceTransform_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/DistanceTransform_suite --log_level=message
+BOOST_AUTO_TEST_CASE(SquaredDistance2D)
+{
+	unsigned const width = 37, height = 29;
+	float const dx = 0.5f, dy = 1.5f;
+	std::vector<float> f(width * height, DistanceTransform::kInfinity);
+	std::vector<unsigned> features;
+	std::mt19937 gen(3);
+	std::uniform_int_distribution<unsigned> dist(0, width * height - 1);
+	for (int i = 0; i < 12; i++)
+	{
+		unsigned const pos = dist(gen);
+		f[pos] = 0.f;
+		features.push_back(pos);
+	}
+
+	std::vector<unsigned> nearest(f.size());
+	DistanceTransform::SquaredDistance2D(f.data(), width, height, dx, dy, nearest.data());
+
+	for (unsigned pos = 0; pos < width * height; pos++)
+	{
+		auto d2 = [&](unsigned q) {
+			float const ex = (float(pos % width) - float(q % width)) * dx;
+			float const ey = (float(pos / width) - float(q / width)) * dy;
+			return ex * ex + ey * ey;
+		};
+		float expected = DistanceTransform::kInfinity;
+		for (unsigned q : features)
+		{
+			expected = std::min(expected, d2(q));
+		}
+		BOOST_CHECK_CLOSE(f[pos] + 1.f, expected + 1.f, 1e-3);
+		BOOST_REQUIRE_LT(nearest[pos], width * height);
+		BOOST_CHECK_CLOSE(d2(nearest[pos]) + 1.f, expected + 1.f, 1e-3);
+	}
+
+	// without features the input is left unchanged
+	std::fill(f.begin(), f.end(), DistanceTransform::kInfinity);
+	DistanceTransform::SquaredDistance2D(f.data(), width, height, dx, dy, nearest.data());
+	BOOST_CHECK(f == std::vector<float>(width * height, DistanceTransform::kInfinity));
+	BOOST_CHECK(nearest == std::vector<unsigned>(width * height, width * height));
+}
+
+BOOST_AUTO_TEST_CASE(SquaredDistance3D)
+{
+	unsigned const width = 11, height = 9, depth = 7;
+	float const dx = 1.f, dy = 0.8f, dz = 2.5f;
+	std::vector<std::vector<float>> volume(depth, std::vector<float>(width * height, DistanceTransform::kInfinity));
+	volume[1][4 * width + 2] = 0.f;
+	volume[5][7 * width + 9] = 0.f;
+	volume[6][0] = 0.f;
+
+	std::vector<float*> slices;
+	for (auto& slice : volume)
+	{
+		slices.push_back(slice.data());
+	}
+	DistanceTransform::SquaredDistance3D(slices, width, height, dx, dy, dz);
+
+	for (unsigned z = 0; z < depth; z++)
+	{
+		for (unsigned y = 0; y < height; y++)
+		{
+			for (unsigned x = 0; x < width; x++)
+			{
+				auto d2 = [&](float fx, float fy, float fz) {
+					return (x - fx) * (x - fx) * dx * dx + (y - fy) * (y - fy) * dy * dy + (z - fz) * (z - fz) * dz * dz;
+				};
+				float const expected = std::min(std::min(d2(2, 4, 1), d2(9, 7, 5)), d2(0, 0, 6));
+				BOOST_CHECK_CLOSE(volume[z][y * width + x] + 1.f, expected + 1.f, 1e-3);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SquaredDistance3DSlabs)
+{
+	unsigned const width = 13, height = 10, depth = 75;
+	float const dx = 0.5f, dy = 0.7f, dz = 0.3f, max_d2 = 1.f;
+	std::mt19937 gen(5);
+	std::bernoulli_distribution dist(0.01);
+	std::vector<std::vector<unsigned char>> features(depth, std::vector<unsigned char>(width * height));
+	std::vector<std::vector<float>> expected(depth, std::vector<float>(width * height));
+	std::vector<float*> slices;
+	for (unsigned z = 0; z < depth; z++)
+	{
+		for (unsigned i = 0; i < width * height; i++)
+		{
+			features[z][i] = dist(gen) ? 1 : 0;
+			expected[z][i] = features[z][i] ? 0.f : DistanceTransform::kInfinity;
+		}
+		slices.push_back(expected[z].data());
+	}
+	DistanceTransform::SquaredDistance3D(slices, width, height, dx, dy, dz);
+
+	// slices are visited in parallel, check the results afterwards
+	std::vector<int> visits(depth, 0);
+	std::vector<std::vector<float>> result(depth);
+	DistanceTransform::SquaredDistance3DSlabs(depth, width, height, dx, dy, dz, max_d2, [&](unsigned z, unsigned i) { return features[z][i] != 0; }, [&](unsigned z, const float* d2) {
+		visits[z]++;
+		result[z].assign(d2, d2 + width * height);
+		// modifying the visited slice must not change the result
+		std::fill(features[z].begin(), features[z].end(), 1);
+	});
+	for (unsigned z = 0; z < depth; z++)
+	{
+		BOOST_REQUIRE_EQUAL(result[z].size(), width * height);
+		for (unsigned i = 0; i < width * height; i++)
+		{
+			if (expected[z][i] <= max_d2)
+				BOOST_CHECK_CLOSE(result[z][i] + 1.f, expected[z][i] + 1.f, 1e-3);
+			else
+				BOOST_CHECK_GT(result[z][i], max_d2);
+		}
+	}
+	BOOST_CHECK(visits == std::vector<int>(depth, 1));
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
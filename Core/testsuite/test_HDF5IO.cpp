@@ -166,5 +166,52 @@ BOOST_AUTO_TEST_CASE(IO_Performance)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(WriteVolume)
+{
+	size_t const slice_size = 3000;
+	size_t const num_slices = 37;
+
+	std::vector<std::vector<unsigned short>> data(num_slices, std::vector<unsigned short>(slice_size));
+	std::vector<unsigned short*> slices;
+	for (size_t k = 0; k < num_slices; k++)
+	{
+		for (size_t i = 0; i < slice_size; i++)
+			data[k][i] = static_cast<unsigned short>((k * 7 + i / 100) % 11);
+		slices.push_back(data[k].data());
+	}
+
+	std::vector<std::vector<unsigned short>> result(num_slices, std::vector<unsigned short>(slice_size, 0));
+	std::vector<unsigned short*> result_slices;
+	for (size_t k = 0; k < num_slices; k++)
+		result_slices.push_back(result[k].data());
+
+	for (int compression : {0, 1})
+	{
+		std::string fname = (fs::temp_directory_path() / fs::path("foo.h5")).string();
+
+		iseg::HDF5IO io(compression);
+		auto fid = io.create(fname, false);
+		BOOST_REQUIRE(fid >= 0);
+
+		// 37 slices in chunks of 4 slices, i.e. last chunk is partial
+		BOOST_CHECK(io.writeVolume(fid, "Tissue", slices.data(), num_slices, slice_size, 4));
+		BOOST_CHECK(io.close(fid));
+
+		fid = io.open(fname);
+		BOOST_REQUIRE(fid >= 0);
+		BOOST_CHECK(io.readData(fid, "Tissue", result_slices.data(), num_slices, slice_size));
+		BOOST_CHECK(result == data);
+
+		// single slice access
+		std::vector<unsigned short> slice(slice_size);
+		BOOST_CHECK(io.readData(fid, "Tissue", 36 * slice_size, slice_size, slice.data()));
+		BOOST_CHECK(slice == data[36]);
+		BOOST_CHECK(io.close(fid));
+
+		boost::system::error_code ec;
+		fs::remove(fname, ec);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 BOOST_AUTO_TEST_SUITE_END();
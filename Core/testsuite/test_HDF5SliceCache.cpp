@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../HDF5IO.h"
+#include "../HDF5SliceCache.h"
+
+#include <boost/filesystem.hpp>
+
+#include <string>
+#include <vector>
+
+namespace fs = boost::filesystem;
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(HDF5SliceCache_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/HDF5SliceCache_suite --log_level=message
+BOOST_AUTO_TEST_CASE(ReadOnDemand)
+{
+	boost::system::error_code ec;
+	std::string fname = (fs::temp_directory_path() / fs::unique_path("iseg-cache-%%%%-%%%%.h5")).string();
+
+	size_t const slice_size = 100;
+	size_t const num_slices = 10;
+	std::vector<std::vector<float>> source(num_slices, std::vector<float>(slice_size));
+	std::vector<std::vector<tissues_size_t>> tissue(num_slices, std::vector<tissues_size_t>(slice_size));
+	std::vector<float*> source_slices;
+	std::vector<tissues_size_t*> tissue_slices;
+	for (size_t k = 0; k < num_slices; k++)
+	{
+		for (size_t i = 0; i < slice_size; i++)
+		{
+			source[k][i] = static_cast<float>(k * slice_size + i);
+			tissue[k][i] = static_cast<tissues_size_t>(k);
+		}
+		source_slices.push_back(source[k].data());
+		tissue_slices.push_back(tissue[k].data());
+	}
+
+	{
+		HDF5IO io(1);
+		auto fid = io.create(fname, false);
+		BOOST_REQUIRE(fid >= 0);
+		BOOST_REQUIRE(io.writeVolume(fid, "/Source", source_slices.data(), num_slices, slice_size, 4));
+		BOOST_REQUIRE(io.writeVolume(fid, "/Tissue", tissue_slices.data(), num_slices, slice_size, 4));
+		BOOST_CHECK(io.close(fid));
+	}
+
+	{
+		HDF5SliceCache cache;
+		BOOST_REQUIRE(cache.open(fname, num_slices, slice_size, "/Source", "/Target", "/Tissue"));
+		BOOST_CHECK(cache.has(HDF5SliceCache::kSource));
+		BOOST_CHECK(!cache.has(HDF5SliceCache::kTarget));
+		BOOST_CHECK(cache.has(HDF5SliceCache::kTissue));
+
+		// one block of 4 slices per channel
+		std::vector<float> s(slice_size), t(slice_size, -1.f);
+		std::vector<tissues_size_t> l(slice_size);
+		BOOST_CHECK(cache.read(5, s.data(), t.data(), l.data()));
+		BOOST_CHECK(s == source[5]);
+		BOOST_CHECK(l == tissue[5]);
+		BOOST_CHECK(t == std::vector<float>(slice_size, -1.f));
+		size_t const block_bytes = 4 * slice_size * (sizeof(float) + sizeof(tissues_size_t));
+		BOOST_CHECK_EQUAL(cache.bytes(), block_bytes);
+
+		BOOST_CHECK(cache.read(6, s.data(), nullptr, l.data()));
+		BOOST_CHECK(s == source[6]);
+		BOOST_CHECK_EQUAL(cache.bytes(), block_bytes);
+
+		// last (partial) block, least recently used blocks are evicted
+		cache.set_budget(block_bytes);
+		BOOST_CHECK(cache.read(9, s.data(), nullptr, l.data()));
+		BOOST_CHECK(s == source[9]);
+		BOOST_CHECK(l == tissue[9]);
+		BOOST_CHECK_LE(cache.bytes(), block_bytes);
+
+		BOOST_CHECK(!cache.read(num_slices, s.data(), nullptr, nullptr));
+	}
+
+	fs::remove(fname, ec);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
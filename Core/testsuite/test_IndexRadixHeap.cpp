@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../ImageForestingTransform.h"
+#include "../IndexRadixHeap.h"
+
+#include <random>
+#include <vector>
+
+namespace iseg {
+
+namespace {
+template<typename Queue>
+class MinimaxForest : public ImageForestingTransform<float, Queue>
+{
+	using ImageForestingTransform<float, Queue>::pf;
+	using ImageForestingTransform<float, Queue>::E_bits;
+
+	float compute_pf(unsigned p, unsigned q, float /* direction */) override
+	{
+		return std::max(pf[p], std::abs(E_bits[p] - E_bits[q]));
+	}
+};
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(IndexRadixHeap_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/IndexRadixHeap_suite --log_level=message
+BOOST_AUTO_TEST_CASE(PopOrder)
+{
+	unsigned const size = 1000;
+	std::vector<float> values(size);
+	IndexRadixHeap heap(size, values.data());
+
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<float> dist(0.f, 100.f);
+	for (unsigned i = 0; i < size; i += 2)
+	{
+		heap.insert(i, dist(gen));
+	}
+	BOOST_CHECK_EQUAL(heap.size(), size / 2);
+	BOOST_CHECK(heap.in_queue(10));
+	BOOST_CHECK(!heap.in_queue(11));
+	heap.make_smaller(10, 0.5f);
+	BOOST_CHECK_EQUAL(values[10], 0.5f);
+
+	// values are popped in increasing order, also when inserting values not below the last popped one
+	float last = 0.f;
+	unsigned popped = 0;
+	while (!heap.empty())
+	{
+		unsigned const pos = heap.pop();
+		BOOST_CHECK(!heap.in_queue(pos));
+		BOOST_CHECK_GE(values[pos], last);
+		last = values[pos];
+		if (++popped % 10 == 0 && pos + 1 < size && !heap.in_queue(pos + 1) && pos % 2 == 0)
+		{
+			heap.insert(pos + 1, last + dist(gen));
+		}
+	}
+	BOOST_CHECK_EQUAL(heap.pop(), size);
+
+	// a cleared heap starts again from 0
+	heap.insert(3, 50.f);
+	heap.insert(4, 60.f);
+	heap.pop();
+	heap.clear();
+	BOOST_CHECK(heap.empty());
+	BOOST_CHECK(!heap.in_queue(4));
+	heap.insert(5, 1.f);
+	heap.insert(6, 0.f);
+	BOOST_CHECK_EQUAL(heap.pop(), 6);
+	BOOST_CHECK_EQUAL(heap.pop(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(ForestMatchesBinaryHeap)
+{
+	unsigned short const width = 64, height = 48;
+	unsigned const area = unsigned(width) * height;
+	std::vector<float> image(area), seeds(area, 0.f);
+	std::mt19937 gen(7);
+	std::uniform_int_distribution<int> dist(0, 255);
+	for (auto& v : image)
+	{
+		v = static_cast<float>(dist(gen));
+	}
+	seeds[5 * width + 7] = 1.f;
+	seeds[40 * width + 50] = 2.f;
+
+	MinimaxForest<IndexPriorityQueue> heap_forest;
+	MinimaxForest<IndexRadixHeap> radix_forest;
+	for (int run = 0; run < 2; run++)
+	{
+		heap_forest.IFTinit(width, height, image.data(), image.data(), seeds.data(), run == 1);
+		radix_forest.IFTinit(width, height, image.data(), image.data(), seeds.data(), run == 1);
+
+		// the minimax path cost is unique, the labels may differ on ties
+		std::vector<float> expected(heap_forest.return_pf(), heap_forest.return_pf() + area);
+		std::vector<float> actual(radix_forest.return_pf(), radix_forest.return_pf() + area);
+		BOOST_CHECK(expected == actual);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
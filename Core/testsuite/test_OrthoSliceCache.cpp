@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../OrthoSliceCache.h"
+
+#include <vector>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(OrthoSliceCache_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/OrthoSliceCache_suite --log_level=message
+BOOST_AUTO_TEST_CASE(ExtractPlanes)
+{
+	unsigned const width = 37, height = 11, nrslices = 5;
+	std::vector<std::vector<float>> volume(nrslices, std::vector<float>(width * height));
+	std::vector<float*> slices;
+	for (unsigned z = 0; z < nrslices; z++)
+	{
+		for (unsigned i = 0; i < width * height; i++)
+		{
+			volume[z][i] = static_cast<float>(z * width * height + i);
+		}
+		slices.push_back(volume[z].data());
+	}
+
+	auto expected_x = [&](unsigned x) {
+		std::vector<float> plane;
+		for (unsigned z = 0; z < nrslices; z++)
+			for (unsigned y = 0; y < height; y++)
+				plane.push_back(volume[z][y * width + x]);
+		return plane;
+	};
+	auto expected_y = [&](unsigned y) {
+		std::vector<float> plane;
+		for (unsigned z = 0; z < nrslices; z++)
+			for (unsigned x = 0; x < width; x++)
+				plane.push_back(volume[z][y * width + x]);
+		return plane;
+	};
+
+	OrthoSliceCache<float> cache;
+	std::vector<float> px(height * nrslices), py(width * nrslices);
+
+	// a block of neighbouring planes is extracted, including the last partial block
+	cache.get(slices, width, height, OrthoSliceCache<float>::kXAxis, 20, px.data());
+	BOOST_CHECK(px == expected_x(20));
+	BOOST_CHECK_EQUAL(cache.num_planes(), size_t(OrthoSliceCache<float>::kBlock));
+	cache.get(slices, width, height, OrthoSliceCache<float>::kXAxis, 36, px.data());
+	BOOST_CHECK(px == expected_x(36));
+	BOOST_CHECK_EQUAL(cache.num_planes(), size_t(OrthoSliceCache<float>::kBlock + 5));
+
+	cache.get(slices, width, height, OrthoSliceCache<float>::kYAxis, 3, py.data());
+	BOOST_CHECK(py == expected_y(3));
+
+	// modified slice is extracted again
+	volume[2][3 * width + 17] = -1.f;
+	cache.get(slices, width, height, OrthoSliceCache<float>::kXAxis, 17, px.data());
+	BOOST_CHECK(px != expected_x(17));
+	cache.invalidate(2);
+	cache.get(slices, width, height, OrthoSliceCache<float>::kXAxis, 17, px.data());
+	BOOST_CHECK(px == expected_x(17));
+	cache.get(slices, width, height, OrthoSliceCache<float>::kYAxis, 3, py.data());
+	BOOST_CHECK(py == expected_y(3));
+
+	// replaced slice buffer is detected
+	std::vector<float> other(width * height, 7.f);
+	volume[4].swap(other);
+	slices[4] = volume[4].data();
+	cache.get(slices, width, height, OrthoSliceCache<float>::kXAxis, 17, px.data());
+	BOOST_CHECK(px == expected_x(17));
+
+	// least recently used planes are evicted
+	size_t const plane_bytes = height * nrslices * sizeof(float);
+	cache.set_budget(2 * plane_bytes);
+	BOOST_CHECK_LE(cache.bytes(), 2 * plane_bytes);
+	cache.get(slices, width, height, OrthoSliceCache<float>::kXAxis, 1, px.data());
+	BOOST_CHECK(px == expected_x(1));
+	BOOST_CHECK_LE(cache.bytes(), 2 * plane_bytes);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../SeparableFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(SeparableFilter_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/SeparableFilter_suite --log_level=message
+BOOST_AUTO_TEST_CASE(ConvolveMatchesNaive)
+{
+	int const width = 23, height = 9;
+	std::vector<float> src(width * height);
+	for (int i = 0; i < width * height; i++)
+	{
+		src[i] = static_cast<float>((i * 37) % 101);
+	}
+	float const kernel[] = {0.1f, 0.2f, 0.4f, 0.2f, 0.1f};
+	int const n = 5, r = n / 2;
+
+	auto clamp = [](int v, int lo, int hi) { return std::min(std::max(v, lo), hi); };
+	for (auto border : {SeparableFilter::kClearBorder, SeparableFilter::kReplicate})
+	{
+		std::vector<float> rows(src.size()), cols(src.size());
+		SeparableFilter::ConvolveRows(src.data(), rows.data(), width, height, kernel, n, border);
+		SeparableFilter::ConvolveColumns(src.data(), cols.data(), width, height, kernel, n, border);
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				float expected_x = 0, expected_y = 0;
+				for (int l = 0; l < n; l++)
+				{
+					expected_x += kernel[l] * src[y * width + clamp(x - r + l, 0, width - 1)];
+					expected_y += kernel[l] * src[clamp(y - r + l, 0, height - 1) * width + x];
+				}
+				if (border == SeparableFilter::kClearBorder)
+				{
+					if (x < r || x >= width - r)
+						expected_x = 0;
+					if (y < r || y >= height - r)
+						expected_y = 0;
+				}
+				BOOST_CHECK_CLOSE(rows[y * width + x] + 1.f, expected_x + 1.f, 1e-3);
+				BOOST_CHECK_CLOSE(cols[y * width + x] + 1.f, expected_y + 1.f, 1e-3);
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(RecursiveGaussian)
+{
+	int const width = 101, height = 101;
+	float const sigma = 6.f;
+
+	// a constant image is preserved, also at the border
+	std::vector<float> img(width * height, 3.f);
+	SeparableFilter::RecursiveGaussian(img.data(), img.data(), width, height, sigma);
+	for (float v : img)
+	{
+		BOOST_CHECK_CLOSE(v, 3.f, 1e-2);
+	}
+
+	// the impulse response is normalized, centered and has a width close to sigma
+	std::fill(img.begin(), img.end(), 0.f);
+	img[(height / 2) * width + width / 2] = 1.f;
+	std::vector<float> out(img.size());
+	SeparableFilter::RecursiveGaussian(img.data(), out.data(), width, height, sigma);
+	double sum = 0, var = 0;
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			double const v = out[y * width + x];
+			sum += v;
+			var += v * (x - width / 2) * (x - width / 2);
+		}
+	}
+	BOOST_CHECK_CLOSE(sum, 1.0, 1.0);
+	BOOST_CHECK_CLOSE(std::sqrt(var / sum), sigma, 15.0);
+	BOOST_CHECK_EQUAL(std::max_element(out.begin(), out.end()) - out.begin(), (height / 2) * width + width / 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -0,0 +1,253 @@
+/*
+* Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+*
+* This file is part of iSEG
+* (see https://github.com/ITISFoundation/osparc-iseg).
+*
+* This software is released under the MIT License.
+*  https://opensource.org/licenses/MIT
+*/
+#include <boost/test/unit_test.hpp>
+
+#include "../UndoQueue.h"
+#include "../UndoScratchFile.h"
+#include "../UndoSlice.h"
+
+#include <vector>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(Core_suite);
+BOOST_AUTO_TEST_SUITE(UndoSlice_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/Core_suite/UndoSlice_suite --log_level=message
+BOOST_AUTO_TEST_CASE(UndoSlice_undo_redo)
+{
+	size_t const n = 3 * UndoSlice::kTileSize + 100;
+	std::vector<float> data(n, 0.f);
+	for (size_t i = 0; i < n; i += 7)
+		data[i] = static_cast<float>(i);
+	std::vector<float> const before = data;
+
+	UndoSlice slice;
+	slice.snapshot(data.data(), n);
+	BOOST_CHECK_EQUAL(slice.num_tiles(), 4);
+
+	// modify the last (partial) tile only
+	data[n - 1] = -1.f;
+	std::vector<float> const after = data;
+
+	slice.prune(data.data());
+	BOOST_CHECK_EQUAL(slice.num_tiles(), 1);
+
+	slice.exchange(data.data());
+	BOOST_CHECK(data == before);
+	slice.exchange(data.data());
+	BOOST_CHECK(data == after);
+}
+
+BOOST_AUTO_TEST_CASE(UndoSlice_compression)
+{
+	size_t const n = 4 * UndoSlice::kTileSize;
+	std::vector<tissues_size_t> labels(n, 0);
+	for (size_t i = n / 2; i < n; i++)
+		labels[i] = 3;
+
+	UndoSlice slice;
+	slice.snapshot(labels.data(), n);
+	BOOST_CHECK_LT(slice.bytes(), n * sizeof(tissues_size_t) / 100);
+
+	std::vector<tissues_size_t> modified(n, 5);
+	slice.exchange(modified.data());
+	BOOST_CHECK(modified == labels);
+}
+
+BOOST_AUTO_TEST_CASE(UndoSlice_merge)
+{
+	size_t const n = 2 * UndoSlice::kTileSize;
+	std::vector<float> data(n, 1.f);
+	std::vector<float> const original = data;
+
+	// first operation modifies tile 0
+	UndoSlice first;
+	first.snapshot(data.data(), n);
+	data[0] = 2.f;
+	first.prune(data.data());
+
+	// second operation modifies tile 0 and 1
+	UndoSlice second;
+	second.snapshot(data.data(), n);
+	data[1] = 3.f;
+	data[n - 1] = 4.f;
+	second.prune(data.data());
+
+	first.merge(second);
+	BOOST_CHECK(second.empty());
+	BOOST_CHECK_EQUAL(first.num_tiles(), 2);
+
+	first.exchange(data.data());
+	BOOST_CHECK(data == original);
+}
+
+BOOST_AUTO_TEST_CASE(UndoQueue_byte_budget)
+{
+	size_t const n = UndoSlice::kTileSize;
+	std::vector<float> data(n);
+	for (size_t i = 0; i < n; i++)
+		data[i] = static_cast<float>(i); // incompressible
+
+	UndoQueue queue;
+	queue.set_undobytesmax(3 * n * sizeof(float));
+	for (int k = 0; k < 5; k++)
+	{
+		auto ue = new UndoElem;
+		ue->dataSelection.bmp = true;
+		ue->bmp.snapshot(data.data(), n);
+		queue.add_undo(ue);
+	}
+	BOOST_CHECK_EQUAL(queue.return_nrundo(), 3);
+	BOOST_CHECK_LE(queue.return_undobytes(), queue.return_undobytesmax());
+
+	auto too_large = new MultiUndoElem;
+	too_large->vbmp.resize(4);
+	for (auto& s : too_large->vbmp)
+		s.snapshot(data.data(), n);
+	BOOST_CHECK(!queue.add_undo(too_large));
+	delete too_large;
+
+	// the only remaining step is dropped if it exceeds a lowered budget
+	queue.set_nrundo(1);
+	BOOST_CHECK_EQUAL(queue.return_nrundo(), 1);
+	queue.set_undobytesmax(n * sizeof(float) / 2);
+	BOOST_CHECK_EQUAL(queue.return_nrundo(), 0);
+	BOOST_CHECK_EQUAL(queue.return_undobytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(UndoQueue_budget_after_exchange)
+{
+	size_t const n = UndoSlice::kTileSize;
+	size_t const step = n * sizeof(float);
+
+	std::vector<float> noise(n);
+	for (size_t i = 0; i < n; i++)
+		noise[i] = static_cast<float>(i); // incompressible
+	std::vector<float> zeros(n, 0.f);
+
+	UndoQueue queue;
+	queue.set_undobytesmax(step + step / 2);
+
+	auto large = new UndoElem;
+	large->dataSelection.bmp = true;
+	large->bmp.snapshot(noise.data(), n);
+	BOOST_REQUIRE(queue.add_undo(large));
+
+	auto small = new UndoElem;
+	small->dataSelection.bmp = true;
+	small->bmp.snapshot(zeros.data(), n);
+	BOOST_REQUIRE(queue.add_undo(small));
+	BOOST_CHECK_EQUAL(queue.return_nrundo(), 2);
+
+	// the exchanged step now holds the incompressible current state
+	std::vector<float> current = noise;
+	UndoElem* ue = queue.undo();
+	BOOST_REQUIRE(ue == small);
+	ue->bmp.exchange(current.data());
+	BOOST_CHECK(current == zeros);
+	queue.end_exchange(ue);
+
+	BOOST_CHECK_LE(queue.return_undobytes(), queue.return_undobytesmax());
+	BOOST_CHECK_EQUAL(queue.return_nrundo(), 0);
+	BOOST_CHECK_EQUAL(queue.return_nrredo(), 1);
+
+	ue = queue.redo();
+	BOOST_REQUIRE(ue == small);
+	ue->bmp.exchange(current.data());
+	BOOST_CHECK(current == noise);
+	queue.end_exchange(ue);
+	BOOST_CHECK_LE(queue.return_undobytes(), queue.return_undobytesmax());
+}
+
+BOOST_AUTO_TEST_CASE(UndoSlice_spill_restore)
+{
+	size_t const n = 2 * UndoSlice::kTileSize;
+	std::vector<float> data(n);
+	for (size_t i = 0; i < n; i++)
+		data[i] = static_cast<float>(i);
+	std::vector<float> const original = data;
+
+	UndoScratchFile file;
+	file.set_capacity(size_t(1) << 20);
+
+	UndoSlice slice;
+	slice.snapshot(data.data(), n);
+	size_t const bytes = slice.bytes();
+
+	BOOST_REQUIRE(slice.spill(file));
+	BOOST_CHECK(slice.spilled());
+	BOOST_CHECK_EQUAL(slice.bytes(), 0);
+	BOOST_CHECK_EQUAL(slice.disk_bytes(), bytes);
+	BOOST_CHECK_EQUAL(file.used(), bytes);
+
+	slice.restore();
+	BOOST_CHECK(!slice.spilled());
+	BOOST_CHECK_EQUAL(file.used(), 0);
+
+	std::vector<float> modified(n, 0.f);
+	slice.exchange(modified.data());
+	BOOST_CHECK(modified == original);
+
+	// budget exhausted
+	slice.exchange(modified.data());
+	file.set_capacity(bytes / 2);
+	BOOST_CHECK(!slice.spill(file));
+	BOOST_CHECK(!slice.spilled());
+}
+
+BOOST_AUTO_TEST_CASE(UndoQueue_disk_budget)
+{
+	size_t const n = UndoSlice::kTileSize;
+	size_t const step = n * sizeof(float);
+
+	UndoQueue queue;
+	queue.set_undobytesmax(2 * step);
+	queue.set_diskbytesmax(4 * step);
+
+	std::vector<std::vector<float>> states;
+	for (int k = 0; k < 8; k++)
+	{
+		std::vector<float> data(n);
+		for (size_t i = 0; i < n; i++)
+			data[i] = static_cast<float>(i * (k + 1)); // incompressible
+		states.push_back(data);
+
+		auto ue = new UndoElem;
+		ue->dataSelection.bmp = true;
+		ue->bmp.snapshot(data.data(), n);
+		queue.add_undo(ue);
+	}
+	// 2 steps in memory, 4 on disk, oldest 2 dropped
+	BOOST_CHECK_EQUAL(queue.return_nrundo(), 6);
+	BOOST_CHECK_LE(queue.return_undobytes(), 2 * step);
+	BOOST_CHECK_EQUAL(queue.return_diskbytes(), 4 * step);
+
+	// steps are paged back in on undo
+	std::vector<float> current(n, 0.f);
+	for (int k = 7; k >= 2; k--)
+	{
+		UndoElem* ue = queue.undo();
+		BOOST_REQUIRE(ue != nullptr);
+		BOOST_CHECK(!ue->bmp.spilled());
+		ue->bmp.exchange(current.data());
+		queue.end_exchange(ue);
+		BOOST_CHECK(current == states[k]);
+		BOOST_CHECK_LE(queue.return_undobytes(), 2 * step);
+	}
+	BOOST_CHECK(queue.undo() == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
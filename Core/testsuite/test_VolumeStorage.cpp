@@ -0,0 +1,190 @@
+/*
+* Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+*
+* This file is part of iSEG
+* (see https://github.com/ITISFoundation/osparc-iseg).
+*
+* This software is released under the MIT License.
+*  https://opensource.org/licenses/MIT
+*/
+#include <boost/test/unit_test.hpp>
+
+#include "../SliceProvider.h"
+#include "../VolumeFile.h"
+#include "../VolumeStorage.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(Core_suite);
+BOOST_AUTO_TEST_SUITE(VolumeStorage_suite);
+
+// TestRunner.exe --run_test=iSeg_suite/Core_suite/VolumeStorage_suite --log_level=message
+BOOST_AUTO_TEST_CASE(VolumeStorage_layout)
+{
+	VolumeStorage storage;
+	BOOST_REQUIRE(storage.allocate(17, 13, 5));
+	BOOST_CHECK_EQUAL(storage.slice_size(), 17 * 13);
+
+	BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(storage.source()) % VolumeStorage::kAlignment, 0);
+	BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(storage.target()) % VolumeStorage::kAlignment, 0);
+	BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(storage.tissues()) % VolumeStorage::kAlignment, 0);
+
+	std::vector<float*> slices;
+	for (unsigned short k = 0; k < 5; k++)
+	{
+		slices.push_back(storage.source(k));
+	}
+	BOOST_CHECK(VolumeStorage::is_contiguous(slices.data(), slices.size(), storage.slice_size()));
+	std::swap(slices[1], slices[2]);
+	BOOST_CHECK(!VolumeStorage::is_contiguous(slices.data(), slices.size(), storage.slice_size()));
+
+	BOOST_CHECK(storage.contains(storage.tissues(4) + 10));
+	BOOST_CHECK(VolumeStorage::owns(storage.target(3)));
+
+	float* last = storage.source(4);
+	storage.release();
+	BOOST_CHECK(!VolumeStorage::owns(last));
+}
+
+BOOST_AUTO_TEST_CASE(VolumeStorage_reuse_slots)
+{
+	// released slabs free their slot in the ownership table
+	for (int i = 0; i < 300; i++)
+	{
+		VolumeStorage a, b;
+		BOOST_REQUIRE(a.allocate(4, 4, 2));
+		BOOST_REQUIRE(b.allocate(4, 4, 2));
+		float* last = a.target(1);
+		a.release();
+		BOOST_REQUIRE(!VolumeStorage::owns(last));
+		BOOST_REQUIRE(VolumeStorage::owns(b.tissues(1)));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(VolumeStorage_SliceProvider)
+{
+	VolumeStorage storage;
+	BOOST_REQUIRE(storage.allocate(8, 8, 2));
+
+	SliceProvider provider(64);
+	// slab memory must not end up in the free list (it would be freed by the provider)
+	provider.take_back(storage.source(1));
+	BOOST_CHECK_EQUAL(provider.return_nrslices(), 0);
+	provider.take_back(provider.give_me());
+	BOOST_CHECK_EQUAL(provider.return_nrslices(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(VolumeStorage_map_file)
+{
+	namespace fs = boost::filesystem;
+	std::string const fname = (fs::temp_directory_path() / fs::unique_path("iseg-%%%%-%%%%.isv")).string();
+
+	unsigned short const w = 7, h = 5, n = 3;
+	size_t const area = size_t(w) * h;
+	std::vector<std::vector<float>> source(n, std::vector<float>(area)), target(n, std::vector<float>(area, 2.f));
+	std::vector<std::vector<tissues_size_t>> tissues(n, std::vector<tissues_size_t>(area, 3));
+	std::vector<float*> s, t;
+	std::vector<tissues_size_t*> l;
+	for (unsigned short k = 0; k < n; k++)
+	{
+		for (size_t i = 0; i < area; i++)
+			source[k][i] = static_cast<float>(k * area + i);
+		s.push_back(source[k].data());
+		t.push_back(target[k].data());
+		l.push_back(tissues[k].data());
+	}
+	BOOST_REQUIRE(VolumeFile::write(fname, w, h, n, s.data(), t.data(), l.data()));
+
+	{
+		VolumeStorage storage;
+		BOOST_REQUIRE(storage.map(fname));
+		BOOST_CHECK(storage.is_mapped());
+		BOOST_CHECK_EQUAL(storage.num_slices(), n);
+		BOOST_CHECK_EQUAL(reinterpret_cast<std::uintptr_t>(storage.source()) % VolumeStorage::kAlignment, 0);
+		BOOST_CHECK(std::equal(source[2].begin(), source[2].end(), storage.source(2)));
+		BOOST_CHECK_EQUAL(storage.target(1)[4], 2.f);
+		BOOST_CHECK_EQUAL(storage.tissues(2)[area - 1], 3);
+		BOOST_CHECK(VolumeStorage::owns(storage.tissues(1)));
+
+		// modifications are private until the slice is written
+		storage.target(0)[0] = 5.f;
+		storage.tissues(1)[0] = 9;
+
+		std::vector<unsigned char> dirty(n, 0);
+		dirty[1] = VolumeFile::kTissue;
+		float* mapped_target[n] = {storage.target(0), storage.target(1), storage.target(2)};
+		tissues_size_t* mapped_tissues[n] = {storage.tissues(0), storage.tissues(1), storage.tissues(2)};
+		BOOST_CHECK(VolumeFile::update(fname, w, h, n, s.data(), mapped_target, mapped_tissues, dirty));
+
+		float* last = storage.source(2);
+		storage.release();
+		BOOST_CHECK(!VolumeStorage::owns(last));
+	}
+
+	{
+		VolumeStorage storage;
+		BOOST_REQUIRE(storage.map(fname));
+		BOOST_CHECK_EQUAL(storage.target(0)[0], 2.f);
+		BOOST_CHECK_EQUAL(storage.tissues(1)[0], 9);
+		BOOST_CHECK_EQUAL(storage.tissues(1)[1], 3);
+	}
+
+	BOOST_CHECK(!VolumeFile::update(fname, w, h, n + 1, s.data(), t.data(), l.data(), std::vector<unsigned char>(n + 1, VolumeFile::kAllChannels)));
+	boost::system::error_code ec;
+	fs::remove(fname, ec);
+}
+
+BOOST_AUTO_TEST_CASE(VolumeFile_snapshot)
+{
+	namespace fs = boost::filesystem;
+	std::string const fname = (fs::temp_directory_path() / fs::unique_path("iseg-%%%%-%%%%.isv")).string();
+
+	unsigned short const w = 4, h = 3, n = 2;
+	size_t const area = size_t(w) * h;
+	BOOST_REQUIRE(VolumeFile::create(fname, w, h, n));
+
+	VolumeFile::Header header;
+	BOOST_REQUIRE(VolumeFile::read_header(fname, header));
+	BOOST_CHECK_EQUAL(header.flags & VolumeFile::kComplete, 0);
+
+	std::vector<float> source(area, 1.f), target(area, 2.f);
+	std::vector<tissues_size_t> tissues(area, 3);
+	{
+		VolumeSnapshot snapshot;
+		snapshot.reset(w, h, n);
+		BOOST_CHECK(snapshot.empty());
+		snapshot.add(1, VolumeFile::kSource | VolumeFile::kTissue, source.data(), target.data(), tissues.data());
+		BOOST_CHECK_EQUAL(snapshot.size_in_bytes(), area * (sizeof(float) + sizeof(tissues_size_t)));
+
+		// the snapshot holds a copy
+		source[0] = 0.f;
+		BOOST_CHECK(VolumeFile::update(fname, snapshot));
+	}
+	BOOST_CHECK(VolumeFile::set_complete(fname));
+
+	BOOST_REQUIRE(VolumeFile::read_header(fname, header));
+	BOOST_CHECK_EQUAL(header.flags & VolumeFile::kComplete, VolumeFile::kComplete);
+
+	VolumeStorage storage;
+	BOOST_REQUIRE(storage.map(fname));
+	BOOST_CHECK_EQUAL(storage.source(1)[0], 1.f);
+	BOOST_CHECK_EQUAL(storage.target(1)[0], 0.f);
+	BOOST_CHECK_EQUAL(storage.tissues(1)[area - 1], 3);
+	BOOST_CHECK_EQUAL(storage.tissues(0)[0], 0);
+	storage.release();
+
+	boost::system::error_code ec;
+	fs::remove(fname, ec);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
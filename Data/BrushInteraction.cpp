@@ -3,6 +3,8 @@
 #include "Brush.h"
 #include "addLine.h"
 
+#include <algorithm>
+
 namespace iseg {
 
 void BrushInteraction::init(iseg::SlicesHandlerInterface* handler)
@@ -45,6 +47,7 @@ void BrushInteraction::on_mouse_clicked(Point p)
 				});
 	}
 
+	report_region(p, p);
 	end_datachange(iseg::NoUndo);
 }
 
@@ -52,6 +55,7 @@ void BrushInteraction::on_mouse_moved(Point p)
 {
 	std::vector<Point> vps;
 	addLine(&vps, _last_pt, p);
+	report_region(_last_pt, p);
 	_last_pt = p;
 
 	if (_brush_target)
@@ -83,6 +87,7 @@ void BrushInteraction::on_mouse_released(Point p)
 {
 	std::vector<Point> vps;
 	addLine(&vps, _last_pt, p);
+	report_region(_last_pt, p);
 
 	if (_brush_target)
 	{
@@ -110,6 +115,24 @@ void BrushInteraction::on_mouse_released(Point p)
 	end_datachange(iseg::EndUndo);
 }
 
+void BrushInteraction::report_region(Point p1, Point p2)
+{
+	if (!region_changed)
+		return;
+
+	// same radius as in brush
+	float const radius_corrected = (_dx > _dy) ? std::floor(_radius / _dx + 0.5f) * _dx : std::floor(_radius / _dy + 0.5f) * _dy;
+	int const xradius = static_cast<int>(std::ceil(radius_corrected / _dx));
+	int const yradius = static_cast<int>(std::ceil(radius_corrected / _dy));
+
+	Point lo, hi;
+	lo.px = static_cast<short>(std::max(0, std::min(p1.px, p2.px) - xradius));
+	lo.py = static_cast<short>(std::max(0, std::min(p1.py, p2.py) - yradius));
+	hi.px = static_cast<short>(std::min(static_cast<int>(_width) - 1, std::max(p1.px, p2.px) + xradius));
+	hi.py = static_cast<short>(std::min(static_cast<int>(_height) - 1, std::max(p1.py, p2.py) + yradius));
+	region_changed(lo, hi);
+}
+
 void BrushInteraction::draw_circle(Point p)
 {
 	Point p1;
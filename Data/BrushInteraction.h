@@ -25,10 +25,12 @@ namespace iseg {
 		BrushInteraction(SlicesHandlerInterface* handler,
 			const boost::function<void(DataSelection)>& begin,
 			const boost::function<void(EndUndoAction)>& end,
-			const boost::function<void(std::vector<Point>*)>& vpdynchanged) 
+			const boost::function<void(std::vector<Point>*)>& vpdynchanged,
+			const boost::function<void(Point, Point)>& regionchanged = boost::function<void(Point, Point)>())
 			: begin_datachange(begin)
 			, end_datachange(end)
 			, vpdyn_changed(vpdynchanged)
+			, region_changed(regionchanged)
 		{
 			init(handler);
 		}
@@ -53,6 +55,10 @@ namespace iseg {
 		boost::function<void(DataSelection)> begin_datachange;
 		boost::function<void(EndUndoAction)> end_datachange;
 		boost::function<void(std::vector<Point>*)> vpdyn_changed;
+		/// bounding box (lower left, upper right) of the pixels modified before end_datachange
+		boost::function<void(Point, Point)> region_changed;
+
+		void report_region(Point p1, Point p2);
 
 		SlicesHandlerInterface* _slice_handler;
 		std::vector<bool> _cached_tissue_locks;
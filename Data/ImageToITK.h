@@ -15,6 +15,9 @@
 #include <itkImage.h>
 #include <itkSliceContiguousImage.h>
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <vector>
 
 namespace iseg {
@@ -34,25 +37,27 @@ typename itk::Image<T, 3>::Pointer allocateImage(const unsigned dimensions[3],
 {
 	typedef itk::Image<T, 3> ImageType;
 
+	assert(end_slice > start_slice && end_slice <= dimensions[2]);
+
 	typename ImageType::IndexType start;
 	start[0] = 0;						// first index on X
 	start[1] = 0;						// first index on Y
 	start[2] = start_slice; // first index on Z
 	typename ImageType::SizeType size;
-	size[0] = dimensions[0]; // size along X
-	size[1] = dimensions[1]; // size along Y
-	size[2] = dimensions[2]; // size along Z
+	size[0] = dimensions[0];					 // size along X
+	size[1] = dimensions[1];					 // size along Y
+	size[2] = end_slice - start_slice; // size along Z
 	typename ImageType::RegionType region;
 	region.SetSize(size);
 	region.SetIndex(start);
 
 	typename ImageType::PointType origin;
 	typename ImageType::DirectionType direction;
-	toITK(transform, origin, direction);
+	copyToITK(transform, origin, direction);
 
 	auto image = itk::Image<T, 3>::New();
 	image->SetRegions(region);
-	image->SetSpacing(spacing);
+	image->SetSpacing(spacing.v);
 	image->SetOrigin(origin);
 	image->SetDirection(direction);
 	image->Allocate();
@@ -66,24 +71,16 @@ typename itk::Image<T, 3>::Pointer copyToITK(const std::vector<T*>& all_slices,
 {
 	auto image = allocateImage<T>(dimensions, start_slice, end_slice, spacing, transform);
 
-	typename itk::Image<T, 3>::IndexType pi;
-	auto size = image->GetLargestPossibleRegion().GetSize();
-
-	// \todo copy using std::copy per slice
-	for (unsigned z = 0; z < size[2]; z++)
+	// the image buffer is contiguous, i.e. each slice is a single block
+	auto size = image->GetBufferedRegion().GetSize();
+	size_t const slice_size = static_cast<size_t>(size[0]) * size[1];
+	std::int64_t const num_slices = static_cast<std::int64_t>(size[2]);
+	T* buffer = image->GetBufferPointer();
+#pragma omp parallel for
+	for (std::int64_t z = 0; z < num_slices; z++)
 	{
 		const T* slice = all_slices[start_slice + z];
-		pi.SetElement(2, z);
-		size_t idx = 0;
-		for (unsigned y = 0; y < size[1]; y++)
-		{
-			pi.SetElement(1, y);
-			for (unsigned x = 0; x < size[0]; x++, idx++)
-			{
-				pi.SetElement(0, x);
-				image->SetPixel(pi, slice[idx]);
-			}
-		}
+		std::copy(slice, slice + slice_size, buffer + z * slice_size);
 	}
 	return image;
 }
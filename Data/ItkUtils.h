@@ -18,8 +18,103 @@
 #include <itkImageRegionIterator.h>
 #include <itkImageRegionIteratorWithIndex.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
 namespace iseg {
 
+namespace detail {
+
+/// Images whose pixel rows are contiguous in memory
+template<class TImage>
+struct HasContiguousRows : std::false_type
+{
+};
+
+template<typename T>
+struct HasContiguousRows<itk::Image<T, 3>> : std::true_type
+{
+};
+
+template<typename T>
+struct HasContiguousRows<itk::SliceContiguousImage<T>> : std::true_type
+{
+};
+
+template<typename T>
+const T* RowPointer(const itk::Image<T, 3>* image, const itk::Index<3>& idx)
+{
+	return image->GetBufferPointer() + image->ComputeOffset(idx);
+}
+
+template<typename T>
+T* RowPointer(itk::Image<T, 3>* image, const itk::Index<3>& idx)
+{
+	return image->GetBufferPointer() + image->ComputeOffset(idx);
+}
+
+template<typename T>
+T* RowPointer(const itk::SliceContiguousImage<T>* image, const itk::Index<3>& idx)
+{
+	auto const& buffered = image->GetBufferedRegion();
+	auto const& slices = *image->GetPixelContainer()->GetSlices();
+	size_t const offset = (idx[1] - buffered.GetIndex(1)) * buffered.GetSize(0) + (idx[0] - buffered.GetIndex(0));
+	return slices[idx[2] - buffered.GetIndex(2)] + offset;
+}
+
+/// Copy row by row, the regions have the same size
+template<class TInputImage, class TOutputImage>
+void PasteRegion(const TInputImage* source, TOutputImage* destination,
+		const itk::ImageRegion<3>& source_region, const itk::ImageRegion<3>& destination_region, std::true_type)
+{
+	using OutputPixel = typename TOutputImage::PixelType;
+
+	auto const size = source_region.GetSize();
+	std::int64_t const ny = static_cast<std::int64_t>(size[1]);
+	std::int64_t const num_rows = ny * static_cast<std::int64_t>(size[2]);
+#pragma omp parallel for
+	for (std::int64_t row = 0; row < num_rows; row++)
+	{
+		auto sidx = source_region.GetIndex();
+		auto didx = destination_region.GetIndex();
+		sidx[1] += row % ny;
+		sidx[2] += row / ny;
+		didx[1] += row % ny;
+		didx[2] += row / ny;
+
+		auto src = RowPointer(source, sidx);
+		auto dst = RowPointer(destination, didx);
+		std::transform(src, src + size[0], dst, [](typename TInputImage::PixelType v) { return static_cast<OutputPixel>(v); });
+	}
+}
+
+/// Copy pixel by pixel using iterators
+template<class TInputImage, class TOutputImage>
+void PasteRegion(const TInputImage* source, TOutputImage* destination,
+		const typename TInputImage::RegionType& source_region, const typename TOutputImage::RegionType& destination_region, std::false_type)
+{
+	using OutputPixel = typename TOutputImage::PixelType;
+
+	itk::ImageRegionConstIterator<TInputImage> sit(source, source_region);
+	itk::ImageRegionIterator<TOutputImage> dit(destination, destination_region);
+
+	for (sit.GoToBegin(), dit.GoToBegin(); !sit.IsAtEnd() && !dit.IsAtEnd(); ++sit, ++dit)
+	{
+		dit.Set(static_cast<OutputPixel>(sit.Get()));
+	}
+}
+
+template<class TInputImage, class TOutputImage>
+void PasteRegion(const TInputImage* source, TOutputImage* destination,
+		const typename TInputImage::RegionType& source_region, const typename TOutputImage::RegionType& destination_region)
+{
+	using fast_path = std::integral_constant<bool, HasContiguousRows<TInputImage>::value && HasContiguousRows<TOutputImage>::value>;
+	PasteRegion(source, destination, source_region, destination_region, fast_path());
+}
+
+} // namespace detail
+
 template<typename TInputPixel, typename TOutputPixel>
 bool Paste(const itk::Image<TInputPixel, 3>* source, itk::SliceContiguousImage<TOutputPixel>* destination,
 		size_t startslice, size_t endslice)
@@ -37,15 +132,7 @@ bool Paste(const itk::Image<TInputPixel, 3>* source, itk::SliceContiguousImage<T
 		// copy active slices into destination, starting at startslice
 		auto active_region = itk::ImageBase<3>::RegionType(start, size);
 
-		typedef itk::ImageRegionConstIterator<itk::Image<TInputPixel, 3>> image_iterator;
-		typedef itk::ImageRegionIterator<itk::SliceContiguousImage<TOutputPixel>> slice_image_iterator;
-		image_iterator sit(source, active_region);
-		slice_image_iterator dit(destination, active_region);
-
-		for (sit.GoToBegin(), dit.GoToBegin(); !sit.IsAtEnd() && !dit.IsAtEnd(); ++sit, ++dit)
-		{
-			dit.Set(static_cast<TOutputPixel>(sit.Get()));
-		}
+		detail::PasteRegion(source, destination, active_region, active_region);
 		return true;
 	}
 	return false;
@@ -54,17 +141,9 @@ bool Paste(const itk::Image<TInputPixel, 3>* source, itk::SliceContiguousImage<T
 template<class TInputImage, class TOutputImage>
 bool Paste(const TInputImage* source, TOutputImage* destination)
 {
-	using OutputPixel = typename TOutputImage::PixelType;
-
 	if (source->GetBufferedRegion().GetSize() == destination->GetBufferedRegion().GetSize())
 	{
-		itk::ImageRegionConstIterator<TInputImage> sit(source, source->GetBufferedRegion());
-		itk::ImageRegionIterator<TOutputImage> dit(destination, destination->GetBufferedRegion());
-
-		for (sit.GoToBegin(), dit.GoToBegin(); !sit.IsAtEnd() && !dit.IsAtEnd(); ++sit, ++dit)
-		{
-			dit.Set(static_cast<OutputPixel>(sit.Get()));
-		}
+		detail::PasteRegion(source, destination, source->GetBufferedRegion(), destination->GetBufferedRegion());
 		return true;
 	}
 	return false;
@@ -73,17 +152,9 @@ bool Paste(const TInputImage* source, TOutputImage* destination)
 template<class TInputImage, class TOutputImage>
 bool Paste(const TInputImage* source, TOutputImage* destination, const typename TInputImage::RegionType& region)
 {
-	using OutputPixel = typename TOutputImage::PixelType;
-
 	if (source->GetBufferedRegion().IsInside(region) && destination->GetBufferedRegion().IsInside(region))
 	{
-		itk::ImageRegionConstIterator<TInputImage> sit(source, region);
-		itk::ImageRegionIterator<TOutputImage> dit(destination, region);
-
-		for (sit.GoToBegin(), dit.GoToBegin(); !sit.IsAtEnd() && !dit.IsAtEnd(); ++sit, ++dit)
-		{
-			dit.Set(static_cast<OutputPixel>(sit.Get()));
-		}
+		detail::PasteRegion(source, destination, region, region);
 		return true;
 	}
 	return false;
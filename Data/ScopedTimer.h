@@ -22,7 +22,7 @@ class ScopedTimerT
 {
 public:
 	ScopedTimerT(const std::string& scope_name, const std::string& unit) 
-		: _scope_name(scope_name), _unit(unit)
+		: _scope_name(scope_name), _unit(unit), _bytes(0)
 	{
 		_before = boost::chrono::high_resolution_clock::now();
 	}
@@ -31,19 +31,33 @@ public:
 		new_scope(_scope_name);
 	}
 
+	/// Amount of data processed in the current scope, reported as throughput
+	void set_bytes(size_t bytes) { _bytes = bytes; }
+
 	void new_scope(const std::string& scope_name)
 	{
 		auto const after = boost::chrono::high_resolution_clock::now();
 		double count = static_cast<double>( boost::chrono::duration_cast<TUnit>(after - _before).count() );
-		Log::note("TIMER", "%g %s in %s", count, _unit.c_str(), _scope_name.c_str());
+		if (_bytes > 0)
+		{
+			double const seconds = boost::chrono::duration<double>(after - _before).count();
+			double const mb = static_cast<double>(_bytes) / (1024.0 * 1024.0);
+			Log::note("TIMER", "%g %s in %s (%.1f MB, %.1f MB/s)", count, _unit.c_str(), _scope_name.c_str(), mb, seconds > 0 ? mb / seconds : 0.0);
+		}
+		else
+		{
+			Log::note("TIMER", "%g %s in %s", count, _unit.c_str(), _scope_name.c_str());
+		}
 
 		_before = after;
 		_scope_name = scope_name;
+		_bytes = 0;
 	}
 
 private:
 	std::string _scope_name;
 	std::string _unit;
+	size_t _bytes;
 	boost::chrono::high_resolution_clock::time_point _before;
 };
 
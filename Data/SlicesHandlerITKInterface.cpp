@@ -1,7 +1,5 @@
 #include "SlicesHandlerITKInterface.h"
 
-#include <itkCastImageFilter.h>
-
 namespace iseg {
 
 itk::SliceContiguousImage<float>::Pointer SlicesHandlerITKInterface::GetSource(bool active_slices)
@@ -119,24 +117,22 @@ itk::ImageRegion<3> SlicesHandlerITKInterface::GetActiveRegion() const
 
 itk::Image<float, 3>::Pointer SlicesHandlerITKInterface::GetImageDeprecated(eImageType type, bool active_slices)
 {
-	using input_image = itk::SliceContiguousImage<float>;
-	using output_image = itk::Image<float, 3>;
+	unsigned dims[3] = {_handler->width(), _handler->height(), _handler->num_slices()};
+	size_t start_slice = active_slices ? _handler->start_slice() : 0;
+	size_t end_slice = active_slices ? _handler->end_slice() : _handler->num_slices();
 
-	auto cast = itk::CastImageFilter<input_image, output_image>::New();
-	cast->SetInput(type == eImageType::kSource ? GetSource(active_slices) : GetTarget(active_slices));
-	cast->Update();
-	return cast->GetOutput();
+	auto all_slices = (type == eImageType::kSource) ? _handler->source_slices() : _handler->target_slices();
+	return copyToITK(all_slices, dims, start_slice, end_slice, _handler->spacing(), _handler->transform());
 }
 
 itk::Image<tissues_size_t, 3>::Pointer SlicesHandlerITKInterface::GetTissuesDeprecated(bool active_slices)
 {
-	using input_image = itk::SliceContiguousImage<tissues_size_t>;
-	using output_image = itk::Image<tissues_size_t, 3>;
+	unsigned dims[3] = {_handler->width(), _handler->height(), _handler->num_slices()};
+	size_t start_slice = active_slices ? _handler->start_slice() : 0;
+	size_t end_slice = active_slices ? _handler->end_slice() : _handler->num_slices();
 
-	auto cast = itk::CastImageFilter<input_image, output_image>::New();
-	cast->SetInput(GetTissues(active_slices));
-	cast->Update();
-	return cast->GetOutput();
+	auto all_slices = _handler->tissue_slices(_handler->active_tissuelayer());
+	return copyToITK(all_slices, dims, start_slice, end_slice, _handler->spacing(), _handler->transform());
 }
 
 } // namespace iseg
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ * 
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ * 
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include <boost/test/unit_test.hpp>
+
+#include "../ImageToITK.h"
+#include "../ItkUtils.h"
+
+#include <boost/chrono.hpp>
+
+#include <cstdlib>
+
+namespace iseg {
+
+BOOST_AUTO_TEST_SUITE(iSeg_suite);
+BOOST_AUTO_TEST_SUITE(ImageToITK_suite);
+
+BOOST_AUTO_TEST_CASE(copyToITK_active_slices)
+{
+	unsigned dims[3] = {5, 4, 6};
+	size_t const slice_size = dims[0] * dims[1];
+	std::vector<float> data(slice_size * dims[2]);
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<float>(i);
+	}
+	std::vector<float*> slices;
+	for (unsigned z = 0; z < dims[2]; z++)
+	{
+		slices.push_back(data.data() + z * slice_size);
+	}
+
+	Transform transform;
+	transform.setIdentity();
+	auto image = copyToITK(slices, dims, 2, 5, Vec3(1.f, 2.f, 3.f), transform);
+
+	auto region = image->GetBufferedRegion();
+	BOOST_CHECK_EQUAL(region.GetIndex(2), 2);
+	BOOST_CHECK_EQUAL(region.GetSize(2), 3);
+	BOOST_CHECK_EQUAL(image->GetSpacing()[2], 3.0);
+
+	itk::Index<3> idx = {3, 1, 4};
+	BOOST_CHECK_EQUAL(image->GetPixel(idx), data[4 * slice_size + 1 * dims[0] + 3]);
+
+	// paste back into the slices (with conversion) and only into the active slices
+	std::vector<unsigned char> result(data.size(), 0);
+	std::vector<unsigned char*> result_slices;
+	for (unsigned z = 0; z < dims[2]; z++)
+	{
+		result_slices.push_back(result.data() + z * slice_size);
+	}
+	auto target = wrapToITK(result_slices, dims, 2, 5, Vec3(1.f, 2.f, 3.f), transform);
+	BOOST_REQUIRE(Paste(image.GetPointer(), target.GetPointer()));
+
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		size_t const z = i / slice_size;
+		unsigned char const expected = (z >= 2 && z < 5) ? static_cast<unsigned char>(data[i]) : 0;
+		BOOST_REQUIRE_EQUAL(result[i], expected);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Paste_region)
+{
+	unsigned dims[3] = {7, 5, 4};
+	size_t const slice_size = dims[0] * dims[1];
+	std::vector<float> data(slice_size * dims[2], 1.f);
+	std::vector<float> result(slice_size * dims[2], 0.f);
+	std::vector<float*> slices, result_slices;
+	for (unsigned z = 0; z < dims[2]; z++)
+	{
+		slices.push_back(data.data() + z * slice_size);
+		result_slices.push_back(result.data() + z * slice_size);
+	}
+
+	Transform transform;
+	transform.setIdentity();
+	auto source = wrapToITK(slices, dims, 0, dims[2], Vec3(1.f, 1.f, 1.f), transform);
+	auto target = wrapToITK(result_slices, dims, 0, dims[2], Vec3(1.f, 1.f, 1.f), transform);
+
+	itk::Index<3> start = {2, 1, 1};
+	itk::Size<3> size = {3, 2, 2};
+	itk::ImageRegion<3> region(start, size);
+	BOOST_REQUIRE(Paste(source.GetPointer(), target.GetPointer(), region));
+
+	float sum = 0.f;
+	for (auto v : result)
+	{
+		sum += v;
+	}
+	BOOST_CHECK_EQUAL(sum, 3.f * 2.f * 2.f);
+	BOOST_CHECK_EQUAL(result[1 * slice_size + 1 * dims[0] + 2], 1.f);
+	BOOST_CHECK_EQUAL(result[2 * slice_size + 2 * dims[0] + 4], 1.f);
+	BOOST_CHECK_EQUAL(result[2 * slice_size + 2 * dims[0] + 5], 0.f);
+}
+
+BOOST_AUTO_TEST_CASE(copyToITK_Performance)
+{
+	// 512^3 voxels, all slices share the same memory to keep the test light
+	unsigned dims[3] = {512, 512, 512};
+	size_t const slice_size = dims[0] * dims[1];
+	std::vector<float> data(slice_size);
+	for (auto& v : data)
+	{
+		v = static_cast<float>(rand()) / RAND_MAX;
+	}
+	std::vector<float> result(slice_size);
+	std::vector<float*> slices(dims[2], data.data());
+	std::vector<float*> result_slices(dims[2], result.data());
+
+	Transform transform;
+	transform.setIdentity();
+	Vec3 spacing(1.f, 1.f, 1.f);
+
+	auto ms_since = [](boost::chrono::high_resolution_clock::time_point before) {
+		auto const after = boost::chrono::high_resolution_clock::now();
+		return static_cast<double>(boost::chrono::duration_cast<boost::chrono::milliseconds>(after - before).count());
+	};
+
+	auto before = boost::chrono::high_resolution_clock::now();
+	auto image = copyToITK(slices, dims, 0, dims[2], spacing, transform);
+	BOOST_TEST_MESSAGE("copyToITK 512^3: " << ms_since(before) << "[ms]");
+
+	auto source = wrapToITK(slices, dims, 0, dims[2], spacing, transform);
+	auto reference = allocateImage<float>(dims, 0, dims[2], spacing, transform);
+	before = boost::chrono::high_resolution_clock::now();
+	detail::PasteRegion(source.GetPointer(), reference.GetPointer(), source->GetBufferedRegion(), reference->GetBufferedRegion(), std::false_type());
+	BOOST_TEST_MESSAGE("Iterator copy 512^3: " << ms_since(before) << "[ms]");
+
+	auto target = wrapToITK(result_slices, dims, 0, dims[2], spacing, transform);
+	before = boost::chrono::high_resolution_clock::now();
+	BOOST_REQUIRE(Paste(image.GetPointer(), target.GetPointer()));
+	BOOST_TEST_MESSAGE("Paste 512^3: " << ms_since(before) << "[ms]");
+
+	BOOST_CHECK(std::equal(data.begin(), data.end(), result.begin()));
+	BOOST_CHECK(std::equal(data.begin(), data.end(), reference->GetBufferPointer() + (dims[2] - 1) * slice_size));
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+BOOST_AUTO_TEST_SUITE_END();
+
+} // namespace iseg
@@ -18,6 +18,7 @@
 
 #include <QDir>
 #include <QIcon>
+#include <QRect>
 #include <QWidget>
 
 class QCursor;
@@ -55,6 +56,8 @@ signals:
 
 	void begin_datachange(iseg::DataSelection& dataSelection, QWidget* sender = nullptr, bool beginUndo = true);
 	void end_datachange(QWidget* sender = nullptr, iseg::EndUndoAction undoAction = iseg::EndUndo);
+	/// Bounding box (slice coordinates) of the pixels modified on the active slice, emitted before end_datachange
+	void region_changed(QRect rect);
 
 protected slots:
 	void tissuenr_changed(int i) { on_tissuenr_changed(i); }
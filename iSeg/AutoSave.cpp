@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "AutoSave.h"
+#include "SlicesHandler.h"
+#include "TissueInfos.h"
+
+#include "Data/Logger.h"
+
+#include "Core/VolumeFile.h"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdio>
+#include <memory>
+
+namespace iseg {
+
+namespace {
+// same tissue list format as in project files
+unsigned short const kTissuesVersion = 12;
+
+bool save_tissues(const std::string& fname)
+{
+	// write to a temporary file first, an interrupted write keeps the previous list
+	std::string const tmp = fname + ".tmp";
+	FILE* fp = fopen(tmp.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+	TissueInfos::SaveTissues(fp, kTissuesVersion);
+	TissueInfos::SaveTissueLocks(fp);
+	bool const ok = ferror(fp) == 0;
+	if (fclose(fp) != 0 || !ok)
+		return false;
+
+	boost::system::error_code ec;
+	boost::filesystem::rename(tmp, fname, ec);
+	return !ec;
+}
+} // namespace
+
+AutoSave::AutoSave()
+		: _busy(false), _failed(false), _pending(false), _created(false), _complete(false), _width(0), _height(0), _nrslices(0)
+{
+}
+
+AutoSave::~AutoSave() { wait(); }
+
+void AutoSave::wait()
+{
+	if (_worker.joinable())
+	{
+		_worker.join();
+	}
+}
+
+void AutoSave::discard()
+{
+	wait();
+	if (!_file_name.empty())
+	{
+		boost::system::error_code ec;
+		boost::filesystem::remove(_file_name, ec);
+		boost::filesystem::remove(tissues_file_name(_file_name), ec);
+	}
+	_file_name.clear();
+	_created = _complete = _pending = false;
+}
+
+std::string AutoSave::file_name(const std::string& project_file_name)
+{
+	return boost::filesystem::path(project_file_name).replace_extension(".autosave.isv").string();
+}
+
+std::string AutoSave::tissues_file_name(const std::string& file_name)
+{
+	return boost::filesystem::path(file_name).replace_extension(".tissues").string();
+}
+
+bool AutoSave::restore_tissues(const std::string& file_name)
+{
+	FILE* fp = fopen(tissues_file_name(file_name).c_str(), "rb");
+	if (fp == nullptr)
+		return false;
+
+	bool ok = true;
+	try
+	{
+		TissueInfos::LoadTissues(fp, 1);
+		TissueInfos::LoadTissueLocks(fp);
+		ok = ferror(fp) == 0;
+	}
+	catch (std::exception& e)
+	{
+		ISEG_WARNING("cannot read autosaved tissues: " << e.what());
+		ok = false;
+	}
+	fclose(fp);
+	return ok;
+}
+
+bool AutoSave::run(SlicesHandler* handler, const std::string& file_name, size_t max_bytes)
+{
+	if (_busy)
+		return false;
+	wait();
+
+	unsigned short const w = handler->width(), h = handler->height(), n = handler->num_slices();
+	boost::system::error_code ec;
+	if (file_name != _file_name || w != _width || h != _height || n != _nrslices ||
+			_failed || (_created && !boost::filesystem::exists(file_name, ec)))
+	{
+		if (file_name != _file_name)
+		{
+			discard();
+		}
+
+		// start over with a new file
+		_file_name = file_name;
+		_width = w;
+		_height = h;
+		_nrslices = n;
+		_created = _complete = _failed = false;
+		handler->mark_autosave_dirty();
+	}
+
+	// the tissue list is small, write it before the slices so that restored labels always have a tissue
+	if (!save_tissues(tissues_file_name(_file_name)))
+	{
+		ISEG_WARNING("autosave of the tissue list to " << tissues_file_name(_file_name) << " failed");
+	}
+
+	auto snapshot = std::make_shared<VolumeSnapshot>();
+	_pending = handler->take_autosave_snapshot(*snapshot, max_bytes) > 0;
+
+	bool const create = !_created;
+	bool const complete = !_complete && !_pending;
+	if (snapshot->empty() && !create && !complete)
+		return true;
+
+	_busy = true;
+	_created = true;
+	_complete = _complete || complete;
+	std::string const fname = _file_name;
+	_worker = std::thread([this, snapshot, fname, create, complete, w, h, n]() {
+		bool ok = !create || VolumeFile::create(fname, w, h, n);
+		if (ok && !snapshot->empty())
+		{
+			ok = VolumeFile::update(fname, *snapshot);
+		}
+		if (ok && complete)
+		{
+			ok = VolumeFile::set_complete(fname);
+		}
+		if (!ok)
+		{
+			// the slices of the snapshot are lost, next run starts over
+			ISEG_WARNING("autosave to " << fname << " failed");
+			_failed = true;
+		}
+		_busy = false;
+	});
+	return true;
+}
+
+} // namespace iseg
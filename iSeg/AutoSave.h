@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+namespace iseg {
+
+class SlicesHandler;
+
+/** \brief Writes modified slices to a side file in a background thread
+ *
+ * The side file is a VolumeFile. The first run creates it and all slices are
+ * written, later runs only write slices modified since the previous run. Slices
+ * are copied (VolumeSnapshot) before writing, so the GUI can continue editing.
+ *
+ * Once all slices have been written the file is marked complete and can be
+ * used to restore the images (SlicesHandler::RestoreAutoSave).
+ *
+ * The tissue list is written to a second side file (tissues_file_name) on
+ * every run, before the slices, and read back with restore_tissues.
+ */
+class AutoSave
+{
+public:
+	AutoSave();
+	~AutoSave();
+
+	/** \brief Start writing slices of 'handler' to 'file_name'
+	 *
+	 * At most max_bytes of slice data are copied per run. Returns false if the
+	 * previous run is still writing.
+	 */
+	bool run(SlicesHandler* handler, const std::string& file_name, size_t max_bytes);
+
+	bool busy() const { return _busy; }
+	/// True if not all modified slices fit into the last run
+	bool pending() const { return _pending; }
+
+	/// Wait for the background thread to finish writing
+	void wait();
+	/// Wait, then delete the side file
+	void discard();
+
+	/// Side file of a project
+	static std::string file_name(const std::string& project_file_name);
+	/// Side file with the tissue list, next to the side file 'file_name'
+	static std::string tissues_file_name(const std::string& file_name);
+	/// Replace the tissue list by the autosaved one, returns false if there is none
+	static bool restore_tissues(const std::string& file_name);
+
+private:
+	AutoSave(const AutoSave&) = delete;
+	AutoSave& operator=(const AutoSave&) = delete;
+
+	std::thread _worker;
+	std::atomic<bool> _busy;
+	std::atomic<bool> _failed;
+	bool _pending;
+	bool _created;
+	bool _complete;
+	std::string _file_name;
+	unsigned short _width;
+	unsigned short _height;
+	unsigned short _nrslices;
+};
+
+} // namespace iseg
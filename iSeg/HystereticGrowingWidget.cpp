@@ -47,9 +47,8 @@ HystereticGrowingWidget::HystereticGrowingWidget(SlicesHandler* hand3D, QWidget*
 	activeslice = handler3D->active_slice();
 	bmphand = handler3D->get_activebmphandler();
 
-	Pair p;
 	p1.px = p1.py = 0;
-	bmphand->get_bmprange(&p);
+	Pair p = handler3D->slice_bmprange(activeslice);
 	lower_limit = p.low;
 	upper_limit = p.high;
 
@@ -295,8 +294,7 @@ void HystereticGrowingWidget::getrange()
 	float ul = ll + (uu - ll) * 0.005f * sl_lowerhyster->value();
 	float lu = ll + (uu - ll) * 0.005f * sl_upperhyster->value();
 
-	Pair p;
-	bmphand->get_bmprange(&p);
+	Pair p = handler3D->slice_bmprange(handler3D->active_slice());
 	lower_limit = p.low;
 	upper_limit = p.high;
 
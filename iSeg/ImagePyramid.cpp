@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "ImagePyramid.h"
+
+#include <cstdint>
+
+namespace iseg {
+
+namespace {
+/// Per channel average of four pixels, two channels are summed in the 16 bit lanes of a word
+inline QRgb average(QRgb a, QRgb b, QRgb c, QRgb d)
+{
+	std::uint32_t const m = 0x00ff00ffu;
+	std::uint32_t const lo = (a & m) + (b & m) + (c & m) + (d & m) + 0x00020002u;
+	std::uint32_t const hi = ((a >> 8) & m) + ((b >> 8) & m) + ((c >> 8) & m) + ((d >> 8) & m) + 0x00020002u;
+	return ((lo >> 2) & m) | (((hi >> 2) & m) << 8);
+}
+} // namespace
+
+const QImage& ImagePyramid::level(const QImage& base, double scale, int& factor)
+{
+	factor = 1;
+	if (base.isNull())
+		return base;
+
+	size_t count = 0;
+	int const max_size = std::max(base.width(), base.height());
+	while (scale * factor * 2 <= 1.0 && factor * 2 <= max_size)
+	{
+		factor *= 2;
+		count++;
+	}
+	if (count == 0)
+	{
+		factor = 1;
+		return base;
+	}
+
+	if (!_levels.empty() &&
+			(_levels[0].size() != QSize((base.width() + 1) / 2, (base.height() + 1) / 2) ||
+					_levels[0].format() != base.format()))
+	{
+		_levels.clear();
+	}
+
+	// update the modified pixels of the existing levels
+	QRect rect = _dirty & base.rect();
+	const QImage* src = &base;
+	for (auto& l : _levels)
+	{
+		if (rect.isEmpty())
+			break;
+		rect = QRect(QPoint(rect.left() / 2, rect.top() / 2), QPoint(rect.right() / 2, rect.bottom() / 2));
+		downsample(*src, l, rect);
+		src = &l;
+	}
+	_dirty = QRect();
+
+	// build the missing levels
+	while (_levels.size() < count)
+	{
+		const QImage& parent = _levels.empty() ? base : _levels.back();
+		QImage l((parent.width() + 1) / 2, (parent.height() + 1) / 2, parent.format());
+		downsample(parent, l, l.rect());
+		_levels.push_back(l);
+	}
+
+	return _levels[count - 1];
+}
+
+void ImagePyramid::downsample(const QImage& src, QImage& dst, QRect rect)
+{
+	rect &= dst.rect();
+	int const last_x = src.width() - 1, last_y = src.height() - 1;
+	for (int y = rect.top(); y <= rect.bottom(); y++)
+	{
+		// odd sizes repeat the last row/column
+		auto row0 = reinterpret_cast<const QRgb*>(src.scanLine(2 * y));
+		auto row1 = reinterpret_cast<const QRgb*>(src.scanLine(std::min(2 * y + 1, last_y)));
+		auto out = reinterpret_cast<QRgb*>(dst.scanLine(y));
+		for (int x = rect.left(); x <= rect.right(); x++)
+		{
+			int const x0 = 2 * x, x1 = std::min(2 * x + 1, last_x);
+			out[x] = average(row0[x0], row0[x1], row1[x0], row1[x1]);
+		}
+	}
+}
+
+} // namespace iseg
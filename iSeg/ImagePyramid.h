@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include <QImage>
+#include <QRect>
+
+#include <vector>
+
+namespace iseg {
+
+/** \brief Mipmap levels of a 32 bit QImage for drawing it zoomed out
+ *
+ * Level i is the base image box filtered and downsampled by 2^i. Levels are
+ * built lazily when requested and only the invalidated pixels are updated,
+ * so drawing a large slice zoomed out costs in the order of screen pixels.
+ */
+class ImagePyramid
+{
+public:
+	/// Drop all levels, e.g. if the base image was resized
+	void clear() { _levels.clear(); }
+
+	/// Mark the pixels in 'rect' (base image coordinates) as modified
+	void invalidate(const QRect& rect) { _dirty |= rect; }
+
+	/** \brief Returns the coarsest level with at least one pixel per screen pixel
+	 *
+	 * 'scale' is the number of screen pixels per base image pixel. The level is
+	 * 'base' itself if scale is not smaller than 0.5. On return 'factor' is the
+	 * downsampling factor of the level.
+	 */
+	const QImage& level(const QImage& base, double scale, int& factor);
+
+private:
+	/// Downsample the pixels of 'src' covering 'rect' (coordinates of 'dst')
+	static void downsample(const QImage& src, QImage& dst, QRect rect);
+
+	// _levels[i] is downsampled by 2^(i+1)
+	std::vector<QImage> _levels;
+	QRect _dirty;
+};
+
+} // namespace iseg
@@ -61,6 +61,10 @@ ImageViewerWidget::ImageViewerWidget(QWidget* parent, const char* name, Qt::Wind
 	crosshairypos = 0;
 	marks = nullptr;
 	overlayalpha = 0.0f;
+	tissue_lut_version = 0;
+	image_use_lut = false;
+	image_scaleoffset = scaleoffset;
+	image_scalefactor = scalefactor;
 	
 	selecttissue = new QAction("Select Tissue", this);
 	addtoselection = new QAction("Select Tissue", this);
@@ -172,7 +176,9 @@ void ImageViewerWidget::paintEvent(QPaintEvent* e)
 			QPainter painter(this);
 			painter.setClipRect(e->rect());
 			painter.scale(zoom * pixelsize.high, zoom * pixelsize.low);
-			painter.drawImage(0, 0, image_decorated);
+			int factor = 1;
+			const QImage& level = pyramid.level(image_decorated, zoom * std::max(pixelsize.high, pixelsize.low), factor);
+			painter.drawImage(QRectF(0, 0, level.width() * factor, level.height() * factor), level);
 			painter.setPen(QPen(actual_color));
 
 			if (marks != nullptr)
@@ -250,21 +256,50 @@ void ImageViewerWidget::bmphand_changed(bmphandler* bmph)
 	}
 }
 
-void ImageViewerWidget::overlay_changed()
+namespace {
+void add_points(QRect& rect, const std::vector<Point>& points)
 {
-	reload_bits();
-	repaint();
+	for (auto& p : points)
+	{
+		rect |= QRect(p.px, p.py, 1, 1);
+	}
 }
 
-void ImageViewerWidget::overlay_changed(QRect rect)
+void add_marks(QRect& rect, const std::vector<Mark>& marks)
+{
+	for (auto& m : marks)
+	{
+		rect |= QRect(m.p.px, m.p.py, 1, 1);
+	}
+}
+} // namespace
+
+void ImageViewerWidget::repaint_region(QRect rect)
 {
-	reload_bits();
 	repaint((int)(rect.left() * zoom * pixelsize.high),
 			(int)((height - 1 - rect.bottom()) * zoom * pixelsize.low),
 			(int)ceil(rect.width() * zoom * pixelsize.high),
 			(int)ceil(rect.height() * zoom * pixelsize.low));
 }
 
+void ImageViewerWidget::decorated_changed(const QRect& rect)
+{
+	// slices are stored bottom up
+	pyramid.invalidate(QRect(rect.left(), height - 1 - rect.bottom(), rect.width(), rect.height()));
+}
+
+void ImageViewerWidget::overlay_changed()
+{
+	reload_bits();
+	repaint();
+}
+
+void ImageViewerWidget::overlay_changed(QRect rect)
+{
+	reload_bits(rect);
+	repaint_region(rect);
+}
+
 void ImageViewerWidget::update()
 {
 	QRect rect;
@@ -311,13 +346,11 @@ void ImageViewerWidget::update(QRect rect)
 			workborder_changed();
 			return;
 		}
+		rect = QRect(0, 0, width, height);
 	}
 
-	reload_bits();
-	repaint((int)(rect.left() * zoom * pixelsize.high),
-			(int)((height - 1 - rect.bottom()) * zoom * pixelsize.low),
-			(int)ceil(rect.width() * zoom * pixelsize.high),
-			(int)ceil(rect.height() * zoom * pixelsize.low));
+	reload_bits(rect);
+	repaint_region(rect);
 }
 
 void ImageViewerWidget::init(SlicesHandler* hand3D, bool bmporwork1)
@@ -383,70 +416,162 @@ void ImageViewerWidget::update_range(unsigned short slicenr)
 	}
 }
 
-void ImageViewerWidget::reload_bits()
+bool ImageViewerWidget::update_tissue_lut()
 {
-	auto color_lut = handler3D->GetColorLookupTable();
+	if (!tissue_lut.empty() && tissue_lut_version == TissueInfos::GetVersion())
+		return false;
 
-	float* bmpbits1 = *bmpbits;
-	tissues_size_t* tissue1 = *tissue;
-	unsigned pos = 0;
-	int f;
 	unsigned char r, g, b;
+	tissue_lut.resize(size_t(TissueInfos::GetTissueCount()) + 1);
+	for (size_t i = 0; i < tissue_lut.size(); i++)
+	{
+		std::tie(r, g, b) = TissueInfos::GetTissueColor(static_cast<tissues_size_t>(i)).toUChar();
+		tissue_lut[i] = qRgb(r, g, b);
+	}
+	tissue_lut_version = TissueInfos::GetVersion();
+	return true;
+}
+
+bool ImageViewerWidget::update_color_lut(const std::shared_ptr<ColorLookupTable>& lut)
+{
+	if (lut == color_lut_source && color_lut.size() == lut->NumberOfColors())
+		return false;
 
-	for (int y = height - 1; y >= 0; y--)
+	unsigned char rgb[3];
+	color_lut.resize(lut->NumberOfColors());
+	for (size_t i = 0; i < color_lut.size(); i++)
 	{
-		for (int x = 0; x < width; x++)
-		{
-			if (picturevisible)
-			{
-				if (color_lut && bmporwork)
-				{
-					// \todo not sure if we should allow to 'scale & offset & clamp' when a color lut is available
-					//f = max(0.0f, min(255.0f, scaleoffset + scalefactor * (bmpbits1)[pos]));
-					color_lut->GetColor((bmpbits1)[pos], r, g, b);
-				}
-				else
-				{
-					r = g = b = (int)std::max(0.0f, std::min(255.0f, scaleoffset + scalefactor * (bmpbits1)[pos]));
-				}
+		lut->GetColor(i, rgb);
+		color_lut[i] = qRgb(rgb[0], rgb[1], rgb[2]);
+	}
+	color_lut_source = lut;
+	return true;
+}
 
-				// overlay only visible if picture is visible
-				if (overlayvisible)
-				{
-					f = std::max(0.0f, std::min(255.0f, scaleoffset + scalefactor * (overlaybits)[pos]));
+void ImageViewerWidget::reload_bits()
+{
+	reload_bits(QRect(0, 0, width, height));
+}
 
-					r = (1.0f - overlayalpha) * r + overlayalpha * f;
-					g = (1.0f - overlayalpha) * g + overlayalpha * f;
-					b = (1.0f - overlayalpha) * b + overlayalpha * f;
-				}
+void ImageViewerWidget::reload_bits(QRect region)
+{
+	auto lut = handler3D->GetColorLookupTable();
+	bool const use_lut = picturevisible && lut && bmporwork && lut->NumberOfColors() > 0;
+	bool colors_changed = (use_lut != image_use_lut) || scaleoffset != image_scaleoffset || scalefactor != image_scalefactor;
+	if (use_lut)
+	{
+		colors_changed = update_color_lut(lut) || colors_changed;
+	}
+	if (tissuevisible)
+	{
+		colors_changed = update_tissue_lut() || colors_changed;
+	}
+	image_use_lut = use_lut;
+	image_scaleoffset = scaleoffset;
+	image_scalefactor = scalefactor;
+
+	QRect const all(0, 0, width, height);
+	if (colors_changed)
+	{
+		// pixels outside the region would have stale colors
+		region = all;
+	}
+	region &= all;
+	if (region.isEmpty())
+		return;
+
+	float const* bmpbits1 = *bmpbits;
+	tissues_size_t const* tissue1 = *tissue;
+	int const w = width;
+	int const x0 = region.left(), x1 = region.right() + 1;
+	gray_row.resize(w);
+
+	// same index as vtkLookupTable::GetColor with table range [0, N-1]
+	int const lut_max = static_cast<int>(color_lut.size()) - 1;
+	float const lut_scale = lut_max > 0 ? float(lut_max + 1) / lut_max : 0.f;
+
+	for (int y = region.top(); y <= region.bottom(); y++)
+	{
+		// slices are stored bottom up
+		QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(height - 1 - y));
+		float const* src = bmpbits1 + size_t(y) * w;
+
+		if (!picturevisible)
+		{
+			std::fill(line + x0, line + x1, qRgb(0, 0, 0));
+		}
+		else if (use_lut)
+		{
+			for (int x = x0; x < x1; x++)
+			{
+				float const f = lut_scale * src[x];
+				int const idx = (f > 0.f) ? std::min(static_cast<int>(f), lut_max) : 0;
+				line[x] = color_lut[idx];
 			}
-			else
+		}
+		else
+		{
+			// window/level, simple loop over contiguous data which the compiler vectorizes
+			unsigned char* gray = gray_row.data();
+			for (int x = x0; x < x1; x++)
 			{
-				r = g = b = 0;
+				gray[x] = static_cast<unsigned char>(std::max(0.0f, std::min(255.0f, scaleoffset + scalefactor * src[x])));
 			}
+			for (int x = x0; x < x1; x++)
+			{
+				line[x] = 0xff000000u | (0x010101u * gray[x]);
+			}
+		}
 
-			if (tissuevisible && tissue1[pos] != 0)
+		// overlay only visible if picture is visible
+		if (picturevisible && overlayvisible)
+		{
+			float const* ov = overlaybits + size_t(y) * w;
+			float const a = overlayalpha, a1 = 1.0f - overlayalpha;
+			for (int x = x0; x < x1; x++)
 			{
-				// blend with tissue color
-				auto rgbo = TissueInfos::GetTissueColor(tissue1[pos]);
-				float alpha = 0.5f;
-				r = static_cast<unsigned char>(r + alpha * (255.0f * rgbo[0] - r));
-				g = static_cast<unsigned char>(g + alpha * (255.0f * rgbo[1] - g));
-				b = static_cast<unsigned char>(b + alpha * (255.0f * rgbo[2] - b));
-				image.setPixel(x, y, qRgb(r, g, b));
+				float const f = a * std::max(0.0f, std::min(255.0f, scaleoffset + scalefactor * ov[x]));
+				QRgb const c = line[x];
+				line[x] = qRgb(static_cast<int>(a1 * qRed(c) + f), static_cast<int>(a1 * qGreen(c) + f), static_cast<int>(a1 * qBlue(c) + f));
 			}
-			else // no tissue
+		}
+
+		if (tissuevisible)
+		{
+			// blend 50% with tissue color, per channel (c + t) / 2
+			tissues_size_t const* t = tissue1 + size_t(y) * w;
+			size_t const ntissues = tissue_lut.size();
+			for (int x = x0; x < x1; x++)
 			{
-				image.setPixel(x, y, qRgb(r, g, b));
+				if (t[x] != 0 && t[x] < ntissues)
+				{
+					QRgb const c = line[x], tc = tissue_lut[t[x]];
+					line[x] = 0xff000000u | (((c & 0xfefefe) >> 1) + ((tc & 0xfefefe) >> 1) + (c & tc & 0x010101));
+				}
 			}
-			pos++;
 		}
 	}
 
+	// rows of the region in image coordinates
+	int const row0 = height - 1 - region.bottom(), row1 = height - region.top();
+
 	// copy to decorated image
-	image_decorated = image;
+	if (region == all || image_decorated.size() != image.size())
+	{
+		image_decorated = image;
+	}
+	else
+	{
+		QImage const& source = image;
+		for (int row = row0; row < row1; row++)
+		{
+			QRgb const* line = reinterpret_cast<const QRgb*>(source.scanLine(row));
+			QRgb* line_decorated = reinterpret_cast<QRgb*>(image_decorated.scanLine(row));
+			std::copy(line + x0, line + x1, line_decorated + x0);
+		}
+	}
 
-	// now decorate
+	// now decorate, only pixels inside the region
 	QRgb color_used = actual_color.rgb();
 	QRgb color_dim = (actual_color.light(30)).rgb();
 
@@ -455,38 +580,46 @@ void ImageViewerWidget::reload_bits()
 	{
 		for (auto& p : vp)
 		{
-			image_decorated.setPixel(int(p.px), int(height - p.py - 1), color_dim);
+			if (region.contains(p.px, p.py))
+				image_decorated.setPixel(int(p.px), int(height - p.py - 1), color_dim);
 		}
 	}
 
 	for (auto& p : vp1)
 	{
-		image_decorated.setPixel(int(p.px), int(height - p.py - 1), color_used);
+		if (region.contains(p.px, p.py))
+			image_decorated.setPixel(int(p.px), int(height - p.py - 1), color_used);
 	}
 
+	unsigned char r, g, b;
 	for (auto& m : vm)
 	{
-		std::tie(r, g, b) = TissueInfos::GetTissueColorMapped(m.mark);
-		image_decorated.setPixel(int(m.p.px), int(height - m.p.py - 1), qRgb(r, g, b));
+		if (region.contains(m.p.px, m.p.py))
+		{
+			std::tie(r, g, b) = TissueInfos::GetTissueColorMapped(m.mark);
+			image_decorated.setPixel(int(m.p.px), int(height - m.p.py - 1), qRgb(r, g, b));
+		}
 	}
 
-	if (crosshairxvisible)
+	if (crosshairxvisible && region.top() <= crosshairxpos && crosshairxpos <= region.bottom())
 	{
-		for (int x = 0; x < width; x++)
+		for (int x = x0; x < x1; x++)
 		{
 			image_decorated.setPixel(x, height - 1 - crosshairxpos, qRgb(0, 255, 0));
 			image.setPixel(x, height - 1 - crosshairxpos, qRgb(0, 255, 0));
 		}
 	}
 
-	if (crosshairyvisible)
+	if (crosshairyvisible && x0 <= crosshairypos && crosshairypos < x1)
 	{
-		for (int y = 0; y < height; y++)
+		for (int y = row0; y < row1; y++)
 		{
 			image_decorated.setPixel(crosshairypos, y, qRgb(0, 255, 0));
 			image.setPixel(crosshairypos, y, qRgb(0, 255, 0));
 		}
 	}
+
+	decorated_changed(region);
 }
 
 void ImageViewerWidget::tissue_changed()
@@ -497,11 +630,8 @@ void ImageViewerWidget::tissue_changed()
 
 void ImageViewerWidget::tissue_changed(QRect rect)
 {
-	reload_bits();
-	repaint((int)(rect.left() * zoom * pixelsize.high),
-			(int)((height - 1 - rect.bottom()) * zoom * pixelsize.low),
-			(int)ceil(rect.width() * zoom * pixelsize.high),
-			(int)ceil(rect.height() * zoom * pixelsize.low));
+	reload_bits(rect);
+	repaint_region(rect);
 }
 
 void ImageViewerWidget::mark_changed()
@@ -946,6 +1076,15 @@ void ImageViewerWidget::vp_to_image_decorator()
 		std::tie(r, g, b) = TissueInfos::GetTissueColorMapped(m.mark);
 		image_decorated.setPixel(int(m.p.px), int(height - m.p.py - 1), qRgb(r, g, b));
 	}
+
+	QRect rect;
+	add_points(rect, vp_old);
+	add_points(rect, vp);
+	add_points(rect, vp1_old);
+	add_points(rect, vp1);
+	add_marks(rect, vm_old);
+	add_marks(rect, vm);
+	decorated_changed(rect);
 }
 
 void ImageViewerWidget::vp_changed()
@@ -971,10 +1110,7 @@ void ImageViewerWidget::vp_changed(QRect rect)
 		rect.setRight(rect.right() + 1);
 	if (rect.bottom() + 1 < height)
 		rect.setBottom(rect.bottom() + 1);
-	repaint((int)(rect.left() * zoom * pixelsize.high),
-			(int)((height - 1 - rect.bottom()) * zoom * pixelsize.low),
-			(int)ceil(rect.width() * zoom * pixelsize.high),
-			(int)ceil(rect.height() * zoom * pixelsize.low));
+	repaint_region(rect);
 
 	vp_old = vp;
 	vp1_old = vp1;
@@ -1032,7 +1168,28 @@ void ImageViewerWidget::vp1dyn_changed()
 		image_decorated.setPixel(int(m.p.px), int(height - m.p.py - 1), qRgb(r, g, b));
 	}
 
-	repaint();
+	QRect modified;
+	add_points(modified, vp_old);
+	add_points(modified, vp);
+	add_points(modified, vp1_old);
+	add_points(modified, vp1);
+	add_points(modified, limit_points);
+	add_marks(modified, vm_old);
+	add_marks(modified, vm);
+	decorated_changed(modified);
+
+	// only the area covered by the old and new contours changed
+	QRect rect;
+	add_points(rect, vp1_old);
+	add_points(rect, vp1);
+	add_points(rect, vpdyn_old);
+	add_points(rect, vpdyn);
+	add_marks(rect, vm_old);
+	add_marks(rect, vm);
+	if (!rect.isEmpty())
+	{
+		repaint_region(rect.adjusted(-1, -1, 1, 1));
+	}
 
 	vpdyn_old = vpdyn;
 	vp_old = vp;
@@ -1042,7 +1199,15 @@ void ImageViewerWidget::vp1dyn_changed()
 
 void ImageViewerWidget::vpdyn_changed()
 {
-	repaint();
+	// vpdyn is drawn in paintEvent, repaint where it was and where it is
+	QRect rect;
+	add_points(rect, vpdyn_old);
+	add_points(rect, vpdyn);
+	if (!rect.isEmpty())
+	{
+		repaint_region(rect.adjusted(-1, -1, 1, 1));
+	}
+	vpdyn_old = vpdyn;
 }
 
 void ImageViewerWidget::set_workbordervisible(bool on)
@@ -9,6 +9,8 @@
  */
 #pragma once
 
+#include "ImagePyramid.h"
+
 #include "Data/Mark.h"
 #include "Data/Types.h"
 
@@ -16,6 +18,7 @@
 
 #include <QWidget>
 
+#include <memory>
 #include <vector>
 
 class QAction;
@@ -23,6 +26,7 @@ class QAction;
 namespace iseg {
 
 class bmphandler;
+class ColorLookupTable;
 class SlicesHandler;
 
 class ImageViewerWidget : public QWidget
@@ -88,6 +92,15 @@ signals:
 
 private:
 	void reload_bits();
+	/// Recolor only the pixels in 'region' (slice coordinates), the whole image if the color mapping changed
+	void reload_bits(QRect region);
+	/// Returns true if the table was rebuilt
+	bool update_tissue_lut();
+	bool update_color_lut(const std::shared_ptr<ColorLookupTable>& lut);
+	/// Repaint the widget area showing 'rect' (slice coordinates)
+	void repaint_region(QRect rect);
+	/// Mark the pixels of image_decorated in 'rect' (slice coordinates) as modified
+	void decorated_changed(const QRect& rect);
 	void vp_to_image_decorator();
 	void vp_changed();
 	void vp_changed(QRect rect);
@@ -112,6 +125,16 @@ private:
 
 	QImage image;
 	QImage image_decorated;
+	ImagePyramid pyramid; // levels of image_decorated drawn when zoomed out
+	std::vector<unsigned char> gray_row;
+	std::vector<unsigned> tissue_lut; // qRgb per tissue, rebuilt when TissueInfos::GetVersion changes
+	unsigned tissue_lut_version;
+	std::vector<unsigned> color_lut;
+	std::shared_ptr<ColorLookupTable> color_lut_source;
+	// color mapping used for the pixels in 'image'
+	bool image_use_lut;
+	float image_scaleoffset;
+	float image_scalefactor;
 
 	unsigned short width, height;
 	bmphandler* bmphand;
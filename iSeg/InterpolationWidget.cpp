@@ -203,7 +203,8 @@ void InterpolationWidget::init()
 		brush = new BrushInteraction(handler3D,
 				[this](iseg::DataSelection sel) { begin_datachange(sel, this); },
 				[this](iseg::EndUndoAction a) { end_datachange(this, a); },
-				[this](std::vector<Point>* vp) { vpdyn_changed(vp);} );
+				[this](std::vector<Point>* vp) { vpdyn_changed(vp);},
+				[this](Point lo, Point hi) { region_changed(QRect(lo.px, lo.py, hi.px - lo.px + 1, hi.py - lo.py + 1)); });
 		brush_changed();
 	}
 	else
@@ -355,33 +356,14 @@ void InterpolationWidget::execute()
 
 				if (cb_medianset->isChecked())
 				{
-					unsigned short batchstart;
-					for (batchstart = startnr;
-							 batchstart <= current - batchstride;
-							 batchstart += batchstride)
+					for (const auto& batch : SlicesHandler::batch_intervals(startnr, current, batchstride))
 					{
-						handler3D->interpolateworkgrey_medianset(batchstart, batchstart + batchstride, rb_8connectivity->isChecked());
-					}
-					// Last batch with smaller stride
-					if (batchstart > current && current - (batchstart - batchstride) >= 2)
-					{
-						handler3D->interpolateworkgrey_medianset(batchstart - batchstride, current, rb_8connectivity->isChecked());
+						handler3D->interpolateworkgrey_medianset(batch.first, batch.second, rb_8connectivity->isChecked());
 					}
 				}
 				else
 				{
-					unsigned short batchstart;
-					for (batchstart = startnr;
-							 batchstart <= current - batchstride;
-							 batchstart += batchstride)
-					{
-						handler3D->interpolateworkgrey(batchstart, batchstart + batchstride, connected);
-					}
-					// Last batch with smaller stride
-					if (batchstart > current && current - (batchstart - batchstride) >= 2)
-					{
-						handler3D->interpolateworkgrey(batchstart - batchstride, current, connected);
-					}
+					handler3D->interpolateworkgrey_batch(startnr, current, batchstride, connected);
 				}
 			}
 			else if (rb_tissue->isChecked())
@@ -391,33 +373,14 @@ void InterpolationWidget::execute()
 
 				if (cb_medianset->isChecked())
 				{
-					unsigned short batchstart;
-					for (batchstart = startnr;
-							 batchstart <= current - batchstride;
-							 batchstart += batchstride)
-					{
-						handler3D->interpolatetissue_medianset(batchstart, batchstart + batchstride, tissuenr, rb_8connectivity->isChecked());
-					}
-					// Last batch with smaller stride
-					if (batchstart > current && current - (batchstart - batchstride) >= 2)
+					for (const auto& batch : SlicesHandler::batch_intervals(startnr, current, batchstride))
 					{
-						handler3D->interpolatetissue_medianset(batchstart - batchstride, current, tissuenr, rb_8connectivity->isChecked());
+						handler3D->interpolatetissue_medianset(batch.first, batch.second, tissuenr, rb_8connectivity->isChecked());
 					}
 				}
 				else
 				{
-					unsigned short batchstart;
-					for (batchstart = startnr;
-							 batchstart <= current - batchstride;
-							 batchstart += batchstride)
-					{
-						handler3D->interpolatetissue(batchstart, batchstart + batchstride, tissuenr, connected);
-					}
-					// Last batch with smaller stride
-					if (batchstart > current && current - (batchstart - batchstride) >= 2)
-					{
-						handler3D->interpolatetissue(batchstart - batchstride, current, tissuenr, connected);
-					}
+					handler3D->interpolatetissue_batch(startnr, current, batchstride, tissuenr, connected);
 				}
 			}
 			else if (rb_tissueall->isChecked())
@@ -425,37 +388,15 @@ void InterpolationWidget::execute()
 				dataSelection.tissues = true;
 				emit begin_datachange(dataSelection, this);
 
-				if (cb_medianset->isChecked())
-				{
-					unsigned short batchstart;
-					for (batchstart = startnr;
-							 batchstart <= current - batchstride;
-							 batchstart += batchstride)
-					{
-						handler3D->interpolatetissuegrey_medianset(batchstart, batchstart + batchstride,
-								rb_8connectivity->isChecked());
-					}
-					// Last batch with smaller stride
-					if (batchstart > current &&
-							current - (batchstart - batchstride) >= 2)
-					{
-						handler3D->interpolatetissuegrey_medianset(batchstart - batchstride, current, rb_8connectivity->isChecked());
-					}
-				}
-				else
+				for (const auto& batch : SlicesHandler::batch_intervals(startnr, current, batchstride))
 				{
-					unsigned short batchstart;
-					for (batchstart = startnr;
-							 batchstart <= current - batchstride;
-							 batchstart += batchstride)
+					if (cb_medianset->isChecked())
 					{
-						handler3D->interpolatetissuegrey(batchstart, batchstart + batchstride);
+						handler3D->interpolatetissuegrey_medianset(batch.first, batch.second, rb_8connectivity->isChecked());
 					}
-					// Last batch with smaller stride
-					if (batchstart > current &&
-							current - (batchstart - batchstride) >= 2)
+					else
 					{
-						handler3D->interpolatetissuegrey(batchstart - batchstride, current);
+						handler3D->interpolatetissuegrey(batch.first, batch.second);
 					}
 				}
 			}
@@ -68,6 +68,7 @@
 #include <QShortcut>
 #include <QSignalMapper>
 #include <QStackedWidget>
+#include <QTimer>
 #include <qapplication.h>
 #include <qdockwidget.h>
 #include <qmenubar.h>
@@ -1662,6 +1663,8 @@ MainWindow::MainWindow(SlicesHandler* hand3D, const QString& locationstring,
 		QObject::connect(widget,
 				SIGNAL(end_datachange(QWidget*, iseg::EndUndoAction)), this,
 				SLOT(handle_end_datachange(QWidget*, iseg::EndUndoAction)));
+		QObject::connect(widget, SIGNAL(region_changed(QRect)), this,
+				SLOT(handle_region_changed(QRect)));
 	}
 
 	QObject::connect(bmp_show, SIGNAL(mousePosZoom_sign(QPoint)), this,
@@ -1713,6 +1716,36 @@ MainWindow::MainWindow(SlicesHandler* hand3D, const QString& locationstring,
 
 	m_Modified = false;
 	m_NewDataAfterSwap = false;
+
+	m_autosave_interval = 0;
+	m_autosave_timer = new QTimer(this);
+	QObject::connect(m_autosave_timer, SIGNAL(timeout()), this, SLOT(execute_autosave()));
+}
+
+void MainWindow::SetAutoSaveInterval(unsigned minutes)
+{
+	m_autosave_interval = minutes;
+	if (minutes > 0)
+	{
+		m_autosave_timer->start(minutes * 60 * 1000);
+	}
+	else
+	{
+		m_autosave_timer->stop();
+	}
+}
+
+void MainWindow::execute_autosave()
+{
+	if (m_autosave_interval == 0 || m_saveprojfilename.isEmpty() || !handler3D->has_unsaved_changes())
+		return;
+
+	// copies at most 256 MB per run, the remaining slices are written shortly after
+	bool started = m_autosave.run(handler3D, AutoSave::file_name(m_saveprojfilename.toStdString()), size_t(256) << 20);
+	if (!started || m_autosave.pending())
+	{
+		QTimer::singleShot(1000, this, SLOT(execute_autosave()));
+	}
 }
 
 void MainWindow::closeEvent(QCloseEvent* qce)
@@ -1747,6 +1780,7 @@ void MainWindow::closeEvent(QCloseEvent* qce)
 
 		SaveSettings();
 		SaveLoadProj(m_loadprojfilename.m_filename);
+		m_autosave.discard();
 		QMainWindow::closeEvent(qce);
 	}
 	else
@@ -2783,7 +2817,14 @@ void MainWindow::execute_loadsurface()
 		if (overwrite == 2)
 			return;
 
+		iseg::DataSelection dataSelection;
+		dataSelection.allSlices = true;
+		dataSelection.work = true;
+		emit begin_datachange(dataSelection, this, true);
+
 		ok = handler3D->LoadSurface(loadfilename.toStdString(), overwrite == 0, intersect);
+
+		emit end_datachange(this, iseg::EndUndo);
 	}
 
 	if (ok)
@@ -2957,7 +2998,8 @@ void MainWindow::execute_saveprojas()
 		//m_saveprojfilename = tempFileName;
 		//AddLoadProj(tempFileName);
 		AddLoadProj(m_saveprojfilename);
-		FILE* fp = handler3D->SaveProject(tempFileName.ascii(), "xmf");
+		FILE* fp = handler3D->SaveProject(tempFileName.ascii(),
+				handler3D->GetNativeProjectFormat() ? "isv" : "xmf", savefilename.ascii());
 		fp = bitstack_widget->save_proj(fp);
 		unsigned short saveProjVersion = 12;
 		fp = TissueInfos::SaveTissues(fp, saveProjVersion);
@@ -3121,9 +3163,15 @@ void MainWindow::SaveSettings()
 	settings.setValue("geometry", saveGeometry());
 	settings.setValue("state", saveState());
 	settings.setValue("NumberOfUndoSteps", this->handler3D->GetNumberOfUndoSteps());
-	settings.setValue("NumberOfUndoArrays", this->handler3D->GetNumberOfUndoArrays());
+	settings.setValue("UndoMemoryBudget", this->handler3D->GetUndoMemoryBudget());
+	settings.setValue("UndoDiskBudget", this->handler3D->GetUndoDiskBudget());
 	settings.setValue("Compression", this->handler3D->GetCompression());
 	settings.setValue("ContiguousMemory", this->handler3D->GetContiguousMemory());
+	settings.setValue("ContiguousStorage", this->handler3D->GetContiguousStorage());
+	settings.setValue("LazyLoading", this->handler3D->GetLazyLoading());
+	settings.setValue("LazyLoadCache", this->handler3D->GetLazyLoadCache());
+	settings.setValue("NativeProjectFormat", this->handler3D->GetNativeProjectFormat());
+	settings.setValue("AutoSaveInterval", GetAutoSaveInterval());
 	settings.setValue("BloscEnabled", BloscEnabled());
 	settings.endGroup();
 	settings.beginGroup("RecentPlaces");
@@ -3256,9 +3304,15 @@ void MainWindow::LoadSettings(const char* loadfilename)
 		restoreGeometry(settings.value("geometry").toByteArray());
 		restoreState(settings.value("state").toByteArray());
 		this->handler3D->SetNumberOfUndoSteps(settings.value("NumberOfUndoSteps", 50).toUInt());
-		this->handler3D->SetNumberOfUndoArrays(settings.value("NumberOfUndoArrays", 20).toUInt());
+		this->handler3D->SetUndoMemoryBudget(settings.value("UndoMemoryBudget", 512).toUInt());
+		this->handler3D->SetUndoDiskBudget(settings.value("UndoDiskBudget", 0).toUInt());
 		this->handler3D->SetCompression(settings.value("Compression", 0).toInt());
 		this->handler3D->SetContiguousMemory(settings.value("ContiguousMemory", true).toBool());
+		this->handler3D->SetContiguousStorage(settings.value("ContiguousStorage", false).toBool());
+		this->handler3D->SetLazyLoading(settings.value("LazyLoading", false).toBool());
+		this->handler3D->SetLazyLoadCache(settings.value("LazyLoadCache", 256).toUInt());
+		this->handler3D->SetNativeProjectFormat(settings.value("NativeProjectFormat", false).toBool());
+		SetAutoSaveInterval(settings.value("AutoSaveInterval", 5).toUInt());
 		SetBloscEnabled(settings.value("BloscEnabled", false).toBool());
 		settings.endGroup();
 
@@ -3387,7 +3441,8 @@ void MainWindow::execute_saveproj()
 			m_saveprojfilename = tempFileName;
 
 			//FILE *fp=handler3D->SaveProject(m_saveprojfilename.ascii(),"xmf");
-			FILE* fp = handler3D->SaveProject(tempFileName.ascii(), "xmf");
+			FILE* fp = handler3D->SaveProject(tempFileName.ascii(),
+					handler3D->GetNativeProjectFormat() ? "isv" : "xmf", (sourceFileNameWithoutExtension + ".prj").ascii());
 			fp = bitstack_widget->save_proj(fp);
 			unsigned short saveProjVersion = 12;
 			fp = TissueInfos::SaveTissues(fp, saveProjVersion);
@@ -3526,6 +3581,8 @@ void MainWindow::loadproj(const QString& loadfilename)
 	}
 
 	emit end_datachange(this, iseg::ClearUndo);
+	handler3D->mark_clean();
+
 	tissuenr_changed(tissueTreeWidget->get_current_type() - 1);
 
 	pixelsize_changed();
@@ -3573,6 +3630,34 @@ void MainWindow::loadproj(const QString& loadfilename)
 		fclose(fp);
 	}
 
+	// changes which were autosaved but not saved, e.g. before a crash
+	QString autosavefilename = ToQ(AutoSave::file_name(loadfilename.toStdString()));
+	if (stillopen && QFile::exists(autosavefilename) &&
+			QFileInfo(autosavefilename).lastModified() > QFileInfo(loadfilename).lastModified())
+	{
+		if (QMessageBox::question(this, "iSeg",
+						"The project has autosaved changes which were not saved.\n"
+						"Would you like to restore them?",
+						QMessageBox::Yes | QMessageBox::Default,
+						QMessageBox::No) == QMessageBox::Yes)
+		{
+			emit begin_datachange(dataSelection, this, false);
+			if (!handler3D->RestoreAutoSave(autosavefilename.ascii()))
+			{
+				QMessageBox::warning(this, "iSeg", "Could not restore the autosaved changes.");
+			}
+			else if (AutoSave::restore_tissues(autosavefilename.toStdString()))
+			{
+				// tissues may have been added after the project was saved
+				tissueTreeWidget->update_tree_widget();
+				tissueTreeWidget->update_tissue_icons();
+				tissueTreeWidget->update_folder_icons();
+				tissuenr_changed(tissueTreeWidget->get_current_type() - 1);
+			}
+			emit end_datachange(this, iseg::ClearUndo);
+		}
+	}
+
 	reset_brightnesscontrast();
 
 	EnableActionsAfterPrjLoaded(true);
@@ -4360,9 +4445,21 @@ void MainWindow::update_bmp()
 	}
 }
 
+QRect MainWindow::changed_region() const
+{
+	// only changes of the displayed slice can be repainted partially
+	if (changeData.allSlices || changeData.sliceNr != handler3D->active_slice())
+		return QRect();
+	return changeRegion;
+}
+
 void MainWindow::update_work()
 {
-	work_show->update();
+	QRect const region = changed_region();
+	if (region.isValid())
+		work_show->update(region);
+	else
+		work_show->update();
 
 	if (xsliceshower != nullptr)
 	{
@@ -4376,8 +4473,17 @@ void MainWindow::update_work()
 
 void MainWindow::update_tissue()
 {
-	bmp_show->tissue_changed();
-	work_show->tissue_changed();
+	QRect const region = changed_region();
+	if (region.isValid())
+	{
+		bmp_show->tissue_changed(region);
+		work_show->tissue_changed(region);
+	}
+	else
+	{
+		bmp_show->tissue_changed();
+		work_show->tissue_changed();
+	}
 	if (xsliceshower != nullptr)
 		xsliceshower->tissue_changed();
 	if (ysliceshower != nullptr)
@@ -6447,6 +6553,15 @@ void MainWindow::execute_undo()
 			selectedData = handler3D->undo();
 		}
 
+		// an undo step can cover several slices
+		auto const undone = handler3D->undone_slices();
+		if (surface_viewer != nullptr)
+			surface_viewer->slices_changed(selectedData, undone.first, undone.second);
+		if (VV3D != nullptr)
+			VV3D->slices_changed(selectedData, undone.first, undone.second);
+		if (VV3Dbmp != nullptr)
+			VV3Dbmp->slices_changed(selectedData, undone.first, undone.second);
+
 		// Update ranges
 		update_ranges_helper();
 
@@ -6476,6 +6591,15 @@ void MainWindow::execute_redo()
 		selectedData = handler3D->redo();
 	}
 
+	// an undo step can cover several slices
+	auto const undone = handler3D->undone_slices();
+	if (surface_viewer != nullptr)
+		surface_viewer->slices_changed(selectedData, undone.first, undone.second);
+	if (VV3D != nullptr)
+		VV3D->slices_changed(selectedData, undone.first, undone.second);
+	if (VV3Dbmp != nullptr)
+		VV3Dbmp->slices_changed(selectedData, undone.first, undone.second);
+
 	// Update ranges
 	update_ranges_helper();
 
@@ -7234,38 +7358,32 @@ void MainWindow::execute_remove_unused_tissues()
 
 void MainWindow::execute_cleanup()
 {
-	tissues_size_t** slices = new tissues_size_t*[handler3D->end_slice() - handler3D->start_slice()];
+	int rate, minsize;
+	CleanerParams CP(&rate, &minsize);
+	CP.exec();
+	if (rate == 0 && minsize == 0)
+		return;
+
+	std::vector<tissues_size_t*> slices;
 	tissuelayers_size_t activelayer = handler3D->active_tissuelayer();
 	for (unsigned short i = handler3D->start_slice(); i < handler3D->end_slice(); i++)
 	{
-		slices[i - handler3D->start_slice()] = handler3D->return_tissues(activelayer, i);
+		slices.push_back(handler3D->return_tissues(activelayer, i));
 	}
 	TissueCleaner TC(
-			slices, handler3D->end_slice() - handler3D->start_slice(),
+			slices.data(), handler3D->end_slice() - handler3D->start_slice(),
 			handler3D->width(), handler3D->height());
-	if (!TC.Allocate())
-	{
-		QMessageBox::information(this, "iSeg", "Not enough memory.\nThis operation cannot be performed.\n");
-	}
-	else
-	{
-		int rate, minsize;
-		CleanerParams CP(&rate, &minsize);
-		CP.exec();
-		if (rate == 0 && minsize == 0)
-			return;
 
-		iseg::DataSelection dataSelection;
-		dataSelection.allSlices = true;
-		dataSelection.tissues = true;
-		emit begin_datachange(dataSelection, this);
+	iseg::DataSelection dataSelection;
+	dataSelection.allSlices = true;
+	dataSelection.tissues = true;
+	emit begin_datachange(dataSelection, this);
 
-		TC.ConnectedComponents();
-		TC.MakeStat();
-		TC.Clean(1.0f / rate, minsize);
+	TC.ConnectedComponents();
+	TC.MakeStat();
+	TC.Clean(1.0f / rate, minsize);
 
-		emit end_datachange(this);
-	}
+	emit end_datachange(this);
 }
 
 void MainWindow::wheelrotated(int delta)
@@ -7432,6 +7550,17 @@ void MainWindow::handle_end_datachange(QWidget* sender, iseg::EndUndoAction undo
 	// End undo
 	end_undo_helper(undoAction);
 
+	// Slices to write on next save of a native project
+	handler3D->mark_dirty(changeData);
+
+	// Surface and volume of the modified slices are reloaded on next update
+	if (surface_viewer != nullptr)
+		surface_viewer->slices_changed(changeData);
+	if (VV3D != nullptr)
+		VV3D->slices_changed(changeData);
+	if (VV3Dbmp != nullptr)
+		VV3Dbmp->slices_changed(changeData);
+
 	// Handle 3d data change
 	if (changeData.allSlices)
 	{
@@ -7490,10 +7619,22 @@ void MainWindow::handle_end_datachange(QWidget* sender, iseg::EndUndoAction undo
 		QObject::connect(this, SIGNAL(tissues_changed()), sender, SLOT(tissues_changed()));
 		QObject::connect(this, SIGNAL(marks_changed()), sender, SLOT(marks_changed()));
 	}
+
+	changeRegion = QRect();
+}
+
+void MainWindow::handle_region_changed(QRect rect)
+{
+	changeRegion |= rect;
 }
 
 void MainWindow::DatasetChanged()
 {
+	// the source of all slices was replaced
+	iseg::DataSelection dataSelection;
+	dataSelection.allSlices = true;
+	dataSelection.bmp = true;
+	handler3D->mark_dirty(dataSelection);
 	emit bmp_changed();
 
 	reset_brightnesscontrast();
@@ -7548,6 +7689,12 @@ void MainWindow::cancel_transform_helper()
 	// Signal changed data
 	bool bmp, work, tissues;
 	transform_widget->GetDataSelection(bmp, work, tissues);
+	iseg::DataSelection dataSelection;
+	dataSelection.allSlices = true;
+	dataSelection.bmp = bmp;
+	dataSelection.work = work;
+	dataSelection.tissues = tissues;
+	handler3D->mark_dirty(dataSelection);
 	if (bmp)
 	{
 		emit bmp_changed();
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "Atlas.h"
+#include "AutoSave.h"
 #include "Project.h"
 
 #include "Data/DataSelection.h"
@@ -39,6 +40,7 @@ class QStackedWidget;
 class QScrollBar;
 class Q3ScrollView;
 class QAction;
+class QTimer;
 
 namespace iseg {
 
@@ -103,6 +105,9 @@ public:
 	void LoadSettings(const char* loadfilename);
 	void loadproj(const QString& loadfilename);
 	void loadS4Llink(const QString& loadfilename);
+	/// Minutes between autosaves of modified slices, 0 disables autosave
+	unsigned GetAutoSaveInterval() const { return m_autosave_interval; }
+	void SetAutoSaveInterval(unsigned minutes);
 
 protected:
 	void start_surfaceviewer(int mode);
@@ -112,6 +117,7 @@ protected:
 	void modifTissue();
 	void modifFolder();
 	void end_undo_helper(iseg::EndUndoAction undoAction);
+	QRect changed_region() const;
 	void cancel_transform_helper();
 	void update_ranges_helper();
 	void pixelsize_changed();
@@ -317,9 +323,14 @@ private:
 	bool undoStarted;
 	bool canUndo3D;
 	iseg::DataSelection changeData;
+	QRect changeRegion; // modified pixels of the active slice, empty if unknown
 	bool m_NewDataAfterSwap;
+	AutoSave m_autosave;
+	QTimer* m_autosave_timer;
+	unsigned m_autosave_interval;
 
 private slots:
+	void execute_autosave();
 	void update_bmp();
 	void update_work();
 	void update_tissue();
@@ -549,6 +560,7 @@ private slots:
 			QWidget* sender = nullptr, bool beginUndo = true);
 	void handle_end_datachange(QWidget* sender = nullptr,
 			iseg::EndUndoAction undoAction = iseg::EndUndo);
+	void handle_region_changed(QRect rect);
 
 	void handle_begin_dataexport(iseg::DataSelection& dataSelection, QWidget* sender = nullptr);
 	void handle_end_dataexport(QWidget* sender = nullptr);
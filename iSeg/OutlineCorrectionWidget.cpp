@@ -201,6 +201,22 @@ void OutlineCorrectionWidget::draw_circle(Point p)
 	vpdyn.clear();
 }
 
+QRect OutlineCorrectionWidget::brush_region(Point p1, Point p2) const
+{
+	float const radius = brush_params->_radius->text().toFloat();
+	int xradius = static_cast<int>(radius);
+	int yradius = xradius;
+	if (brush_params->_unit_mm->isChecked())
+	{
+		// the brush rounds the radius to the larger spacing
+		float const r = radius + std::max(spacing[0], spacing[1]);
+		xradius = static_cast<int>(std::ceil(r / spacing[0]));
+		yradius = static_cast<int>(std::ceil(r / spacing[1]));
+	}
+	return QRect(QPoint(std::min(p1.px, p2.px) - xradius, std::min(p1.py, p2.py) - yradius),
+			QPoint(std::max(p1.px, p2.px) + xradius, std::max(p1.py, p2.py) + yradius));
+}
+
 void OutlineCorrectionWidget::draw_guide()
 {
 	if (brush->isChecked() && brush_params->_show_guide->isChecked())
@@ -394,6 +410,7 @@ void OutlineCorrectionWidget::on_mouse_clicked(Point p)
 			else
 				bmphand->brushtissue(idx, tissuenr, p, static_cast<int>(radius), draw, tissuenrnew);
 		}
+		emit region_changed(brush_region(p, p));
 		emit end_datachange(this, iseg::NoUndo);
 
 		draw_circle(p);
@@ -440,6 +457,7 @@ void OutlineCorrectionWidget::on_mouse_moved(Point p)
 						bmphand->brushtissue(idx, tissuenr, *it, static_cast<int>(radius), draw, tissuenrnew);
 				}
 			}
+			emit region_changed(brush_region(last_pt, p));
 			emit end_datachange(this, iseg::NoUndo);
 			last_pt = p;
 		}
@@ -507,6 +525,7 @@ void OutlineCorrectionWidget::on_mouse_released(Point p)
 				}
 			}
 
+			emit region_changed(brush_region(last_pt, p));
 			emit end_datachange(this);
 
 			vpdyn.clear();
@@ -637,7 +656,6 @@ void OutlineCorrectionWidget::execute_pushed()
 			{
 				if (mm_unit)
 				{
-					// \warning creates block shaped kernel, instead of ellipsoid
 					if (dataSelection.work)
 					{
 						float setto = handler3D->add_skin3D_outside2(rx, ry, rz);
@@ -683,7 +701,6 @@ void OutlineCorrectionWidget::execute_pushed()
 			{
 				if (mm_unit)
 				{
-					// \warning creates block shaped kernel, instead of ellipsoid
 					if (dataSelection.work)
 					{
 						float setto = handler3D->add_skin3D(rx, ry, rz);
@@ -61,6 +61,8 @@ private:
 	void on_mouse_moved(Point p) override;
 
 	void draw_circle(Point p);
+	/// Bounding box of the brush moved from p1 to p2
+	QRect brush_region(Point p1, Point p2) const;
 
 	float get_object_value() const;
 
@@ -109,6 +109,9 @@ SaveOutlinesWidget::SaveOutlinesWidget(SlicesHandler* hand3D, QWidget* parent,
 	cb_marchingcubes = new QCheckBox("Use Marching Cubes (faster)", hbox9);
 	cb_marchingcubes->setChecked(true);
 
+	cb_parallel = new QCheckBox("Parallel", hbox9);
+	cb_parallel->setChecked(true);
+
 	lb_between = new QLabel("Interpol. Slices: ", hboxslicesbetween);
 	sb_between = new QSpinBox(0, 10, 1, hboxslicesbetween);
 	sb_between->setValue(0);
@@ -271,9 +274,13 @@ void SaveOutlinesWidget::save_pushed()
 			if (cb_marchingcubes->isChecked())
 				usemc = true;
 
+			// one block per thread
+			unsigned blocks = cb_parallel->isChecked() ? 0 : 1;
+
 			// Call method to extract surface, smooth, simplify and finally save it to file
 			int numberOfErrors = handler3D->extract_tissue_surfaces(
-				loadfilename.ascii(), vtissues, usemc, ratio, smoothingiter);
+				loadfilename.ascii(), vtissues, usemc, ratio, smoothingiter,
+				0.1f, 180, blocks);
 
 			if (numberOfErrors < 0)
 			{
@@ -85,6 +85,7 @@ private:
 	QCheckBox* cb_extrusion;
 	QCheckBox* cb_smooth;
 	QCheckBox* cb_marchingcubes;
+	QCheckBox* cb_parallel;
 
 private slots:
 	void mode_changed();
@@ -33,6 +33,16 @@ Settings::Settings(QWidget* parent)
 	this->ui->checkBoxContiguousMemory->setChecked(
 		mainWindow->handler3D->GetContiguousMemory());
 	this->ui->checkBoxEnableBlosc->setChecked(BloscEnabled());
+	this->ui->checkBoxContiguousStorage->setChecked(
+		mainWindow->handler3D->GetContiguousStorage());
+	this->ui->checkBoxLazyLoading->setChecked(
+		mainWindow->handler3D->GetLazyLoading());
+	this->ui->spinBoxLazyLoadCache->setValue(
+		mainWindow->handler3D->GetLazyLoadCache());
+	this->ui->checkBoxNativeProjectFormat->setChecked(
+		mainWindow->handler3D->GetNativeProjectFormat());
+	this->ui->spinBoxAutoSaveInterval->setValue(
+		mainWindow->GetAutoSaveInterval());
 }
 
 Settings::~Settings() { delete ui; }
@@ -45,6 +55,16 @@ void Settings::accept()
 	mainWindow->handler3D->SetContiguousMemory(
 		this->ui->checkBoxContiguousMemory->isChecked());
 	SetBloscEnabled(this->ui->checkBoxEnableBlosc->isChecked());
+	mainWindow->handler3D->SetContiguousStorage(
+		this->ui->checkBoxContiguousStorage->isChecked());
+	mainWindow->handler3D->SetLazyLoading(
+		this->ui->checkBoxLazyLoading->isChecked());
+	mainWindow->handler3D->SetLazyLoadCache(
+		this->ui->spinBoxLazyLoadCache->value());
+	mainWindow->handler3D->SetNativeProjectFormat(
+		this->ui->checkBoxNativeProjectFormat->isChecked());
+	mainWindow->SetAutoSaveInterval(
+		this->ui->spinBoxAutoSaveInterval->value());
 
 	mainWindow->SaveSettings();
 	this->hide();
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#include "Precompiled.h"
+
+#include "SliceVector.h"
+#include "bmp_read_1.h"
+
+#include "Data/Logger.h"
+
+#include "Core/HDF5SliceCache.h"
+
+#include <algorithm>
+
+namespace iseg {
+
+SliceVector::SliceVector() : _lazy(false), _pending(0) {}
+
+SliceVector::~SliceVector() { reset_lazy(); }
+
+bmphandler& SliceVector::operator[](size_t i)
+{
+	if (_lazy && !_resident[i])
+		fetch(i);
+	return _slices[i];
+}
+
+const bmphandler& SliceVector::operator[](size_t i) const
+{
+	if (_lazy && !_resident[i])
+		fetch(i);
+	return _slices[i];
+}
+
+void SliceVector::resize(size_t n)
+{
+	reset_lazy();
+	_slices.resize(n);
+}
+
+void SliceVector::clear()
+{
+	reset_lazy();
+	_slices.clear();
+}
+
+std::vector<bmphandler>::iterator SliceVector::begin() { return _slices.begin(); }
+
+std::vector<bmphandler>::iterator SliceVector::end() { return _slices.end(); }
+
+void SliceVector::set_lazy(std::unique_ptr<HDF5SliceCache> cache, const loaded_callback_type& loaded)
+{
+	reset_lazy();
+	if (!cache || !cache->is_open() || _slices.empty())
+		return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_cache = std::move(cache);
+	_loaded = loaded;
+	_pending = _slices.size();
+	_resident.reset(new std::atomic<bool>[_slices.size()]);
+	for (size_t i = 0; i < _slices.size(); i++)
+	{
+		_resident[i] = false;
+	}
+	_lazy = true;
+}
+
+void SliceVector::set_cache_budget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_cache)
+	{
+		_cache->set_budget(bytes);
+	}
+}
+
+void SliceVector::copy_slice(size_t i, float* bmp, float* work, tissues_size_t* tissues) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	bmphandler& slice = _slices[i];
+	unsigned const n = slice.return_area();
+	std::copy(slice.return_bmp(), slice.return_bmp() + n, bmp);
+	std::copy(slice.return_work(), slice.return_work() + n, work);
+	std::copy(slice.return_tissues(0), slice.return_tissues(0) + n, tissues);
+
+	if (_lazy && !_resident[i] && !_cache->read(i, bmp, work, tissues))
+	{
+		ISEG_ERROR("could not read slice " << i);
+	}
+}
+
+void SliceVector::reset_lazy()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_lazy = false;
+	_cache.reset();
+	_resident.reset();
+	_loaded = loaded_callback_type();
+	_pending = 0;
+}
+
+void SliceVector::fetch(size_t i) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_lazy || _resident[i])
+		return;
+
+	bmphandler& slice = _slices[i];
+	if (!_cache->read(i, slice.return_bmp(), slice.return_work(), slice.return_tissues(0)))
+	{
+		ISEG_ERROR("could not read slice " << i);
+	}
+	_resident[i] = true;
+
+	if (_loaded)
+	{
+		_loaded(i, slice);
+	}
+
+	if (--_pending == 0)
+	{
+		// everything is in memory, release the file
+		ISEG_INFO_MSG("all slices loaded");
+		_lazy = false;
+		_cache.reset();
+	}
+}
+
+} // namespace iseg
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018 The Foundation for Research on Information Technologies in Society (IT'IS).
+ *
+ * This file is part of iSEG
+ * (see https://github.com/ITISFoundation/osparc-iseg).
+ *
+ * This software is released under the MIT License.
+ *  https://opensource.org/licenses/MIT
+ */
+#pragma once
+
+#include "Data/Types.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace iseg {
+
+class bmphandler;
+class HDF5SliceCache;
+
+/** \brief The slices of a SlicesHandler
+ *
+ * In lazy mode (see set_lazy) the image data of a slice is read from an
+ * HDF5SliceCache the first time the slice is accessed via operator[], which is
+ * thread-safe. Once all slices have been read the file is closed.
+ *
+ * Iterating with begin()/end() does not load slices.
+ */
+class SliceVector
+{
+public:
+	typedef std::function<void(size_t, bmphandler&)> loaded_callback_type;
+
+	SliceVector();
+	~SliceVector();
+
+	bmphandler& operator[](size_t i);
+	const bmphandler& operator[](size_t i) const;
+
+	/// Resizing or clearing the slices ends lazy mode
+	void resize(size_t n);
+	void clear();
+	bool empty() const { return _slices.empty(); }
+	size_t size() const { return _slices.size(); }
+
+	std::vector<bmphandler>::iterator begin();
+	std::vector<bmphandler>::iterator end();
+
+	/// Read source, target and tissue layer 0 of each slice from 'cache' on first access, 'loaded' is called after reading a slice
+	void set_lazy(std::unique_ptr<HDF5SliceCache> cache, const loaded_callback_type& loaded = loaded_callback_type());
+	bool is_lazy() const { return _lazy; }
+	/// True if the image data of slice i is in memory
+	bool is_resident(size_t i) const { return !_lazy || _resident[i]; }
+	/// Budget in bytes for decompressed blocks held by the cache
+	void set_cache_budget(size_t bytes);
+	/// Copy source, target and tissue layer 0 of slice i into the buffers, a slice which is not resident is read from the file but not kept
+	void copy_slice(size_t i, float* bmp, float* work, tissues_size_t* tissues) const;
+
+private:
+	SliceVector(const SliceVector&) = delete;
+	SliceVector& operator=(const SliceVector&) = delete;
+
+	void fetch(size_t i) const;
+	void reset_lazy();
+
+	mutable std::vector<bmphandler> _slices;
+	mutable std::mutex _mutex;
+	mutable std::unique_ptr<HDF5SliceCache> _cache;
+	mutable std::unique_ptr<std::atomic<bool>[]> _resident;
+	mutable std::atomic<bool> _lazy;
+	mutable size_t _pending;
+	loaded_callback_type _loaded;
+};
+
+} // namespace iseg
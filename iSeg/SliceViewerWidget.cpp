@@ -85,7 +85,9 @@ void bmptissuesliceshower::paintEvent(QPaintEvent* e)
 		QPainter painter(this);
 		painter.setClipRect(e->rect());
 		painter.scale(d * zoom, thickness * zoom);
-		painter.drawImage(0, 0, image);
+		int factor = 1;
+		const QImage& level = pyramid.level(image, zoom * std::max(d, thickness), factor);
+		painter.drawImage(QRectF(0, 0, level.width() * factor, level.height() * factor), level);
 	}
 }
 
@@ -197,17 +199,18 @@ void bmptissuesliceshower::reload_bits()
 		unsigned char r, g, b;
 		for (int y = 0; y < height; y++)
 		{
+			QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
 			for (int x = 0; x < width; x++)
 			{
 				f = (int)std::max(0.0f, std::min(255.0f, scaleoffset + scalefactor * (bmpbits)[pos]));
 				if (tissue[pos] == 0)
 				{
-					image.setPixel(x, y, qRgb(int(f), int(f), int(f)));
+					line[x] = qRgb(int(f), int(f), int(f));
 				}
 				else
 				{
 					TissueInfos::GetTissueColorBlendedRGB(tissue[pos], r, g, b, f);
-					image.setPixel(x, y, qRgb(r, g, b));
+					line[x] = qRgb(r, g, b);
 				}
 				pos++;
 			}
@@ -226,10 +229,11 @@ void bmptissuesliceshower::reload_bits()
 			scalefactor = scalefactorwork;
 		for (int y = 0; y < height; y++)
 		{
+			QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
 			for (int x = 0; x < width; x++)
 			{
 				f = (int)std::max(0.0f, std::min(255.0f, scaleoffset + scalefactor * (bmpbits)[pos]));
-				image.setPixel(x, y, qRgb(f, f, f));
+				line[x] = qRgb(f, f, f);
 				pos++;
 			}
 		}
@@ -250,6 +254,8 @@ void bmptissuesliceshower::reload_bits()
 			image.setPixel(xypos, y, qRgb(0, 255, 0));
 		}
 	}
+
+	pyramid.invalidate(image.rect());
 }
 
 void bmptissuesliceshower::set_scale(float offset1, float factor1, bool bmporwork1)
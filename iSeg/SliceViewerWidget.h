@@ -10,6 +10,7 @@
 #ifndef SLICESHOWER_29April05
 #define SLICESHOWER_29April05
 
+#include "ImagePyramid.h"
 #include "SlicesHandler.h"
 
 #include "Data/Point.h"
@@ -56,6 +57,7 @@ protected:
 private:
 	void reload_bits();
 	QImage image;
+	ImagePyramid pyramid; // levels of image drawn when zoomed out
 	unsigned short width, height;
 	unsigned short nrslices, slicenr;
 	float* bmpbits;
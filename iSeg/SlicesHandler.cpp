@@ -32,8 +32,11 @@
 #include "Data/Transform.h"
 
 #include "Core/ColorLookupTable.h"
+#include "Core/ComponentLabeling.h"
 #include "Core/ConnectedShapeBasedInterpolation.h"
+#include "Core/DistanceTransform.h"
 #include "Core/ExpectationMaximization.h"
+#include "Core/HDF5SliceCache.h"
 #include "Core/HDF5Writer.h"
 #include "Core/ImageForestingTransform.h"
 #include "Core/ImageReader.h"
@@ -48,15 +51,19 @@
 #include "Core/RTDoseWriter.h"
 #include "Core/SliceProvider.h"
 #include "Core/SmoothSteps.h"
-#include "Core/Treaps.h"
+#include "Core/VolumeFile.h"
+#include "Core/VolumeStorage.h"
 #include "Core/VoxelSurface.h"
 
 #include "vtkMyGDCMPolyDataReader.h"
 
+#include <vtkAppendPolyData.h>
 #include <vtkCellArray.h>
 #include <vtkCellData.h>
+#include <vtkCleanPolyData.h>
 #include <vtkDiscreteMarchingCubes.h>
 #include <vtkFloatArray.h>
+#include <vtkIdList.h>
 #include <vtkImageData.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
@@ -67,6 +74,7 @@
 #include <vtkStringArray.h>
 #include <vtkTransform.h>
 #include <vtkTransformPolyDataFilter.h>
+#include <vtkUnsignedCharArray.h>
 #include <vtkWindowedSincPolyDataFilter.h>
 
 #include <itkConnectedComponentImageFilter.h>
@@ -78,6 +86,10 @@
 #include <qmessagebox.h>
 #include <qprogressdialog.h>
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+
 #ifndef NO_OPENMP_SUPPORT
 #	include <omp.h>
 #endif
@@ -99,6 +111,20 @@ int const project_version = 5;
 int const tissue_version = 1;
 } // namespace
 
+namespace {
+unsigned char dirty_channels(const DataSelection& selection)
+{
+	return (selection.bmp ? VolumeFile::kSource : 0) |
+				 (selection.work ? VolumeFile::kTarget : 0) |
+				 (selection.tissues ? VolumeFile::kTissue : 0);
+}
+
+bool same_file(const std::string& a, const std::string& b)
+{
+	return QFileInfo(ToQ(a)).absoluteFilePath() == QFileInfo(ToQ(b)).absoluteFilePath();
+}
+} // namespace
+
 struct posit
 {
 	unsigned pxy;
@@ -116,6 +142,99 @@ struct posit
 	}
 };
 
+namespace {
+/** \brief Grows the exterior through the background (0) voxels of adjacent slices
+ *
+ * The exterior of each slice was marked with set_to before (flood_exterior).
+ */
+template<typename T>
+void flood_exterior_3d(const std::vector<T*>& slices, unsigned short width, unsigned area, T set_to)
+{
+	unsigned short const n = static_cast<unsigned short>(slices.size());
+	std::vector<posit> s;
+	posit p;
+	for (unsigned short z = 0; z < n; z++)
+	{
+		for (unsigned short z2 : {static_cast<unsigned short>(z - 1), static_cast<unsigned short>(z + 1)})
+		{
+			if (z2 >= n)
+				continue;
+			for (unsigned i = 0; i < area; i++)
+			{
+				if (slices[z][i] == 0 && slices[z2][i] == set_to)
+				{
+					slices[z][i] = set_to;
+					p.pxy = i;
+					p.pz = z;
+					s.push_back(p);
+				}
+			}
+		}
+	}
+
+	auto visit = [&](unsigned pxy, unsigned short pz) {
+		if (slices[pz][pxy] == 0)
+		{
+			slices[pz][pxy] = set_to;
+			p.pxy = pxy;
+			p.pz = pz;
+			s.push_back(p);
+		}
+	};
+	while (!s.empty())
+	{
+		posit const i = s.back();
+		s.pop_back();
+
+		if (i.pxy % width != 0)
+			visit(i.pxy - 1, i.pz);
+		if ((i.pxy + 1) % width != 0)
+			visit(i.pxy + 1, i.pz);
+		if (i.pxy >= width)
+			visit(i.pxy - width, i.pz);
+		if (i.pxy + width < area)
+			visit(i.pxy + width, i.pz);
+		if (i.pz > 0)
+			visit(i.pxy, i.pz - 1);
+		if (i.pz + 1 < n)
+			visit(i.pxy, i.pz + 1);
+	}
+}
+
+/** \brief Calls set(v) for the voxels within the ellipsoid of radii rx,ry,rz (in pixels) around a voxel with is_feature(v)
+ *
+ * The features themselves are not set. The distance transform runs slab by slab,
+ * so the memory needed does not grow with the number of slices.
+ */
+template<typename T, typename TFeature, typename TSet>
+void add_skin_3d(const std::vector<T*>& slices, unsigned short width, unsigned short height, int rx, int ry, int rz, TFeature is_feature, TSet set)
+{
+	// one step along an axis without thickness leaves the ellipsoid
+	auto spacing = [](int radius) { return radius > 0 ? 1.f / radius : 2.f; };
+	float const max_d2 = 1.f + 1e-4f; // tolerance for the rounding of 1/radius
+	unsigned const area = unsigned(width) * height;
+	DistanceTransform::SquaredDistance3DSlabs(static_cast<unsigned>(slices.size()), width, height, spacing(rx), spacing(ry), spacing(rz), max_d2, [&](unsigned k, unsigned i) { return is_feature(slices[k][i]); }, [&](unsigned k, const float* d2) {
+		T* slice = slices[k];
+		for (unsigned i = 0; i < area; i++)
+		{
+			if (d2[i] > 0 && d2[i] <= max_d2)
+				set(slice[i]);
+		}
+	});
+}
+
+template<typename T>
+void replace_value(const std::vector<T*>& slices, unsigned area, T from, T to)
+{
+	int const n = static_cast<int>(slices.size());
+#pragma omp parallel for
+	for (int k = 0; k < n; k++)
+	{
+		std::replace(slices[k], slices[k] + area, from, to);
+	}
+}
+} // namespace
+
 SlicesHandler::SlicesHandler()
 {
 	_activeslice = 0;
@@ -127,18 +246,283 @@ SlicesHandler::SlicesHandler()
 	_endslice = _nrslices = 0;
 
 	_active_tissuelayer = 0;
+	_ortho_tissue_layer = 0;
 	_color_lookup_table = nullptr;
 	_tissue_hierachy = new TissueHiearchy;
 	_overlay = nullptr;
 
 	_loaded = false;
 	_uelem = nullptr;
+	_undone_slices = std::make_pair(0, 0);
 	_undo3D = true;
 	_hdf5_compression = 1;
 	_contiguous_memory_io = false; // Default: slice-by-slice
+	_contiguous_storage = false;
+	_lazy_loading = false;
+	_lazy_load_cache = 256;
+	_native_project_format = false;
+}
+
+SlicesHandler::~SlicesHandler()
+{
+	// slices must release their views before the slabs are freed
+	_image_slices.clear();
+	_volume_storage.reset();
+
+	delete _tissue_hierachy;
+}
+
+void SlicesHandler::SetContiguousStorage(bool v)
+{
+	if (v == _contiguous_storage)
+		return;
+
+	_contiguous_storage = v;
+	if (!_loaded)
+		return;
+
+	if (_contiguous_storage)
+	{
+		make_contiguous();
+	}
+	else if (_volume_storage)
+	{
+		for (auto& slice : _image_slices)
+		{
+			slice.unbind_storage();
+		}
+		_volume_storage.reset();
+	}
+}
+
+bool SlicesHandler::make_contiguous()
+{
+	if (_image_slices.empty() || _width == 0 || _height == 0)
+		return false;
+
+	std::unique_ptr<VolumeStorage> storage(new VolumeStorage);
+	if (!storage->allocate(_width, _height, _nrslices))
+	{
+		ISEG_WARNING("could not allocate contiguous storage for " << _width << " x " << _height << " x " << _nrslices);
+		return false;
+	}
+
+	adopt_storage(std::move(storage), true);
+	return true;
+}
+
+void SlicesHandler::adopt_storage(std::unique_ptr<VolumeStorage> storage, bool copy)
+{
+	for (unsigned short i = 0; i < _nrslices; i++)
+	{
+		_image_slices[i].bind_storage(storage->source(i), storage->target(i), storage->tissues(i), copy);
+	}
+
+	// buffers which were swapped e.g. into the help image must not reference the old slabs
+	if (_volume_storage)
+	{
+		for (auto& slice : _image_slices)
+		{
+			slice.unbind_storage(_volume_storage.get());
+		}
+	}
+
+	_volume_storage = std::move(storage);
+}
+
+bool SlicesHandler::is_mapped_from(const std::string& filename)
+{
+	return _volume_storage && _volume_storage->is_mapped() &&
+				 same_file(_volume_storage->file_name(), filename) && is_bound_to(*_volume_storage);
+}
+
+bool SlicesHandler::is_bound_to(VolumeStorage& storage)
+{
+	if (_image_slices.empty() || _image_slices.size() != _nrslices ||
+			storage.width() != _width || storage.height() != _height ||
+			storage.num_slices() != _nrslices)
+	{
+		return false;
+	}
+
+	// slice buffers may have been swapped, e.g. with the help image, or reallocated by a loader
+	unsigned short i = 0;
+	for (auto& slice : _image_slices)
+	{
+		if (slice.return_bmp() != storage.source(i) ||
+				slice.return_work() != storage.target(i) ||
+				slice.return_tissues(0) != storage.tissues(i))
+		{
+			return false;
+		}
+		i++;
+	}
+	return true;
+}
+
+void SlicesHandler::finish_loading()
+{
+	// slabs of the previous volume, any slice still viewing them gets a private copy
+	if (_volume_storage && !is_bound_to(*_volume_storage))
+	{
+		for (auto& slice : _image_slices)
+		{
+			slice.unbind_storage(_volume_storage.get());
+		}
+		_volume_storage.reset();
+	}
+	if (_contiguous_storage && !_volume_storage)
+	{
+		make_contiguous();
+	}
+
+	// Ranges
+	Pair dummy;
+	reset_range_cache(_nrslices);
+	compute_range_mode1(&dummy);
+	compute_bmprange_mode1(&dummy);
+}
+
+void SlicesHandler::mark_dirty(const DataSelection& selection)
+{
+	unsigned char const channels = dirty_channels(selection);
+	if (selection.allSlices)
+	{
+		for (unsigned short i = 0; i < _nrslices; i++)
+		{
+			mark_dirty(i, channels);
+		}
+	}
+	else
+	{
+		mark_dirty(selection.sliceNr, channels);
+	}
+}
+
+void SlicesHandler::mark_dirty(unsigned short slicenr, unsigned char channels)
+{
+	for (auto dirty : {&_dirty_slices, &_autosave_dirty})
+	{
+		if (dirty->size() != _nrslices)
+		{
+			dirty->assign(_nrslices, VolumeFile::kAllChannels);
+		}
+		if (slicenr < dirty->size())
+		{
+			(*dirty)[slicenr] |= channels;
+		}
+	}
+
+	// statistics of the slice
+	if (slicenr < _slice_cache_valid.size())
+	{
+		if (channels & VolumeFile::kSource)
+			_slice_cache_valid[slicenr] &= ~kBmpRangeValid;
+		if (channels & VolumeFile::kTarget)
+			_slice_cache_valid[slicenr] &= ~kRangeValid;
+	}
+
+	// rows of cached orthogonal planes
+	if (channels & VolumeFile::kSource)
+		_ortho_source.invalidate(slicenr);
+	if (channels & VolumeFile::kTarget)
+		_ortho_target.invalidate(slicenr);
+	if (channels & VolumeFile::kTissue)
+		_ortho_tissues.invalidate(slicenr);
+}
+
+void SlicesHandler::mark_clean() { _dirty_slices.assign(_nrslices, 0); }
+
+bool SlicesHandler::has_unsaved_changes() const
+{
+	return _dirty_slices.size() != _nrslices ||
+				 std::any_of(_dirty_slices.begin(), _dirty_slices.end(), [](unsigned char d) { return d != 0; });
+}
+
+void SlicesHandler::mark_autosave_dirty()
+{
+	_autosave_dirty.assign(_nrslices, VolumeFile::kAllChannels);
+}
+
+unsigned short SlicesHandler::take_autosave_snapshot(VolumeSnapshot& snapshot, size_t max_bytes)
+{
+	if (_autosave_dirty.size() != _nrslices)
+	{
+		mark_autosave_dirty();
+	}
+
+	snapshot.reset(_width, _height, _nrslices);
+	std::vector<float> bmp, work;
+	std::vector<tissues_size_t> tissues;
+	unsigned short left = 0;
+	for (unsigned short i = 0; i < _nrslices; i++)
+	{
+		if (_autosave_dirty[i] == 0)
+			continue;
+
+		if (!snapshot.empty() && snapshot.size_in_bytes() >= max_bytes)
+		{
+			left++;
+			continue;
+		}
+
+		if (_image_slices.is_resident(i))
+		{
+			auto& slice = _image_slices[i];
+			snapshot.add(i, _autosave_dirty[i], slice.return_bmp(), slice.return_work(), slice.return_tissues(0));
+		}
+		else
+		{
+			// slices which are loaded on demand stay on disk
+			bmp.resize(_area);
+			work.resize(_area);
+			tissues.resize(_area);
+			_image_slices.copy_slice(i, bmp.data(), work.data(), tissues.data());
+			snapshot.add(i, _autosave_dirty[i], bmp.data(), work.data(), tissues.data());
+		}
+		_autosave_dirty[i] = 0;
+	}
+	return left;
 }
 
-SlicesHandler::~SlicesHandler() { delete _tissue_hierachy; }
+bool SlicesHandler::RestoreAutoSave(const char* filename)
+{
+	if (!LoadAllVolumeFile(filename))
+		return false;
+
+	// the side file is replaced by the next autosave, keep a private copy
+	for (auto& slice : _image_slices)
+	{
+		slice.unbind_storage(_volume_storage.get());
+	}
+	_volume_storage.reset();
+	if (_contiguous_storage)
+	{
+		make_contiguous();
+	}
+
+	_dirty_slices.assign(_nrslices, VolumeFile::kAllChannels);
+	_autosave_dirty.assign(_nrslices, VolumeFile::kAllChannels);
+	return true;
+}
+
+float* SlicesHandler::contiguous_source()
+{
+	auto slices = source_slices();
+	return VolumeStorage::is_contiguous(slices.data(), slices.size(), _area) ? slices[0] : nullptr;
+}
+
+float* SlicesHandler::contiguous_target()
+{
+	auto slices = target_slices();
+	return VolumeStorage::is_contiguous(slices.data(), slices.size(), _area) ? slices[0] : nullptr;
+}
+
+tissues_size_t* SlicesHandler::contiguous_tissues()
+{
+	auto slices = tissue_slices(_active_tissuelayer);
+	return VolumeStorage::is_contiguous(slices.data(), slices.size(), _area) ? slices[0] : nullptr;
+}
 
 float SlicesHandler::get_work_pt(Point p, unsigned short slicenr)
 {
@@ -148,6 +532,7 @@ float SlicesHandler::get_work_pt(Point p, unsigned short slicenr)
 void SlicesHandler::set_work_pt(Point p, unsigned short slicenr, float f)
 {
 	_image_slices[slicenr].set_work_pt(p, f);
+	mark_dirty(slicenr, VolumeFile::kTarget);
 }
 
 float SlicesHandler::get_bmp_pt(Point p, unsigned short slicenr)
@@ -158,6 +543,7 @@ float SlicesHandler::get_bmp_pt(Point p, unsigned short slicenr)
 void SlicesHandler::set_bmp_pt(Point p, unsigned short slicenr, float f)
 {
 	_image_slices[slicenr].set_bmp_pt(p, f);
+	mark_dirty(slicenr, VolumeFile::kSource);
 }
 
 tissues_size_t SlicesHandler::get_tissue_pt(Point p, unsigned short slicenr)
@@ -168,6 +554,7 @@ tissues_size_t SlicesHandler::get_tissue_pt(Point p, unsigned short slicenr)
 void SlicesHandler::set_tissue_pt(Point p, unsigned short slicenr, tissues_size_t f)
 {
 	_image_slices[slicenr].set_tissue_pt(_active_tissuelayer, p, f);
+	mark_dirty(slicenr, VolumeFile::kTissue);
 }
 
 std::vector<const float*> SlicesHandler::source_slices() const
@@ -300,12 +687,7 @@ int SlicesHandler::LoadDIBitmap(std::vector<const char*> filenames)
 
 	if (j == _nrslices)
 	{
-		// Ranges
-		Pair dummy;
-		_slice_ranges.resize(_nrslices);
-		_slice_bmpranges.resize(_nrslices);
-		compute_range_mode1(&dummy);
-		compute_bmprange_mode1(&dummy);
+		finish_loading();
 
 		_loaded = true;
 		return 1;
@@ -337,19 +719,14 @@ int SlicesHandler::LoadDIBitmap(std::vector<const char*> filenames, Point p,
 
 	if (j == _nrslices)
 	{
-		// Ranges
-		Pair dummy;
-		_slice_ranges.resize(_nrslices);
-		_slice_bmpranges.resize(_nrslices);
-		compute_range_mode1(&dummy);
-		compute_bmprange_mode1(&dummy);
-
 		_loaded = true;
 		_width = dx;
 		_height = dy;
 		_area = _height * (unsigned int)_width;
 
 		new_overlay();
+
+		finish_loading();
 		return 1;
 	}
 	else
@@ -398,15 +775,10 @@ int SlicesHandler::LoadPng(std::vector<const char*> filenames)
 			j = _nrslices + 1;
 	}
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(_nrslices);
-	_slice_bmpranges.resize(_nrslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == _nrslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -441,15 +813,10 @@ int SlicesHandler::LoadPng(std::vector<const char*> filenames, Point p,
 
 	new_overlay();
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(_nrslices);
-	_slice_bmpranges.resize(_nrslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == _nrslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -491,15 +858,10 @@ int SlicesHandler::LoadDIJpg(std::vector<const char*> filenames)
 			j = _nrslices + 1;
 	}
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(_nrslices);
-	_slice_bmpranges.resize(_nrslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == _nrslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -534,15 +896,10 @@ int SlicesHandler::LoadDIJpg(std::vector<const char*> filenames, Point p,
 
 	new_overlay();
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(_nrslices);
-	_slice_bmpranges.resize(_nrslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == _nrslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -575,15 +932,10 @@ int SlicesHandler::ReadRaw(const char* filename, short unsigned w,
 
 	new_overlay();
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(nrofslices);
-	_slice_bmpranges.resize(nrofslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == nrofslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -789,6 +1141,10 @@ int SlicesHandler::ReadRTdose(const char* filename)
 	{
 		this->_image_slices[j].newbmp(_width, _height);
 	}
+	if (_contiguous_storage)
+	{
+		make_contiguous();
+	}
 
 	new_overlay();
 
@@ -812,12 +1168,7 @@ int SlicesHandler::ReadRTdose(const char* filename)
 		newbmp(_width, _height, _nrslices);
 	}
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(_nrslices);
-	_slice_bmpranges.resize(_nrslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
+	finish_loading();
 
 	set_active_tissuelayer(0);
 
@@ -864,9 +1215,41 @@ bool SlicesHandler::LoadSurface(const std::string& filename_in, bool overwrite_w
 	{
 		ret = voxeler.Voxelize(surface, slices, dims, spacing(), _transform, _startslice, _endslice);
 	}
+
+	for (unsigned short i = _startslice; i < _endslice; i++)
+	{
+		mark_dirty(i, VolumeFile::kTarget);
+	}
 	return (ret != VoxelSurface::kNone);
 }
 
+template<class TReader>
+bool SlicesHandler::open_lazy(TReader& reader)
+{
+	std::unique_ptr<HDF5SliceCache> cache(new HDF5SliceCache);
+	if (!reader.OpenSliceCache(*cache))
+	{
+		ISEG_WARNING_MSG("cannot load slices on demand, reading all slices");
+		return false;
+	}
+	cache->set_budget(size_t(_lazy_load_cache) << 20);
+
+	_image_slices.set_lazy(std::move(cache), [this](size_t i, bmphandler& slice) {
+		// slices which are not loaded yet do not contribute to the total range
+		if (i < _slice_cache_valid.size() && slice.return_mode(false) == 1)
+		{
+			slice.get_range(&_slice_ranges[i]);
+			_slice_cache_valid[i] |= kRangeValid;
+		}
+		if (i < _slice_cache_valid.size() && slice.return_mode(true) == 1)
+		{
+			slice.get_bmprange(&_slice_bmpranges[i]);
+			_slice_cache_valid[i] |= kBmpRangeValid;
+		}
+	});
+	return true;
+}
+
 int SlicesHandler::LoadAllHDF(const char* filename)
 {
 	unsigned w, h, nrofslices;
@@ -902,6 +1285,11 @@ int SlicesHandler::LoadAllHDF(const char* filename)
 	// read colors if any
 	UpdateColorLookupTable(reader.ReadColorLookup());
 
+	if (_lazy_loading && open_lazy(reader))
+	{
+		return 1;
+	}
+
 	std::vector<float*> bmpslices(_nrslices);
 	std::vector<float*> workslices(_nrslices);
 	std::vector<tissues_size_t*> tissueslices(_nrslices);
@@ -919,6 +1307,12 @@ int SlicesHandler::LoadAllHDF(const char* filename)
 	return reader.Read();
 }
 
+void SlicesHandler::SetLazyLoadCache(unsigned megabytes)
+{
+	_lazy_load_cache = megabytes;
+	_image_slices.set_cache_budget(size_t(megabytes) << 20);
+}
+
 void SlicesHandler::UpdateColorLookupTable(
 		std::shared_ptr<ColorLookupTable> new_lut /*= nullptr*/)
 {
@@ -952,6 +1346,13 @@ int SlicesHandler::LoadAllXdmf(const char* filename)
 
 	const int NPA = arrayNames.size();
 
+	UpdateColorLookupTable(reader.ReadColorLookup());
+
+	if (_lazy_loading && open_lazy(reader))
+	{
+		return 1;
+	}
+
 	std::vector<float*> bmpslices(_nrslices);
 	std::vector<float*> workslices(_nrslices);
 	std::vector<tissues_size_t*> tissueslices(_nrslices);
@@ -963,8 +1364,6 @@ int SlicesHandler::LoadAllXdmf(const char* filename)
 		tissueslices[i] = this->_image_slices[i].return_tissues(0); // TODO
 	}
 
-	UpdateColorLookupTable(reader.ReadColorLookup());
-
 	reader.SetImageSlices(bmpslices.data());
 	reader.SetWorkSlices(workslices.data());
 	reader.SetTissueSlices(tissueslices.data());
@@ -973,10 +1372,85 @@ int SlicesHandler::LoadAllXdmf(const char* filename)
 	return code;
 }
 
-int SlicesHandler::SaveAllXdmf(const char* filename, int compression,
-		bool naked)
+bool SlicesHandler::LoadAllVolumeFile(const char* filename)
 {
-	float pixsize[3] = {_dx, _dy, _thickness};
+	VolumeFile::Header header;
+	if (!VolumeFile::read_header(filename, header))
+		return false;
+	if (!(header.flags & VolumeFile::kComplete))
+	{
+		ISEG_ERROR(filename << " does not contain all slices");
+		return false;
+	}
+
+	std::unique_ptr<VolumeStorage> storage(new VolumeStorage);
+	if (!storage->map(filename))
+		return false;
+
+	if ((storage->width() != _width) || (storage->height() != _height) || (storage->num_slices() != _nrslices))
+	{
+		ISEG_ERROR_MSG("inconsistent dimensions in LoadAllVolumeFile");
+		return false;
+	}
+
+	// slices become views into the mapping, pages are read on first access
+	adopt_storage(std::move(storage), false);
+	_dirty_slices.assign(_nrslices, 0);
+	return true;
+}
+
+bool SlicesHandler::SaveAllVolumeFile(const char* filename)
+{
+	std::vector<float*> bmpslices(_nrslices);
+	std::vector<float*> workslices(_nrslices);
+	std::vector<tissues_size_t*> tissueslices(_nrslices);
+	auto collect_slices = [&]() {
+		for (unsigned short i = 0; i < _nrslices; i++)
+		{
+			bmpslices[i] = _image_slices[i].return_bmp();
+			workslices[i] = _image_slices[i].return_work();
+			tissueslices[i] = _image_slices[i].return_tissues(0); // TODO
+		}
+	};
+
+	if (is_mapped_from(filename) && _dirty_slices.size() == _nrslices)
+	{
+		// unmodified slices still have the contents of the file
+		collect_slices();
+		if (!VolumeFile::update(filename, _width, _height, _nrslices, bmpslices.data(), workslices.data(), tissueslices.data(), _dirty_slices))
+			return false;
+
+		_dirty_slices.assign(_nrslices, 0);
+		return true;
+	}
+
+	if (_volume_storage && _volume_storage->is_mapped() && same_file(_volume_storage->file_name(), filename))
+	{
+		// the file is rewritten, slices must not reference the old mapping
+		for (auto& slice : _image_slices)
+		{
+			slice.unbind_storage(_volume_storage.get());
+		}
+		_volume_storage.reset();
+	}
+
+	collect_slices();
+	if (!VolumeFile::write(filename, _width, _height, _nrslices, bmpslices.data(), workslices.data(), tissueslices.data()))
+		return false;
+
+	// map the new file, so that the next save only needs to write modified slices
+	if (!LoadAllVolumeFile(filename))
+	{
+		ISEG_WARNING("could not map " << filename << ", slices will be rewritten on next save");
+		_dirty_slices.assign(_nrslices, VolumeFile::kAllChannels);
+	}
+	return true;
+}
+
+int SlicesHandler::SaveAllXdmf(const char* filename, int compression,
+		bool naked)
+{
+	float pixsize[3] = {_dx, _dy, _thickness};
 
 	std::vector<float*> bmpslices(_endslice - _startslice);
 	std::vector<float*> workslices(_endslice - _startslice);
@@ -1182,15 +1656,10 @@ int SlicesHandler::ReadAvw(const char* filename)
 
 	new_overlay();
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(nrofslices);
-	_slice_bmpranges.resize(nrofslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == nrofslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -1225,15 +1694,10 @@ int SlicesHandler::ReadRaw(const char* filename, short unsigned w,
 
 	new_overlay();
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(nrofslices);
-	_slice_bmpranges.resize(nrofslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == nrofslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -1266,15 +1730,10 @@ int SlicesHandler::ReadRawFloat(const char* filename, short unsigned w,
 
 	new_overlay();
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(nrofslices);
-	_slice_bmpranges.resize(nrofslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == nrofslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -1310,15 +1769,10 @@ int SlicesHandler::ReadRawFloat(const char* filename, short unsigned w,
 
 	new_overlay();
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(nrofslices);
-	_slice_bmpranges.resize(nrofslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
-
 	if (j == nrofslices)
 	{
+		finish_loading();
+
 		_loaded = true;
 		return 1;
 	}
@@ -1803,7 +2257,7 @@ FILE* SlicesHandler::SaveHeader(FILE* fp, short unsigned nr_slices_to_write,
 }
 
 FILE* SlicesHandler::SaveProject(const char* filename,
-		const char* imageFileExtension)
+		const char* imageFileExtension, const char* projectFileName)
 {
 	FILE* fp;
 
@@ -1823,20 +2277,38 @@ FILE* SlicesHandler::SaveProject(const char* filename,
 	unsigned short endslice1 = _endslice;
 	_startslice = 0;
 	_endslice = _nrslices;
+	bool native = (std::string(imageFileExtension) == "isv");
+	if (native && _color_lookup_table)
+	{
+		// the color lookup table is only stored in the Xdmf/HDF5 file
+		ISEG_WARNING_MSG("saving images as xmf to keep the color lookup table");
+		imageFileExtension = "xmf";
+		native = false;
+	}
 	unsigned char length1 = 0;
 	while (imageFileExtension[length1] != '\0')
 		length1++;
 	length1++;
 	fwrite(&length1, 1, sizeof(unsigned char), fp);
 	fwrite(imageFileExtension, length1, sizeof(char), fp);
-	QString imageFileName = QString(filename);
+	// native image files are updated in place, i.e. named after the final project file
+	QString imageFileName = QString(native && projectFileName ? projectFileName : filename);
 	int afterDot = imageFileName.lastIndexOf('.') + 1;
 	imageFileName =
 			imageFileName.remove(afterDot, imageFileName.length() - afterDot) +
 			imageFileExtension;
-	SaveAllXdmf(
-			QFileInfo(filename).dir().absFilePath(imageFileName).toAscii().data(),
-			this->_hdf5_compression, false);
+	if (native)
+	{
+		SaveAllVolumeFile(
+				QFileInfo(filename).dir().absFilePath(imageFileName).toAscii().data());
+	}
+	else
+	{
+		SaveAllXdmf(
+				QFileInfo(filename).dir().absFilePath(imageFileName).toAscii().data(),
+				this->_hdf5_compression, false);
+		mark_clean();
+	}
 
 	_startslice = startslice1;
 	_endslice = endslice1;
@@ -2105,18 +2577,17 @@ FILE* SlicesHandler::LoadProject(const char* filename, int& tissuesVersion)
 		{
 			LoadAllXdmf(QFileInfo(filename).dir().absFilePath(imageFileName).toAscii().data());
 		}
+		else if (imageFileName.endsWith(".isv", Qt::CaseInsensitive))
+		{
+			LoadAllVolumeFile(QFileInfo(filename).dir().absFilePath(imageFileName).toAscii().data());
+		}
 		else
 		{
 			ISEG_ERROR_MSG("unsupported format...");
 		}
 	}
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(_nrslices);
-	_slice_bmpranges.resize(_nrslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
+	finish_loading();
 
 	_loaded = true;
 
@@ -2165,17 +2636,16 @@ bool SlicesHandler::LoadS4Llink(const char* filename, int& tissuesVersion)
 	{
 		this->_image_slices[j].newbmp(w, h);
 	}
+	if (_contiguous_storage)
+	{
+		make_contiguous();
+	}
 
 	new_overlay();
 
 	bool res = LoadAllHDF(filename);
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(nrofslices);
-	_slice_bmpranges.resize(nrofslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
+	finish_loading();
 
 	set_active_tissuelayer(0);
 
@@ -3391,24 +3861,24 @@ void SlicesHandler::newbmp(unsigned short width1, unsigned short height1, unsign
 	for (unsigned short i = 0; i < _nrslices; i++)
 		_image_slices[i].newbmp(width1, height1);
 
+	_width = width1;
+	_height = height1;
+	_area = _height * (unsigned int)_width;
+	if (_contiguous_storage)
+	{
+		make_contiguous();
+	}
+
 	// now that memory is allocated give callback a chance to 'initialize' the data
 	if (init_callback)
 	{
 		init_callback(source_slices().data());
 	}
 
-	// Ranges
-	Pair dummy;
-	_slice_ranges.resize(nrofslices);
-	_slice_bmpranges.resize(nrofslices);
-	compute_range_mode1(&dummy);
-	compute_bmprange_mode1(&dummy);
+	finish_loading();
 
 	_loaded = true;
 
-	_width = width1;
-	_height = height1;
-	_area = _height * (unsigned int)_width;
 	set_active_tissuelayer(0);
 
 	new_overlay();
@@ -3418,6 +3888,7 @@ void SlicesHandler::freebmp()
 {
 	for (unsigned short i = 0; i < _nrslices; i++)
 		_image_slices[i].freebmp();
+	_volume_storage.reset();
 
 	_loaded = false;
 }
@@ -3452,34 +3923,40 @@ void SlicesHandler::set_bmp(unsigned short slicenr, float* bits,
 		unsigned char mode)
 {
 	(_image_slices[slicenr]).set_bmp(bits, mode);
+	mark_dirty(slicenr, VolumeFile::kSource);
 }
 
 void SlicesHandler::set_work(unsigned short slicenr, float* bits,
 		unsigned char mode)
 {
 	(_image_slices[slicenr]).set_work(bits, mode);
+	mark_dirty(slicenr, VolumeFile::kTarget);
 }
 
 void SlicesHandler::set_tissue(unsigned short slicenr, tissues_size_t* bits)
 {
 	(_image_slices[slicenr]).set_tissue(_active_tissuelayer, bits);
+	mark_dirty(slicenr, VolumeFile::kTissue);
 }
 
 void SlicesHandler::copy2bmp(unsigned short slicenr, float* bits,
 		unsigned char mode)
 {
 	(_image_slices[slicenr]).copy2bmp(bits, mode);
+	mark_dirty(slicenr, VolumeFile::kSource);
 }
 
 void SlicesHandler::copy2work(unsigned short slicenr, float* bits,
 		unsigned char mode)
 {
 	(_image_slices[slicenr]).copy2work(bits, mode);
+	mark_dirty(slicenr, VolumeFile::kTarget);
 }
 
 void SlicesHandler::copy2tissue(unsigned short slicenr, tissues_size_t* bits)
 {
 	(_image_slices[slicenr]).copy2tissue(_active_tissuelayer, bits);
+	mark_dirty(slicenr, VolumeFile::kTissue);
 }
 
 void SlicesHandler::copyfrombmp(unsigned short slicenr, float* bits)
@@ -3512,30 +3989,6 @@ void SlicesHandler::copyfromtissuepadded(unsigned short slicenr,
 			.copyfromtissuepadded(_active_tissuelayer, bits, padding);
 }
 
-unsigned int SlicesHandler::make_histogram(bool includeoutofrange)
-{
-	// \note unused function
-	unsigned int histogram[256];
-	unsigned int* dummy;
-	unsigned int l = 0;
-
-	for (unsigned short i = _startslice; i < _endslice; i++)
-		l += _image_slices[i].make_histogram(includeoutofrange);
-
-	dummy = (_image_slices[_startslice]).return_histogram();
-	for (unsigned short i = 0; i < 255; i++)
-		histogram[i] = dummy[i];
-
-	for (unsigned short j = _startslice + 1; j < _endslice; j++)
-	{
-		dummy = _image_slices[j].return_histogram();
-		for (unsigned short i = 0; i < 255; i++)
-			histogram[i] += dummy[i];
-	}
-
-	return l;
-}
-
 unsigned int SlicesHandler::return_area()
 {
 	return (_image_slices[0]).return_area();
@@ -3565,8 +4018,13 @@ bool SlicesHandler::isloaded() { return _loaded; }
 
 void SlicesHandler::gaussian(float sigma)
 {
-	for (unsigned short i = _startslice; i < _endslice; i++)
+	int const iN = _endslice;
+
+#pragma omp parallel for
+	for (int i = _startslice; i < iN; i++)
+	{
 		_image_slices[i].gaussian(sigma);
+	}
 
 	return;
 }
@@ -4098,8 +4556,13 @@ void SlicesHandler::em(unsigned short slicenr, short nrtissues,
 void SlicesHandler::aniso_diff(float dt, int n, float (*f)(float, float),
 		float k, float restraint)
 {
-	for (unsigned short i = _startslice; i < _endslice; i++)
+	int const iN = _endslice;
+
+#pragma omp parallel for
+	for (int i = _startslice; i < iN; i++)
+	{
 		_image_slices[i].aniso_diff(dt, n, f, k, restraint);
+	}
 
 	return;
 }
@@ -4107,29 +4570,49 @@ void SlicesHandler::aniso_diff(float dt, int n, float (*f)(float, float),
 void SlicesHandler::cont_anisodiff(float dt, int n, float (*f)(float, float),
 		float k, float restraint)
 {
-	for (unsigned short i = _startslice; i < _endslice; i++)
+	int const iN = _endslice;
+
+#pragma omp parallel for
+	for (int i = _startslice; i < iN; i++)
+	{
 		_image_slices[i].cont_anisodiff(dt, n, f, k, restraint);
+	}
 
 	return;
 }
 
 void SlicesHandler::median_interquartile(bool median)
 {
-	for (unsigned short i = _startslice; i < _endslice; i++)
+	int const iN = _endslice;
+
+#pragma omp parallel for
+	for (int i = _startslice; i < iN; i++)
+	{
 		_image_slices[i].median_interquartile(median);
+	}
 }
 
 void SlicesHandler::average(unsigned short n)
 {
-	for (unsigned short i = _startslice; i < _endslice; i++)
+	int const iN = _endslice;
+
+#pragma omp parallel for
+	for (int i = _startslice; i < iN; i++)
+	{
 		_image_slices[i].average(n);
+	}
 }
 
 void SlicesHandler::sigmafilter(float sigma, unsigned short nx,
 		unsigned short ny)
 {
-	for (unsigned short i = _startslice; i < _endslice; i++)
+	int const iN = _endslice;
+
+#pragma omp parallel for
+	for (int i = _startslice; i < iN; i++)
+	{
 		_image_slices[i].sigmafilter(sigma, nx, ny);
+	}
 }
 
 void SlicesHandler::threshold(float* thresholds)
@@ -4396,102 +4879,140 @@ void SlicesHandler::crop_colors()
 	}
 }
 
-void SlicesHandler::get_range(Pair* pp)
+void SlicesHandler::reset_range_cache(unsigned short nrslices)
 {
-	Pair p;
-	_image_slices[_startslice].get_range(pp);
+	_slice_ranges.resize(nrslices);
+	_slice_bmpranges.resize(nrslices);
+	_slice_cache_valid.assign(nrslices, 0);
+}
 
-	for (unsigned short i = _startslice + 1; i < _endslice; i++)
+void SlicesHandler::clear_range_cache() { reset_range_cache(_nrslices); }
+
+void SlicesHandler::update_slice_cache(unsigned short slicenr, unsigned char what)
+{
+	if ((_slice_cache_valid[slicenr] & what) == what)
+		return;
+
+	// loading a slice on demand can already update its ranges
+	auto& slice = _image_slices[slicenr];
+	unsigned char& valid = _slice_cache_valid[slicenr];
+
+	if ((what & kRangeValid) && !(valid & kRangeValid))
 	{
-		_image_slices[i].get_range(&p);
-		if ((*pp).high < p.high)
-			(*pp).high = p.high;
-		if ((*pp).low > p.low)
-			(*pp).low = p.low;
+		slice.get_range(&_slice_ranges[slicenr]);
+	}
+	if ((what & kBmpRangeValid) && !(valid & kBmpRangeValid))
+	{
+		slice.get_bmprange(&_slice_bmpranges[slicenr]);
 	}
+	valid |= what;
 }
 
-void SlicesHandler::compute_range_mode1(Pair* pp)
+Pair SlicesHandler::slice_range(unsigned short slicenr)
 {
-	// Update ranges for all mode 1 slices and compute total range
-	pp->low = FLT_MAX;
-	pp->high = 0.f;
+	if (_slice_cache_valid.size() != _nrslices)
+		reset_range_cache(_nrslices);
 
-#pragma omp parallel
-	{
-		// this data is thread private
-		Pair p;
-		float low = FLT_MAX;
-		float high = 0.f;
+	update_slice_cache(slicenr, kRangeValid);
+	return _slice_ranges[slicenr];
+}
 
-		const int iN = _nrslices;
-#pragma omp for
-		for (int i = 0; i < iN; i++)
-		{
-			if (_image_slices[i].return_mode(false) == 1)
-			{
-				_image_slices[i].get_range(&p);
-				_slice_ranges[i] = p;
-				if (high < p.high)
-					high = p.high;
-				if (low > p.low)
-					low = p.low;
-			}
-		}
+Pair SlicesHandler::slice_bmprange(unsigned short slicenr)
+{
+	if (_slice_cache_valid.size() != _nrslices)
+		reset_range_cache(_nrslices);
 
-#pragma omp critical
-		{
-			if (low < pp->low)
-				pp->low = low;
-			if (high > pp->high)
-				pp->high = high;
-		}
+	update_slice_cache(slicenr, kBmpRangeValid);
+	return _slice_bmpranges[slicenr];
+}
+
+void SlicesHandler::get_range(Pair* pp)
+{
+	if (_slice_cache_valid.size() != _nrslices)
+		reset_range_cache(_nrslices);
+
+	int const iN = _endslice;
+#pragma omp parallel for
+	for (int i = _startslice; i < iN; i++)
+	{
+		update_slice_cache(i, kRangeValid);
 	}
 
-	if (pp->high < pp->low)
+	*pp = _slice_ranges[_startslice];
+	for (unsigned short i = _startslice + 1; i < _endslice; i++)
 	{
-		// No mode 1 slices: Set to mode 2 range
-		pp->low = 255.0f;
+		Pair const& p = _slice_ranges[i];
+		if ((*pp).high < p.high)
+			(*pp).high = p.high;
+		if ((*pp).low > p.low)
+			(*pp).low = p.low;
 	}
 }
 
-void SlicesHandler::compute_range_mode1(unsigned short updateSlicenr, Pair* pp)
+void SlicesHandler::compute_range_mode1(Pair* pp)
 {
-	// Update range for single mode 1 slice
-	if (_image_slices[updateSlicenr].return_mode(false) == 1)
+	if (_slice_cache_valid.size() != _nrslices)
+		reset_range_cache(_nrslices);
+
+	// Update ranges of modified mode 1 slices
+	const int iN = _nrslices;
+#pragma omp parallel for
+	for (int i = 0; i < iN; i++)
 	{
-		_image_slices[updateSlicenr].get_range(&_slice_ranges[updateSlicenr]);
+		// slices which are loaded on demand update their range when read
+		if (_image_slices.is_resident(i) && _image_slices[i].return_mode(false) == 1)
+		{
+			update_slice_cache(i, kRangeValid);
+		}
 	}
 
 	// Compute total range
-	pp->high = 0.0f;
 	pp->low = FLT_MAX;
+	pp->high = 0.f;
 	for (unsigned short i = 0; i < _nrslices; ++i)
 	{
-		if (_image_slices[i].return_mode(false) != 1)
+		if (!_image_slices.is_resident(i) || _image_slices[i].return_mode(false) != 1)
 			continue;
-		Pair p = _slice_ranges[i];
+		Pair const& p = _slice_ranges[i];
 		if (pp->high < p.high)
 			pp->high = p.high;
 		if (pp->low > p.low)
 			pp->low = p.low;
 	}
 
-	if (pp->high == 0.0f && pp->low == FLT_MAX)
+	if (pp->high < pp->low)
 	{
 		// No mode 1 slices: Set to mode 2 range
 		pp->low = 255.0f;
 	}
 }
 
+void SlicesHandler::compute_range_mode1(unsigned short updateSlicenr, Pair* pp)
+{
+	if (_slice_cache_valid.size() != _nrslices)
+		reset_range_cache(_nrslices);
+
+	// Update range for single mode 1 slice
+	_slice_cache_valid[updateSlicenr] &= ~kRangeValid;
+	compute_range_mode1(pp);
+}
+
 void SlicesHandler::get_bmprange(Pair* pp)
 {
-	Pair p;
-	_image_slices[_startslice].get_bmprange(pp);
+	if (_slice_cache_valid.size() != _nrslices)
+		reset_range_cache(_nrslices);
+
+	int const iN = _endslice;
+#pragma omp parallel for
+	for (int i = _startslice; i < iN; i++)
+	{
+		update_slice_cache(i, kBmpRangeValid);
+	}
 
+	*pp = _slice_bmpranges[_startslice];
 	for (unsigned short i = _startslice + 1; i < _endslice; i++)
 	{
-		_image_slices[i].get_bmprange(&p);
+		Pair const& p = _slice_bmpranges[i];
 		if ((*pp).high < p.high)
 			(*pp).high = p.high;
 		if ((*pp).low > p.low)
@@ -4501,63 +5022,28 @@ void SlicesHandler::get_bmprange(Pair* pp)
 
 void SlicesHandler::compute_bmprange_mode1(Pair* pp)
 {
-	// Update ranges for all mode 1 slices and compute total range
-	pp->low = FLT_MAX;
-	pp->high = 0.f;
+	if (_slice_cache_valid.size() != _nrslices)
+		reset_range_cache(_nrslices);
 
-#pragma omp parallel
+	// Update ranges of modified mode 1 slices
+	const int iN = _nrslices;
+#pragma omp parallel for
+	for (int i = 0; i < iN; ++i)
 	{
-		// this data is thread private
-		Pair p;
-		float low = FLT_MAX;
-		float high = 0.f;
-
-		const int iN = _nrslices;
-#pragma omp for
-		for (int i = 0; i < iN; ++i)
-		{
-			if (_image_slices[i].return_mode(true) == 1)
-			{
-				_image_slices[i].get_bmprange(&p);
-				_slice_bmpranges[i] = p;
-
-				high = std::max(high, p.high);
-				low = std::min(low, p.low);
-			}
-		}
-
-#pragma omp critical
+		if (_image_slices.is_resident(i) && _image_slices[i].return_mode(true) == 1)
 		{
-			if (low < pp->low)
-				pp->low = low;
-			if (high > pp->high)
-				pp->high = high;
+			update_slice_cache(i, kBmpRangeValid);
 		}
 	}
 
-	if (pp->high < pp->low)
-	{
-		// No mode 1 slices: Set to mode 2 range
-		pp->low = 255.0f;
-	}
-}
-
-void SlicesHandler::compute_bmprange_mode1(unsigned short updateSlicenr, Pair* pp)
-{
-	// Update range for single mode 1 slice
-	if (_image_slices[updateSlicenr].return_mode(true) == 1)
-	{
-		_image_slices[updateSlicenr].get_bmprange(&_slice_bmpranges[updateSlicenr]);
-	}
-
 	// Compute total range
-	pp->high = 0.0f;
 	pp->low = FLT_MAX;
+	pp->high = 0.f;
 	for (unsigned short i = 0; i < _nrslices; ++i)
 	{
-		if (_image_slices[i].return_mode(true) != 1)
+		if (!_image_slices.is_resident(i) || _image_slices[i].return_mode(true) != 1)
 			continue;
-		Pair p = _slice_bmpranges[i];
+		Pair const& p = _slice_bmpranges[i];
 		if (pp->high < p.high)
 			pp->high = p.high;
 		if (pp->low > p.low)
@@ -4571,6 +5057,16 @@ void SlicesHandler::compute_bmprange_mode1(unsigned short updateSlicenr, Pair* p
 	}
 }
 
+void SlicesHandler::compute_bmprange_mode1(unsigned short updateSlicenr, Pair* pp)
+{
+	if (_slice_cache_valid.size() != _nrslices)
+		reset_range_cache(_nrslices);
+
+	// Update range for single mode 1 slice
+	_slice_cache_valid[updateSlicenr] &= ~kBmpRangeValid;
+	compute_bmprange_mode1(pp);
+}
+
 void SlicesHandler::get_rangetissue(tissues_size_t* pp)
 {
 	tissues_size_t p;
@@ -5195,56 +5691,7 @@ void SlicesHandler::interpolateworkgrey(unsigned short slice1, unsigned short sl
 	const short n = slice2 - slice1;
 	if (!connected)
 	{
-		_image_slices[slice1].pushstack_bmp();
-		_image_slices[slice2].pushstack_bmp();
-
-		_image_slices[slice1].swap_bmpwork();
-		_image_slices[slice2].swap_bmpwork();
-
-		_image_slices[slice2].dead_reckoning();
-		_image_slices[slice1].dead_reckoning();
-
-		float* bmp1 = _image_slices[slice1].return_bmp();
-		float* bmp2 = _image_slices[slice2].return_bmp();
-		float* work1 = _image_slices[slice1].return_work();
-		float* work2 = _image_slices[slice2].return_work();
-
-		Point p;
-		float prop;
-		unsigned short n1;
-		unsigned i1 = 0;
-
-		for (p.py = 0; p.py < _height; p.py++)
-		{
-			for (p.px = 0; p.px < _width; p.px++)
-			{
-				if (work2[i1] + work1[i1] != 0)
-					prop = work1[i1] / (work2[i1] + work1[i1]);
-				else
-					prop = 0.5f;
-				n1 = (unsigned short)n * prop;
-				for (unsigned short j = 1; j <= n1 && j < n; j++)
-				{
-					_image_slices[slice1 + j].set_work_pt(p, bmp1[i1]);
-				}
-				for (unsigned short j = n1 + 1; j < n; j++)
-				{
-					_image_slices[slice1 + j].set_work_pt(p, bmp2[i1]);
-				}
-				i1++;
-			}
-		}
-
-		_image_slices[slice1].swap_bmpwork();
-		_image_slices[slice2].swap_bmpwork();
-
-		for (unsigned short j = 1; j < n; j++)
-		{
-			_image_slices[slice1 + j].set_mode(2, false);
-		}
-
-		_image_slices[slice2].popstack_bmp();
-		_image_slices[slice1].popstack_bmp();
+		interpolateworkgrey_intervals({SliceInterval(slice1, slice2)});
 	}
 	else
 	{
@@ -5903,63 +6350,7 @@ void SlicesHandler::interpolatetissue(unsigned short slice1, unsigned short slic
 	const short n = slice2 - slice1;
 	if (!connected)
 	{
-		tissues_size_t* tissue1 = _image_slices[slice1].return_tissues(_active_tissuelayer);
-		tissues_size_t* tissue2 = _image_slices[slice2].return_tissues(_active_tissuelayer);
-		_image_slices[slice1].pushstack_bmp();
-		_image_slices[slice2].pushstack_bmp();
-		float* bmp1 = _image_slices[slice1].return_bmp();
-		float* bmp2 = _image_slices[slice2].return_bmp();
-		for (unsigned int i = 0; i < _area; i++)
-		{
-			bmp1[i] = (float)tissue1[i];
-			bmp2[i] = (float)tissue2[i];
-		}
-
-		_image_slices[slice2].dead_reckoning((float)tissuetype);
-		_image_slices[slice1].dead_reckoning((float)tissuetype);
-
-		bmp1 = _image_slices[slice1].return_work();
-		bmp2 = _image_slices[slice2].return_work();
-		const short n = slice2 - slice1;
-		Point p;
-		float delta;
-		unsigned i1 = 0;
-
-		for (p.py = 0; p.py < _height; p.py++)
-		{
-			for (p.px = 0; p.px < _width; p.px++)
-			{
-				delta = (bmp2[i1] - bmp1[i1]) / n;
-				for (unsigned short j = 1; j < n; j++)
-				{
-					if (bmp1[i1] + delta * j >= 0)
-						_image_slices[slice1 + j].set_work_pt(p, 255.0f);
-					else
-						_image_slices[slice1 + j].set_work_pt(p, 0.0f);
-				}
-				i1++;
-			}
-		}
-
-		for (unsigned i = 0; i < _area; i++)
-		{
-			if (bmp1[i] < 0)
-				bmp1[i] = 0;
-			else
-				bmp1[i] = 255.0f;
-			if (bmp2[i] < 0)
-				bmp2[i] = 0;
-			else
-				bmp2[i] = 255.0f;
-		}
-
-		for (unsigned short j = 1; j < n; j++)
-		{
-			_image_slices[slice1 + j].set_mode(2, false);
-		}
-
-		_image_slices[slice2].popstack_bmp();
-		_image_slices[slice1].popstack_bmp();
+		interpolatetissue_intervals({SliceInterval(slice1, slice2)}, tissuetype);
 	}
 	else
 	{
@@ -5989,6 +6380,200 @@ void SlicesHandler::interpolatetissue(unsigned short slice1, unsigned short slic
 	}
 }
 
+std::vector<std::pair<unsigned short, unsigned short>> SlicesHandler::batch_intervals(unsigned short startslice, unsigned short endslice, unsigned short stride)
+{
+	std::vector<SliceInterval> intervals;
+	if (stride == 0)
+		return intervals;
+
+	unsigned short batchstart;
+	for (batchstart = startslice; batchstart <= endslice - stride; batchstart += stride)
+	{
+		intervals.push_back(SliceInterval(batchstart, batchstart + stride));
+	}
+	// Last batch with smaller stride
+	if (batchstart > endslice && endslice - (batchstart - stride) >= 2)
+	{
+		intervals.push_back(SliceInterval(batchstart - stride, endslice));
+	}
+	return intervals;
+}
+
+void SlicesHandler::interpolatetissue_batch(unsigned short startslice, unsigned short endslice, unsigned short stride, tissues_size_t tissuetype, bool connected)
+{
+	auto intervals = batch_intervals(startslice, endslice, stride);
+	if (connected)
+	{
+		for (const auto& interval : intervals)
+		{
+			interpolatetissue(interval.first, interval.second, tissuetype, true);
+		}
+	}
+	else
+	{
+		interpolatetissue_intervals(intervals, tissuetype);
+	}
+}
+
+void SlicesHandler::interpolateworkgrey_batch(unsigned short startslice, unsigned short endslice, unsigned short stride, bool connected)
+{
+	auto intervals = batch_intervals(startslice, endslice, stride);
+	if (connected)
+	{
+		for (const auto& interval : intervals)
+		{
+			interpolateworkgrey(interval.first, interval.second, true);
+		}
+	}
+	else
+	{
+		interpolateworkgrey_intervals(intervals);
+	}
+}
+
+void SlicesHandler::interpolate_intervals(const std::vector<SliceInterval>& all_intervals,
+		const std::function<void(unsigned short, float*)>& prepare_key,
+		const std::function<void(const SliceInterval&, unsigned short, const float*, const float*)>& fill)
+{
+	std::vector<SliceInterval> intervals;
+	for (auto interval : all_intervals)
+	{
+		if (interval.second < interval.first)
+			std::swap(interval.first, interval.second);
+		if (interval.first + 1 < interval.second) // slices in between
+			intervals.push_back(interval);
+	}
+
+	// the maps of the key slices are held for a chunk of intervals at a time,
+	// a key shared with the next chunk is kept
+	size_t const kChunkIntervals = 32;
+	std::map<unsigned short, std::vector<float>> maps;
+	for (size_t c0 = 0; c0 < intervals.size(); c0 += kChunkIntervals)
+	{
+		size_t const c1 = std::min(c0 + kChunkIntervals, intervals.size());
+
+		std::vector<unsigned short> keys;
+		for (size_t i = c0; i < c1; i++)
+		{
+			for (unsigned short key : {intervals[i].first, intervals[i].second})
+			{
+				if (maps.find(key) == maps.end())
+				{
+					maps[key].resize(_area);
+					keys.push_back(key);
+				}
+			}
+		}
+		int const nkeys = static_cast<int>(keys.size());
+#pragma omp parallel for
+		for (int k = 0; k < nkeys; k++)
+		{
+			prepare_key(keys[k], maps.at(keys[k]).data());
+		}
+
+		std::vector<std::pair<size_t, unsigned short>> tasks;
+		for (size_t i = c0; i < c1; i++)
+		{
+			for (unsigned short j = 1; j < intervals[i].second - intervals[i].first; j++)
+			{
+				tasks.push_back(std::make_pair(i, j));
+			}
+		}
+		int const ntasks = static_cast<int>(tasks.size());
+#pragma omp parallel for
+		for (int t = 0; t < ntasks; t++)
+		{
+			const auto& interval = intervals[tasks[t].first];
+			fill(interval, tasks[t].second, maps.at(interval.first).data(), maps.at(interval.second).data());
+		}
+
+		for (auto it = maps.begin(); it != maps.end();)
+		{
+			bool needed = false;
+			for (size_t i = c1; i < std::min(c1 + kChunkIntervals, intervals.size()); i++)
+			{
+				needed |= (it->first == intervals[i].first || it->first == intervals[i].second);
+			}
+			it = needed ? std::next(it) : maps.erase(it);
+		}
+	}
+}
+
+void SlicesHandler::interpolatetissue_intervals(const std::vector<SliceInterval>& intervals, tissues_size_t tissuetype)
+{
+	// signed distance to the tissue boundary, the key slice work becomes the tissue mask
+	auto prepare_key = [this, tissuetype](unsigned short slicenr, float* dist) {
+		bmphandler& slice = _image_slices[slicenr];
+		float* bmp = slice.return_bmp();
+		std::vector<float> bmp_backup(bmp, bmp + _area);
+		tissues_size_t* tissue = slice.return_tissues(_active_tissuelayer);
+		for (unsigned int i = 0; i < _area; i++)
+		{
+			bmp[i] = (float)tissue[i];
+		}
+
+		free(slice.dead_reckoning((float)tissuetype));
+
+		float* work = slice.return_work();
+		std::copy(work, work + _area, dist);
+		for (unsigned int i = 0; i < _area; i++)
+		{
+			work[i] = (work[i] < 0) ? 0.0f : 255.0f;
+		}
+		std::copy(bmp_backup.begin(), bmp_backup.end(), slice.return_bmp());
+	};
+
+	auto fill = [this](const SliceInterval& interval, unsigned short j, const float* dist1, const float* dist2) {
+		const short n = interval.second - interval.first;
+		float* work = _image_slices[interval.first + j].return_work();
+		for (unsigned int i = 0; i < _area; i++)
+		{
+			float const delta = (dist2[i] - dist1[i]) / n;
+			work[i] = (dist1[i] + delta * j >= 0) ? 255.0f : 0.0f;
+		}
+		_image_slices[interval.first + j].set_mode(2, false);
+	};
+
+	interpolate_intervals(intervals, prepare_key, fill);
+}
+
+void SlicesHandler::interpolateworkgrey_intervals(const std::vector<SliceInterval>& intervals)
+{
+	// distance to the label boundaries of the target, the key slices are not modified
+	auto prepare_key = [this](unsigned short slicenr, float* dist) {
+		bmphandler& slice = _image_slices[slicenr];
+		unsigned char const bmp_mode = slice.return_mode(true);
+		float* bmp = slice.return_bmp();
+		std::vector<float> bmp_backup(bmp, bmp + _area);
+
+		slice.swap_bmpwork();
+		slice.dead_reckoning();
+		float* work = slice.return_work();
+		std::copy(work, work + _area, dist);
+		std::copy(bmp_backup.begin(), bmp_backup.end(), work);
+		slice.swap_bmpwork();
+		slice.set_mode(bmp_mode, true);
+	};
+
+	auto fill = [this](const SliceInterval& interval, unsigned short j, const float* dist1, const float* dist2) {
+		const short n = interval.second - interval.first;
+		const float* work1 = _image_slices[interval.first].return_work();
+		const float* work2 = _image_slices[interval.second].return_work();
+		float* work = _image_slices[interval.first + j].return_work();
+		for (unsigned int i = 0; i < _area; i++)
+		{
+			float prop = 0.5f;
+			if (dist2[i] + dist1[i] != 0)
+				prop = dist1[i] / (dist2[i] + dist1[i]);
+			unsigned short const n1 = (unsigned short)(n * prop);
+			work[i] = (j <= n1) ? work1[i] : work2[i];
+		}
+		_image_slices[interval.first + j].set_mode(2, false);
+	};
+
+	interpolate_intervals(intervals, prepare_key, fill);
+}
+
 void SlicesHandler::interpolatetissue_medianset(unsigned short slice1,
 		unsigned short slice2,
 		tissues_size_t tissuetype,
@@ -6379,38 +6964,12 @@ void SlicesHandler::set_direction_cosines(const float dc[6])
 
 void SlicesHandler::slicebmp_x(float* return_bits, unsigned short xcoord)
 {
-	unsigned n = 0;
-	float* dummy;
-
-	for (unsigned short i = 0; i < _nrslices; i++)
-	{
-		dummy = _image_slices[i].return_bmp();
-		for (unsigned short j = 0; j < _height; j++)
-		{
-			return_bits[n] = dummy[j * _width + xcoord];
-			n++;
-		}
-	}
-
-	return;
+	_ortho_source.get(source_slices(), _width, _height, OrthoSliceCache<float>::kXAxis, xcoord, return_bits);
 }
 
 void SlicesHandler::slicebmp_y(float* return_bits, unsigned short ycoord)
 {
-	unsigned n = 0;
-	float* dummy;
-
-	for (unsigned short i = 0; i < _nrslices; i++)
-	{
-		dummy = _image_slices[i].return_bmp();
-		for (unsigned short j = 0; j < _width; j++)
-		{
-			return_bits[n] = dummy[j + ycoord * _width];
-			n++;
-		}
-	}
-
-	return;
+	_ortho_source.get(source_slices(), _width, _height, OrthoSliceCache<float>::kYAxis, ycoord, return_bits);
 }
 
 float* SlicesHandler::slicebmp_x(unsigned short xcoord)
@@ -6431,38 +6990,12 @@ float* SlicesHandler::slicebmp_y(unsigned short ycoord)
 
 void SlicesHandler::slicework_x(float* return_bits, unsigned short xcoord)
 {
-	unsigned n = 0;
-	float* dummy;
-
-	for (unsigned short i = 0; i < _nrslices; i++)
-	{
-		dummy = _image_slices[i].return_work();
-		for (unsigned short j = 0; j < _height; j++)
-		{
-			return_bits[n] = dummy[j * _width + xcoord];
-			n++;
-		}
-	}
-
-	return;
+	_ortho_target.get(target_slices(), _width, _height, OrthoSliceCache<float>::kXAxis, xcoord, return_bits);
 }
 
 void SlicesHandler::slicework_y(float* return_bits, unsigned short ycoord)
 {
-	unsigned n = 0;
-	float* dummy;
-
-	for (unsigned short i = 0; i < _nrslices; i++)
-	{
-		dummy = _image_slices[i].return_work();
-		for (unsigned short j = 0; j < _width; j++)
-		{
-			return_bits[n] = dummy[j + ycoord * _width];
-			n++;
-		}
-	}
-
-	return;
+	_ortho_target.get(target_slices(), _width, _height, OrthoSliceCache<float>::kYAxis, ycoord, return_bits);
 }
 
 float* SlicesHandler::slicework_x(unsigned short xcoord)
@@ -6481,42 +7014,24 @@ float* SlicesHandler::slicework_y(unsigned short ycoord)
 	return result;
 }
 
-void SlicesHandler::slicetissue_x(tissues_size_t* return_bits,
-		unsigned short xcoord)
+void SlicesHandler::slicetissue_x(tissues_size_t* return_bits, unsigned short xcoord)
 {
-	unsigned n = 0;
-	tissues_size_t* dummy;
-
-	for (unsigned short i = 0; i < _nrslices; i++)
+	if (_ortho_tissue_layer != _active_tissuelayer)
 	{
-		dummy = _image_slices[i].return_tissues(_active_tissuelayer);
-		for (unsigned short j = 0; j < _height; j++)
-		{
-			return_bits[n] = dummy[j * _width + xcoord];
-			n++;
-		}
+		_ortho_tissues.clear();
+		_ortho_tissue_layer = _active_tissuelayer;
 	}
-
-	return;
+	_ortho_tissues.get(tissue_slices(_active_tissuelayer), _width, _height, OrthoSliceCache<tissues_size_t>::kXAxis, xcoord, return_bits);
 }
 
-void SlicesHandler::slicetissue_y(tissues_size_t* return_bits,
-		unsigned short ycoord)
+void SlicesHandler::slicetissue_y(tissues_size_t* return_bits, unsigned short ycoord)
 {
-	unsigned n = 0;
-	tissues_size_t* dummy;
-
-	for (unsigned short i = 0; i < _nrslices; i++)
+	if (_ortho_tissue_layer != _active_tissuelayer)
 	{
-		dummy = _image_slices[i].return_tissues(_active_tissuelayer);
-		for (unsigned short j = 0; j < _width; j++)
-		{
-			return_bits[n] = dummy[j + ycoord * _width];
-			n++;
-		}
+		_ortho_tissues.clear();
+		_ortho_tissue_layer = _active_tissuelayer;
 	}
-
-	return;
+	_ortho_tissues.get(tissue_slices(_active_tissuelayer), _width, _height, OrthoSliceCache<tissues_size_t>::kYAxis, ycoord, return_bits);
 }
 
 tissues_size_t* SlicesHandler::slicetissue_x(unsigned short xcoord)
@@ -6537,6 +7052,13 @@ tissues_size_t* SlicesHandler::slicetissue_y(unsigned short ycoord)
 	return result;
 }
 
+void SlicesHandler::clear_ortho_cache()
+{
+	_ortho_source.clear();
+	_ortho_target.clear();
+	_ortho_tissues.clear();
+}
+
 void SlicesHandler::slicework_z(unsigned short slicenr)
 {
 	_image_slices[slicenr].return_work();
@@ -6554,10 +7076,22 @@ int GetScalarType<unsigned char>() { return VTK_UNSIGNED_CHAR; }
 template<>
 int GetScalarType<unsigned short>() { return VTK_UNSIGNED_SHORT; }
 
+namespace {
+/// Piece of the label field meshed separately, see extract_tissue_surfaces
+struct SurfaceBlock
+{
+	int cell0 = 0; // first voxel layer (between padded slices) owned by the block
+	int cell1 = 0; // one past the last owned layer
+	bool ok = true;
+	vtkSmartPointer<vtkPolyData> raw;	// surface before smoothing
+	vtkSmartPointer<vtkPolyData> mesh; // smoothed, cropped and simplified surface
+};
+} // namespace
+
 int SlicesHandler::extract_tissue_surfaces(
 		const QString& filename, std::vector<tissues_size_t>& tissuevec,
 		bool usediscretemc, float ratio, unsigned smoothingiterations,
-		float passBand, float featureAngle)
+		float passBand, float featureAngle, unsigned blocks)
 {
 	int error_counter = 0;
 	ISEG_INFO_MSG("SlicesHandler::extract_tissue_surfaces");
@@ -6566,34 +7100,13 @@ int SlicesHandler::extract_tissue_surfaces(
 	ISEG_INFO("\tfeatureAngle " << featureAngle);
 	ISEG_INFO("\tusediscretemc " << usediscretemc);
 
-	//
-	// Copy label field into a vtkImageData object
-	//
 	const char* tissueIndexArrayName = "Domain";		 // this can be changed
 	const char* tissueNameArrayName = "TissueNames"; // don't modify this
 	const char* tissueColorArrayName = "Colors";		 // don't modify this
-
-	vtkSmartPointer<vtkImageData> labelField =
-			vtkSmartPointer<vtkImageData>::New();
-	labelField->SetExtent(0, (int)width() + 1, 0,
-			(int)height() + 1, 0,
-			(int)(_endslice - _startslice) + 1);
-	Pair ps = get_pixelsize();
-	labelField->SetSpacing(ps.high, ps.low, get_slicethickness());
-	// transform (translation and rotation) is applied at end of function
-	labelField->SetOrigin(0, 0, 0);
-	labelField->AllocateScalars(GetScalarType<tissues_size_t>(), 1);
-	vtkDataArray* arr = labelField->GetPointData()->GetScalars();
-	if (!arr)
-	{
-		ISEG_ERROR_MSG("no scalars");
-		return -1;
-	}
-	arr->SetName(tissueIndexArrayName);
-	labelField->GetPointData()->SetActiveScalars(tissueIndexArrayName);
+	const char* fixedPointsArrayName = "SeamPoints";
 
 	//
-	// Copy tissue names and colors into labelField
+	// Tissue names and colors
 	//
 	tissues_size_t num_tissues = TissueInfos::GetTissueCount();
 	vtkSmartPointer<vtkStringArray> names_array =
@@ -6615,96 +7128,84 @@ int SlicesHandler::extract_tissue_surfaces(
 		color_array->SetTuple(i, color.v.data());
 	}
 
-	labelField->GetFieldData()->AddArray(names_array);
-	labelField->GetFieldData()->AddArray(color_array);
+	Pair ps = get_pixelsize();
+	double const spacing[3] = {ps.high, ps.low, get_slicethickness()};
+	int const padding = 1;
+	// the label field is padded with a background slice at z=0 and z=nz+1
+	int const nz = _endslice - _startslice;
 
-	tissues_size_t* field = (tissues_size_t*)labelField->GetScalarPointer(0, 0, 0);
-	if (!field)
-	{
-		ISEG_ERROR_MSG("null pointer");
-		return -1;
-	}
+	//
+	// Copy padded slices [z0, z1] of the label field into a vtkImageData object
+	// The extent is global, i.e. pieces of the label field have consistent coordinates
+	//
+	auto make_label_field = [&](int z0, int z1) -> vtkSmartPointer<vtkImageData> {
+		vtkSmartPointer<vtkImageData> labelField =
+				vtkSmartPointer<vtkImageData>::New();
+		labelField->SetExtent(0, (int)width() + 1, 0, (int)height() + 1, z0, z1);
+		labelField->SetSpacing(spacing[0], spacing[1], spacing[2]);
+		// transform (translation and rotation) is applied at end of function
+		labelField->SetOrigin(0, 0, 0);
+		labelField->AllocateScalars(GetScalarType<tissues_size_t>(), 1);
+		vtkDataArray* arr = labelField->GetPointData()->GetScalars();
+		if (!arr)
+			return nullptr;
+		arr->SetName(tissueIndexArrayName);
+		labelField->GetPointData()->SetActiveScalars(tissueIndexArrayName);
 
-	int const padding = 1;
-	//labelField is already cropped
-	unsigned short nrSlice = 0;
-	for (unsigned short i = _startslice; i < _endslice; i++, nrSlice++)
-	{
-		copyfromtissuepadded(
-				i,
-				&(field[(nrSlice + 1) * (unsigned long long)(width() + 2) *
-								(height() + 2)]),
-				padding);
-	}
-	for (unsigned long long i = 0;
-			 i < (unsigned long long)(width() + 2) * (height() + 2);
-			 i++)
-		field[i] = 0;
-	for (unsigned long long i = (_endslice - _startslice + 1) *
-															(unsigned long long)(width() + 2) *
-															(height() + 2);
-			 i < (_endslice - _startslice + 2) *
-							 (unsigned long long)(width() + 2) *
-							 (height() + 2);
-			 i++)
-		field[i] = 0;
-
-	// Check the label field
-	check(labelField != 0);
-	//check( labelField->GetPointData()->HasArray(tissueIndexArrayName) );
-	check(labelField->GetFieldData()->HasArray(tissueNameArrayName));
-	check(labelField->GetFieldData()->HasArray(tissueColorArrayName));
+		tissues_size_t* field = (tissues_size_t*)labelField->GetScalarPointer(0, 0, z0);
+		if (!field)
+			return nullptr;
+
+		size_t const slice_size = (size_t)(width() + 2) * (height() + 2);
+		for (int z = z0; z <= z1; z++, field += slice_size)
+		{
+			if (z == 0 || z == nz + 1)
+				std::fill(field, field + slice_size, 0);
+			else
+				copyfromtissuepadded(_startslice + z - 1, field, padding);
+		}
+		return labelField;
+	};
 
 	//
-	// Now extract the surface from the label field
+	// Extract the surface from the label field
 	//
-	vtkSmartPointer<vtkImageExtractCompatibleMesher> contour =
-			vtkSmartPointer<vtkImageExtractCompatibleMesher>::New();
-	vtkSmartPointer<vtkDiscreteMarchingCubes> cubes =
-			vtkSmartPointer<vtkDiscreteMarchingCubes>::New();
-	vtkSmartPointer<vtkWindowedSincPolyDataFilter> smoother =
-			vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
-	vtkSmartPointer<vtkEdgeCollapse> simplify =
-			vtkSmartPointer<vtkEdgeCollapse>::New();
-
-	vtkPolyData* output = nullptr;
-	if (usediscretemc)
-	{
-		cubes->SetInputData(labelField);
-		cubes->SetComputeNormals(0);
-		cubes->SetComputeGradients(0);
-		//cubes->SetComputeScalars(0);
-		cubes->SetNumberOfContours((int)tissuevec.size());
-		for (size_t i = 0; i < tissuevec.size(); i++)
-			cubes->SetValue((int)i, tissuevec[i]);
-		cubes->Update();
-		output = cubes->GetOutput();
-	}
-	else
-	{
+	auto extract_surface = [&](vtkImageData* labelField) -> vtkSmartPointer<vtkPolyData> {
+		if (usediscretemc)
+		{
+			vtkSmartPointer<vtkDiscreteMarchingCubes> cubes =
+					vtkSmartPointer<vtkDiscreteMarchingCubes>::New();
+			cubes->SetInputData(labelField);
+			cubes->SetComputeNormals(0);
+			cubes->SetComputeGradients(0);
+			//cubes->SetComputeScalars(0);
+			cubes->SetNumberOfContours((int)tissuevec.size());
+			for (size_t i = 0; i < tissuevec.size(); i++)
+				cubes->SetValue((int)i, tissuevec[i]);
+			cubes->Update();
+			return cubes->GetOutput();
+		}
+		vtkSmartPointer<vtkImageExtractCompatibleMesher> contour =
+				vtkSmartPointer<vtkImageExtractCompatibleMesher>::New();
 		contour->SetInputData(labelField);
 		contour->SetOutputScalarName(tissueIndexArrayName);
 		contour->UseTemplatesOn();
-		contour->UseOctreeLocatorOff();
 		contour->FiveTetrahedraPerVoxelOn();
 		contour->SetBackgroundLabel(
 				0); /// \todo this will not be extracted! is this correct?
 		contour->Update();
-		output = contour->GetOutput();
-	}
-	if (output)
-	{
-		//check( output->GetCellData()->HasArray(tissueIndexArrayName) );
-		check(output->GetFieldData()->HasArray(tissueNameArrayName));
-		check(output->GetFieldData()->HasArray(tissueColorArrayName));
-	}
+		return contour->GetOutput();
+	};
 
 	//
 	// Smooth surface
 	//
-	if (smoothingiterations > 0)
-	{
-		smoother->SetInputData(output);
+	auto smooth_surface = [&](vtkPolyData* surface) -> vtkSmartPointer<vtkPolyData> {
+		if (smoothingiterations == 0)
+			return surface;
+		vtkSmartPointer<vtkWindowedSincPolyDataFilter> smoother =
+				vtkSmartPointer<vtkWindowedSincPolyDataFilter>::New();
+		smoother->SetInputData(surface);
 		smoother->BoundarySmoothingOff();
 		smoother->NonManifoldSmoothingOn();
 		smoother->NormalizeCoordinatesOn();
@@ -6713,14 +7214,8 @@ int SlicesHandler::extract_tissue_surfaces(
 		smoother->SetPassBand(passBand);
 		smoother->SetNumberOfIterations(smoothingiterations);
 		smoother->Update();
-		output = smoother->GetOutput();
-	}
-	if (output)
-	{
-		//check( output->GetCellData()->HasArray(tissueIndexArrayName) );
-		check(output->GetFieldData()->HasArray(tissueNameArrayName));
-		check(output->GetFieldData()->HasArray(tissueColorArrayName));
-	}
+		return smoother->GetOutput();
+	};
 
 	//
 	// Simplify surface
@@ -6731,57 +7226,277 @@ int SlicesHandler::extract_tissue_surfaces(
 		ratio = 0.02;
 	double targetReduction = 1.0 - ratio;
 	// don't bother if below reduction rate of 5%
-	if (targetReduction > 0.05)
-	{
-		double cellBnds[6];
-		labelField->GetCellBounds(0, cellBnds);
-		double x0[3] = {cellBnds[0], cellBnds[2], cellBnds[4]};
-		double x1[3] = {cellBnds[1], cellBnds[3], cellBnds[5]};
-		// cellSize is related to current edge length
-		double cellSize =
-				0.5 * std::sqrt(vtkMath::Distance2BetweenPoints(x0, x1));
-
-		// min edge length -> cellSize  :  no edges will be collapsed, no edge shorter than 0
-		// min edge length -> inf:  all edges will be collapsed, ""
-		// If edge length is halved, number of triangles multiplies by 4
-		double minEdgeLength = cellSize / (ratio * ratio);
-
-		simplify->SetInputData(output);
-		simplify->SetDomainLabelName(tissueIndexArrayName);
-		simplify->SetMinimumEdgeLength(minEdgeLength);
-		simplify->FlipEdgesOn();
-		simplify->SetIntersectionCheckLevel(0);
-		simplify->Update();
-		output = simplify->GetOutput();
-
-		// Case 65858: Set name and color info when the collapsed exporting tissue is only one
-		if (tissuevec.size() == 1)
-		{
-			vtkSmartPointer<vtkStringArray> names_array_1 =
-					vtkSmartPointer<vtkStringArray>::New();
-			names_array_1->SetNumberOfTuples(1);
-			names_array_1->SetName(tissueNameArrayName);
-
-			vtkSmartPointer<vtkFloatArray> color_array_1 =
-					vtkSmartPointer<vtkFloatArray>::New();
-			color_array_1->SetNumberOfComponents(3);
-			color_array_1->SetNumberOfTuples(1);
-			color_array_1->SetName(tissueColorArrayName);
-
-			for (tissues_size_t i = 1; i < num_tissues; i++)
+	bool const simplify = targetReduction > 0.05;
+
+	// cellSize is related to current edge length (half the voxel diagonal)
+	double cellSize = 0.5 * std::sqrt(spacing[0] * spacing[0] +
+			spacing[1] * spacing[1] + spacing[2] * spacing[2]);
+
+	// min edge length -> cellSize  :  no edges will be collapsed, no edge shorter than 0
+	// min edge length -> inf:  all edges will be collapsed, ""
+	// If edge length is halved, number of triangles multiplies by 4
+	double minEdgeLength = cellSize / (ratio * ratio);
+
+	auto simplify_surface = [&](vtkPolyData* surface, const char* fixedPoints) -> vtkSmartPointer<vtkPolyData> {
+		vtkSmartPointer<vtkEdgeCollapse> simplifier =
+				vtkSmartPointer<vtkEdgeCollapse>::New();
+		simplifier->SetInputData(surface);
+		simplifier->SetDomainLabelName(tissueIndexArrayName);
+		simplifier->SetFixedPointsArrayName(fixedPoints);
+		simplifier->SetMinimumEdgeLength(minEdgeLength);
+		simplifier->FlipEdgesOn();
+		simplifier->BatchCollapseOn();
+		simplifier->SetIntersectionCheckLevel(0);
+		simplifier->Update();
+		return simplifier->GetOutput();
+	};
+
+	// Blocks are at least kMinBlockLayers voxel layers and twice the overlap thick
+	int const overlap = static_cast<int>(smoothingiterations) + 2;
+	int const kMinBlockLayers = 16;
+	if (blocks == 0)
+	{
+#ifdef NO_OPENMP_SUPPORT
+		blocks = 1;
+#else
+		blocks = static_cast<unsigned>(omp_get_max_threads());
+#endif
+	}
+	blocks = std::max(1u, std::min(blocks, static_cast<unsigned>((nz + 1) / std::max(kMinBlockLayers, 2 * overlap))));
+	ISEG_INFO("\tblocks " << blocks);
+
+	vtkSmartPointer<vtkPolyData> output;
+	if (blocks == 1)
+	{
+		vtkSmartPointer<vtkImageData> labelField = make_label_field(0, nz + 1);
+		if (!labelField)
+		{
+			ISEG_ERROR_MSG("no scalars");
+			return -1;
+		}
+		labelField->GetFieldData()->AddArray(names_array);
+		labelField->GetFieldData()->AddArray(color_array);
+
+		// Check the label field
+		//check( labelField->GetPointData()->HasArray(tissueIndexArrayName) );
+		check(labelField->GetFieldData()->HasArray(tissueNameArrayName));
+		check(labelField->GetFieldData()->HasArray(tissueColorArrayName));
+
+		output = extract_surface(labelField);
+		if (output)
+		{
+			//check( output->GetCellData()->HasArray(tissueIndexArrayName) );
+			check(output->GetFieldData()->HasArray(tissueNameArrayName));
+			check(output->GetFieldData()->HasArray(tissueColorArrayName));
+		}
+
+		output = smooth_surface(output);
+		if (output)
+		{
+			check(output->GetFieldData()->HasArray(tissueNameArrayName));
+			check(output->GetFieldData()->HasArray(tissueColorArrayName));
+		}
+
+		if (simplify)
+		{
+			output = simplify_surface(output, nullptr);
+		}
+	}
+	else
+	{
+		//
+		// Each block owns a range of voxel layers and is meshed with 'overlap'
+		// extra layers on each side, such that smoothing near the seams sees the
+		// same neighborhood as in the neighbouring block. Points on a seam take
+		// the coordinates computed by the block below, are kept by the
+		// simplification and finally merged with the neighbour's points.
+		//
+		int const num_layers = nz + 1;
+		std::vector<SurfaceBlock> parts(blocks);
+		for (unsigned k = 0; k < blocks; k++)
+		{
+			parts[k].cell0 = static_cast<int>(k * num_layers / blocks);
+			parts[k].cell1 = static_cast<int>((k + 1) * num_layers / blocks);
+		}
+
+		double const dz = spacing[2];
+		auto on_plane = [dz](double z, int layer) {
+			return std::abs(z - layer * dz) < 1e-3 * dz;
+		};
+
+		std::int64_t const num_parts = static_cast<std::int64_t>(parts.size());
+#pragma omp parallel for schedule(dynamic)
+		for (std::int64_t k = 0; k < num_parts; k++)
+		{
+			SurfaceBlock& part = parts[k];
+			vtkSmartPointer<vtkImageData> labelField = make_label_field(
+					std::max(0, part.cell0 - overlap), std::min(nz + 1, part.cell1 + overlap));
+			if (!labelField)
+			{
+				part.ok = false;
+				continue;
+			}
+			part.raw = extract_surface(labelField);
+			part.mesh = smooth_surface(part.raw);
+		}
+
+		for (auto& part : parts)
+		{
+			if (!part.ok)
+			{
+				ISEG_ERROR_MSG("no scalars");
+				return -1;
+			}
+		}
+
+		// Stitch seams
+		size_t unmatched = 0;
+		for (size_t k = 1; smoothingiterations > 0 && k < parts.size(); k++)
+		{
+			vtkPoints* below_raw = parts[k - 1].raw->GetPoints();
+			vtkPoints* below = parts[k - 1].mesh->GetPoints();
+			vtkPoints* raw = parts[k].raw->GetPoints();
+			vtkPoints* points = parts[k].mesh->GetPoints();
+			if (!below_raw || !raw)
+				continue;
+
+			int const seam = parts[k].cell0;
+			std::map<std::pair<double, double>, vtkIdType> seam_points;
+			double x[3];
+			for (vtkIdType i = 0; i < below_raw->GetNumberOfPoints(); i++)
+			{
+				below_raw->GetPoint(i, x);
+				if (on_plane(x[2], seam))
+					seam_points[std::make_pair(x[0], x[1])] = i;
+			}
+			for (vtkIdType i = 0; i < raw->GetNumberOfPoints(); i++)
 			{
-				check_equal(TissueInfos::GetTissueType(TissueInfos::GetTissueName(i)), i);
-				if (i == tissuevec[0])
+				raw->GetPoint(i, x);
+				if (on_plane(x[2], seam))
 				{
-					names_array_1->SetValue(0, TissueInfos::GetTissueName(i).c_str());
-					auto color = TissueInfos::GetTissueColor(i);
-					color_array_1->SetTuple(0, color.v.data());
+					auto it = seam_points.find(std::make_pair(x[0], x[1]));
+					if (it != seam_points.end())
+						points->SetPoint(i, below->GetPoint(it->second));
+					else
+						unmatched++;
 				}
 			}
+		}
+		if (unmatched != 0)
+		{
+			ISEG_WARNING(unmatched << " seam points could not be matched");
+		}
+
+		// Crop to owned layers and simplify
+#pragma omp parallel for schedule(dynamic)
+		for (std::int64_t k = 0; k < num_parts; k++)
+		{
+			SurfaceBlock& part = parts[k];
+			vtkPolyData* mesh = part.mesh;
+			vtkPoints* raw = part.raw->GetPoints();
+			if (!raw || mesh->GetNumberOfCells() == 0)
+			{
+				part.mesh = nullptr;
+				continue;
+			}
+
+			double x[3];
+			vtkSmartPointer<vtkUnsignedCharArray> fixed =
+					vtkSmartPointer<vtkUnsignedCharArray>::New();
+			fixed->SetName(fixedPointsArrayName);
+			fixed->SetNumberOfTuples(raw->GetNumberOfPoints());
+			for (vtkIdType i = 0; i < raw->GetNumberOfPoints(); i++)
+			{
+				raw->GetPoint(i, x);
+				bool const seam = (k > 0 && on_plane(x[2], part.cell0)) ||
+													(k + 1 < num_parts && on_plane(x[2], part.cell1));
+				fixed->SetValue(i, seam ? 1 : 0);
+			}
+			mesh->GetPointData()->AddArray(fixed);
+
+			// a triangle belongs to the voxel layer of its (unsmoothed) center
+			vtkSmartPointer<vtkIdList> owned = vtkSmartPointer<vtkIdList>::New();
+			vtkIdType npts, *pts;
+			for (vtkIdType c = 0; c < mesh->GetNumberOfCells(); c++)
+			{
+				if (mesh->GetCellType(c) != VTK_TRIANGLE)
+					continue;
+				mesh->GetCellPoints(c, npts, pts);
+				double zc = 0;
+				for (vtkIdType i = 0; i < npts; i++)
+					zc += raw->GetPoint(pts[i])[2];
+				int const layer = static_cast<int>(std::floor(zc / (npts * dz) + 1e-3));
+				if (layer >= part.cell0 && layer < part.cell1)
+					owned->InsertNextId(c);
+			}
+
+			vtkSmartPointer<vtkPolyData> cropped = vtkSmartPointer<vtkPolyData>::New();
+			cropped->Allocate(mesh, owned->GetNumberOfIds());
+			cropped->GetPointData()->CopyAllocate(mesh->GetPointData());
+			cropped->GetCellData()->CopyAllocate(mesh->GetCellData());
+			cropped->CopyCells(mesh, owned);
+
+			part.mesh = simplify ? simplify_surface(cropped, fixedPointsArrayName) : cropped;
+			part.mesh->GetPointData()->RemoveArray(fixedPointsArrayName);
+			part.raw = nullptr;
+		}
+
+		// Merge the blocks, the seam points coincide exactly
+		vtkSmartPointer<vtkAppendPolyData> append =
+				vtkSmartPointer<vtkAppendPolyData>::New();
+		for (auto& part : parts)
+		{
+			if (part.mesh && part.mesh->GetNumberOfCells() > 0)
+				append->AddInputData(part.mesh);
+		}
+		if (append->GetNumberOfInputConnections(0) > 0)
+		{
+			vtkSmartPointer<vtkCleanPolyData> clean =
+					vtkSmartPointer<vtkCleanPolyData>::New();
+			clean->SetInputConnection(append->GetOutputPort());
+			clean->PointMergingOn();
+			clean->SetTolerance(0.0);
+			clean->ConvertLinesToPointsOff();
+			clean->ConvertPolysToLinesOff();
+			clean->ConvertStripsToPolysOff();
+			clean->Update();
+			output = clean->GetOutput();
+		}
+		else
+		{
+			output = vtkSmartPointer<vtkPolyData>::New();
+		}
+		output->GetFieldData()->AddArray(names_array);
+		output->GetFieldData()->AddArray(color_array);
+	}
+
+	// Case 65858: Set name and color info when the collapsed exporting tissue is only one
+	if (simplify && tissuevec.size() == 1)
+	{
+		vtkSmartPointer<vtkStringArray> names_array_1 =
+				vtkSmartPointer<vtkStringArray>::New();
+		names_array_1->SetNumberOfTuples(1);
+		names_array_1->SetName(tissueNameArrayName);
 
-			output->GetFieldData()->AddArray(names_array_1);
-			output->GetFieldData()->AddArray(color_array_1);
+		vtkSmartPointer<vtkFloatArray> color_array_1 =
+				vtkSmartPointer<vtkFloatArray>::New();
+		color_array_1->SetNumberOfComponents(3);
+		color_array_1->SetNumberOfTuples(1);
+		color_array_1->SetName(tissueColorArrayName);
+
+		for (tissues_size_t i = 1; i < num_tissues; i++)
+		{
+			check_equal(TissueInfos::GetTissueType(TissueInfos::GetTissueName(i)), i);
+			if (i == tissuevec[0])
+			{
+				names_array_1->SetValue(0, TissueInfos::GetTissueName(i).c_str());
+				auto color = TissueInfos::GetTissueColor(i);
+				color_array_1->SetTuple(0, color.v.data());
+			}
 		}
+
+		output->GetFieldData()->AddArray(names_array_1);
+		output->GetFieldData()->AddArray(color_array_1);
 	}
 	if (output)
 	{
@@ -7147,51 +7862,40 @@ void SlicesHandler::start_undo(iseg::DataSelection& dataSelection)
 		_uelem = new UndoElem;
 		_uelem->dataSelection = dataSelection;
 
+		bmphandler& slice = _image_slices[dataSelection.sliceNr];
 		if (dataSelection.bmp)
 		{
-			_uelem->bmp_old = _image_slices[dataSelection.sliceNr].copy_bmp();
-			_uelem->mode1_old = _image_slices[dataSelection.sliceNr].return_mode(true);
-		}
-		else
-		{
-			_uelem->bmp_old = nullptr;
+			_uelem->bmp.snapshot(slice.return_bmp(), _area);
+			_uelem->mode1_old = slice.return_mode(true);
 		}
 
 		if (dataSelection.work)
 		{
-			_uelem->work_old = _image_slices[dataSelection.sliceNr].copy_work();
-			_uelem->mode2_old = _image_slices[dataSelection.sliceNr].return_mode(false);
-		}
-		else
-		{
-			_uelem->work_old = nullptr;
+			_uelem->work.snapshot(slice.return_work(), _area);
+			_uelem->mode2_old = slice.return_mode(false);
 		}
 
 		if (dataSelection.tissues)
 		{
-			_uelem->tissue_old = _image_slices[dataSelection.sliceNr].copy_tissue(_active_tissuelayer);
-		}
-		else
-		{
-			_uelem->tissue_old = nullptr;
+			_uelem->tissue.snapshot(slice.return_tissues(_active_tissuelayer), _area);
 		}
 
 		_uelem->vvm_old.clear();
 		if (dataSelection.vvm)
 		{
-			_uelem->vvm_old = *(_image_slices[dataSelection.sliceNr].return_vvm());
+			_uelem->vvm_old = *(slice.return_vvm());
 		}
 
 		_uelem->limits_old.clear();
 		if (dataSelection.limits)
 		{
-			_uelem->limits_old = *(_image_slices[dataSelection.sliceNr].return_limits());
+			_uelem->limits_old = *(slice.return_limits());
 		}
 
 		_uelem->marks_old.clear();
 		if (dataSelection.marks)
 		{
-			_uelem->marks_old = *(_image_slices[dataSelection.sliceNr].return_marks());
+			_uelem->marks_old = *(slice.return_marks());
 		}
 	}
 }
@@ -7214,38 +7918,60 @@ bool SlicesHandler::start_undo(iseg::DataSelection& dataSelection,
 	{
 		MultiUndoElem* uelem1 = new MultiUndoElem;
 		_uelem = uelem1;
-		//		uelem=new MultiUndoElem;
-		//		MultiUndoElem *uelem1=dynamic_cast<MultiUndoElem *>(uelem);
 		_uelem->dataSelection = dataSelection;
 		uelem1->vslicenr = vslicenr1;
 
-		if (_uelem->arraynr() < this->_undoQueue.return_nrundoarraysmax())
+		int const n = static_cast<int>(vslicenr1.size());
+		if (dataSelection.bmp)
 		{
-			//abcd std::vector<unsigned short>::iterator it;
-			std::vector<unsigned>::iterator it;
-			uelem1->vbmp_old.clear();
-			uelem1->vmode1_old.clear();
+			uelem1->vbmp.resize(n);
+			uelem1->vmode1_old.resize(n);
+		}
+		if (dataSelection.work)
+		{
+			uelem1->vwork.resize(n);
+			uelem1->vmode2_old.resize(n);
+		}
+		if (dataSelection.tissues)
+		{
+			uelem1->vtissue.resize(n);
+		}
+
+		// compress slice by slice, only unchanged tiles are dropped in end_undo.
+		// Stop as soon as the compressed size exceeds the budget, the step is rejected then.
+		size_t const bytes_max = this->_undoQueue.return_undobytesmax();
+		std::atomic<size_t> bytes(0);
+#pragma omp parallel for
+		for (int i = 0; i < n; i++)
+		{
+			if (bytes.load(std::memory_order_relaxed) > bytes_max)
+				continue;
+
+			bmphandler& slice = _image_slices[vslicenr1[i]];
+			size_t slice_bytes = 0;
 			if (dataSelection.bmp)
-				for (it = vslicenr1.begin(); it != vslicenr1.end(); it++)
-				{
-					uelem1->vbmp_old.push_back(_image_slices[*it].copy_bmp());
-					uelem1->vmode1_old.push_back(
-							_image_slices[*it].return_mode(true));
-				}
-			uelem1->vwork_old.clear();
-			uelem1->vmode2_old.clear();
+			{
+				uelem1->vbmp[i].snapshot(slice.return_bmp(), _area);
+				uelem1->vmode1_old[i] = slice.return_mode(true);
+				slice_bytes += uelem1->vbmp[i].bytes();
+			}
 			if (dataSelection.work)
-				for (it = vslicenr1.begin(); it != vslicenr1.end(); it++)
-				{
-					uelem1->vwork_old.push_back(_image_slices[*it].copy_work());
-					uelem1->vmode2_old.push_back(
-							_image_slices[*it].return_mode(false));
-				}
-			uelem1->vtissue_old.clear();
+			{
+				uelem1->vwork[i].snapshot(slice.return_work(), _area);
+				uelem1->vmode2_old[i] = slice.return_mode(false);
+				slice_bytes += uelem1->vwork[i].bytes();
+			}
 			if (dataSelection.tissues)
-				for (it = vslicenr1.begin(); it != vslicenr1.end(); it++)
-					uelem1->vtissue_old.push_back(
-							_image_slices[*it].copy_tissue(_active_tissuelayer));
+			{
+				uelem1->vtissue[i].snapshot(slice.return_tissues(_active_tissuelayer), _area);
+				slice_bytes += uelem1->vtissue[i].bytes();
+			}
+			bytes += slice_bytes;
+		}
+
+		if (bytes <= bytes_max && uelem1->bytes() <= bytes_max)
+		{
+			std::vector<unsigned>::iterator it;
 			uelem1->vvvm_old.clear();
 			if (dataSelection.vvm)
 				for (it = vslicenr1.begin(); it != vslicenr1.end(); it++)
@@ -7256,7 +7982,7 @@ bool SlicesHandler::start_undo(iseg::DataSelection& dataSelection,
 				for (it = vslicenr1.begin(); it != vslicenr1.end(); it++)
 					uelem1->vlimits_old.push_back(
 							*(_image_slices[*it].return_limits()));
-			uelem1->marks_old.clear();
+			uelem1->vmarks_old.clear();
 			if (dataSelection.marks)
 				for (it = vslicenr1.begin(); it != vslicenr1.end(); it++)
 					uelem1->vmarks_old.push_back(
@@ -7266,7 +7992,7 @@ bool SlicesHandler::start_undo(iseg::DataSelection& dataSelection,
 		}
 		else
 		{
-			free(_uelem);
+			delete _uelem;
 			_uelem = nullptr;
 		}
 	}
@@ -7278,7 +8004,7 @@ void SlicesHandler::abort_undo()
 {
 	if (_uelem != nullptr)
 	{
-		free(_uelem);
+		delete _uelem;
 		_uelem = nullptr;
 	}
 }
@@ -7291,33 +8017,49 @@ void SlicesHandler::end_undo()
 		{
 			MultiUndoElem* uelem1 = dynamic_cast<MultiUndoElem*>(_uelem);
 
-			uelem1->vbmp_new.clear();
-			uelem1->vmode1_new.clear();
+			// drop tiles which were not modified by the operation
+			int const n = static_cast<int>(uelem1->vslicenr.size());
+#pragma omp parallel for
+			for (int i = 0; i < n; i++)
+			{
+				bmphandler& slice = _image_slices[uelem1->vslicenr[i]];
+				if (_uelem->dataSelection.bmp)
+					uelem1->vbmp[i].prune(slice.return_bmp());
+				if (_uelem->dataSelection.work)
+					uelem1->vwork[i].prune(slice.return_work());
+				if (_uelem->dataSelection.tissues)
+					uelem1->vtissue[i].prune(slice.return_tissues(_active_tissuelayer));
+			}
 
-			uelem1->vwork_new.clear();
+			uelem1->vmode1_new.clear();
 			uelem1->vmode2_new.clear();
 
-			uelem1->vtissue_new.clear();
-
 			uelem1->vvvm_new.clear();
 
 			uelem1->vlimits_new.clear();
 
-			uelem1->marks_new.clear();
+			uelem1->vmarks_new.clear();
 
-			this->_undoQueue.add_undo(uelem1);
+			if (!this->_undoQueue.add_undo(uelem1))
+			{
+				delete uelem1;
+			}
 
 			_uelem = nullptr;
 		}
 		else
 		{
-			_uelem->bmp_new = nullptr;
+			bmphandler& slice = _image_slices[_uelem->dataSelection.sliceNr];
+			if (_uelem->dataSelection.bmp)
+				_uelem->bmp.prune(slice.return_bmp());
 			_uelem->mode1_new = 0;
 
-			_uelem->work_new = nullptr;
+			if (_uelem->dataSelection.work)
+				_uelem->work.prune(slice.return_work());
 			_uelem->mode2_new = 0;
 
-			_uelem->tissue_new = nullptr;
+			if (_uelem->dataSelection.tissues)
+				_uelem->tissue.prune(slice.return_tissues(_active_tissuelayer));
 
 			_uelem->vvm_new.clear();
 
@@ -7325,7 +8067,10 @@ void SlicesHandler::end_undo()
 
 			_uelem->marks_new.clear();
 
-			this->_undoQueue.add_undo(_uelem);
+			if (!this->_undoQueue.add_undo(_uelem))
+			{
+				delete _uelem;
+			}
 
 			_uelem = nullptr;
 		}
@@ -7336,27 +8081,16 @@ void SlicesHandler::merge_undo()
 {
 	if (_uelem != nullptr && !_uelem->multi)
 	{
-		iseg::DataSelection dataSelection = _uelem->dataSelection;
+		bmphandler& slice = _image_slices[_uelem->dataSelection.sliceNr];
+		if (_uelem->dataSelection.bmp)
+			_uelem->bmp.prune(slice.return_bmp());
+		if (_uelem->dataSelection.work)
+			_uelem->work.prune(slice.return_work());
+		if (_uelem->dataSelection.tissues)
+			_uelem->tissue.prune(slice.return_tissues(_active_tissuelayer));
 
+		// queue takes ownership
 		this->_undoQueue.merge_undo(_uelem);
-
-		if (dataSelection.bmp)
-		{
-			_uelem->bmp_new = nullptr;
-			_uelem->bmp_old = nullptr;
-		}
-		if (dataSelection.work)
-		{
-			_uelem->work_new = nullptr;
-			_uelem->work_old = nullptr;
-		}
-		if (dataSelection.tissues)
-		{
-			_uelem->tissue_new = nullptr;
-			_uelem->tissue_old = nullptr;
-		}
-
-		delete _uelem;
 		_uelem = nullptr;
 	}
 }
@@ -7366,47 +8100,51 @@ iseg::DataSelection SlicesHandler::undo()
 	if (_uelem == nullptr)
 	{
 		_uelem = this->_undoQueue.undo();
+		if (_uelem == nullptr)
+			return iseg::DataSelection();
 		if (_uelem->multi)
 		{
 			MultiUndoElem* uelem1 = dynamic_cast<MultiUndoElem*>(_uelem);
 
 			if (uelem1 != nullptr)
 			{
-				unsigned short current_slice;
 				iseg::DataSelection dataSelection = _uelem->dataSelection;
 
-				for (unsigned i = 0; i < uelem1->vslicenr.size(); i++)
+				int const n = static_cast<int>(uelem1->vslicenr.size());
+				uelem1->vmode1_new.resize(dataSelection.bmp ? n : 0);
+				uelem1->vmode2_new.resize(dataSelection.work ? n : 0);
+
+				// exchange stored (old) tiles with current (new) state
+#pragma omp parallel for
+				for (int i = 0; i < n; i++)
 				{
-					current_slice = uelem1->vslicenr[i];
+					bmphandler& slice = _image_slices[uelem1->vslicenr[i]];
 					if (dataSelection.bmp)
 					{
-						uelem1->vbmp_new.push_back(
-								_image_slices[current_slice].copy_bmp());
-						uelem1->vmode1_new.push_back(
-								_image_slices[current_slice].return_mode(true));
-						_image_slices[current_slice].copy2bmp(
-								uelem1->vbmp_old[i], uelem1->vmode1_old[i]);
-						free(uelem1->vbmp_old[i]);
+						uelem1->vmode1_new[i] = slice.return_mode(true);
+						uelem1->vbmp[i].exchange(slice.return_bmp());
+						slice.set_mode(uelem1->vmode1_old[i], true);
 					}
 					if (dataSelection.work)
 					{
-						uelem1->vwork_new.push_back(
-								_image_slices[current_slice].copy_work());
-						uelem1->vmode2_new.push_back(
-								_image_slices[current_slice].return_mode(false));
-						_image_slices[current_slice].copy2work(
-								uelem1->vwork_old[i], uelem1->vmode2_old[i]);
-						free(uelem1->vwork_old[i]);
+						uelem1->vmode2_new[i] = slice.return_mode(false);
+						uelem1->vwork[i].exchange(slice.return_work());
+						slice.set_mode(uelem1->vmode2_old[i], false);
 					}
 					if (dataSelection.tissues)
 					{
-						uelem1->vtissue_new.push_back(
-								_image_slices[current_slice].copy_tissue(
-										_active_tissuelayer));
-						_image_slices[current_slice].copy2tissue(
-								_active_tissuelayer, uelem1->vtissue_old[i]);
-						free(uelem1->vtissue_old[i]);
+						uelem1->vtissue[i].exchange(slice.return_tissues(_active_tissuelayer));
 					}
+				}
+
+				_undone_slices = std::make_pair(_nrslices, 0);
+				unsigned short current_slice;
+				for (unsigned i = 0; i < uelem1->vslicenr.size(); i++)
+				{
+					current_slice = uelem1->vslicenr[i];
+					_undone_slices.first = std::min(_undone_slices.first, current_slice);
+					_undone_slices.second = std::max<unsigned short>(_undone_slices.second, current_slice + 1);
+					mark_dirty(current_slice, dirty_channels(dataSelection));
 					if (dataSelection.vvm)
 					{
 						uelem1->vvvm_new.push_back(
@@ -7429,15 +8167,11 @@ iseg::DataSelection SlicesHandler::undo()
 								&(uelem1->vmarks_old[i]));
 					}
 				}
-				uelem1->vbmp_old.clear();
-				uelem1->vmode1_old.clear();
-				uelem1->vwork_old.clear();
-				uelem1->vmode2_old.clear();
-				uelem1->vtissue_old.clear();
 				uelem1->vvvm_old.clear();
 				uelem1->vlimits_old.clear();
 				uelem1->vmarks_old.clear();
 
+				_undoQueue.end_exchange(_uelem);
 				_uelem = nullptr;
 
 				return dataSelection;
@@ -7450,74 +8184,56 @@ iseg::DataSelection SlicesHandler::undo()
 			if (_uelem != nullptr)
 			{
 				iseg::DataSelection dataSelection = _uelem->dataSelection;
+				bmphandler& slice = _image_slices[dataSelection.sliceNr];
 
 				if (dataSelection.bmp)
 				{
-					_uelem->bmp_new =
-							_image_slices[dataSelection.sliceNr].copy_bmp();
-					_uelem->mode1_new =
-							_image_slices[dataSelection.sliceNr].return_mode(true);
-					_image_slices[dataSelection.sliceNr].copy2bmp(
-							_uelem->bmp_old, _uelem->mode1_old);
-					free(_uelem->bmp_old);
-					_uelem->bmp_old = nullptr;
+					_uelem->mode1_new = slice.return_mode(true);
+					_uelem->bmp.exchange(slice.return_bmp());
+					slice.set_mode(_uelem->mode1_old, true);
 				}
 
 				if (dataSelection.work)
 				{
-					_uelem->work_new =
-							_image_slices[dataSelection.sliceNr].copy_work();
-					_uelem->mode2_new =
-							_image_slices[dataSelection.sliceNr].return_mode(false);
-					_image_slices[dataSelection.sliceNr].copy2work(
-							_uelem->work_old, _uelem->mode2_old);
-					free(_uelem->work_old);
-					_uelem->work_old = nullptr;
+					_uelem->mode2_new = slice.return_mode(false);
+					_uelem->work.exchange(slice.return_work());
+					slice.set_mode(_uelem->mode2_old, false);
 				}
 
 				if (dataSelection.tissues)
 				{
-					_uelem->tissue_new =
-							_image_slices[dataSelection.sliceNr].copy_tissue(
-									_active_tissuelayer);
-					_image_slices[dataSelection.sliceNr].copy2tissue(
-							_active_tissuelayer, _uelem->tissue_old);
-					free(_uelem->tissue_old);
-					_uelem->tissue_old = nullptr;
+					_uelem->tissue.exchange(slice.return_tissues(_active_tissuelayer));
 				}
 
 				if (dataSelection.vvm)
 				{
 					_uelem->vvm_new.clear();
-					_uelem->vvm_new =
-							*(_image_slices[dataSelection.sliceNr].return_vvm());
-					_image_slices[dataSelection.sliceNr].copy2vvm(
-							&_uelem->vvm_old);
+					_uelem->vvm_new = *(slice.return_vvm());
+					slice.copy2vvm(&_uelem->vvm_old);
 					_uelem->vvm_old.clear();
 				}
 
 				if (dataSelection.limits)
 				{
 					_uelem->limits_new.clear();
-					_uelem->limits_new =
-							*(_image_slices[dataSelection.sliceNr].return_limits());
-					_image_slices[dataSelection.sliceNr].copy2limits(
-							&_uelem->limits_old);
+					_uelem->limits_new = *(slice.return_limits());
+					slice.copy2limits(&_uelem->limits_old);
 					_uelem->limits_old.clear();
 				}
 
 				if (dataSelection.marks)
 				{
 					_uelem->marks_new.clear();
-					_uelem->marks_new =
-							*(_image_slices[dataSelection.sliceNr].return_marks());
-					_image_slices[dataSelection.sliceNr].copy2marks(
-							&_uelem->marks_old);
+					_uelem->marks_new = *(slice.return_marks());
+					slice.copy2marks(&_uelem->marks_old);
 					_uelem->marks_old.clear();
 				}
 
+				mark_dirty(dataSelection);
+				_undone_slices = std::make_pair(dataSelection.sliceNr, dataSelection.sliceNr + 1);
 				set_active_slice(dataSelection.sliceNr);
 
+				_undoQueue.end_exchange(_uelem);
 				_uelem = nullptr;
 
 				return dataSelection;
@@ -7543,40 +8259,41 @@ iseg::DataSelection SlicesHandler::redo()
 
 			if (uelem1 != nullptr)
 			{
-				unsigned short current_slice;
 				iseg::DataSelection dataSelection = _uelem->dataSelection;
-				for (unsigned i = 0; i < uelem1->vslicenr.size(); i++)
+
+				int const n = static_cast<int>(uelem1->vslicenr.size());
+
+				// exchange stored (new) tiles with current (old) state
+#pragma omp parallel for
+				for (int i = 0; i < n; i++)
 				{
-					current_slice = uelem1->vslicenr[i];
+					bmphandler& slice = _image_slices[uelem1->vslicenr[i]];
 					if (dataSelection.bmp)
 					{
-						uelem1->vbmp_old.push_back(
-								_image_slices[current_slice].copy_bmp());
-						uelem1->vmode1_old.push_back(
-								_image_slices[current_slice].return_mode(true));
-						_image_slices[current_slice].copy2bmp(
-								uelem1->vbmp_new[i], uelem1->vmode1_new[i]);
-						free(uelem1->vbmp_new[i]);
+						uelem1->vmode1_old[i] = slice.return_mode(true);
+						uelem1->vbmp[i].exchange(slice.return_bmp());
+						slice.set_mode(uelem1->vmode1_new[i], true);
 					}
 					if (dataSelection.work)
 					{
-						uelem1->vwork_old.push_back(
-								_image_slices[current_slice].copy_work());
-						uelem1->vmode2_old.push_back(
-								_image_slices[current_slice].return_mode(false));
-						_image_slices[current_slice].copy2work(
-								uelem1->vwork_new[i], uelem1->vmode2_new[i]);
-						free(uelem1->vwork_new[i]);
+						uelem1->vmode2_old[i] = slice.return_mode(false);
+						uelem1->vwork[i].exchange(slice.return_work());
+						slice.set_mode(uelem1->vmode2_new[i], false);
 					}
 					if (dataSelection.tissues)
 					{
-						uelem1->vtissue_old.push_back(
-								_image_slices[current_slice].copy_tissue(
-										_active_tissuelayer));
-						_image_slices[current_slice].copy2tissue(
-								_active_tissuelayer, uelem1->vtissue_new[i]);
-						free(uelem1->vtissue_new[i]);
+						uelem1->vtissue[i].exchange(slice.return_tissues(_active_tissuelayer));
 					}
+				}
+
+				_undone_slices = std::make_pair(_nrslices, 0);
+				unsigned short current_slice;
+				for (unsigned i = 0; i < uelem1->vslicenr.size(); i++)
+				{
+					current_slice = uelem1->vslicenr[i];
+					_undone_slices.first = std::min(_undone_slices.first, current_slice);
+					_undone_slices.second = std::max<unsigned short>(_undone_slices.second, current_slice + 1);
+					mark_dirty(current_slice, dirty_channels(dataSelection));
 					if (dataSelection.vvm)
 					{
 						uelem1->vvvm_old.push_back(
@@ -7599,13 +8316,11 @@ iseg::DataSelection SlicesHandler::redo()
 								&(uelem1->vmarks_new[i]));
 					}
 				}
-				uelem1->vbmp_new.clear();
-				uelem1->vwork_new.clear();
-				uelem1->vtissue_new.clear();
 				uelem1->vvvm_new.clear();
 				uelem1->vlimits_new.clear();
 				uelem1->vmarks_new.clear();
 
+				_undoQueue.end_exchange(_uelem);
 				_uelem = nullptr;
 
 				return dataSelection;
@@ -7618,74 +8333,56 @@ iseg::DataSelection SlicesHandler::redo()
 			if (_uelem != nullptr)
 			{
 				iseg::DataSelection dataSelection = _uelem->dataSelection;
+				bmphandler& slice = _image_slices[dataSelection.sliceNr];
 
 				if (dataSelection.bmp)
 				{
-					_uelem->bmp_old =
-							_image_slices[dataSelection.sliceNr].copy_bmp();
-					_uelem->mode1_old =
-							_image_slices[dataSelection.sliceNr].return_mode(true);
-					_image_slices[dataSelection.sliceNr].copy2bmp(
-							_uelem->bmp_new, _uelem->mode1_new);
-					free(_uelem->bmp_new);
-					_uelem->bmp_new = nullptr;
+					_uelem->mode1_old = slice.return_mode(true);
+					_uelem->bmp.exchange(slice.return_bmp());
+					slice.set_mode(_uelem->mode1_new, true);
 				}
 
 				if (dataSelection.work)
 				{
-					_uelem->work_old =
-							_image_slices[dataSelection.sliceNr].copy_work();
-					_uelem->mode2_old =
-							_image_slices[dataSelection.sliceNr].return_mode(false);
-					_image_slices[dataSelection.sliceNr].copy2work(
-							_uelem->work_new, _uelem->mode2_new);
-					free(_uelem->work_new);
-					_uelem->work_new = nullptr;
+					_uelem->mode2_old = slice.return_mode(false);
+					_uelem->work.exchange(slice.return_work());
+					slice.set_mode(_uelem->mode2_new, false);
 				}
 
 				if (dataSelection.tissues)
 				{
-					_uelem->tissue_old =
-							_image_slices[dataSelection.sliceNr].copy_tissue(
-									_active_tissuelayer);
-					_image_slices[dataSelection.sliceNr].copy2tissue(
-							_active_tissuelayer, _uelem->tissue_new);
-					free(_uelem->tissue_new);
-					_uelem->tissue_new = nullptr;
+					_uelem->tissue.exchange(slice.return_tissues(_active_tissuelayer));
 				}
 
 				if (dataSelection.vvm)
 				{
 					_uelem->vvm_old.clear();
-					_uelem->vvm_old =
-							*(_image_slices[dataSelection.sliceNr].return_vvm());
-					_image_slices[dataSelection.sliceNr].copy2vvm(
-							&_uelem->vvm_new);
+					_uelem->vvm_old = *(slice.return_vvm());
+					slice.copy2vvm(&_uelem->vvm_new);
 					_uelem->vvm_new.clear();
 				}
 
 				if (dataSelection.limits)
 				{
 					_uelem->limits_old.clear();
-					_uelem->limits_old =
-							*(_image_slices[dataSelection.sliceNr].return_limits());
-					_image_slices[dataSelection.sliceNr].copy2limits(
-							&_uelem->limits_new);
+					_uelem->limits_old = *(slice.return_limits());
+					slice.copy2limits(&_uelem->limits_new);
 					_uelem->limits_new.clear();
 				}
 
 				if (dataSelection.marks)
 				{
 					_uelem->marks_old.clear();
-					_uelem->marks_old =
-							*(_image_slices[dataSelection.sliceNr].return_marks());
-					_image_slices[dataSelection.sliceNr].copy2marks(
-							&_uelem->marks_new);
+					_uelem->marks_old = *(slice.return_marks());
+					slice.copy2marks(&_uelem->marks_new);
 					_uelem->marks_new.clear();
 				}
 
+				mark_dirty(dataSelection);
+				_undone_slices = std::make_pair(dataSelection.sliceNr, dataSelection.sliceNr + 1);
 				set_active_slice(dataSelection.sliceNr);
 
+				_undoQueue.end_exchange(_uelem);
 				_uelem = nullptr;
 
 				return dataSelection;
@@ -7733,20 +8430,10 @@ unsigned SlicesHandler::return_nrundosteps()
 	return this->_undoQueue.return_nrundomax();
 }
 
-unsigned SlicesHandler::return_nrundoarrays()
-{
-	return this->_undoQueue.return_nrundoarraysmax();
-}
-
 void SlicesHandler::set_undo3D(bool undo3D1) { _undo3D = undo3D1; }
 
 void SlicesHandler::set_undonr(unsigned nr) { this->_undoQueue.set_nrundo(nr); }
 
-void SlicesHandler::set_undoarraynr(unsigned nr)
-{
-	this->_undoQueue.set_nrundoarraysmax(nr);
-}
-
 int SlicesHandler::LoadDICOM(std::vector<const char*> lfilename)
 {
 	if (lfilename.size() > 0)
@@ -7823,19 +8510,14 @@ int SlicesHandler::LoadDICOM(std::vector<const char*> lfilename)
 		_endslice = _nrslices = (unsigned short)(lfilename.size());
 		_os.set_sizenr(_nrslices);
 
-		// Ranges
-		Pair dummy;
-		_slice_ranges.resize(_nrslices);
-		_slice_bmpranges.resize(_nrslices);
-		compute_range_mode1(&dummy);
-		compute_bmprange_mode1(&dummy);
-
 		_width = _image_slices[0].return_width();
 		_height = _image_slices[0].return_height();
 		_area = _height * static_cast<unsigned int>(_width);
 
 		new_overlay();
 
+		finish_loading();
+
 		_loaded = true;
 
 		return true;
@@ -7887,19 +8569,14 @@ int SlicesHandler::LoadDICOM(std::vector<const char*> lfilename, Point p,
 			if (j < _nrslices)
 				return 0;
 
-			// Ranges
-			Pair dummy;
-			_slice_ranges.resize(_nrslices);
-			_slice_bmpranges.resize(_nrslices);
-			compute_range_mode1(&dummy);
-			compute_bmprange_mode1(&dummy);
-
 			_width = _image_slices[0].return_width();
 			_height = _image_slices[0].return_height();
 			_area = _height * (unsigned int)_width;
 
 			new_overlay();
 
+			finish_loading();
+
 			_loaded = true;
 
 			Transform tr(disp1, dc1);
@@ -7958,12 +8635,7 @@ int SlicesHandler::LoadDICOM(std::vector<const char*> lfilename, Point p,
 			set_transform(tr);
 		}
 
-		// Ranges
-		Pair dummy;
-		_slice_ranges.resize(_nrslices);
-		_slice_bmpranges.resize(_nrslices);
-		compute_range_mode1(&dummy);
-		compute_bmprange_mode1(&dummy);
+		finish_loading();
 
 		return 1;
 	}
@@ -8697,2248 +9369,262 @@ void SlicesHandler::add_skin3D(int ix, int iy, int iz, float setto)
 {
 	// ix,iy,iz are in pixels
 
-	//Create skin in each slice as same way is done in the 2D AddSkin process
+	// the skin are the tissue voxels within the ellipsoid of radii ix,iy,iz around a background voxel
+	auto work = target_slices();
+	std::vector<float*> slices(work.begin() + _startslice, work.begin() + _endslice);
+	add_skin_3d(slices, _width, _height, ix, iy, iz, [](float v) { return v == 0; }, [setto](float& v) { v = setto; });
+}
+
+void SlicesHandler::add_skin3D_outside(int ix, int iy, int iz, float setto)
+{
+	// the skin are the exterior background voxels within the ellipsoid of radii ix,iy,iz around another voxel
+	float const set_to = (float)123E10;
 	for (unsigned short z = _startslice; z < _endslice; z++)
 	{
-		float* work;
-		work = _image_slices[z].return_work();
-		unsigned i = 0, pos, y, x;
-
-		//Create a binary vector noTissue/Tissue
-		std::vector<int> s;
-		for (int j = 0; j < _height; j++)
-		{
-			for (int k = 0; k < _width; k++)
-			{
-				if (work[i] == 0)
-					s.push_back(-1);
-				else
-					s.push_back(0);
-				i++;
-			}
-		}
-
-		// i4 itetations through  y, -y, x, -x converting, each time a tissue beginning is find, one tissue pixel into skin
-		//!! It is assumed that ix and iy are the same
-		bool convertSkin = true;
-		for (i = 1; i < ix + 1; i++)
-		{
-			for (y = 0; y < _height; y++)
-			{
-				pos = y * _width;
-				while (pos < (y + 1) * _width)
-				{
-					if (s[pos] == 0)
-					{
-						if (convertSkin)
-							s[pos] = 256;
-						convertSkin = false;
-					}
-					else
-						convertSkin = true;
-
-					pos++;
-				}
-
-				pos = (y + 1) * _width - 1;
-				while (pos > y * _width)
-				{
-					if (s[pos] == 0)
-					{
-						if (convertSkin)
-							s[pos] = 256;
-						convertSkin = false;
-					}
-					else
-						convertSkin = true;
+		_image_slices[z].flood_exterior(set_to);
+	}
 
-					pos--;
-				}
-			}
+	auto work = target_slices();
+	std::vector<float*> slices(work.begin() + _startslice, work.begin() + _endslice);
+	flood_exterior_3d(slices, _width, _area, set_to);
+	add_skin_3d(slices, _width, _height, ix, iy, iz, [set_to](float v) { return v != set_to; }, [setto](float& v) { v = setto; });
+	replace_value(slices, _area, set_to, 0.f);
+}
 
-			for (x = 0; x < _width; x++)
-			{
-				pos = x;
-				while (pos < _height * _width)
-				{
-					if (s[pos] == 0)
-					{
-						if (convertSkin)
-							s[pos] = 256;
-						convertSkin = false;
-					}
-					else
-						convertSkin = true;
+void SlicesHandler::add_skin3D_outside2(int ix, int iy, int iz, float setto)
+{
+	add_skin3D_outside(ix, iy, iz, setto);
+}
 
-					pos += _width;
-				}
+void SlicesHandler::add_skintissue3D_outside2(int ix, int iy, int iz, tissues_size_t f)
+{
+	// the skin are the exterior background voxels within the ellipsoid of radii ix,iy,iz around a tissue
+	tissues_size_t const set_to = TISSUES_SIZE_MAX;
+	for (unsigned short z = _startslice; z < _endslice; z++)
+	{
+		_image_slices[z].flood_exteriortissue(_active_tissuelayer, set_to);
+	}
 
-				pos = _width * (_height - 1) + x;
-				while (pos > _width)
-				{
-					if (s[pos] == 0)
-					{
-						if (convertSkin)
-							s[pos] = 256;
-						convertSkin = false;
-					}
-					else
-						convertSkin = true;
+	auto tissues = tissue_slices(_active_tissuelayer);
+	std::vector<tissues_size_t*> slices(tissues.begin() + _startslice, tissues.begin() + _endslice);
+	flood_exterior_3d(slices, _width, _area, set_to);
+	add_skin_3d(slices, _width, _height, ix, iy, iz, [set_to](tissues_size_t v) { return v != set_to; }, [f](tissues_size_t& v) { v = f; });
+	replace_value(slices, _area, set_to, tissues_size_t(0));
+}
 
-					pos -= _width;
-				}
-			}
-		}
+float SlicesHandler::add_skin3D(int i1)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
+	{
+		setto = p.low;
 
-		//go over the vector and set the skin pixel at the source pointer
-		i = 0;
-		for (int j = 0; j < _height; j++)
+		for (unsigned short i = _startslice; i < _endslice; i++)
 		{
-			for (int k = 0; k < _width; k++)
+			float* bits = _image_slices[i].return_work();
+			for (unsigned pos = 0; pos < _area; pos++)
 			{
-				if (s[i] == 256)
-					work[i] = setto;
-				i++;
+				if (bits[pos] != p.high)
+					setto = std::max(setto, bits[pos]);
 			}
 		}
-	}
 
-	// To create skin in 3D, it is check if where there is tissue, in the thickness (up&down) distance there is neither tissue nor skin
-	//The conversion is already done.
-	//int checkSliceDistance = int(iz/thickness);
-	int checkSliceDistance = iz;
+		setto = (setto + p.high) / 2;
+	}
 
-	for (unsigned short z = _startslice; z < _endslice - checkSliceDistance; z++)
-	{
-		float* work1;
-		float* work2;
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z + checkSliceDistance].return_work();
-
-		unsigned i = 0;
-		for (int j = 0; j < _height; j++)
-		{
-			for (int k = 0; k < _width; k++)
-			{
-				if (work1[i] != 0 && work1[i] != setto)
-					if (work2[i] == 0)
-						work1[i] = setto;
-				i++;
-			}
-		}
-	}
-
-	for (unsigned short z = _endslice - 1; z > _startslice + checkSliceDistance;
-			 z--)
-	{
-		float* work1;
-		float* work2;
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z - checkSliceDistance].return_work();
-
-		unsigned i = 0;
-		for (int j = 0; j < _height; j++)
-		{
-			for (int k = 0; k < _width; k++)
-			{
-				if (work1[i] != 0 && work1[i] != setto)
-					if (work2[i] == 0)
-						work1[i] = setto;
-				i++;
-			}
-		}
-	}
-}
-
-void SlicesHandler::add_skin3D_outside(int ix, int iy, int iz, float setto)
-{
-	float set_to = (float)123E10;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exterior(set_to);
-	}
-
-	std::vector<posit> s;
-	posit p1;
-
-	p1.pz = _activeslice;
-
-	float* work1;
-	float* work2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z + 1].return_work();
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z - 1].return_work();
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	float* work;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
-
-		work = _image_slices[i.pz].return_work();
-		if (i.pxy % _width != 0 && work[i.pxy - 1] == 0)
-		{
-			work[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && work[i.pxy + 1] == 0)
-		{
-			work[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && work[i.pxy - _width] == 0)
-		{
-			work[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy < _area - _width && work[i.pxy + _width] == 0)
-		{
-			work[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			work = _image_slices[i.pz - 1].return_work();
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			work = _image_slices[i.pz + 1].return_work();
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
-
-	unsigned short x, y;
-	unsigned long pos;
-	unsigned short i1;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_work();
-
-		for (y = 0; y < _height; y++)
-		{
-			pos = y * _width;
-			i1 = 0;
-			while (pos < (unsigned long)(y + 1) * _width)
-			{
-				if (work[pos] != set_to)
-					i1 = ix;
-				else
-				{
-					if (i1 > 0)
-					{
-						work[pos] = setto;
-						i1--;
-					}
-				}
-				pos++;
-			}
-		}
-
-		for (y = 0; y < _height; y++)
-		{
-			pos = (y + 1) * _width - 1;
-			i1 = 0;
-			while (pos > (unsigned long)y * _width)
-			{
-				if (work[pos] != set_to)
-					i1 = ix;
-				else
-				{
-					if (i1 > 0)
-					{
-						work[pos] = setto;
-						i1--;
-					}
-				}
-				pos--;
-			}
-			if (work[pos] != set_to)
-				i1 = ix;
-			else
-			{
-				if (i1 > 0)
-				{
-					work[pos] = setto;
-					i1--;
-				}
-			}
-		}
-
-		for (x = 0; x < _width; x++)
-		{
-			pos = x;
-			i1 = 0;
-			while (pos < _area)
-			{
-				if (work[pos] != set_to)
-					i1 = iy;
-				else
-				{
-					if (i1 > 0)
-					{
-						work[pos] = setto;
-						i1--;
-					}
-				}
-				pos += _width;
-			}
-		}
-
-		for (x = 0; x < _width; x++)
-		{
-			pos = _area + x - _width;
-			i1 = 0;
-			while (pos > _width)
-			{
-				if (work[pos] != set_to)
-					i1 = iy;
-				else
-				{
-					if (i1 > 0)
-					{
-						work[pos] = setto;
-						i1--;
-					}
-				}
-				pos -= _width;
-			}
-			if (work[pos] != set_to)
-				i1 = iy;
-			else
-			{
-				if (i1 > 0)
-				{
-					work[pos] = setto;
-					i1--;
-				}
-			}
-		}
-	}
-
-	unsigned short* counter = (unsigned short*)malloc(sizeof(unsigned short) * _area);
-	for (unsigned i1 = 0; i1 < _area; i1++)
-		counter[i1] = 0;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_work();
-		for (pos = 0; pos < _area; pos++)
-		{
-			if (work[pos] != set_to)
-				counter[pos] = iz;
-			else
-			{
-				if (counter[pos] > 0)
-				{
-					work[pos] = setto;
-					counter[pos]--;
-				}
-			}
-		}
-	}
-	for (unsigned i1 = 0; i1 < _area; i1++)
-		counter[i1] = 0;
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		work = _image_slices[z].return_work();
-		for (pos = 0; pos < _area; pos++)
-		{
-			if (work[pos] != set_to)
-				counter[pos] = iz;
-			else
-			{
-				if (counter[pos] > 0)
-				{
-					work[pos] = setto;
-					counter[pos]--;
-				}
-			}
-		}
-	}
-	work = _image_slices[_startslice].return_work();
-	for (pos = 0; pos < _area; pos++)
-	{
-		if (work[pos] != set_to)
-			counter[pos] = iz;
-		else
-		{
-			if (counter[pos] > 0)
-			{
-				work[pos] = setto;
-				counter[pos]--;
-			}
-		}
-	}
-	free(counter);
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_work();
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (work[i1] == set_to)
-				work[i1] = 0;
-	}
-}
-
-void SlicesHandler::add_skin3D_outside2(int ix, int iy, int iz, float setto)
-{
-	float set_to = (float)123E10;
-	float set_to2 = (float)321E10;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exterior(set_to);
-	}
-
-	//Point p;
-	//unsigned position;
-	std::vector<posit> s;
-	posit p1;
-
-	//	p1.pxy=position;
-	p1.pz = _activeslice;
-
-	float* work1;
-	float* work2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z + 1].return_work();
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		work1 = _image_slices[z].return_work();
-		work2 = _image_slices[z - 1].return_work();
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	float* work;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
-
-		work = _image_slices[i.pz].return_work();
-		if (i.pxy % _width != 0 && work[i.pxy - 1] == 0)
-		{
-			work[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && work[i.pxy + 1] == 0)
-		{
-			work[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && work[i.pxy - _width] == 0)
-		{
-			work[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy < _area - _width && work[i.pxy + _width] == 0)
-		{
-			work[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			work = _image_slices[i.pz - 1].return_work();
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			work = _image_slices[i.pz + 1].return_work();
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
-
-	unsigned int totcount = (ix + 1) * (iy + 1) * (iz + 1);
-	unsigned int subx = (iy + 1) * (iz + 1);
-	unsigned int suby = (ix + 1) * (iz + 1);
-	unsigned int subz = (iy + 1) * (ix + 1);
-
-	Treap<posit, unsigned int> treap1;
-	if (iz > 0)
-	{
-		for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-		{
-			work1 = _image_slices[z].return_work();
-			work2 = _image_slices[z + 1].return_work();
-			for (unsigned long i = 0; i < _area; i++)
-			{
-				if (work1[i] == set_to)
-				{
-					if ((work2[i] != set_to) && (work2[i] != set_to2))
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						Treap<posit, unsigned int>::Node* n = nullptr;
-						treap1.insert(n, p1, 1, subz);
-						work1[i] = set_to2;
-					}
-				}
-				else if (work1[i] == set_to2)
-				{
-					if ((work2[i] != set_to) && (work2[i] != set_to2))
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						Treap<posit, unsigned int>::Node* n1 =
-								treap1.lookup(p1);
-						if (n1->getPriority() > subz)
-							treap1.update_priority(n1, subz);
-					}
-				}
-				else
-				{
-					if (work2[i] == set_to2)
-					{
-						p1.pxy = i;
-						p1.pz = z + 1;
-						Treap<posit, unsigned int>::Node* n1 =
-								treap1.lookup(p1);
-						if (n1->getPriority() > subz)
-							treap1.update_priority(n1, subz);
-					}
-					else if (work2[i] == set_to)
-					{
-						p1.pxy = i;
-						p1.pz = z + 1;
-						Treap<posit, unsigned int>::Node* n = nullptr;
-						treap1.insert(n, p1, 1, subz);
-						work2[i] = set_to2;
-					}
-				}
-			}
-		}
-	}
-
-	if (ix > 0)
-	{
-		for (unsigned short z = _startslice; z < _endslice; z++)
-		{
-			p1.pz = z;
-			work1 = _image_slices[z].return_work();
-			unsigned long i = 0;
-			for (unsigned short y = 0; y < _height; y++)
-			{
-				for (unsigned short x = 0; x + 1 < _width; x++)
-				{
-					if (work1[i] == set_to)
-					{
-						if ((work1[i + 1] != set_to) &&
-								(work1[i + 1] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, subx);
-							work1[i] = set_to2;
-						}
-					}
-					else if (work1[i] == set_to2)
-					{
-						if ((work1[i + 1] != set_to) &&
-								(work1[i + 1] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > subx)
-								treap1.update_priority(n1, subx);
-						}
-					}
-					else
-					{
-						if (work1[i + 1] == set_to2)
-						{
-							p1.pxy = i + 1;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > subx)
-								treap1.update_priority(n1, subx);
-						}
-						else if (work1[i + 1] == set_to)
-						{
-							p1.pxy = i + 1;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, subx);
-							work1[i + 1] = set_to2;
-						}
-					}
-					i++;
-				}
-				i++;
-			}
-		}
-	}
-
-	if (iy > 0)
-	{
-		for (unsigned short z = _startslice; z < _endslice; z++)
-		{
-			p1.pz = z;
-			work1 = _image_slices[z].return_work();
-			unsigned long i = 0;
-			for (unsigned short y = 0; y + 1 < _height; y++)
-			{
-				for (unsigned short x = 0; x < _width; x++)
-				{
-					if (work1[i] == set_to)
-					{
-						if ((work1[i + _width] != set_to) &&
-								(work1[i + _width] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, suby);
-							work1[i] = set_to2;
-						}
-					}
-					else if (work1[i] == set_to2)
-					{
-						if ((work1[i + _width] != set_to) &&
-								(work1[i + _width] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > suby)
-								treap1.update_priority(n1, suby);
-						}
-					}
-					else
-					{
-						if (work1[i + _width] == set_to2)
-						{
-							p1.pxy = i + _width;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > suby)
-								treap1.update_priority(n1, suby);
-						}
-						else if (work1[i + _width] == set_to)
-						{
-							p1.pxy = i + _width;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, suby);
-							work1[i + _width] = set_to2;
-						}
-					}
-					i++;
-				}
-			}
-		}
-	}
-
-	Treap<posit, unsigned int>::Node* n1;
-	posit p2;
-	unsigned int prior;
-	while ((n1 = treap1.get_top()) != nullptr)
-	{
-		p1 = n1->getKey();
-		prior = n1->getPriority();
-		work1 = _image_slices[p1.pz].return_work();
-		work1[p1.pxy] = setto;
-		if (p1.pxy % _width != 0)
-		{
-			if (work1[p1.pxy - 1] == set_to)
-			{
-				if (prior + 2 * subx <= totcount)
-				{
-					p2.pxy = p1.pxy - 1;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subx);
-					work1[p1.pxy - 1] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy - 1] == set_to2)
-			{
-				p2.pxy = p1.pxy - 1;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subx)
-					treap1.update_priority(n2, prior + subx);
-			}
-		}
-		if ((p1.pxy + 1) % _width != 0)
-		{
-			if (work1[p1.pxy + 1] == set_to)
-			{
-				if (prior + 2 * subx <= totcount)
-				{
-					p2.pxy = p1.pxy + 1;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subx);
-					work1[p1.pxy + 1] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy + 1] == set_to2)
-			{
-				p2.pxy = p1.pxy + 1;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subx)
-					treap1.update_priority(n2, prior + subx);
-			}
-		}
-		if (p1.pxy >= _width)
-		{
-			if (work1[p1.pxy - _width] == set_to)
-			{
-				if (prior + 2 * suby <= totcount)
-				{
-					p2.pxy = p1.pxy - _width;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + suby);
-					work1[p1.pxy - _width] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy - _width] == set_to2)
-			{
-				p2.pxy = p1.pxy - _width;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + suby)
-					treap1.update_priority(n2, prior + suby);
-			}
-		}
-		if (p1.pxy < _area - _width)
-		{
-			if (work1[p1.pxy + _width] == set_to)
-			{
-				if (prior + 2 * suby <= totcount)
-				{
-					p2.pxy = p1.pxy + _width;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + suby);
-					work1[p1.pxy + _width] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy + _width] == set_to2)
-			{
-				p2.pxy = p1.pxy + _width;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + suby)
-					treap1.update_priority(n2, prior + suby);
-			}
-		}
-		if (p1.pz > _startslice)
-		{
-			work2 = _image_slices[p1.pz - 1].return_work();
-			if (work2[p1.pxy] == set_to)
-			{
-				if (prior + 2 * subz <= totcount)
-				{
-					p2.pxy = p1.pxy;
-					p2.pz = p1.pz - 1;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subz);
-					work2[p1.pxy] = set_to2;
-				}
-			}
-			else if (work2[p1.pxy] == set_to2)
-			{
-				p2.pxy = p1.pxy;
-				p2.pz = p1.pz - 1;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subz)
-					treap1.update_priority(n2, prior + subz);
-			}
-		}
-		if (p1.pz + 1 < _endslice)
-		{
-			work2 = _image_slices[p1.pz + 1].return_work();
-			if (work2[p1.pxy] == set_to)
-			{
-				if (prior + 2 * subz <= totcount)
-				{
-					p2.pxy = p1.pxy;
-					p2.pz = p1.pz + 1;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subz);
-					work2[p1.pxy] = set_to2;
-				}
-			}
-			else if (work2[p1.pxy] == set_to2)
-			{
-				p2.pxy = p1.pxy;
-				p2.pz = p1.pz + 1;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subz)
-					treap1.update_priority(n2, prior + subz);
-			}
-		}
-
-		delete treap1.remove(n1);
-	}
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_work();
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (work[i1] == set_to)
-				work[i1] = 0;
-	}
-
-	return;
-}
-
-void SlicesHandler::add_skintissue3D_outside2(int ix, int iy, int iz, tissues_size_t f)
-{
-	tissues_size_t set_to = TISSUES_SIZE_MAX;
-	tissues_size_t set_to2 = TISSUES_SIZE_MAX - 1;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exteriortissue(_active_tissuelayer, set_to);
-	}
-
-	std::vector<posit> s;
-	posit p1;
-
-	p1.pz = _activeslice;
-
-	tissues_size_t* work1;
-	tissues_size_t* work2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		work2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		work2 = _image_slices[z - 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (work1[i] == 0 && work2[i] == set_to)
-			{
-				work1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	tissues_size_t* work;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
-
-		work = _image_slices[i.pz].return_tissues(_active_tissuelayer);
-		if (i.pxy % _width != 0 && work[i.pxy - 1] == 0)
-		{
-			work[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && work[i.pxy + 1] == 0)
-		{
-			work[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && work[i.pxy - _width] == 0)
-		{
-			work[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy < _area - _width && work[i.pxy + _width] == 0)
-		{
-			work[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			work = _image_slices[i.pz - 1].return_tissues(_active_tissuelayer);
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			work = _image_slices[i.pz + 1].return_tissues(_active_tissuelayer);
-			if (work[i.pxy] == 0)
-			{
-				work[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
-
-	unsigned int totcount = (ix + 1) * (iy + 1) * (iz + 1);
-	unsigned int subx = (iy + 1) * (iz + 1);
-	unsigned int suby = (ix + 1) * (iz + 1);
-	unsigned int subz = (iy + 1) * (ix + 1);
-
-	Treap<posit, unsigned int> treap1;
-	if (iz > 0)
-	{
-		for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-		{
-			work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-			work2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-			for (unsigned long i = 0; i < _area; i++)
-			{
-				if (work1[i] == set_to)
-				{
-					if ((work2[i] != set_to) && (work2[i] != set_to2))
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						Treap<posit, unsigned int>::Node* n = nullptr;
-						treap1.insert(n, p1, 1, subz);
-						work1[i] = set_to2;
-					}
-				}
-				else if (work1[i] == set_to2)
-				{
-					if ((work2[i] != set_to) && (work2[i] != set_to2))
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						Treap<posit, unsigned int>::Node* n1 =
-								treap1.lookup(p1);
-						if (n1->getPriority() > subz)
-							treap1.update_priority(n1, subz);
-					}
-				}
-				else
-				{
-					if (work2[i] == set_to2)
-					{
-						p1.pxy = i;
-						p1.pz = z + 1;
-						Treap<posit, unsigned int>::Node* n1 =
-								treap1.lookup(p1);
-						if (n1->getPriority() > subz)
-							treap1.update_priority(n1, subz);
-					}
-					else if (work2[i] == set_to)
-					{
-						p1.pxy = i;
-						p1.pz = z + 1;
-						Treap<posit, unsigned int>::Node* n = nullptr;
-						treap1.insert(n, p1, 1, subz);
-						work2[i] = set_to2;
-					}
-				}
-			}
-		}
-	}
-
-	if (ix > 0)
-	{
-		for (unsigned short z = _startslice; z < _endslice; z++)
-		{
-			p1.pz = z;
-			work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-			unsigned long i = 0;
-			for (unsigned short y = 0; y < _height; y++)
-			{
-				for (unsigned short x = 0; x + 1 < _width; x++)
-				{
-					if (work1[i] == set_to)
-					{
-						if ((work1[i + 1] != set_to) &&
-								(work1[i + 1] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, subx);
-							work1[i] = set_to2;
-						}
-					}
-					else if (work1[i] == set_to2)
-					{
-						if ((work1[i + 1] != set_to) &&
-								(work1[i + 1] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > subx)
-								treap1.update_priority(n1, subx);
-						}
-					}
-					else
-					{
-						if (work1[i + 1] == set_to2)
-						{
-							p1.pxy = i + 1;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > subx)
-								treap1.update_priority(n1, subx);
-						}
-						else if (work1[i + 1] == set_to)
-						{
-							p1.pxy = i + 1;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, subx);
-							work1[i + 1] = set_to2;
-						}
-					}
-					i++;
-				}
-				i++;
-			}
-		}
-	}
-
-	if (iy > 0)
-	{
-		for (unsigned short z = _startslice; z < _endslice; z++)
-		{
-			p1.pz = z;
-			work1 = _image_slices[z].return_tissues(_active_tissuelayer);
-			unsigned long i = 0;
-			for (unsigned short y = 0; y + 1 < _height; y++)
-			{
-				for (unsigned short x = 0; x < _width; x++)
-				{
-					if (work1[i] == set_to)
-					{
-						if ((work1[i + _width] != set_to) &&
-								(work1[i + _width] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, suby);
-							work1[i] = set_to2;
-						}
-					}
-					else if (work1[i] == set_to2)
-					{
-						if ((work1[i + _width] != set_to) &&
-								(work1[i + _width] != set_to2))
-						{
-							p1.pxy = i;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > suby)
-								treap1.update_priority(n1, suby);
-						}
-					}
-					else
-					{
-						if (work1[i + _width] == set_to2)
-						{
-							p1.pxy = i + _width;
-							Treap<posit, unsigned int>::Node* n1 =
-									treap1.lookup(p1);
-							if (n1->getPriority() > suby)
-								treap1.update_priority(n1, suby);
-						}
-						else if (work1[i + _width] == set_to)
-						{
-							p1.pxy = i + _width;
-							Treap<posit, unsigned int>::Node* n = nullptr;
-							treap1.insert(n, p1, 1, suby);
-							work1[i + _width] = set_to2;
-						}
-					}
-					i++;
-				}
-			}
-		}
-	}
-
-	Treap<posit, unsigned int>::Node* n1;
-	posit p2;
-	unsigned int prior;
-	while ((n1 = treap1.get_top()) != nullptr)
-	{
-		p1 = n1->getKey();
-		prior = n1->getPriority();
-		work1 = _image_slices[p1.pz].return_tissues(_active_tissuelayer);
-		work1[p1.pxy] = f;
-		if (p1.pxy % _width != 0)
-		{
-			if (work1[p1.pxy - 1] == set_to)
-			{
-				if (prior + subx <= totcount)
-				{
-					p2.pxy = p1.pxy - 1;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subx);
-					work1[p1.pxy - 1] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy - 1] == set_to2)
-			{
-				p2.pxy = p1.pxy - 1;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subx)
-					treap1.update_priority(n2, prior + subx);
-			}
-		}
-		if ((p1.pxy + 1) % _width != 0)
-		{
-			if (work1[p1.pxy + 1] == set_to)
-			{
-				if (prior + subx <= totcount)
-				{
-					p2.pxy = p1.pxy + 1;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subx);
-					work1[p1.pxy + 1] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy + 1] == set_to2)
-			{
-				p2.pxy = p1.pxy + 1;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subx)
-					treap1.update_priority(n2, prior + subx);
-			}
-		}
-		if (p1.pxy >= _width)
-		{
-			if (work1[p1.pxy - _width] == set_to)
-			{
-				if (prior + suby <= totcount)
-				{
-					p2.pxy = p1.pxy - _width;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + suby);
-					work1[p1.pxy - _width] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy - _width] == set_to2)
-			{
-				p2.pxy = p1.pxy - _width;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + suby)
-					treap1.update_priority(n2, prior + suby);
-			}
-		}
-		if (p1.pxy < _area - _width)
-		{
-			if (work1[p1.pxy + _width] == set_to)
-			{
-				if (prior + suby <= totcount)
-				{
-					p2.pxy = p1.pxy + _width;
-					p2.pz = p1.pz;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + suby);
-					work1[p1.pxy + _width] = set_to2;
-				}
-			}
-			else if (work1[p1.pxy + _width] == set_to2)
-			{
-				p2.pxy = p1.pxy + _width;
-				p2.pz = p1.pz;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + suby)
-					treap1.update_priority(n2, prior + suby);
-			}
-		}
-		if (p1.pz > _startslice)
-		{
-			work2 = _image_slices[p1.pz - 1].return_tissues(_active_tissuelayer);
-			if (work2[p1.pxy] == set_to)
-			{
-				if (prior + subz <= totcount)
-				{
-					p2.pxy = p1.pxy;
-					p2.pz = p1.pz - 1;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subz);
-					work2[p1.pxy] = set_to2;
-				}
-			}
-			else if (work2[p1.pxy] == set_to2)
-			{
-				p2.pxy = p1.pxy;
-				p2.pz = p1.pz - 1;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subz)
-					treap1.update_priority(n2, prior + subz);
-			}
-		}
-		if (p1.pz + 1 < _endslice)
-		{
-			work2 = _image_slices[p1.pz + 1].return_tissues(_active_tissuelayer);
-			if (work2[p1.pxy] == set_to)
-			{
-				if (prior + subz <= totcount)
-				{
-					p2.pxy = p1.pxy;
-					p2.pz = p1.pz + 1;
-					Treap<posit, unsigned int>::Node* n = nullptr;
-					treap1.insert(n, p2, 1, prior + subz);
-					work2[p1.pxy] = set_to2;
-				}
-			}
-			else if (work2[p1.pxy] == set_to2)
-			{
-				p2.pxy = p1.pxy;
-				p2.pz = p1.pz + 1;
-				Treap<posit, unsigned int>::Node* n2 = treap1.lookup(p2);
-				if (n2->getPriority() > prior + subz)
-					treap1.update_priority(n2, prior + subz);
-			}
-		}
-
-		delete treap1.remove(n1);
-	}
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		work = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (work[i1] == set_to)
-				work[i1] = 0;
-	}
-}
-
-float SlicesHandler::add_skin3D(int i1)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-
-		for (unsigned short i = _startslice; i < _endslice; i++)
-		{
-			float* bits = _image_slices[i].return_work();
-			for (unsigned pos = 0; pos < _area; pos++)
-			{
-				if (bits[pos] != p.high)
-					setto = std::max(setto, bits[pos]);
-			}
-		}
-
-		setto = (setto + p.high) / 2;
-	}
-
-	add_skin3D(i1, i1, i1, setto);
-	return setto;
-}
-
-float SlicesHandler::add_skin3D(int ix, int iy, int iz)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-
-		for (unsigned short i = _startslice; i < _endslice; i++)
-		{
-			float* bits = _image_slices[i].return_work();
-			for (unsigned pos = 0; pos < _area; pos++)
-			{
-				if (bits[pos] != p.high)
-					setto = std::max(setto, bits[pos]);
-			}
-		}
-
-		setto = (setto + p.high) / 2;
-	}
-
-	// ix,iy,iz are in pixels
-	add_skin3D(ix, iy, iz, setto);
-	return setto;
-}
-
-float SlicesHandler::add_skin3D_outside(int i1)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-
-		for (unsigned short i = _startslice; i < _endslice; i++)
-		{
-			float* bits = _image_slices[i].return_work();
-			for (unsigned pos = 0; pos < _area; pos++)
-			{
-				if (bits[pos] != p.high)
-					setto = std::max(setto, bits[pos]);
-			}
-		}
-
-		setto = (setto + p.high) / 2;
-	}
-
-	add_skin3D_outside(i1, i1, i1, setto);
-	return setto;
-}
-
-float SlicesHandler::add_skin3D_outside2(int ix, int iy, int iz)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-
-		for (unsigned short i = _startslice; i < _endslice; i++)
-		{
-			float* bits = _image_slices[i].return_work();
-			for (unsigned pos = 0; pos < _area; pos++)
-			{
-				if (bits[pos] != p.high)
-					setto = std::max(setto, bits[pos]);
-			}
-		}
-
-		setto = (setto + p.high) / 2;
-	}
-
-	add_skin3D_outside2(ix, iy, iz, setto);
-	return setto;
-}
-
-void SlicesHandler::add_skintissue3D(int ix, int iy, int iz, tissues_size_t f)
-{
-	tissues_size_t set_to = TISSUES_SIZE_MAX;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exteriortissue(_active_tissuelayer, set_to);
-	}
-
-	//Point p;
-	//unsigned position;
-	std::vector<posit> s;
-	posit p1;
-
-	//	p1.pxy=position;
-	p1.pz = _activeslice;
-
-	tissues_size_t* tissue1;
-	tissues_size_t* tissue2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (tissue1[i] == 0 && tissue2[i] == set_to)
-			{
-				tissue1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z - 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (tissue1[i] == 0 && tissue2[i] == set_to)
-			{
-				tissue1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	tissues_size_t* tissue;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
-
-		tissue = _image_slices[i.pz].return_tissues(_active_tissuelayer);
-		if (i.pxy % _width != 0 && tissue[i.pxy - 1] == 0)
-		{
-			tissue[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && tissue[i.pxy + 1] == 0)
-		{
-			tissue[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && tissue[i.pxy - _width] == 0)
-		{
-			tissue[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy < _area - _width && tissue[i.pxy + _width] == 0)
-		{
-			tissue[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			tissue = _image_slices[i.pz - 1].return_tissues(_active_tissuelayer);
-			if (tissue[i.pxy] == 0)
-			{
-				tissue[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			tissue = _image_slices[i.pz + 1].return_tissues(_active_tissuelayer);
-			if (tissue[i.pxy] == 0)
-			{
-				tissue[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
-
-	unsigned short x, y;
-	unsigned long pos;
-	unsigned short i1;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-
-		for (y = 0; y < _height; y++)
-		{
-			pos = y * _width;
-			i1 = 0;
-			while (pos < (unsigned long)(y + 1) * _width)
-			{
-				if (tissue[pos] == set_to)
-					i1 = ix;
-				else
-				{
-					if (i1 > 0 && (!TissueInfos::GetTissueLocked(tissue[pos])))
-					{
-						tissue[pos] = f;
-						i1--;
-					}
-				}
-				pos++;
-			}
-		}
-
-		for (y = 0; y < _height; y++)
-		{
-			pos = (y + 1) * _width - 1;
-			i1 = 0;
-			while (pos > (unsigned long)y * _width)
-			{
-				if (tissue[pos] == set_to)
-					i1 = ix;
-				else
-				{
-					if (i1 > 0)
-					{
-						if (!TissueInfos::GetTissueLocked(tissue[pos]))
-							tissue[pos] = f;
-						i1--;
-					}
-				}
-				pos--;
-			}
-			if (tissue[pos] == set_to)
-				i1 = ix;
-			else
-			{
-				if (i1 > 0)
-				{
-					if (!TissueInfos::GetTissueLocked(tissue[pos]))
-						tissue[pos] = f;
-					i1--;
-				}
-			}
-		}
-
-		for (x = 0; x < _width; x++)
-		{
-			pos = x;
-			i1 = 0;
-			while (pos < _area)
-			{
-				if (tissue[pos] == set_to)
-					i1 = iy;
-				else
-				{
-					if (i1 > 0)
-					{
-						if (!TissueInfos::GetTissueLocked(tissue[pos]))
-							tissue[pos] = f;
-						i1--;
-					}
-				}
-				pos += _width;
-			}
-		}
-
-		for (x = 0; x < _width; x++)
-		{
-			pos = _area + x - _width;
-			i1 = 0;
-			while (pos > _width)
-			{
-				if (tissue[pos] == set_to)
-					i1 = iy;
-				else
-				{
-					if (i1 > 0)
-					{
-						if (!TissueInfos::GetTissueLocked(tissue[pos]))
-							tissue[pos] = f;
-						i1--;
-					}
-				}
-				pos -= _width;
-			}
-			if (tissue[pos] == set_to)
-				i1 = iy;
-			else
-			{
-				if (i1 > 0)
-				{
-					if (!TissueInfos::GetTissueLocked(tissue[pos]))
-						tissue[pos] = f;
-					i1--;
-				}
-			}
-		}
-	}
-
-	unsigned short* counter =
-			(unsigned short*)malloc(sizeof(unsigned short) * _area);
-	for (unsigned i1 = 0; i1 < _area; i1++)
-		counter[i1] = 0;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (pos = 0; pos < _area; pos++)
-		{
-			if (tissue[pos] == set_to)
-				counter[pos] = iz;
-			else
-			{
-				if (counter[pos] > 0)
-				{
-					if (!TissueInfos::GetTissueLocked(tissue[pos]))
-						tissue[pos] = f;
-					counter[pos]--;
-				}
-			}
-		}
-	}
-	for (unsigned i1 = 0; i1 < _area; i1++)
-		counter[i1] = 0;
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (pos = 0; pos < _area; pos++)
-		{
-			if (tissue[pos] == set_to)
-				counter[pos] = iz;
-			else
-			{
-				if (counter[pos] > 0)
-				{
-					if (!TissueInfos::GetTissueLocked(tissue[pos]))
-						tissue[pos] = f;
-					counter[pos]--;
-				}
-			}
-		}
-	}
-	tissue = _image_slices[_startslice].return_tissues(_active_tissuelayer);
-	for (pos = 0; pos < _area; pos++)
-	{
-		if (tissue[pos] == set_to)
-			counter[pos] = iz;
-		else
-		{
-			if (counter[pos] > 0)
-			{
-				if (!TissueInfos::GetTissueLocked(tissue[pos]))
-					tissue[pos] = f;
-				counter[pos]--;
-			}
-		}
-	}
-	free(counter);
-
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (tissue[i1] == set_to)
-				tissue[i1] = 0;
-	}
-
-	return;
-}
-
-void SlicesHandler::add_skintissue3D_outside(int ixyz, tissues_size_t f)
-{
-	tissues_size_t set_to = TISSUES_SIZE_MAX;
-	for (unsigned short z = _startslice; z < _endslice; z++)
-	{
-		_image_slices[z].flood_exteriortissue(_active_tissuelayer, set_to);
-	}
-
-	//Point p;
-	//unsigned position;
-	std::vector<posit> s;
-	std::vector<posit> s1;
-	std::vector<posit>* s2 = &s1;
-	std::vector<posit>* s3 = &s;
-	posit p1;
-
-	//	p1.pxy=position;
-	p1.pz = _activeslice;
-
-	tissues_size_t* tissue1;
-	tissues_size_t* tissue2;
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (tissue1[i] == 0 && tissue2[i] == set_to)
-			{
-				tissue1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-	for (unsigned short z = _endslice - 1; z > _startslice; z--)
-	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z - 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
-		{
-			if (tissue1[i] == 0 && tissue2[i] == set_to)
-			{
-				tissue1[i] = set_to;
-				p1.pxy = i;
-				p1.pz = z;
-				s.push_back(p1);
-			}
-		}
-	}
-
-	posit i, j;
-	tissues_size_t* tissue;
-
-	while (!s.empty())
-	{
-		i = s.back();
-		s.pop_back();
-
-		tissue = _image_slices[i.pz].return_tissues(_active_tissuelayer);
-		if (i.pxy % _width != 0 && tissue[i.pxy - 1] == 0)
-		{
-			tissue[i.pxy - 1] = set_to;
-			j.pxy = i.pxy - 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if ((i.pxy + 1) % _width != 0 && tissue[i.pxy + 1] == 0)
-		{
-			tissue[i.pxy + 1] = set_to;
-			j.pxy = i.pxy + 1;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy >= _width && tissue[i.pxy - _width] == 0)
-		{
-			tissue[i.pxy - _width] = set_to;
-			j.pxy = i.pxy - _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pxy <= _area - _width && tissue[i.pxy + _width] == 0)
-		{
-			tissue[i.pxy + _width] = set_to;
-			j.pxy = i.pxy + _width;
-			j.pz = i.pz;
-			s.push_back(j);
-		}
-		if (i.pz > _startslice)
-		{
-			tissue = _image_slices[i.pz - 1].return_tissues(_active_tissuelayer);
-			if (tissue[i.pxy] == 0)
-			{
-				tissue[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz - 1;
-				s.push_back(j);
-			}
-		}
-		if (i.pz + 1 < _endslice)
-		{
-			tissue = _image_slices[i.pz + 1].return_tissues(_active_tissuelayer);
-			if (tissue[i.pxy] == 0)
-			{
-				tissue[i.pxy] = set_to;
-				j.pxy = i.pxy;
-				j.pz = i.pz + 1;
-				s.push_back(j);
-			}
-		}
-	}
+	add_skin3D(i1, i1, i1, setto);
+	return setto;
+}
 
-	for (unsigned short z = _startslice; z + 1 < _endslice; z++)
+float SlicesHandler::add_skin3D(int ix, int iy, int iz)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		tissue2 = _image_slices[z + 1].return_tissues(_active_tissuelayer);
-		for (unsigned long i = 0; i < _area; i++)
+		setto = p.low;
+
+		for (unsigned short i = _startslice; i < _endslice; i++)
 		{
-			if (tissue1[i] == set_to)
-			{
-				if (tissue2[i] != set_to)
-				{
-					p1.pxy = i;
-					p1.pz = z + 1;
-					(*s2).push_back(p1);
-				}
-			}
-			else
+			float* bits = _image_slices[i].return_work();
+			for (unsigned pos = 0; pos < _area; pos++)
 			{
-				if (tissue2[i] == set_to)
-				{
-					p1.pxy = i;
-					p1.pz = z;
-					(*s2).push_back(p1);
-				}
+				if (bits[pos] != p.high)
+					setto = std::max(setto, bits[pos]);
 			}
 		}
+
+		setto = (setto + p.high) / 2;
 	}
 
-	for (unsigned short z = _startslice; z < _endslice; z++)
+	// ix,iy,iz are in pixels
+	add_skin3D(ix, iy, iz, setto);
+	return setto;
+}
+
+float SlicesHandler::add_skin3D_outside(int i1)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		tissue1 = _image_slices[z].return_tissues(_active_tissuelayer);
-		unsigned long i = 0;
-		for (unsigned short y = 0; y < _height; y++)
-		{
-			for (unsigned short x = 0; x + 1 < _width; x++)
-			{
-				if (tissue1[i] == set_to)
-				{
-					if (tissue1[i + 1] != set_to)
-					{
-						p1.pxy = i + 1;
-						p1.pz = z;
-						(*s2).push_back(p1);
-					}
-				}
-				else
-				{
-					if (tissue1[i + 1] == set_to)
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						(*s2).push_back(p1);
-					}
-				}
-				i++;
-			}
-			i++;
-		}
-		i = 0;
-		for (unsigned short y = 0; y + 1 < _height; y++)
+		setto = p.low;
+
+		for (unsigned short i = _startslice; i < _endslice; i++)
 		{
-			for (unsigned short x = 0; x < _width; x++)
+			float* bits = _image_slices[i].return_work();
+			for (unsigned pos = 0; pos < _area; pos++)
 			{
-				if (tissue1[i] == set_to)
-				{
-					if (tissue1[i + _width] != set_to)
-					{
-						p1.pxy = i + _width;
-						p1.pz = z;
-						(*s2).push_back(p1);
-					}
-				}
-				else
-				{
-					if (tissue1[i + _width] == set_to)
-					{
-						p1.pxy = i;
-						p1.pz = z;
-						(*s2).push_back(p1);
-					}
-				}
-				i++;
+				if (bits[pos] != p.high)
+					setto = std::max(setto, bits[pos]);
 			}
 		}
+
+		setto = (setto + p.high) / 2;
 	}
 
-	for (int i4 = 0; i4 < ixyz; i4++)
+	add_skin3D_outside(i1, i1, i1, setto);
+	return setto;
+}
+
+float SlicesHandler::add_skin3D_outside2(int ix, int iy, int iz)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		while (!(*s2).empty())
-		{
-			i = (*s2).back();
-			(*s2).pop_back();
+		setto = p.low;
 
-			tissue = _image_slices[i.pz].return_tissues(_active_tissuelayer);
-			if (i.pxy % _width != 0 && tissue[i.pxy - 1] == set_to)
-			{
-				tissue[i.pxy - 1] = f;
-				j.pxy = i.pxy - 1;
-				j.pz = i.pz;
-				(*s3).push_back(j);
-			}
-			if ((i.pxy + 1) % _width != 0 && tissue[i.pxy + 1] == set_to)
-			{
-				tissue[i.pxy + 1] = f;
-				j.pxy = i.pxy + 1;
-				j.pz = i.pz;
-				(*s3).push_back(j);
-			}
-			if (i.pxy >= _width && tissue[i.pxy - _width] == set_to)
-			{
-				tissue[i.pxy - _width] = f;
-				j.pxy = i.pxy - _width;
-				j.pz = i.pz;
-				(*s3).push_back(j);
-			}
-			if (i.pxy < _area - _width && tissue[i.pxy + _width] == set_to)
-			{
-				tissue[i.pxy + _width] = f;
-				j.pxy = i.pxy + _width;
-				j.pz = i.pz;
-				(*s3).push_back(j);
-			}
-			if (i.pz > _startslice)
-			{
-				tissue =
-						_image_slices[i.pz - 1].return_tissues(_active_tissuelayer);
-				if (tissue[i.pxy] == set_to)
-				{
-					tissue[i.pxy] = f;
-					j.pxy = i.pxy;
-					j.pz = i.pz - 1;
-					(*s3).push_back(j);
-				}
-			}
-			if (i.pz + 1 < _endslice)
+		for (unsigned short i = _startslice; i < _endslice; i++)
+		{
+			float* bits = _image_slices[i].return_work();
+			for (unsigned pos = 0; pos < _area; pos++)
 			{
-				tissue =
-						_image_slices[i.pz + 1].return_tissues(_active_tissuelayer);
-				if (tissue[i.pxy] == set_to)
-				{
-					tissue[i.pxy] = f;
-					j.pxy = i.pxy;
-					j.pz = i.pz + 1;
-					(*s3).push_back(j);
-				}
+				if (bits[pos] != p.high)
+					setto = std::max(setto, bits[pos]);
 			}
 		}
-		std::vector<posit>* sdummy = s2;
-		s2 = s3;
-		s3 = sdummy;
-	}
 
-	while (!(*s2).empty())
-	{
-		(*s2).pop_back();
+		setto = (setto + p.high) / 2;
 	}
 
+	add_skin3D_outside2(ix, iy, iz, setto);
+	return setto;
+}
+
+void SlicesHandler::add_skintissue3D(int ix, int iy, int iz, tissues_size_t f)
+{
+	// the skin are the voxels within the ellipsoid of radii ix,iy,iz around an exterior background voxel
+	tissues_size_t const set_to = TISSUES_SIZE_MAX;
 	for (unsigned short z = _startslice; z < _endslice; z++)
 	{
-		tissue = _image_slices[z].return_tissues(_active_tissuelayer);
-		for (unsigned i1 = 0; i1 < _area; i1++)
-			if (tissue[i1] == set_to)
-				tissue[i1] = 0;
+		_image_slices[z].flood_exteriortissue(_active_tissuelayer, set_to);
 	}
 
-	return;
+	auto tissues = tissue_slices(_active_tissuelayer);
+	std::vector<tissues_size_t*> slices(tissues.begin() + _startslice, tissues.begin() + _endslice);
+	flood_exterior_3d(slices, _width, _area, set_to);
+	add_skin_3d(slices, _width, _height, ix, iy, iz, [set_to](tissues_size_t v) { return v == set_to; }, [f](tissues_size_t& v) {
+		if (!TissueInfos::GetTissueLocked(v))
+			v = f;
+	});
+	replace_value(slices, _area, set_to, tissues_size_t(0));
+}
+
+void SlicesHandler::add_skintissue3D_outside(int ixyz, tissues_size_t f)
+{
+	add_skintissue3D_outside2(ixyz, ixyz, ixyz, f);
 }
 
 void SlicesHandler::fill_skin_3d(int thicknessX, int thicknessY, int thicknessZ,
 		tissues_size_t backgroundID,
 		tissues_size_t skinID)
 {
-	int numTasks = _nrslices;
+	int numTasks = 3;
 	QProgressDialog progress("Fill Skin in progress...", "Cancel", 0, numTasks);
 	progress.show();
 	progress.setWindowModality(Qt::WindowModal);
 	progress.setModal(true);
 	progress.setValue(0);
 
-	int skinThick = thicknessX;
-
-	std::vector<int> dims;
-	dims.push_back(_width);
-	dims.push_back(_height);
-	dims.push_back(_nrslices);
-
-	double max_d = skinThick == 1 ? 1.75 * skinThick : 1.2 * skinThick;
-
-	//Create the relative neighborhood
-	std::vector<std::vector<int>> offsetsSlices;
-	for (int z = -skinThick; z <= skinThick; z++)
-	{
-		std::vector<int> offsets;
-		for (int y = -skinThick; y <= skinThick; y++)
-		{
-			for (int x = -skinThick; x <= skinThick; x++)
-			{
-				if (sqrt(x * x + y * y + z * z) < max_d)
-				{
-					int shift = x + y * dims[0];
-					if (shift != 0)
-					{
-						offsets.push_back(shift);
-					}
-				}
-			}
-		}
-		offsetsSlices.push_back(offsets);
-	}
-
-	struct changesToMakeStruct
-	{
-		size_t sliceNumber;
-		int positionConvert;
-
-		bool operator==(const changesToMakeStruct& m) const
-		{
-			return ((m.sliceNumber == sliceNumber) &&
-							(m.positionConvert == positionConvert));
-		}
-	};
-
 	bool thereIsBG = false;
 	bool thereIsSkin = false;
-	//unsigned long bgPixels=0;
-	//unsigned long skinPixels=0;
-	for (int i = 0; i < dims[2]; i++)
+	for (unsigned short i = 0; i < _nrslices; i++)
 	{
 		tissues_size_t* tissuesMain = _image_slices[i].return_tissues(0);
-		for (int j = 0; j < _area && (!thereIsBG || !thereIsSkin); j++)
+		for (unsigned j = 0; j < _area && (!thereIsBG || !thereIsSkin); j++)
 		{
 			tissues_size_t value = tissuesMain[j];
 			if (value == backgroundID)
-				//bgPixels++;
 				thereIsBG = true;
 			else if (value == skinID)
-				//skinPixels++;
 				thereIsSkin = true;
 		}
 		if (thereIsSkin && thereIsBG)
 			break;
 	}
 
-	if (!thereIsBG || !thereIsSkin)
+	if (!thereIsBG || !thereIsSkin || thicknessX <= 0)
 	{
 		progress.setValue(numTasks);
 		return;
 	}
 
-	std::vector<tissues_size_t*> tissuesVector;
-	for (int i = 0; i < _image_slices.size(); i++)
-		tissuesVector.push_back(_image_slices[i].return_tissues(0));
+	int skinThick = thicknessX;
+	double max_d = skinThick == 1 ? 1.75 * skinThick : 1.2 * skinThick;
 
-	for (int i = 0; i < dims[2]; i++)
+	// distance to the skin, computed in place in the work slices, scaled such that the thickness is 1 along each axis
+	auto tissues = tissue_slices(0);
+	auto work = target_slices();
+	int const iN = _nrslices;
+#pragma omp parallel for
+	for (int k = 0; k < iN; k++)
 	{
-		float* bmp1 = _image_slices[i].return_bmp();
-
-		tissues_size_t* tissue1 = _image_slices[i].return_tissues(0);
-		_image_slices[i].pushstack_bmp();
-
-		for (unsigned int j = 0; j < _area; j++)
+		for (unsigned i = 0; i < _area; i++)
 		{
-			bmp1[j] = (float)tissue1[j];
+			work[k][i] = (tissues[k][i] == skinID) ? 0.f : DistanceTransform::kInfinity;
 		}
-
-		_image_slices[i].dead_reckoning((float)0);
-		bmp1 = _image_slices[i].return_work();
-	}
-
-#ifdef NO_OPENMP_SUPPORT
-	const int numberThreads = 1;
-#else
-	const int numberThreads = omp_get_max_threads();
-#endif
-	int sliceCounter = 0;
-	std::vector<std::vector<changesToMakeStruct>> partialChangesThreads;
-
-	for (int i = 0; i < numberThreads; i++)
-	{
-		changesToMakeStruct sample;
-		sample.sliceNumber = -1;
-		sample.positionConvert = -1;
-		std::vector<changesToMakeStruct> samplePerThread;
-		samplePerThread.push_back(sample);
-		partialChangesThreads.push_back(samplePerThread);
 	}
+	progress.setValue(1);
 
-	//if(skinPixels<bgPixels/neighbors)
-	{
-#pragma omp parallel for
-		for (int k = skinThick; k < dims[2] - skinThick; k++)
-		{
-			std::vector<changesToMakeStruct> partialChanges;
-
-			Point p;
-			for (int j = skinThick; j < dims[1] - skinThick; j++)
-			{
-				for (int i = skinThick; i < dims[0] - skinThick; i++)
-				{
-					int pos = i + j * dims[0];
-					if (tissuesVector[k][pos] == skinID)
-					{
-						for (int z = 0; z < offsetsSlices.size(); z++)
-						{
-							size_t neighborSlice = z - ((offsetsSlices.size() - 1) / 2);
-
-							//iterate through neighbors of pixel
-							//if any of these are not
-							for (int l = 0; l < offsetsSlices[z].size(); l++)
-							{
-								int idx = pos + offsetsSlices[z][l];
-								assert(idx >= 0 && idx < _area);
-								p.px = i;
-								p.py = j;
-								tissues_size_t value = tissuesVector[k + neighborSlice][idx];
-								if (value == backgroundID)
-								{
-									for (int y = 0; y < offsetsSlices.size(); y++)
-									{
-										size_t neighborSlice2 = y - ((offsetsSlices.size() - 1) / 2);
-
-										//iterate through neighbors of pixel
-										//if any of these are not
-										for (int m = 0; m < offsetsSlices[y].size(); m++)
-										{
-											int idx2 = idx + offsetsSlices[y][m];
-											assert(idx2 >= 0 && idx2 < _area);
-											if (k + neighborSlice + neighborSlice2 < dims[2]) // && k + neighborSlice + neighborSlice2 >= 0 (always true)
-											{
-												tissues_size_t value2 = tissuesVector[k + neighborSlice + neighborSlice2][idx2];
-												if (value2 != backgroundID && value2 != skinID)
-												{
-													changesToMakeStruct changes;
-													changes.sliceNumber = k + neighborSlice;
-													changes.positionConvert = idx;
-													if (std::find(partialChanges.begin(), partialChanges.end(), changes) == partialChanges.end())
-														partialChanges.push_back(changes);
-													//image_slices[k+neighborSlice].return_work()[idx]=255.0f;
-													break;
-												}
-											}
-										}
-									}
-								}
-							}
-						}
-					}
-				}
-			}
-
-#ifdef NO_OPENMP_SUPPORT
-			int thread_id = 0;
-#else
-			int thread_id = omp_get_thread_num();
-#endif
-
-			for (int i = 0; i < partialChanges.size(); i++)
-			{
-				partialChangesThreads[thread_id].push_back(partialChanges[i]);
-			}
-
-			if (0 == thread_id)
-			{
-				sliceCounter++;
-				progress.setValue(numberThreads * sliceCounter);
-			}
-		}
-	}
+	// one step along an axis without thickness is beyond the neighborhood
+	auto spacing = [](int thickness) { return thickness > 0 ? 1.f / thickness : 2.f; };
+	DistanceTransform::SquaredDistance3D(work, _width, _height, spacing(thicknessX), spacing(thicknessY), spacing(thicknessZ));
+	progress.setValue(2);
 
-	for (int i = 0; i < partialChangesThreads.size(); i++)
-	{
-		for (int j = 0; j < partialChangesThreads[i].size(); j++)
+	// preview the background voxels close to the skin and to another tissue,
+	// the distance to the other tissues is computed slab by slab
+	float const max_d2 = float(max_d * max_d) / (skinThick * skinThick);
+	DistanceTransform::SquaredDistance3DSlabs(_nrslices, _width, _height, spacing(thicknessX), spacing(thicknessY), spacing(thicknessZ), max_d2, [&](unsigned k, unsigned i) { return tissues[k][i] != backgroundID && tissues[k][i] != skinID; }, [&](unsigned k, const float* dist_tissue) {
+		for (unsigned i = 0; i < _area; i++)
 		{
-			if (partialChangesThreads[i][j].sliceNumber != -1)
-			{
-				size_t slice = partialChangesThreads[i][j].sliceNumber;
-				int pos = partialChangesThreads[i][j].positionConvert;
-				_image_slices[slice].return_work()[pos] = 255.0f;
-			}
+			work[k][i] = (tissues[k][i] == backgroundID && work[k][i] < max_d2 && dist_tissue[i] < max_d2) ? 255.0f : 0.0f;
 		}
-	}
-	for (int i = dims[2] - 1; i >= 0; i--)
+	});
+	for (unsigned short k = 0; k < _nrslices; k++)
 	{
-		float* bmp1 = _image_slices[i].return_bmp();
-
-		for (unsigned k = 0; k < _area; k++)
-		{
-			if (bmp1[k] < 0)
-				bmp1[k] = 0;
-			else
-				bmp1[k] = 255.0f;
-		}
-
-		_image_slices[i].set_mode(2, false);
-		_image_slices[i].popstack_bmp();
+		_image_slices[k].set_mode(2, false);
 	}
 
 	progress.setValue(numTasks);
@@ -11282,14 +9968,24 @@ void SlicesHandler::SetNumberOfUndoSteps(unsigned n)
 	this->_undoQueue.set_nrundo(n);
 }
 
-unsigned SlicesHandler::GetNumberOfUndoArrays()
+unsigned SlicesHandler::GetUndoMemoryBudget()
+{
+	return static_cast<unsigned>(this->_undoQueue.return_undobytesmax() >> 20);
+}
+
+void SlicesHandler::SetUndoMemoryBudget(unsigned megabytes)
 {
-	return this->_undoQueue.return_nrundoarraysmax();
+	this->_undoQueue.set_undobytesmax(size_t(megabytes) << 20);
 }
 
-void SlicesHandler::SetNumberOfUndoArrays(unsigned n)
+unsigned SlicesHandler::GetUndoDiskBudget()
 {
-	this->_undoQueue.set_nrundoarraysmax(n);
+	return static_cast<unsigned>(this->_undoQueue.return_diskbytesmax() >> 30);
+}
+
+void SlicesHandler::SetUndoDiskBudget(unsigned gigabytes)
+{
+	this->_undoQueue.set_diskbytesmax(size_t(gigabytes) << 30);
 }
 
 std::vector<iseg::tissues_size_t> SlicesHandler::tissue_selection() const
@@ -11319,42 +10015,35 @@ void SlicesHandler::get_color(size_t idx, unsigned char& r, unsigned char& g, un
 
 bool SlicesHandler::compute_target_connectivity(ProgressInfo* progress)
 {
-	using input_type = SlicesHandlerITKInterface::image_ref_type;
-	using image_type = itk::Image<unsigned, 3>;
+	auto all_slices = target_slices();
+	std::vector<const float*> slices(all_slices.begin() + _startslice, all_slices.begin() + _endslice);
 
-	SlicesHandlerITKInterface wrapper(this);
-	auto all_slices = wrapper.GetTarget(true);
-
-	auto observer = ItkProgressObserver::New();
+	// the components of non-zero pixels, whatever their value
+	ComponentLabeling labeling(slices, _width, _height, ComponentLabeling::kVertices, [](float v) { return v != 0; });
+	if (progress && progress->wasCanceled())
+		return false;
 
-	auto filter = itk::ConnectedComponentImageFilter<input_type, image_type>::New();
-	filter->SetInput(all_slices);
-	filter->SetFullyConnected(true);
-	if (progress)
+	// the background stays 0, the other components are numbered from 1
+	std::vector<float> label_map(labeling.number_of_components(), 0.f);
+	float next = 1.f;
+	for (unsigned label = 0; label < labeling.number_of_components(); label++)
 	{
-		observer->SetProgressInfo(progress);
-		filter->AddObserver(itk::ProgressEvent(), observer);
+		auto const& c = labeling.component(label);
+		if (slices[c.slice][c.offset] != 0)
+			label_map[label] = next++;
 	}
-	try
-	{
-		filter->Update();
-
-		if (!progress || (progress && !progress->wasCanceled()))
-		{
-			// copy result back
-			iseg::Paste<image_type, input_type>(filter->GetOutput(), all_slices);
 
-			// auto-scale target rendering
-			set_target_fixed_range(false);
-
-			return true;
-		}
-	}
-	catch (itk::ExceptionObject& e)
+	int const iN = static_cast<int>(slices.size());
+#pragma omp parallel for
+	for (int i = 0; i < iN; i++)
 	{
-		ISEG_ERROR("Exception occurred: " << e.what());
+		labeling.write_slice(i, all_slices[_startslice + i], [&label_map](unsigned label) { return label_map[label]; });
 	}
-	return false;
+
+	// auto-scale target rendering
+	set_target_fixed_range(false);
+
+	return true;
 }
 
 bool SlicesHandler::compute_split_tissues(tissues_size_t tissue, ProgressInfo* progress)
@@ -12,11 +12,14 @@
 #include "Data/SlicesHandlerInterface.h"
 #include "Data/Transform.h"
 
+#include "Core/OrthoSliceCache.h"
 #include "Core/Outline.h" // BL TODO get rid of this
 #include "Core/RGB.h"
 #include "Core/UndoElem.h"
 #include "Core/UndoQueue.h"
 
+#include "SliceVector.h"
+
 // boost 1.48, Qt and [Parse error at "BOOST_JOIN"] error
 // https://bugreports.qt.io/browse/QTBUG-22829
 #ifndef Q_MOC_RUN
@@ -24,9 +27,12 @@
 #endif
 #include <boost/variant.hpp>
 
+#include <array>
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 class QString;
 class vtkImageData;
@@ -39,6 +45,8 @@ class TissueHiearchy;
 class ColorLookupTable;
 class bmphandler;
 class ProgressInfo;
+class VolumeSnapshot;
+class VolumeStorage;
 
 class SlicesHandler : public SlicesHandlerInterface
 {
@@ -83,12 +91,16 @@ public:
 
 	int LoadAllXdmf(const char* filename);
 	int LoadAllHDF(const char* filename);
+	/// Map the slices from a native image file (*.isv), see VolumeFile
+	bool LoadAllVolumeFile(const char* filename);
 
 	void UpdateColorLookupTable(std::shared_ptr<ColorLookupTable> new_lut = nullptr);
 	std::shared_ptr<ColorLookupTable> GetColorLookupTable() { return _color_lookup_table; }
 
 	// Description: write project data into an Xdmf file
 	int SaveAllXdmf(const char* filename, int compression, bool naked = false);
+	/// Write all slices to a native image file, only modified slices are written if the slices are mapped from 'filename'
+	bool SaveAllVolumeFile(const char* filename);
 	bool SaveMarkersHDF(const char* filename, bool naked, unsigned short version);
 	int SaveMergeAllXdmf(const char* filename, std::vector<QString>& mergeImagefilenames, unsigned short nrslicesTotal, int compression);
 	int ReadRaw(const char* filename, short unsigned w, short unsigned h,
@@ -153,7 +165,8 @@ public:
 	int ReloadRTdose(const char* filename, unsigned short slicenr);
 	int ReloadAVW(const char* filename, unsigned short slicenr);
 	FILE* SaveHeader(FILE* fp, short unsigned nr_slices_to_write, Transform transform_to_write);
-	FILE* SaveProject(const char* filename, const char* imageFileExtension);
+	/// projectFileName: final name of the project if 'filename' is a temporary file, see GetNativeProjectFormat
+	FILE* SaveProject(const char* filename, const char* imageFileExtension, const char* projectFileName = nullptr);
 	bool SaveCommunicationFile(const char* filename);
 	FILE* SaveActiveSlices(const char* filename, const char* imageFileExtension);
 	void LoadHeader(FILE* fp, int& tissuesVersion, int& version);
@@ -211,7 +224,6 @@ public:
 	void set_bmp_pt(Point p, unsigned short slicenr, float f);
 	tissues_size_t get_tissue_pt(Point p, unsigned short slicenr);
 	void set_tissue_pt(Point p, unsigned short slicenr, tissues_size_t f);
-	unsigned int make_histogram(bool includeoutofrange);
 	unsigned int return_area();
 	unsigned short width() const override;
 	unsigned short height() const override;
@@ -233,6 +245,10 @@ public:
 	void scale_colors(Pair p);
 	void crop_colors();
 	void get_range(Pair* pp);
+	/// Range of the target of a slice, cached until the slice is marked dirty
+	Pair slice_range(unsigned short slicenr);
+	/// Range of the source of a slice, cached until the slice is marked dirty
+	Pair slice_bmprange(unsigned short slicenr);
 	void compute_range_mode1(Pair* pp);
 	void compute_range_mode1(unsigned short updateSlicenr, Pair* pp);
 	void get_bmprange(Pair* pp);
@@ -351,6 +367,12 @@ public:
 			bool handleVanishingComp = true);
 	void interpolate(unsigned short slice1, unsigned short slice2);
 	void extrapolate(unsigned short origin1, unsigned short origin2, unsigned short target);
+	/// Intervals between every 'stride'-th slice from 'startslice', the last interval ends at 'endslice'
+	static std::vector<std::pair<unsigned short, unsigned short>> batch_intervals(unsigned short startslice, unsigned short endslice, unsigned short stride);
+	/// interpolatetissue for all batch_intervals, the intervals are interpolated in parallel
+	void interpolatetissue_batch(unsigned short startslice, unsigned short endslice, unsigned short stride, tissues_size_t tissuetype, bool connected);
+	/// interpolateworkgrey for all batch_intervals, the intervals are interpolated in parallel
+	void interpolateworkgrey_batch(unsigned short startslice, unsigned short endslice, unsigned short stride, bool connected);
 	void interpolate(unsigned short slice1, unsigned short slice2, float* bmp1, float* bmp2);
 
 	bool compute_target_connectivity(ProgressInfo* progress = nullptr);
@@ -360,6 +382,7 @@ public:
 	float get_slicethickness();
 	void set_pixelsize(float dx1, float dy1);
 	Pair get_pixelsize();
+	/// Planes x=const or y=const through all slices, served from a cache of recently extracted planes
 	void slicebmp_x(float* return_bits, unsigned short xcoord);
 	float* slicebmp_x(unsigned short xcoord);
 	void slicebmp_y(float* return_bits, unsigned short ycoord);
@@ -372,13 +395,24 @@ public:
 	tissues_size_t* slicetissue_x(unsigned short xcoord);
 	void slicetissue_y(tissues_size_t* return_bits, unsigned short ycoord);
 	tissues_size_t* slicetissue_y(unsigned short ycoord);
+	/// Drop the cached planes, needed if slices were modified without mark_dirty
+	void clear_ortho_cache();
+	/// Drop the cached slice ranges, needed if slices were modified without mark_dirty
+	void clear_range_cache();
 	void slicework_z(unsigned short slicenr);
+	/** \brief Extract, smooth, simplify and write the surfaces of the tissues
+	 *
+	 * With blocks > 1 the slices are split into slabs, which are meshed,
+	 * smoothed and simplified in parallel and merged at their seams. blocks=0
+	 * uses one block per thread. Thin volumes are extracted in one piece.
+	 */
 	int extract_tissue_surfaces(const QString& filename,
 			std::vector<tissues_size_t>& tissuevec,
 			bool usediscretemc = false, float ratio = 1.0f,
 			unsigned smoothingiterations = 15,
 			float passBand = 0.1f,
-			float featureAngle = 180);
+			float featureAngle = 180,
+			unsigned blocks = 1);
 	void next_slice();
 	void prev_slice();
 	unsigned short get_next_featuring_slice(tissues_size_t type, bool& found);
@@ -449,16 +483,16 @@ public:
 	void merge_undo();
 	DataSelection undo();
 	DataSelection redo();
+	/// Slices [first, last) exchanged by the last undo() or redo()
+	std::pair<unsigned short, unsigned short> undone_slices() const { return _undone_slices; }
 	void clear_undo();
 	void reverse_undosliceorder();
 	unsigned return_nrundo();
 	unsigned return_nrredo();
 	bool return_undo3D();
 	unsigned return_nrundosteps();
-	unsigned return_nrundoarrays();
 	void set_undo3D(bool undo3D1);
 	void set_undonr(unsigned nr);
-	void set_undoarraynr(unsigned nr);
 	void mask_source(bool all_slices, float maskvalue);
 	void map_tissue_indices(const std::vector<tissues_size_t>& indexMap);
 	void remove_tissue(tissues_size_t tissuenr);
@@ -503,12 +537,47 @@ public:
 	bool unwrap(float jumpratio, float shift = 0);
 	unsigned GetNumberOfUndoSteps();
 	void SetNumberOfUndoSteps(unsigned);
-	unsigned GetNumberOfUndoArrays();
-	void SetNumberOfUndoArrays(unsigned);
+	/// Memory budget of the undo queue in MB
+	unsigned GetUndoMemoryBudget();
+	void SetUndoMemoryBudget(unsigned megabytes);
+	/// Disk space in GB for undo steps exceeding the memory budget, 0 disables spilling
+	unsigned GetUndoDiskBudget();
+	void SetUndoDiskBudget(unsigned gigabytes);
 	int GetCompression() const { return this->_hdf5_compression; }
 	void SetCompression(int c) { this->_hdf5_compression = c; }
 	bool GetContiguousMemory() const { return _contiguous_memory_io; }
 	void SetContiguousMemory(bool v) { _contiguous_memory_io = v; }
+	/// Keep source, target and tissues in one aligned slab per channel, slices are views into it
+	bool GetContiguousStorage() const { return _contiguous_storage; }
+	void SetContiguousStorage(bool v);
+	/// Read slices of HDF5/XDMF projects when they are first accessed
+	bool GetLazyLoading() const { return _lazy_loading; }
+	void SetLazyLoading(bool v) { _lazy_loading = v; }
+	/// Budget in MB for decompressed data cached while loading slices on demand
+	unsigned GetLazyLoadCache() const { return _lazy_load_cache; }
+	void SetLazyLoadCache(unsigned megabytes);
+	/// Save project images as memory-mappable *.isv instead of *.xmf
+	bool GetNativeProjectFormat() const { return _native_project_format; }
+	void SetNativeProjectFormat(bool v) { _native_project_format = v; }
+	/// Record that the channels in 'selection' were modified since the project image file was written
+	void mark_dirty(const DataSelection& selection);
+	void mark_dirty(unsigned short slicenr, unsigned char channels);
+	/// The slices have the contents of the project image file, e.g. after loading the project
+	void mark_clean();
+	/// True if slices were modified since the project was loaded or saved
+	bool has_unsaved_changes() const;
+	/// All slices need to be written by the next autosave
+	void mark_autosave_dirty();
+	/// Copy slices modified since the last snapshot, at most max_bytes but at least one slice, returns number of slices left
+	unsigned short take_autosave_snapshot(VolumeSnapshot& snapshot, size_t max_bytes);
+	/// Replace the images by those of an autosave side file, see AutoSave
+	bool RestoreAutoSave(const char* filename);
+	/// (Re-)bind all slices to a freshly allocated VolumeStorage, e.g. after slice buffers were replaced
+	bool make_contiguous();
+	/// Pointer to the whole volume if slices are contiguous in memory, else nullptr
+	float* contiguous_source();
+	float* contiguous_target();
+	tissues_size_t* contiguous_tissues();
 
 	int SaveRaw(const char* filename, bool work);
 	float DICOMsort(std::vector<const char*>* lfilename);
@@ -518,8 +587,41 @@ public:
 	void mergetissues(tissues_size_t tissuetype);
 
 private:
+	/// Attach the slices to the image file of 'reader', returns false if all slices need to be read
+	template<class TReader>
+	bool open_lazy(TReader& reader);
+	/// Bind all slices to 'storage', which replaces the current storage
+	void adopt_storage(std::unique_ptr<VolumeStorage> storage, bool copy);
+	/// True if all slices are views into the mapping of 'filename'
+	bool is_mapped_from(const std::string& filename);
+	/// True if source, target and tissue layer 0 of all slices are views into 'storage'
+	bool is_bound_to(VolumeStorage& storage);
+	/// Called by all loaders once the slices are read: drops slabs the new slices do not use, binds them to contiguous storage if enabled and computes the ranges
+	void finish_loading();
+
+	/// Flags of the per slice statistics which are up to date
+	enum eSliceCache { kBmpRangeValid = 1,
+		kRangeValid = 2 };
+	/// Invalidate the statistics of all slices, e.g. after loading images
+	void reset_range_cache(unsigned short nrslices);
+	/// Compute the statistics in 'what' of slice 'slicenr' which are not up to date
+	void update_slice_cache(unsigned short slicenr, unsigned char what);
+
+	using SliceInterval = std::pair<unsigned short, unsigned short>;
+	/** \brief Shape based interpolation of all slices strictly inside the (disjoint) intervals
+	 *
+	 * 'prepare_key' computes the distance map of a key slice once for both neighbouring
+	 * intervals, 'fill' writes in-between slice slice1 + j from the maps of slice1 and slice2.
+	 * Both run in parallel.
+	 */
+	void interpolate_intervals(const std::vector<SliceInterval>& intervals,
+			const std::function<void(unsigned short, float*)>& prepare_key,
+			const std::function<void(const SliceInterval&, unsigned short, const float*, const float*)>& fill);
+	void interpolatetissue_intervals(const std::vector<SliceInterval>& intervals, tissues_size_t tissuetype);
+	void interpolateworkgrey_intervals(const std::vector<SliceInterval>& intervals);
+
 	unsigned short _activeslice;
-	std::vector<bmphandler> _image_slices;
+	SliceVector _image_slices;
 	short unsigned _width;
 	short unsigned _height;
 	short unsigned _startslice;
@@ -536,14 +638,27 @@ private:
 	float* _overlay;
 	std::vector<Pair> _slice_ranges;
 	std::vector<Pair> _slice_bmpranges;
+	std::vector<unsigned char> _slice_cache_valid; // eSliceCache flags per slice
 	OutlineSlices _os;
 
 	bool _loaded;
 	UndoElem* _uelem;
 	UndoQueue _undoQueue;
+	std::pair<unsigned short, unsigned short> _undone_slices;
 	bool _undo3D;
 	int _hdf5_compression;
 	bool _contiguous_memory_io;
+	bool _contiguous_storage;
+	std::unique_ptr<VolumeStorage> _volume_storage;
+	bool _lazy_loading;
+	unsigned _lazy_load_cache;
+	bool _native_project_format;
+	std::vector<unsigned char> _dirty_slices; // VolumeFile::eChannel flags per slice
+	std::vector<unsigned char> _autosave_dirty;
+	OrthoSliceCache<float> _ortho_source;
+	OrthoSliceCache<float> _ortho_target;
+	OrthoSliceCache<tissues_size_t> _ortho_tissues;
+	tissuelayers_size_t _ortho_tissue_layer;
 };
 
 } // namespace iseg
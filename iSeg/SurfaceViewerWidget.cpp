@@ -18,9 +18,13 @@
 #include "../Data/Color.h"
 
 #include <QAction>
+#include <QCheckBox>
 #include <QMenu>
 #include <QResizeEvent>
 
+#include <limits>
+
+#include <vtkAppendPolyData.h>
 #include <vtkBitArray.h>
 #include <vtkCellData.h>
 #include <vtkDiscreteFlyingEdges3D.h>
@@ -28,6 +32,7 @@
 #include <vtkPointData.h>
 #include <vtkUnsignedShortArray.h>
 
+#include <vtkCleanPolyData.h>
 #include <vtkDecimatePro.h>
 #include <vtkEventQtSlotConnect.h>
 #include <vtkInteractorStyleTrackballCamera.h>
@@ -77,6 +82,9 @@ void transform_slices_vtk(const std::vector<TIn*>& slices, size_t slice_size, TA
 	}
 }
 
+// Number of voxel layers per brick, which is re-extracted after a slice is modified
+int const kBrickSlices = 32;
+
 enum eActions {
 	kSelectTissue,
 	kGotoSlice,
@@ -103,6 +111,10 @@ SurfaceViewerWidget::SurfaceViewerWidget(SlicesHandler* hand3D1, eInputType inpu
 	bt_update->setToolTip("Re-extract surface from updated image.");
 	bt_update->setMaximumWidth(200);
 
+	cb_autoupdate = new QCheckBox("Auto update");
+	cb_autoupdate->setToolTip("Re-extract the surface of modified slices after each change.");
+	cb_autoupdate->setChecked(false);
+
 	bt_connectivity = new QPushButton("Compute connectivity");
 	bt_connectivity->setToolTip("Compute connectivity and show in different colors");
 	bt_connectivity->setMaximumWidth(200);
@@ -153,7 +165,10 @@ SurfaceViewerWidget::SurfaceViewerWidget(SlicesHandler* hand3D1, eInputType inpu
 		QObject::connect(sl_thresh, SIGNAL(sliderReleased()), this, SLOT(thresh_changed()));
 	}
 
-	vbox->addWidget(bt_update);
+	auto update_hbox = new QHBoxLayout;
+	update_hbox->addWidget(bt_update);
+	update_hbox->addWidget(cb_autoupdate);
+	vbox->addLayout(update_hbox);
 
 	auto connectivity_hbox = new QHBoxLayout;
 	connectivity_hbox->addWidget(bt_connectivity);
@@ -194,13 +209,6 @@ SurfaceViewerWidget::SurfaceViewerWidget(SlicesHandler* hand3D1, eInputType inpu
 
 	// copy input data and setup VTK pipeline
 	input = vtkSmartPointer<vtkImageData>::New();
-	discreteCubes = vtkSmartPointer<vtkDiscreteFlyingEdges3D>::New();
-	cubes = vtkSmartPointer<vtkFlyingEdges3D>::New();
-	decimate = vtkSmartPointer<vtkDecimatePro>::New();
-	decimate->PreserveTopologyOn();
-	decimate->BoundaryVertexDeletionOff();
-	decimate->SplittingOff();
-	decimate->SetTargetReduction(reduction->text().toDouble() / 100.0);
 
 	load();
 
@@ -219,128 +227,275 @@ bool SurfaceViewerWidget::isOpenGLSupported()
 
 void SurfaceViewerWidget::load()
 {
-	auto tissue_selection = hand3D->tissue_selection();
 	auto spacing = hand3D->spacing();
-	size_t slice_size = static_cast<size_t>(hand3D->width()) * hand3D->height();
+	int const width = static_cast<int>(hand3D->width());
+	int const height = static_cast<int>(hand3D->height());
+	int const nz = static_cast<int>(hand3D->num_slices());
 
-	input->SetExtent(0, (int)hand3D->width() - 1, 0,
-			(int)hand3D->height() - 1, 0,
-			(int)hand3D->num_slices() - 1);
+	// only geometry, the voxel values are stored in the bricks
+	input->SetExtent(0, width - 1, 0, height - 1, 0, nz - 1);
 	input->SetSpacing(spacing[0], spacing[1], spacing[2]);
 
+	// map tissue types to labels
+	loaded_selection = hand3D->tissue_selection();
 	index_tissue_map.clear();
-
-	if (input_type == kSource) // iso-surface
-	{
-		auto slices = hand3D->source_slices();
-		input->AllocateScalars(VTK_FLOAT, 1);
-		auto field = (float*)input->GetScalarPointer();
-		transform_slices(slices, slice_size, field, [](float v) { return v; });
-	}
-	else if (input_type == kTarget) // foreground
+	tissue_index_map.assign(TissueInfos::GetTissueCount() + 1, 0);
+	if (input_type != kSelectedTissues)
 	{
-		auto slices = hand3D->target_slices();
-		input->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-		auto field = vtkUnsignedCharArray::SafeDownCast(input->GetPointData()->GetScalars());
-		transform_slices_vtk(slices, slice_size, field, [](float v) { return v > 0.f ? 1 : 0; });
+		loaded_selection.clear();
 	}
-	else if (tissue_selection.size() > 254) // all tissues
+	else if (loaded_selection.size() > 254) // all tissues
 	{
-		auto slices = hand3D->tissue_slices(0);
-		input->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
-		auto field = static_cast<tissues_size_t*>(input->GetScalarPointer());
-
-		std::vector<tissues_size_t> tissue_index_map(TissueInfos::GetTissueCount() + 1, 0);
-		for (auto tissue_type : tissue_selection)
+		for (auto tissue_type : loaded_selection)
 		{
 			tissue_index_map[tissue_type] = tissue_type;
 		}
-		transform_slices(slices, slice_size, field, [tissue_index_map](tissues_size_t v) { return tissue_index_map.at(v); });
 	}
-	else if (tissue_selection.size() >= 1) // [1, 254]
+	else // [0, 254]
 	{
 		unsigned char count = 1;
-		std::vector<unsigned char> tissue_index_map(TissueInfos::GetTissueCount() + 1, 0);
-		for (auto tissue_type : tissue_selection)
+		for (auto tissue_type : loaded_selection)
 		{
 			index_tissue_map[count] = tissue_type;
 			tissue_index_map[tissue_type] = count++;
 		}
+	}
 
-		auto slices = hand3D->tissue_slices(0);
-		input->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
-		auto field = static_cast<unsigned char*>(input->GetScalarPointer());
-		try
+	int scalar_type = VTK_BIT;
+	if (input_type == kSource) // iso-surface
+		scalar_type = VTK_FLOAT;
+	else if (input_type == kTarget) // foreground
+		scalar_type = VTK_UNSIGNED_CHAR;
+	else if (loaded_selection.size() > 254)
+		scalar_type = VTK_UNSIGNED_SHORT;
+	else if (loaded_selection.size() >= 1)
+		scalar_type = VTK_UNSIGNED_CHAR;
+
+	// Split the volume into bricks, which share the last slice with the next brick.
+	// The surfaces of the bricks are decimated without moving boundary vertices,
+	// i.e. the pieces still fit together after appending them.
+	int const num_bricks = std::max(1, (nz - 1 + kBrickSlices - 1) / kBrickSlices);
+	bricks.assign(num_bricks, Brick());
+	append = vtkSmartPointer<vtkAppendPolyData>::New();
+	for (int k = 0; k < num_bricks; k++)
+	{
+		auto& brick = bricks[k];
+		brick.z0 = k * kBrickSlices;
+		brick.z1 = std::max(brick.z0, std::min(brick.z0 + kBrickSlices, nz - 1));
+		brick.dirty = true;
+
+		brick.image = vtkSmartPointer<vtkImageData>::New();
+		brick.image->SetExtent(0, width - 1, 0, height - 1, brick.z0, brick.z1);
+		brick.image->SetSpacing(spacing[0], spacing[1], spacing[2]);
+		brick.image->AllocateScalars(scalar_type, 1);
+
+		brick.decimate = vtkSmartPointer<vtkDecimatePro>::New();
+		brick.decimate->PreserveTopologyOn();
+		brick.decimate->BoundaryVertexDeletionOff();
+		brick.decimate->SplittingOff();
+		brick.decimate->SetTargetReduction(reduction->text().toDouble() / 100.0);
+
+		if (input_type == kSource)
 		{
-			transform_slices(slices, slice_size, field, [tissue_index_map](tissues_size_t v) { return tissue_index_map.at(v); });
+			brick.cubes = vtkSmartPointer<vtkFlyingEdges3D>::New();
+			brick.cubes->SetInputData(brick.image);
+			brick.decimate->SetInputConnection(brick.cubes->GetOutputPort());
 		}
-		catch (std::exception& e)
+		else
 		{
-			ISEG_ERROR("bad tissue index map " << e.what());
-			std::fill_n(field, slices.size() * slice_size, 0);
+			brick.discreteCubes = vtkSmartPointer<vtkDiscreteFlyingEdges3D>::New();
+			brick.discreteCubes->SetInputData(brick.image);
+			brick.decimate->SetInputConnection(brick.discreteCubes->GetOutputPort());
 		}
-	}
-	else
-	{
-		input->AllocateScalars(VTK_BIT, 1);
-		auto field = vtkBitArray::SafeDownCast(input->GetPointData()->GetScalars());
-		field->FillComponent(0, 0);
+		append->AddInputConnection(brick.decimate->GetOutputPort());
 	}
 
-	// Define all of the variables
-	input->GetScalarRange(range);
-	startLabel = range[0];
-	endLabel = range[1];
-	startLabel = 1;
+	update_bricks();
 
 	mapper = vtkSmartPointer<vtkPolyDataMapper>::New();
 	actor = vtkSmartPointer<vtkQuadricLODActor>::New();
 
-	if (input_type == kSource)
-	{
-		cubes->SetInputData(input);
-		cubes->SetValue(0, range[0] + 0.01 * (range[1] - range[0]) * sl_thresh->value());
+	setup_mapper();
+
+	actor->GetProperty()->SetOpacity(1.0 - 0.01 * sl_trans->value());
+
+	actor->SetMapper(mapper);
+	ren3D->AddActor(actor);
+}
 
-		decimate->SetInputConnection(cubes->GetOutputPort());
+bool SurfaceViewerWidget::needs_full_reload() const
+{
+	if (bricks.empty())
+		return true;
+
+	int dims[3];
+	input->GetDimensions(dims);
+	if (dims[0] != static_cast<int>(hand3D->width()) ||
+			dims[1] != static_cast<int>(hand3D->height()) ||
+			dims[2] != static_cast<int>(hand3D->num_slices()))
+		return true;
+
+	// the label mapping depends on the tissue selection
+	return input_type == kSelectedTissues &&
+				 (hand3D->tissue_selection() != loaded_selection ||
+						 tissue_index_map.size() != TissueInfos::GetTissueCount() + 1);
+}
 
-		mapper->SetInputConnection(decimate->GetOutputPort());
-		mapper->ScalarVisibilityOff();
+void SurfaceViewerWidget::update_bricks()
+{
+	for (auto& brick : bricks)
+	{
+		if (brick.dirty)
+		{
+			fill_brick(brick);
+			brick.dirty = false;
+		}
 	}
-	else
+
+	// the range is cached per brick, unmodified bricks are not scanned again
+	range[0] = std::numeric_limits<double>::max();
+	range[1] = std::numeric_limits<double>::lowest();
+	for (auto& brick : bricks)
 	{
-		discreteCubes->SetInputData(input);
-		discreteCubes->GenerateValues(endLabel - startLabel + 1, startLabel, endLabel);
+		double r[2];
+		brick.image->GetScalarRange(r);
+		range[0] = std::min(range[0], r[0]);
+		range[1] = std::max(range[1], r[1]);
+	}
 
-		// if split surface
-		// merge duplicate points (check if necessary)
-		// connectivity filter & set random colors
-		// mapper set input to connectivity output
-		decimate->SetInputConnection(discreteCubes->GetOutputPort());
+	// Define all of the variables
+	startLabel = 1;
+	endLabel = range[1];
 
-		mapper->SetInputConnection(decimate->GetOutputPort());
-		if (input_type == kTarget)
+	// setting the same values does not modify the filters
+	for (auto& brick : bricks)
+	{
+		if (input_type == kSource)
 		{
-			mapper->ScalarVisibilityOff();
+			brick.cubes->SetValue(0, range[0] + 0.01 * (range[1] - range[0]) * sl_thresh->value());
 		}
 		else
 		{
-			mapper->ScalarVisibilityOn();
-			mapper->SetColorModeToMapScalars();
+			brick.discreteCubes->GenerateValues(endLabel - startLabel + 1, startLabel, endLabel);
 		}
+	}
+}
+
+void SurfaceViewerWidget::fill_brick(Brick& brick)
+{
+	size_t slice_size = static_cast<size_t>(hand3D->width()) * hand3D->height();
+	auto first = static_cast<size_t>(brick.z0);
+	auto last = static_cast<size_t>(brick.z1) + 1;
+	auto scalars = brick.image->GetPointData()->GetScalars();
 
+	if (input_type == kSource) // iso-surface
+	{
+		auto all_slices = hand3D->source_slices();
+		std::vector<float*> slices(all_slices.begin() + first, all_slices.begin() + last);
+		auto field = (float*)brick.image->GetScalarPointer();
+		transform_slices(slices, slice_size, field, [](float v) { return v; });
+	}
+	else if (input_type == kTarget) // foreground
+	{
+		auto all_slices = hand3D->target_slices();
+		std::vector<float*> slices(all_slices.begin() + first, all_slices.begin() + last);
+		auto field = vtkUnsignedCharArray::SafeDownCast(scalars);
+		transform_slices_vtk(slices, slice_size, field, [](float v) { return v > 0.f ? 1 : 0; });
+	}
+	else if (loaded_selection.size() > 254) // all tissues
+	{
+		auto all_slices = hand3D->tissue_slices(0);
+		std::vector<tissues_size_t*> slices(all_slices.begin() + first, all_slices.begin() + last);
+		auto field = static_cast<tissues_size_t*>(brick.image->GetScalarPointer());
+		auto const& map = tissue_index_map;
+		transform_slices(slices, slice_size, field, [&map](tissues_size_t v) { return map.at(v); });
+	}
+	else if (loaded_selection.size() >= 1) // [1, 254]
+	{
+		auto all_slices = hand3D->tissue_slices(0);
+		std::vector<tissues_size_t*> slices(all_slices.begin() + first, all_slices.begin() + last);
+		auto field = static_cast<unsigned char*>(brick.image->GetScalarPointer());
+		auto const& map = tissue_index_map;
+		try
+		{
+			transform_slices(slices, slice_size, field, [&map](tissues_size_t v) { return static_cast<unsigned char>(map.at(v)); });
+		}
+		catch (std::exception& e)
+		{
+			ISEG_ERROR("bad tissue index map " << e.what());
+			std::fill_n(field, slices.size() * slice_size, 0);
+		}
+	}
+	else
+	{
+		auto field = vtkBitArray::SafeDownCast(scalars);
+		field->FillComponent(0, 0);
+	}
+
+	// values were written through raw pointers
+	scalars->Modified();
+	brick.image->Modified();
+}
+
+void SurfaceViewerWidget::setup_mapper()
+{
+	mapper->SetInputConnection(append->GetOutputPort());
+	if (input_type == kSource || input_type == kTarget)
+	{
+		mapper->ScalarVisibilityOff();
+	}
+	else
+	{
+		mapper->ScalarVisibilityOn();
+		mapper->SetColorModeToMapScalars();
+	}
+
+	if (input_type != kSource)
+	{
 		build_lookuptable();
 	}
+}
 
-	actor->GetProperty()->SetOpacity(1.0 - 0.01 * sl_trans->value());
+void SurfaceViewerWidget::slices_changed(const DataSelection& selection)
+{
+	if (selection.allSlices)
+		slices_changed(selection, 0, hand3D->num_slices());
+	else
+		slices_changed(selection, selection.sliceNr, selection.sliceNr + 1);
+}
 
-	actor->SetMapper(mapper);
-	ren3D->AddActor(actor);
+void SurfaceViewerWidget::slices_changed(const DataSelection& selection, unsigned short first, unsigned short last)
+{
+	bool const modified = (input_type == kSource && selection.bmp) ||
+												(input_type == kTarget && selection.work) ||
+												(input_type == kSelectedTissues && selection.tissues);
+	if (!modified || first >= last)
+		return;
+
+	for (auto& brick : bricks)
+	{
+		if (brick.z0 < last && first <= brick.z1)
+		{
+			brick.dirty = true;
+		}
+	}
+
+	if (cb_autoupdate->isChecked())
+	{
+		reload();
+	}
 }
 
 void SurfaceViewerWidget::split_surface()
 {
+	// merge the duplicate points at the seams between the bricks
+	auto merge = vtkSmartPointer<vtkCleanPolyData>::New();
+	merge->SetInputConnection(append->GetOutputPort());
+	merge->PointMergingOn();
+	merge->SetTolerance(0.0);
+
 	auto connectivity = vtkSmartPointer<vtkPolyDataConnectivityFilter>::New();
-	connectivity->SetInputConnection(mapper->GetInputConnection(0, 0));
+	connectivity->SetInputConnection(merge->GetOutputPort());
 	connectivity->SetExtractionModeToAllRegions();
 	connectivity->ScalarConnectivityOff();
 	connectivity->ColorRegionsOn();
@@ -534,6 +689,11 @@ void SurfaceViewerWidget::pixelsize_changed(Pair p)
 {
 	input->SetSpacing(p.high, p.low, hand3D->get_slicethickness());
 	input->Modified();
+	for (auto& brick : bricks)
+	{
+		brick.image->SetSpacing(p.high, p.low, hand3D->get_slicethickness());
+		brick.image->Modified();
+	}
 
 	vtkWidget->GetRenderWindow()->Render();
 }
@@ -543,17 +703,30 @@ void SurfaceViewerWidget::thickness_changed(float thick)
 	Pair p = hand3D->get_pixelsize();
 	input->SetSpacing(p.high, p.low, thick);
 	input->Modified();
+	for (auto& brick : bricks)
+	{
+		brick.image->SetSpacing(p.high, p.low, thick);
+		brick.image->Modified();
+	}
 
 	vtkWidget->GetRenderWindow()->Render();
 }
 
 void SurfaceViewerWidget::reload()
 {
-	ren3D->RemoveActor(actor);
+	if (needs_full_reload())
+	{
+		ren3D->RemoveActor(actor);
 
-	load();
+		load();
+	}
+	else
+	{
+		// only re-extract the bricks with modified slices
+		update_bricks();
 
-	input->Modified();
+		setup_mapper();
+	}
 
 	vtkWidget->GetRenderWindow()->Render();
 }
@@ -575,7 +748,10 @@ void SurfaceViewerWidget::thresh_changed()
 {
 	if (input_type == kSource)
 	{
-		cubes->SetValue(0, range[0] + 0.01 * (range[1] - range[0]) * sl_thresh->value());
+		for (auto& brick : bricks)
+		{
+			brick.cubes->SetValue(0, range[0] + 0.01 * (range[1] - range[0]) * sl_thresh->value());
+		}
 
 		vtkWidget->GetRenderWindow()->Render();
 	}
@@ -583,7 +759,10 @@ void SurfaceViewerWidget::thresh_changed()
 
 void SurfaceViewerWidget::reduction_changed()
 {
-	decimate->SetTargetReduction(reduction->text().toDouble() / 100.0);
+	for (auto& brick : bricks)
+	{
+		brick.decimate->SetTargetReduction(reduction->text().toDouble() / 100.0);
+	}
 
 	vtkWidget->GetRenderWindow()->Render();
 }
@@ -591,9 +770,9 @@ void SurfaceViewerWidget::reduction_changed()
 int SurfaceViewerWidget::get_picked_tissue() const
 {
 	double* worldPosition = picker->GetPickPosition();
-	if (discreteCubes)
+	if (input_type == kSelectedTissues && append)
 	{
-		auto surface = discreteCubes->GetOutput();
+		auto surface = append->GetOutput();
 		vtkIdType pointId = surface->FindPoint(worldPosition);
 
 		if (pointId != -1)
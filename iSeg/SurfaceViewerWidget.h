@@ -19,6 +19,7 @@
 #include <vtkSmartPointer.h>
 
 #include <map>
+#include <vector>
 
 class QVTKWidget;
 class QVTKInteractor;
@@ -29,6 +30,7 @@ class QPushButton;
 class QCheckBox;
 
 class vtkActor;
+class vtkAppendPolyData;
 class vtkInteractorStyleTrackballCamera;
 class vtkImageData;
 class vtkFlyingEdges3D;
@@ -60,8 +62,29 @@ public:
 
 	static bool isOpenGLSupported();
 
+	/// Marks the bricks containing the modified slices, which are re-extracted on the next reload
+	void slices_changed(const DataSelection& selection);
+	/// Marks the bricks containing slices [first, last), e.g. the slices of an undo step
+	void slices_changed(const DataSelection& selection, unsigned short first, unsigned short last);
+
 protected:
+	/// Part of the volume, which is contoured and decimated separately
+	struct Brick
+	{
+		int z0; ///< first slice
+		int z1; ///< last slice, shared with the next brick
+		bool dirty;
+		vtkSmartPointer<vtkImageData> image;
+		vtkSmartPointer<vtkFlyingEdges3D> cubes;
+		vtkSmartPointer<vtkDiscreteFlyingEdges3D> discreteCubes;
+		vtkSmartPointer<vtkDecimatePro> decimate;
+	};
+
 	void load();
+	bool needs_full_reload() const;
+	void update_bricks();
+	void fill_brick(Brick& brick);
+	void setup_mapper();
 	void build_lookuptable();
 	int get_picked_tissue() const;
 	void closeEvent(QCloseEvent*) override;
@@ -95,6 +118,7 @@ private:
 	QSlider* sl_thresh;
 	QLineEdit* reduction;
 	QPushButton* bt_update;
+	QCheckBox* cb_autoupdate;
 	QPushButton* bt_connectivity;
 	QLabel* lb_connectivity_count;
 
@@ -104,15 +128,16 @@ private:
 	vtkSmartPointer<vtkImageData> input;
 	vtkSmartPointer<vtkRenderer> ren3D;
 	vtkSmartPointer<vtkInteractorStyleTrackballCamera> style;
-	vtkSmartPointer<vtkDiscreteFlyingEdges3D> discreteCubes;
-	vtkSmartPointer<vtkFlyingEdges3D> cubes;
-	vtkSmartPointer<vtkDecimatePro> decimate;
+	std::vector<Brick> bricks;
+	vtkSmartPointer<vtkAppendPolyData> append;
 	vtkSmartPointer<vtkPolyDataMapper> mapper;
 	vtkSmartPointer<vtkActor> actor;
 	vtkSmartPointer<vtkLookupTable> lut;
 
 	double range[2];
 	std::map<int, tissues_size_t> index_tissue_map;
+	std::vector<tissues_size_t> tissue_index_map;
+	std::vector<tissues_size_t> loaded_selection;
 	unsigned int startLabel;
 	unsigned int endLabel;
 };
@@ -138,8 +138,7 @@ std::pair<float, float> ThresholdWidgetQt4::get_range() const
 	std::pair<float, float> range(0.0f, 0.0f);
 	if (handler3D->get_activebmphandler())
 	{
-		Pair p;
-		handler3D->get_activebmphandler()->get_bmprange(&p);
+		Pair p = handler3D->slice_bmprange(handler3D->active_slice());
 		range.first = p.low;
 		range.second = p.high;
 	}
@@ -11,31 +11,31 @@
 
 #include "Data/Types.h"
 
+#include <memory>
 #include <vector>
 
 namespace iseg {
 
+class ComponentLabeling;
+
+/// Reassigns small 6-connected tissue components to the tissue preceding them in their row
 class TissueCleaner
 {
 public:
 	TissueCleaner(tissues_size_t** slices1, unsigned short n1,
 			unsigned short width1, unsigned short height1);
 	~TissueCleaner();
-	bool Allocate();
 	void ConnectedComponents();
 	void Clean(float ratio, unsigned minsize);
 	void MakeStat();
 
 private:
-	int base_connection(int c);
-	std::vector<int> map;
+	std::unique_ptr<ComponentLabeling> labeling;
 	std::vector<tissues_size_t> tissuemap;
-	std::vector<unsigned> volumes;
 	unsigned totvolumes[TISSUES_SIZE_MAX + 1];
-	int* volume;
 	tissues_size_t** slices;
-	size_t width, height;
-	size_t nrslices;
+	unsigned short width, height;
+	unsigned short nrslices;
 };
 
 } // namespace iseg
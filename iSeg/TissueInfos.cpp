@@ -44,6 +44,8 @@ std::string str_tolower(std::string s)
 
 TissueInfo* TissueInfos::GetTissueInfo(tissues_size_t tissuetype)
 {
+	// caller may modify the info
+	version++;
 	return &tissueInfosVector[tissuetype];
 }
 
@@ -120,6 +122,7 @@ tissues_size_t TissueInfos::GetTissueType(std::string tissuename)
 void TissueInfos::SetTissueColor(tissues_size_t tissuetype, float r, float g, float b)
 {
 	tissueInfosVector[tissuetype].color = Color(r, g, b);
+	version++;
 }
 
 void TissueInfos::SetTissueOpac(tissues_size_t tissuetype, float val)
@@ -1018,6 +1021,7 @@ void TissueInfos::AddTissue(TissueInfo& tissue)
 {
 	tissueInfosVector.push_back(tissue);
 	tissueTypeMap.insert(TissueTypeMapEntryType(str_tolower(tissue.name), GetTissueCount()));
+	version++;
 }
 
 void TissueInfos::RemoveTissue(tissues_size_t tissuetype)
@@ -1043,10 +1047,12 @@ void TissueInfos::RemoveAllTissues()
 	tissueTypeMap.clear();
 	tissueInfosVector.clear();
 	tissueInfosVector.resize(1); // Background
+	version++;
 }
 
 void TissueInfos::CreateTissueTypeMap()
 {
+	version++;
 	tissueTypeMap.clear();
 	for (tissues_size_t type = 1; type <= GetTissueCount(); ++type)
 	{
@@ -1079,5 +1085,6 @@ void TissueInfos::SetSelectedTissues(const std::set<tissues_size_t>& sel)
 
 TissueInfos::TissueInfosVecType TissueInfos::tissueInfosVector;
 TissueInfos::TissueTypeMapType TissueInfos::tissueTypeMap;
+unsigned TissueInfos::version = 0;
 
 }// namespace iseg
\ No newline at end of file
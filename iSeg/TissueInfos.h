@@ -40,6 +40,8 @@ public:
 	using TissueTypeMapEntryType = std::pair<std::string, tissues_size_t>;
 
 	static tissues_size_t GetTissueCount();
+	/// Changes whenever tissues or their colors may have been modified, e.g. to update cached colors
+	static unsigned GetVersion() { return version; }
 	static TissueInfo* GetTissueInfo(tissues_size_t tissuetype);
 
 	static const Color& GetTissueColor(tissues_size_t tissuetype);
@@ -86,6 +88,7 @@ protected:
 protected:
 	static TissueInfosVecType tissueInfosVector;
 	static TissueTypeMapType tissueTypeMap;
+	static unsigned version;
 };
 
 } // namespace iseg
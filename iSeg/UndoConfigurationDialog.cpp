@@ -30,15 +30,22 @@ UndoConfigurationDialog::UndoConfigurationDialog(SlicesHandler* hand3D, QWidget*
 
 	sb_nrundo = new QSpinBox(1, 100, 1, nullptr);
 	sb_nrundo->setValue(handler3D->GetNumberOfUndoSteps());
-	sb_nrundoarrays = new QSpinBox(6, 10000, 1, nullptr);
-	sb_nrundoarrays->setValue(handler3D->GetNumberOfUndoArrays());
+	sb_undomemory = new QSpinBox(16, 1 << 20, 16, nullptr);
+	sb_undomemory->setSuffix(" MB");
+	sb_undomemory->setValue(handler3D->GetUndoMemoryBudget());
+	sb_undodisk = new QSpinBox(0, 1024, 1, nullptr);
+	sb_undodisk->setSuffix(" GB");
+	sb_undodisk->setSpecialValueText(tr("Disabled"));
+	sb_undodisk->setValue(handler3D->GetUndoDiskBudget());
+	sb_undodisk->setToolTip(tr("Temporary disk space for undo steps which do not fit into the undo memory."));
 
 	pb_close = new QPushButton("Accept");
 
 	// layout
 	layout->addRow(tr("Enable 3D Undo"), cb_undo3D);
 	layout->addRow(tr("Maximal nr of undo steps"), sb_nrundo);
-	layout->addRow(tr("Maximal nr of stored images"), sb_nrundoarrays);
+	layout->addRow(tr("Undo memory"), sb_undomemory);
+	layout->addRow(tr("Undo disk space"), sb_undodisk);
 	layout->addRow(pb_close);
 
 	setLayout(layout);
@@ -55,7 +62,8 @@ UndoConfigurationDialog::~UndoConfigurationDialog()
 void UndoConfigurationDialog::ok_pressed()
 {
 	handler3D->set_undo3D(cb_undo3D->isChecked());
-	handler3D->SetNumberOfUndoArrays((unsigned)sb_nrundoarrays->value());
+	handler3D->SetUndoMemoryBudget((unsigned)sb_undomemory->value());
+	handler3D->SetUndoDiskBudget((unsigned)sb_undodisk->value());
 	handler3D->SetNumberOfUndoSteps((unsigned)sb_nrundo->value());
 
 	close();
@@ -30,7 +30,8 @@ private:
 	SlicesHandler* handler3D;
 	QCheckBox* cb_undo3D;
 	QSpinBox* sb_nrundo;
-	QSpinBox* sb_nrundoarrays;
+	QSpinBox* sb_undomemory;
+	QSpinBox* sb_undodisk;
 	QPushButton* pb_close;
 
 private slots:
@@ -16,12 +16,12 @@
 #include "QVTKWidget.h"
 
 #include <QResizeEvent>
+#include <QTimer>
 #include <Q3VBox>
 
 #include <vtkActor.h>
 #include <vtkColorTransferFunction.h>
 #include <vtkCutter.h>
-#include <vtkImageShiftScale.h>
 #include <vtkImplicitPlaneWidget.h>
 #include <vtkInteractorStyleTrackballCamera.h>
 #include <vtkLookupTable.h>
@@ -37,8 +37,44 @@
 #include <vtkVolumeProperty.h>
 #include <vtkXMLImageDataReader.h>
 
+#include <cstdint>
+
 namespace iseg {
 
+namespace {
+// number of slices loaded per refinement step
+int const kBrickSlices = 16;
+// largest dimension of the coarse preview volume
+int const kPreviewSize = 128;
+// the source is rendered rescaled to [0, kScaledMax]
+float const kScaledMax = 255.f;
+
+// copy the slices [z0 * factor, z1 * factor) with stride factor into image
+template<typename TOut, typename TSlices, typename TConvert>
+void sample_slices(const TSlices& slices, int width, int factor, int z0, int z1, vtkImageData* image, TConvert convert)
+{
+	int dims[3];
+	image->GetDimensions(dims);
+	TOut* field = static_cast<TOut*>(image->GetScalarPointer(0, 0, 0));
+	std::int64_t const area = static_cast<std::int64_t>(dims[0]) * dims[1];
+
+#pragma omp parallel for
+	for (std::int64_t k = z0; k < z1; ++k)
+	{
+		auto const slice = slices[k * factor];
+		TOut* out = field + k * area;
+		for (std::int64_t j = 0; j < dims[1]; ++j)
+		{
+			auto const row = slice + j * factor * width;
+			for (std::int64_t i = 0; i < dims[0]; ++i)
+			{
+				out[j * dims[0] + i] = convert(row[i * factor]);
+			}
+		}
+	}
+}
+} // namespace
+
 VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1,
 		bool gpu_or_raycast, bool shade1,
 		QWidget* parent, const char* name,
@@ -141,49 +177,30 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 	//  vtkImageData* input = (vtkImageData*)reader->GetOutput();
 	//  input->Update();
 
-	input = vtkSmartPointer<vtkImageData>::New();
-	input->SetExtent(0, (int)hand3D->width() - 1, 0,
-			(int)hand3D->height() - 1, 0,
-			(int)hand3D->num_slices() - 1);
-	Pair ps = hand3D->get_pixelsize();
+	refine_timer = new QTimer(this);
+	QObject::connect(refine_timer, SIGNAL(timeout()), this, SLOT(refine()));
+
 	if (bmportissue)
 	{
-		input->SetSpacing(ps.high, ps.low, hand3D->get_slicethickness());
-		input->AllocateScalars(VTK_FLOAT, 1);
-		float* field = (float*)input->GetScalarPointer(0, 0, 0);
-		for (unsigned short i = 0; i < hand3D->num_slices(); i++)
-		{
-			hand3D->copyfrombmp(
-					i, &(field[i * (unsigned long long)hand3D->return_area()]));
-		}
+		Pair p;
+		hand3D->get_bmprange(&p);
+		range[0] = p.low;
+		range[1] = p.high;
 	}
 	else
 	{
-		switch (sizeof(tissues_size_t))
-		{
-		case 1: input->AllocateScalars(VTK_UNSIGNED_CHAR, 1); break;
-		case 2: input->AllocateScalars(VTK_UNSIGNED_SHORT, 1); break;
-		default:
-			std::cerr << "volumeviewer3D::volumeviewer3D: tissues_size_t not "
-							"implemented."
-					 << endl;
-		}
-		input->SetSpacing(ps.high, ps.low, hand3D->get_slicethickness());
-		tissues_size_t* field =
-				(tissues_size_t*)input->GetScalarPointer(0, 0, 0);
-		for (unsigned short i = 0; i < hand3D->num_slices(); i++)
-		{
-			hand3D->copyfromtissue(
-					i, &(field[i * (unsigned long long)hand3D->return_area()]));
-		}
+		range[0] = 0;
+		range[1] = TissueInfos::GetTissueCount();
 	}
 
-	double bounds[6], center[3];
+	// the full resolution volume is filled brick by brick after a coarse preview has been shown
+	input = vtkSmartPointer<vtkImageData>::New();
+	preview = vtkSmartPointer<vtkImageData>::New();
+	allocate();
 
+	double bounds[6], center[3];
 	input->GetBounds(bounds);
 	input->GetCenter(center);
-	input->GetScalarRange(range);
-	std::cerr << "input range = " << range[0] << " " << range[1] << endl;
 
 	double level = 0.5 * (range[1] + range[0]);
 	double window = range[1] - range[0];
@@ -217,7 +234,6 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 
 	// Attach a Cutter to the slice plane to sample the function.
 	sliceCutterY = vtkSmartPointer<vtkCutter>::New();
-	sliceCutterY->SetInputData(input);
 	slicePlaneY = vtkSmartPointer<vtkPlane>::New();
 	planeWidgetY->GetPlane(slicePlaneY);
 	sliceCutterY->SetCutFunction(slicePlaneY);
@@ -233,7 +249,6 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 
 	// Attach a Cutter to the slice plane to sample the function.
 	sliceCutterZ = vtkSmartPointer<vtkCutter>::New();
-	sliceCutterZ->SetInputData(input);
 	slicePlaneZ = vtkSmartPointer<vtkPlane>::New();
 	planeWidgetZ->GetPlane(slicePlaneZ);
 	sliceCutterZ->SetCutFunction(slicePlaneZ);
@@ -244,7 +259,7 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 	if (bmportissue)
 	{
 		lut = vtkSmartPointer<vtkLookupTable>::New();
-		lut->SetTableRange(range);
+		lut->SetTableRange(0, kScaledMax);
 		lut->SetHueRange(0, 0);
 		lut->SetSaturationRange(0, 0);
 		lut->SetValueRange(0, 1);
@@ -272,10 +287,9 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 	sliceY->SetInputConnection(sliceCutterY->GetOutputPort());
 	//   input->GetScalarRange( range );
 	//range[1] *= 0.7; // reduce the upper range by 30%
-	sliceY->SetScalarRange(range);
+	sliceY->SetScalarRange(bmportissue ? 0.0 : range[0], bmportissue ? kScaledMax : range[1]);
 	sliceY->SetLookupTable(lut);
 	//   sliceY->SelectColorArray(argv[2]);
-	sliceY->Update();
 	sliceActorY = vtkSmartPointer<vtkActor>::New();
 	sliceActorY->SetMapper(sliceY);
 
@@ -285,9 +299,8 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 	sliceZ->SetInputConnection(sliceCutterZ->GetOutputPort());
 	//   input->GetScalarRange( range );
 	//range[1] *= 0.7; // reduce the upper range by 30%
-	sliceZ->SetScalarRange(range);
+	sliceZ->SetScalarRange(bmportissue ? 0.0 : range[0], bmportissue ? kScaledMax : range[1]);
 	sliceZ->SetLookupTable(lut);
-	sliceZ->Update();
 	sliceActorZ = vtkSmartPointer<vtkActor>::New();
 	sliceActorZ->SetMapper(sliceZ);
 
@@ -343,22 +356,6 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 	volumeMapper = vtkSmartPointer<vtkSmartVolumeMapper>::New();
 	volumeMapper->SetRequestedRenderModeToDefault();
 
-	cast = vtkSmartPointer<vtkImageShiftScale>::New();
-	if (bmportissue)
-	{
-		double slope = 255 / (range[1] - range[0]);
-		double shift = -range[0];
-		cast->SetInputData(input);
-		cast->SetShift(shift);
-		cast->SetScale(slope);
-		cast->SetOutputScalarTypeToUnsignedShort();
-		volumeMapper->SetInputConnection(cast->GetOutputPort());
-	}
-	else
-	{
-		volumeMapper->SetInputData(input);
-	}
-
 	volume = vtkSmartPointer<vtkVolume>::New();
 	if (gpu_or_raycast)
 		volumeMapper->SetRequestedRenderModeToDefault();
@@ -421,6 +418,8 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 	planeWidgetZ->SetEnabled(cb_showslice2->isChecked());
 	planeWidgetZ->PlaceWidget(bounds);
 
+	update_volume();
+
 	//
 	// Jump into the event loop and capture mouse and keyboard events.
 	//
@@ -428,6 +427,171 @@ VolumeViewerWidget::VolumeViewerWidget(SlicesHandler* hand3D1, bool bmportissue1
 	vtkWidget->GetRenderWindow()->Render();
 }
 
+void VolumeViewerWidget::allocate()
+{
+	int const dims[3] = {(int)hand3D->width(), (int)hand3D->height(), (int)hand3D->num_slices()};
+
+	int scalar_type = VTK_UNSIGNED_SHORT;
+	if (!bmportissue)
+	{
+		switch (sizeof(tissues_size_t))
+		{
+		case 1: scalar_type = VTK_UNSIGNED_CHAR; break;
+		case 2: scalar_type = VTK_UNSIGNED_SHORT; break;
+		default:
+			ISEG_ERROR_MSG("VolumeViewerWidget::allocate: tissues_size_t not implemented.");
+		}
+	}
+
+	input->SetExtent(0, dims[0] - 1, 0, dims[1] - 1, 0, dims[2] - 1);
+	input->AllocateScalars(scalar_type, 1);
+
+	int const max_dim = std::max(dims[0], std::max(dims[1], dims[2]));
+	preview_factor = std::max(1, (max_dim + kPreviewSize - 1) / kPreviewSize);
+	if (preview_factor > 1)
+	{
+		preview->SetExtent(0, (dims[0] - 1) / preview_factor, 0,
+				(dims[1] - 1) / preview_factor, 0,
+				(dims[2] - 1) / preview_factor);
+		preview->AllocateScalars(scalar_type, 1);
+	}
+	update_spacing(hand3D->get_pixelsize(), hand3D->get_slicethickness());
+
+	bricks.clear();
+	for (int z0 = 0; z0 < dims[2]; z0 += kBrickSlices)
+	{
+		Brick brick = {z0, std::min(z0 + kBrickSlices, dims[2]), true};
+		bricks.push_back(brick);
+	}
+
+	scaled_range[0] = range[0];
+	scaled_range[1] = range[1];
+}
+
+void VolumeViewerWidget::update_spacing(Pair ps, float thick)
+{
+	input->SetSpacing(ps.high, ps.low, thick);
+	input->Modified();
+	preview->SetSpacing(ps.high * preview_factor, ps.low * preview_factor, thick * preview_factor);
+	preview->Modified();
+}
+
+void VolumeViewerWidget::update_volume()
+{
+	bool const all_dirty = std::all_of(bricks.begin(), bricks.end(), [](const Brick& b) { return b.dirty; });
+	if (all_dirty && preview_factor > 1)
+	{
+		// show the coarse level right away, the bricks are loaded in the background
+		fill_preview();
+		set_render_input(preview);
+		refine_timer->start(0);
+	}
+	else
+	{
+		refine_timer->stop();
+		bool modified = false;
+		for (auto& brick : bricks)
+		{
+			if (brick.dirty)
+			{
+				fill_brick(brick);
+				brick.dirty = false;
+				modified = true;
+			}
+		}
+		if (modified)
+		{
+			input->Modified();
+		}
+		set_render_input(input);
+	}
+}
+
+void VolumeViewerWidget::refine()
+{
+	auto next = std::find_if(bricks.begin(), bricks.end(), [](const Brick& b) { return b.dirty; });
+	if (next != bricks.end())
+	{
+		fill_brick(*next);
+		next->dirty = false;
+		return;
+	}
+
+	refine_timer->stop();
+	input->Modified();
+	set_render_input(input);
+	vtkWidget->GetRenderWindow()->Render();
+}
+
+void VolumeViewerWidget::fill_preview()
+{
+	int dims[3];
+	preview->GetDimensions(dims);
+	if (bmportissue)
+	{
+		float const offset = scaled_range[0];
+		float const scale = scaled_range[1] > scaled_range[0] ? kScaledMax / (scaled_range[1] - scaled_range[0]) : 0.f;
+		sample_slices<unsigned short>(hand3D->source_slices(), hand3D->width(), preview_factor, 0, dims[2], preview, [=](float v) {
+			return static_cast<unsigned short>(std::min(std::max((v - offset) * scale, 0.f), kScaledMax));
+		});
+	}
+	else
+	{
+		sample_slices<tissues_size_t>(hand3D->tissue_slices(hand3D->active_tissuelayer()), hand3D->width(), preview_factor, 0, dims[2], preview, [](tissues_size_t v) {
+			return v;
+		});
+	}
+	preview->Modified();
+}
+
+void VolumeViewerWidget::fill_brick(const Brick& brick)
+{
+	if (bmportissue)
+	{
+		float const offset = scaled_range[0];
+		float const scale = scaled_range[1] > scaled_range[0] ? kScaledMax / (scaled_range[1] - scaled_range[0]) : 0.f;
+		sample_slices<unsigned short>(hand3D->source_slices(), hand3D->width(), 1, brick.z0, brick.z1, input, [=](float v) {
+			return static_cast<unsigned short>(std::min(std::max((v - offset) * scale, 0.f), kScaledMax));
+		});
+	}
+	else
+	{
+		sample_slices<tissues_size_t>(hand3D->tissue_slices(hand3D->active_tissuelayer()), hand3D->width(), 1, brick.z0, brick.z1, input, [](tissues_size_t v) {
+			return v;
+		});
+	}
+}
+
+void VolumeViewerWidget::set_render_input(vtkImageData* image)
+{
+	sliceCutterY->SetInputData(image);
+	sliceCutterZ->SetInputData(image);
+	volumeMapper->SetInputData(image);
+}
+
+void VolumeViewerWidget::slices_changed(const DataSelection& selection)
+{
+	if (selection.allSlices)
+		slices_changed(selection, 0, hand3D->num_slices());
+	else
+		slices_changed(selection, selection.sliceNr, selection.sliceNr + 1);
+}
+
+void VolumeViewerWidget::slices_changed(const DataSelection& selection, unsigned short first, unsigned short last)
+{
+	if (!(bmportissue ? selection.bmp : selection.tissues))
+		return;
+
+	// the modified bricks are reloaded on the next update
+	for (auto& brick : bricks)
+	{
+		if (brick.z0 < last && first < brick.z1)
+		{
+			brick.dirty = true;
+		}
+	}
+}
+
 void VolumeViewerWidget::resizeEvent(QResizeEvent* RE)
 {
 	QWidget::resizeEvent(RE);
@@ -611,13 +775,12 @@ void VolumeViewerWidget::contrbright_changed()
 
 void VolumeViewerWidget::pixelsize_changed(Pair p)
 {
-	input->SetSpacing(p.high, p.low, hand3D->get_slicethickness());
+	update_spacing(p, hand3D->get_slicethickness());
 	//BL?
 	//vtkInformation* info = input->GetPipelineInformation();
 	//double spc[3];
 	//input->GetSpacing(spc);
 	//info->Set(vtkDataObject::SPACING(), spc, 3);
-	input->Modified();
 
 	double bounds[6], center[3];
 
@@ -635,14 +798,12 @@ void VolumeViewerWidget::pixelsize_changed(Pair p)
 
 void VolumeViewerWidget::thickness_changed(float thick)
 {
-	Pair p = hand3D->get_pixelsize();
-	input->SetSpacing(p.high, p.low, thick);
+	update_spacing(hand3D->get_pixelsize(), thick);
 	//BL? what does this do?
 	//vtkInformation* info = input->GetPipelineInformation();
 	//double spc[3];
 	//input->GetSpacing(spc);
 	//info->Set(vtkDataObject::SPACING(), spc, 3);
-	input->Modified();
 
 	double bounds[6], center[3];
 	input->GetBounds(bounds);
@@ -704,25 +865,29 @@ void VolumeViewerWidget::thickness_changed(float thick)
 
 void VolumeViewerWidget::reload()
 {
-	int xm, xp, ym, yp, zm, zp;								//xxxa
-	input->GetExtent(xm, xp, ym, yp, zm, zp); //xxxa
+	if (bmportissue)
+	{
+		Pair p;
+		hand3D->get_bmprange(&p);
+		range[0] = p.low;
+		range[1] = p.high;
+	}
+	else
+	{
+		range[0] = 0;
+		range[1] = TissueInfos::GetTissueCount();
+	}
+
 	int size1[3];
 	input->GetDimensions(size1);
-	int w = hand3D->width(); //xxxa
 	if ((hand3D->width() != size1[0]) ||
 			(hand3D->height() != size1[1]) ||
 			(hand3D->num_slices() != size1[2]))
 	{
-		input->SetExtent(0, (int)hand3D->width() - 1, 0,
-				(int)hand3D->height() - 1, 0,
-				(int)hand3D->num_slices() - 1);
-		input->AllocateScalars(input->GetScalarType(),
-				input->GetNumberOfScalarComponents());
+		allocate();
 		outlineGrid->SetInputData(input);
 		planeWidgetY->SetInputData(input);
-		sliceCutterY->SetInputData(input);
 		planeWidgetZ->SetInputData(input);
-		sliceCutterZ->SetInputData(input);
 
 		double bounds[6], center[3];
 		input->GetBounds(bounds);
@@ -731,66 +896,26 @@ void VolumeViewerWidget::reload()
 		planeWidgetY->PlaceWidget(bounds);
 		planeWidgetZ->SetOrigin(center);
 		planeWidgetZ->PlaceWidget(bounds);
-		if (!bmportissue)
-		{
-			volumeMapper->SetInputData(input);
-		}
-		else
-		{
-			cast->SetInputData(input);
-			volumeMapper->SetInputConnection(cast->GetOutputPort());
-		}
-	}
-	input->GetExtent(xm, xp, ym, yp, zm, zp); //xxxa
-	input->GetDimensions(size1);							//xxxa
-	Pair ps = hand3D->get_pixelsize();
-	input->SetSpacing(ps.high, ps.low, hand3D->get_slicethickness());
-
-	if (bmportissue)
-	{
-		float* field = (float*)input->GetScalarPointer(0, 0, 0);
-		for (unsigned short i = 0; i < hand3D->num_slices(); i++)
-		{
-			hand3D->copyfrombmp(
-					i, &(field[i * (unsigned long long)hand3D->return_area()]));
-		}
 	}
 	else
 	{
-		tissues_size_t* field =
-				(tissues_size_t*)input->GetScalarPointer(0, 0, 0);
-		for (unsigned short i = 0; i < hand3D->num_slices(); i++)
+		update_spacing(hand3D->get_pixelsize(), hand3D->get_slicethickness());
+		if (bmportissue && (range[0] != scaled_range[0] || range[1] != scaled_range[1]))
 		{
-			hand3D->copyfromtissue(
-					i, &(field[i * (unsigned long long)hand3D->return_area()]));
+			// rescaling touches every voxel
+			scaled_range[0] = range[0];
+			scaled_range[1] = range[1];
+			for (auto& brick : bricks)
+			{
+				brick.dirty = true;
+			}
 		}
 	}
 
-	/*vtkInformation* info = input->GetPipelineInformation();
-	Pair p;
-	hand3D->get_bmprange(&p);
-	range[0]=p.low;
-	range[1]=p.high;
-	info->Set(vtkDataObject::FIELD_RANGE(),range,2);*/
-	input->Modified();
-	input->GetScalarRange(range);
-	if (bmportissue)
-	{
-		Pair p;
+	// only the modified bricks are copied again
+	update_volume();
 
-		hand3D->get_bmprange(&p);
-		range[0] = p.low;
-		range[1] = p.high;
-		lut->SetTableRange(range);
-		lut->Build(); //effective build
-		double slope = 255 / (range[1] - range[0]);
-		double shift = -range[0];
-		cast->SetShift(shift);
-		cast->SetScale(slope);
-		cast->SetOutputScalarTypeToUnsignedShort();
-		cast->Update();
-	}
-	else
+	if (!bmportissue)
 	{
 		tissues_size_t tissuecount = TissueInfos::GetTissueCount();
 		lut->SetNumberOfColors(tissuecount + 1);
@@ -804,10 +929,10 @@ void VolumeViewerWidget::reload()
 		auto tissuecolor = TissueInfos::GetTissueColor(tissuecount + 1);
 		colorTransferFunction->AddRGBPoint((double)tissuecount + 0.1, tissuecolor[0], tissuecolor[1], tissuecolor[2]);
 	}
-	sliceY->SetScalarRange(range);
+	sliceY->SetScalarRange(bmportissue ? 0.0 : range[0], bmportissue ? kScaledMax : range[1]);
 	sliceY->SetLookupTable(lut);
 	sliceY->Update();
-	sliceZ->SetScalarRange(range);
+	sliceZ->SetScalarRange(bmportissue ? 0.0 : range[0], bmportissue ? kScaledMax : range[1]);
 	sliceZ->SetLookupTable(lut);
 	sliceZ->Update();
 	//		sliceY->Update();
@@ -841,7 +966,6 @@ void VolumeViewerWidget::reload()
 		}
 	}
 
-	input->Modified();
 	outlineActor->Modified();
 
 	vtkWidget->GetRenderWindow()->Render();
@@ -9,6 +9,8 @@
 */
 #pragma once
 
+#include "Data/DataSelection.h"
+
 #include "Core/Pair.h"
 
 #include <QWidget>
@@ -16,6 +18,8 @@
 #include <vtkCommand.h>
 #include <vtkSmartPointer.h>
 
+#include <vector>
+
 class QVTKWidget;
 class QVTKInteractor;
 class Q3VBox;
@@ -24,6 +28,7 @@ class QSlider;
 class QLabel;
 class QCheckBox;
 class QPushButton;
+class QTimer;
 
 class vtkLookupTable;
 class vtkImplicitPlaneWidget;
@@ -36,7 +41,6 @@ class vtkVolume;
 class vtkVolumeProperty;
 class vtkSmartVolumeMapper;
 class vtkInteractorStyleTrackballCamera;
-class vtkImageShiftScale;
 class vtkPlane;
 class vtkCutter;
 class vtkOutlineFilter;
@@ -84,6 +88,8 @@ public slots:
 	void pixelsize_changed(Pair p);
 	void thickness_changed(float thick);
 	void reload();
+	void slices_changed(const DataSelection& selection);
+	void slices_changed(const DataSelection& selection, unsigned short first, unsigned short last);
 
 protected:
 	void closeEvent(QCloseEvent*);
@@ -96,19 +102,40 @@ protected slots:
 	void showvolume_changed();
 	void contrbright_changed();
 	void transp_changed();
+	void refine();
 
 signals:
 	void hasbeenclosed();
 
 private:
+	/// slab of slices [z0, z1) of the full resolution volume
+	struct Brick
+	{
+		int z0, z1;
+		bool dirty;
+	};
+
+	void allocate();
+	void update_spacing(Pair ps, float thick);
+	void update_volume();
+	void fill_preview();
+	void fill_brick(const Brick& brick);
+	void set_render_input(vtkImageData* image);
+
 	SlicesHandler* hand3D;
 	double range[2];
+	/// bmp range used to scale the source into the rendered volume
+	double scaled_range[2];
+	int preview_factor;
+	std::vector<Brick> bricks;
+	QTimer* refine_timer;
 	vtkSmartPointer<vtkCutter> sliceCutterY, sliceCutterZ;
 	vtkSmartPointer<vtkPlane> slicePlaneY, slicePlaneZ;
 
 	vtkSmartPointer<QVTKInteractor> iren;
 
 	vtkSmartPointer<vtkImageData> input;
+	vtkSmartPointer<vtkImageData> preview;
 	vtkSmartPointer<vtkRenderer> ren3D;
 	vtkSmartPointer<vtkXMLImageDataReader> reader;
 	vtkSmartPointer<vtkOutlineFilter> outlineGrid;
@@ -129,7 +156,6 @@ private:
 	vtkSmartPointer<vtkVolumeProperty> volumeProperty;
 	vtkSmartPointer<vtkSmartVolumeMapper> volumeMapper;
 	vtkSmartPointer<vtkVolume> volume;
-	vtkSmartPointer<vtkImageShiftScale> cast;
 
 	//	vtkSmartPointer<vtkRenderWindow> renWin;
 
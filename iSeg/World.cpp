@@ -13,6 +13,7 @@
 
 #include "Core/BranchItem.h"
 
+#include <algorithm>
 #include <cmath>
 #include <math.h>
 
@@ -35,6 +36,8 @@ void World::clear()
 		delete[] nodes;
 		nodes = nullptr;
 	}
+	activelist.reset();
+	priority.clear();
 	_isValid = false;
 }
 //----------------------------------------------------------------------------------
@@ -98,6 +101,7 @@ bool World::init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 	float px, py, pz;
 	float gradient, fgradient;
 	float intens, fintens;
+	float minfcost = 0;
 
 	for (unsigned o = 0; o < total; o++)
 	{
@@ -155,9 +159,15 @@ bool World::init(Vec3 bbStart, Vec3 bbEnd, SlicesHandler* handler3D)
 		else
 			fgradient = 1;
 		nodes2[o].fcost = (fgradient * 0.8f + fintens * 0.2f);
+		if (o == 0 || nodes2[o].fcost < minfcost)
+			minfcost = nodes2[o].fcost;
 	}
 
 	this->nodes = nodes2;
+	priority.assign(total, 0.f);
+	activelist.reset(new IndexPriorityQueue(total, priority.data()));
+	// every step adds the cost of the entered node plus 10
+	minstepcost = minfcost + 10;
 	//	std::cout << "TIME for initialization: " << time2.getRunningTime() << std::endl;
 
 	_isValid = true;
@@ -186,6 +196,8 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 	endpoint[0] = end[0] - offx;
 	endpoint[1] = end[1] - offy;
 	endpoint[2] = end[2] - offz;
+	for (int d = 0; d < 3; d++)
+		target[d] = (int)endpoint[d];
 
 	unsigned off = n_x + n_y * width + n_z * width * height;
 	unsigned short int cross_x;
@@ -209,7 +221,6 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 	bool ends = false;
 	bool firstfound = false;
 	bool morethanoneseed = true;
-	int min;
 	int counter = 0;
 	bool largearea = false;
 	int largeareatimes = 0;
@@ -221,28 +232,20 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 	//Initializing first node to expand (first seed)
 
-	nodes[off].cost = 0;
-	activelist.push_back(&nodes[off]);
+	start_search(off);
 	std::cout << "Expanding seed " << 1 << std::endl;
 
 	//----------------------------------------------------------------------------------
 	//@ Main loop
 	//----------------------------------------------------------------------------------
 
-	while ((activelist.size() != 0 || solvingarea == true) && !endt)
+	while ((!activelist->empty() || solvingarea == true) && !endt)
 	{
-		if (activelist.size() == 0)
+		if (activelist->empty())
 		{
 			std::cout << "Activelist empty!!" << std::endl;
 			off = solvelargearea2();
-			activelist.push_back(&nodes[off]);
-		}
-
-		//Reducing activelist if it is too large
-		if (activelist.size() > 3000 && largearea == false)
-		{
-			reduceactivelist();
-			//std::cout << "Reducing activelist" << std::endl;
+			push_active(off);
 		}
 
 		//Skipping seed if it is lasting too much to find the path
@@ -271,9 +274,7 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 				n_z = (unsigned short)(seeds[pos][2] - offz);
 
 				unsigned off5 = n_x + n_y * width + n_z * width * height;
-				std::list<Node*> activelist2;
-				activelist = activelist2;
-				activelist.push_back(&nodes[off5]);
+				start_search(off5);
 
 				redfound = false;
 				counter = 0;
@@ -288,7 +289,7 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 				solvingarea = false;
 				firstseedexpanded = false;
 				times = 0;
-				activelist.clear();
+				activelist->clear();
 				activelistlowint.clear();
 				if (firstfound == true)
 					storingtree(children, rootOne);
@@ -359,10 +360,8 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			n_z = (unsigned short)(seeds[pos][2] - offz);
 
 			unsigned off5 = n_x + n_y * width + n_z * width * height;
-			std::list<Node*> activelist2;
-			activelist = activelist2;
-			activelistlowint = activelist2;
-			activelist.push_back(&nodes[off5]);
+			activelistlowint.clear();
+			start_search(off5);
 
 			redfound = false;
 			counter = 0;
@@ -404,9 +403,7 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 			n_z = (unsigned short)(seeds[pos][2] - offz);
 
 			unsigned off5 = n_x + n_y * width + n_z * width * height;
-			std::list<Node*> activelist2;
-			activelist = activelist2;
-			activelist.push_back(&nodes[off5]);
+			start_search(off5);
 
 			ends = false;
 			firstfound = true;
@@ -438,24 +435,11 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 		//std::cout << activelist.size() << std::endl;
 
-		min = -1;
-		li todel;
-
-		//Looking for the node with the mininum cost in activelist
+		//Taking the node with the mininum cost (plus heuristic) from activelist
 
 		if (solvingarea == false)
 		{
-			for (li ii = activelist.begin(); ii != activelist.end(); ++ii)
-			{
-				Node* e = *ii;
-				if (min == -1 || min > e->cost)
-				{
-					min = (int)e->cost;
-					off = e->offset;
-					todel = ii;
-				}
-			}
-			activelist.erase(todel);
+			off = activelist->pop();
 		}
 
 		if (nodes[off].computed == true)
@@ -464,7 +448,7 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 		//Dealing with large structures
 
 		//		if (activelist.size()>1 && largeareatimes<1){
-		//			unsigned o7=nodes[off].prev->offset;
+		//			unsigned o7=nodes[off].prev;
 		//			if (checkdiameter(off, o7)){
 		//				largearea=true;
 		//				std::cout << "Large structure found" << std::endl;
@@ -624,16 +608,7 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 
 						//Checking if the neighbour is already in activelist
 
-						li l = activelist.begin();
-						while (!alreadyinlist && l != activelist.end())
-						{
-							Node* e = *l;
-							if (e->offset == o)
-							{
-								alreadyinlist = true;
-							}
-							l++;
-						}
+						alreadyinlist = activelist->in_queue(o);
 
 						//If it was in one of the activelists and the new cost is lower, update it
 
@@ -641,10 +616,10 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 						{
 							if (nodes[o].cost > tmp + 10)
 							{
-								//activelist.erase(activelist.begin()+todel);
-								//alreadyinlist=false;
 								nodes[o].cost = tmp + 10;
-								nodes[o].prev = &nodes[o2];
+								nodes[o].prev = o2;
+								if (alreadyinlist)
+									activelist->make_smaller(o, nodes[o].cost + heuristic(o));
 							}
 						}
 
@@ -655,8 +630,8 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 							if (nodes[o].intens > 1000)
 							{
 								nodes[o].cost = tmp + 10;
-								nodes[o].prev = &nodes[o2];
-								activelist.push_back(&nodes[o]);
+								nodes[o].prev = o2;
+								push_active(o);
 							}
 						}
 					}
@@ -710,7 +685,7 @@ void World::dijkstra(std::vector<Vec3> seeds, Vec3 end, BranchTree* _branchTree)
 	solvingarea = false;
 	firstseedexpanded = false;
 	times = 0;
-	activelist.clear();
+	activelist->clear();
 	activelistlowint.clear();
 	storingtree(children, rootOne);
 	paths.clear();
@@ -736,7 +711,7 @@ void World::paint(std::vector<Vec3> seeds, Vec3 cross,
 
 	std::cout << "Painting path " << pos + 1 << ": x: " << n_x << " y: " << n_y
 			  << " z: " << n_z << std::endl;
-	std::cout << "Activelistsize: " << activelist.size() << std::endl;
+	std::cout << "Activelistsize: " << activelist->size() << std::endl;
 	std::cout << "Seedsleft: " << seedsleft << std::endl;
 	int counter = 0;
 	std::vector<PathElement> newpath;
@@ -774,7 +749,7 @@ void World::paint(std::vector<Vec3> seeds, Vec3 cross,
 			nodes[o3].intens = (float)(4000 - pos);
 			if (!firstseedexpanded)
 				rootOneintens = 4000 - pos;
-			o2 = nodes[o3].prev->offset;
+			o2 = nodes[o3].prev;
 			counter++;
 
 			n_z = o2 / (width * height);
@@ -1229,40 +1204,6 @@ int World::whoistheparent(std::vector<Vec3> seeds, int parentintens)
 	return (parent);
 }
 //----------------------------------------------------------------------------------
-//! Reduce size of activelist by removing every second node
-//----------------------------------------------------------------------------------
-void World::reduceactivelist()
-{
-	typedef std::list<Node*>::iterator li;
-	std::list<Node*> activelistempty;
-	Node* e;
-	unsigned off;
-
-	int par = 0;
-	for (li ia = activelist.begin(); ia != activelist.end(); ++ia)
-	{
-		e = *ia;
-		off = e->offset;
-		if (!(par % 2))
-		{
-			if (nodes[off].intens < 3900)
-			{
-				nodes[off].computed = true;
-				//int z = off / (width * height);
-				//int y = (off - (z * width * height)) / width;
-				//int x = off - (y * width) - (z * width * height);
-				//vOutVol->setVoxel(ml::Vector(x+offx, y+offy, z+offz, 0, 0, 0), 4000);
-			}
-		}
-		else
-		{
-			activelistempty.push_back(&nodes[off]);
-		}
-		par++;
-	}
-	activelist = activelistempty;
-}
-//----------------------------------------------------------------------------------
 //! Reassigns costs to intensities
 //----------------------------------------------------------------------------------
 void World::changeintens(unsigned o)
@@ -1554,15 +1495,18 @@ unsigned World::solvelargearea2()
 	unsigned newoff;
 	unsigned off;
 	Node* e;
-	li ie, todel;
+	li todel;
 	int min = -1;
 
 	if (solvingarea == false)
 	{
 		activelistlowint.clear();
-		for (ie = activelist.begin(); ie != activelist.end(); ++ie)
+		int total = width * height * length;
+		for (int o = 0; o < total; o++)
 		{
-			e = *ie;
+			if (!activelist->in_queue(o))
+				continue;
+			e = &nodes[o];
 			off = e->offset;
 			if (e->intens > 1000 && e->intens <= 1150)
 			{
@@ -1584,7 +1528,7 @@ unsigned World::solvelargearea2()
 			}
 		}
 		solvingarea = true;
-		activelist.clear();
+		activelist->clear();
 
 		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
 
@@ -1619,7 +1563,6 @@ unsigned World::solvelargearea2()
 			}
 		}*/
 		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
-		activelist.clear();
 		activelistlowintsize = activelistlowint.size();
 
 		for (li ii = activelistlowint.begin(); ii != activelistlowint.end();
@@ -1635,7 +1578,10 @@ unsigned World::solvelargearea2()
 		}
 
 		activelistlowint.erase(todel);
-		activelist = activelistlowint;
+		for (li ii = activelistlowint.begin(); ii != activelistlowint.end(); ++ii)
+		{
+			push_active((*ii)->offset);
+		}
 		return (newoff);
 	}
 	else
@@ -1668,19 +1614,7 @@ unsigned World::solvelargearea2()
 		activelistlowint.erase(todel);
 		//std::cout << "Activelistsizelowint: " << activelistlowint.size() << std::endl;
 
-		bool found = false;
-		li p = activelist.begin();
-		while (!found && p != activelist.end())
-		{
-			Node* e = *p;
-			if (e->offset == newoff)
-			{
-				found = true;
-				todel = p;
-			}
-			p++;
-		}
-		activelist.erase(todel);
+		activelist->remove(newoff);
 
 		//std::cout << "Newoff: " << newoff << std::endl;
 		//std::cout << "Largeareatimes: " << largeareatimes << std::endl;
@@ -1756,6 +1690,32 @@ void World::set3dslicehandler(SlicesHandler* handler3D)
 	_handler3D = handler3D;
 }
 
+float World::heuristic(unsigned o) const
+{
+	if (firstseedexpanded)
+		return 0;
+
+	// each step changes the Chebyshev distance to the end point by at most one
+	int z = o / (width * height);
+	int y = (o - (z * width * height)) / width;
+	int x = o - (y * width) - (z * width * height);
+	int steps = std::max(std::abs(x - target[0]),
+			std::max(std::abs(y - target[1]), std::abs(z - target[2])));
+	return steps * minstepcost;
+}
+
+void World::push_active(unsigned o)
+{
+	activelist->insert(o, nodes[o].cost + heuristic(o));
+}
+
+void World::start_search(unsigned o)
+{
+	activelist->clear();
+	nodes[o].cost = 0;
+	push_active(o);
+}
+
 Node::Node(unsigned offset, float intens)
 {
 	this->offset = offset;
@@ -17,9 +17,11 @@
 #include "Data/Vec3.h"
 
 #include "Core/BranchTree.h"
+#include "Core/IndexPriorityQueue.h"
 
 #include <iostream>
 #include <list>
+#include <memory>
 #include <vector>
 
 namespace iseg {
@@ -31,9 +33,9 @@ public:
 	float intens;
 	float cost;
 	float fcost;
+	unsigned prev; // offset of the previous node on the path
 	bool computed;
 	bool first;
-	Node* prev;
 	Node(unsigned offset, float intens);
 	Node() {}
 	~Node();
@@ -54,8 +56,11 @@ public:
 class World
 {
 	Node* nodes;
-	std::list<Node*>
-			activelist; //list with the active nodes (the ones that have been "touched" but not expanded yet)
+	std::unique_ptr<IndexPriorityQueue>
+			activelist; //heap with the active nodes (the ones that have been "touched" but not expanded yet)
+	std::vector<float> priority; // cost + heuristic of the active nodes
+	float minstepcost; // lower bound of the cost of a step, for the A* heuristic
+	int target[3];
 	std::list<Node*> activelistlowint;
 	std::vector<std::vector<PathElement>> paths;
 	int width;
@@ -94,7 +99,6 @@ public:
 	void solvelargearea();
 	unsigned solvelargearea2();
 	void changeintens(unsigned o);
-	void reduceactivelist();
 	int whoistheparent(std::vector<Vec3> seeds, int parentintens);
 	void outputBranchTree(BranchItem* branchItem, std::string prefix,
 			FILE*& fp);
@@ -102,6 +106,11 @@ public:
 	void set3dslicehandler(SlicesHandler* handler3D);
 
 private:
+	/// Admissible estimate of the remaining cost to the end point while the first path is tracked
+	float heuristic(unsigned o) const;
+	void push_active(unsigned o);
+	void start_search(unsigned o);
+
 	SlicesHandler* _handler3D;
 	// start of bounding box
 	Vec3 _bbStart;
@@ -16,6 +16,7 @@
 
 #include "Core/ColorLookupTable.h"
 #include "Core/HDF5Reader.h"
+#include "Core/HDF5SliceCache.h"
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -292,34 +293,25 @@ int _Read(HDF5Reader& reader, size_t NumberOfSlices, size_t Width,
 		if (reader.exists(source_dname))
 		{
 			ScopedTimer timer("Read Source");
-			bool ok = true;
-			size_t offset = 0;
-			for (int k = 0; k < NumberOfSlices; k++, offset += slice_size)
+			if (!reader.read(ImageSlices, NumberOfSlices, slice_size, source_dname))
 			{
-				ok = ok && reader.read(ImageSlices[k], offset, slice_size,
-											 source_dname);
+				ISEG_ERROR_MSG("reading Source slices");
 			}
 		}
 		if (reader.exists(target_dname))
 		{
 			ScopedTimer timer("Read Target");
-			bool ok = true;
-			size_t offset = 0;
-			for (int k = 0; k < NumberOfSlices; k++, offset += slice_size)
+			if (!reader.read(WorkSlices, NumberOfSlices, slice_size, target_dname))
 			{
-				ok = ok && reader.read(WorkSlices[k], offset, slice_size,
-											 target_dname);
+				ISEG_ERROR_MSG("reading Target slices");
 			}
 		}
 		if (reader.exists(tissue_dname))
 		{
 			ScopedTimer timer("Read Tissue");
-			bool ok = true;
-			size_t offset = 0;
-			for (int k = 0; k < NumberOfSlices; k++, offset += slice_size)
+			if (!reader.read(TissueSlices, NumberOfSlices, slice_size, tissue_dname))
 			{
-				ok = ok && reader.read(TissueSlices[k], offset, slice_size,
-											 tissue_dname);
+				ISEG_ERROR_MSG("reading Tissue slices");
 			}
 		}
 	}
@@ -517,6 +509,18 @@ int XdmfImageReader::Read()
 	return r;
 }
 
+bool XdmfImageReader::OpenSliceCache(HDF5SliceCache& cache)
+{
+	QFileInfo fileInfo(QString(this->FileName));
+	const QString fname = fileInfo.absoluteDir().absoluteFilePath(fileInfo.completeBaseName() + ".h5");
+
+	ISEG_INFO("Opening " << fname.toStdString() << " for reading slices on demand");
+	return cache.open(fname.toStdString(), NumberOfSlices, (size_t)Width * (size_t)Height,
+			this->mapArrayNames["Source"].toStdString(),
+			this->mapArrayNames["Target"].toStdString(),
+			this->mapArrayNames["Tissue"].toStdString());
+}
+
 std::shared_ptr<ColorLookupTable> XdmfImageReader::ReadColorLookup() const
 {
 	std::string fname(this->FileName);
@@ -658,6 +662,17 @@ int HDFImageReader::Read()
 	return 1;
 }
 
+bool HDFImageReader::OpenSliceCache(HDF5SliceCache& cache)
+{
+	const QString fname = QFileInfo(QString(this->FileName)).absoluteFilePath();
+
+	ISEG_INFO("Opening " << fname.toStdString() << " for reading slices on demand");
+	return cache.open(fname.toStdString(), NumberOfSlices, (size_t)Width * (size_t)Height,
+			this->mapArrayNames["Source"].toStdString(),
+			this->mapArrayNames["Target"].toStdString(),
+			this->mapArrayNames["Tissue"].toStdString());
+}
+
 std::shared_ptr<ColorLookupTable> HDFImageReader::ReadColorLookup() const
 {
 	ScopedTimer timer("ReadColorLookup");
@@ -23,6 +23,7 @@
 namespace iseg {
 
 class ColorLookupTable;
+class HDF5SliceCache;
 
 class XdmfImageReader
 {
@@ -52,6 +53,8 @@ public:
 	}
 	int ParseXML();
 	int Read();
+	/// Open the image file for reading slices on demand instead of calling Read
+	bool OpenSliceCache(HDF5SliceCache& cache);
 
 	std::shared_ptr<ColorLookupTable> ReadColorLookup() const;
 
@@ -101,6 +104,8 @@ public:
 	};
 	int ParseHDF();
 	int Read();
+	/// Open the image file for reading slices on demand instead of calling Read
+	bool OpenSliceCache(HDF5SliceCache& cache);
 
 	std::shared_ptr<ColorLookupTable> ReadColorLookup() const;
 
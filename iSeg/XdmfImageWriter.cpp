@@ -15,6 +15,7 @@
 
 #include "Core/ColorLookupTable.h"
 #include "Core/HDF5Writer.h"
+#include "Core/VolumeStorage.h"
 
 #include <QDir>
 #include <QDomDocument>
@@ -29,6 +30,7 @@
 
 #include <boost/format.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 
@@ -175,111 +177,57 @@ int XdmfImageWriter::InternalWrite(const char* filename, float** slicesbmp,
 	}
 	writer.compression = compression;
 
-	// The slices are not contiguous in memory so we need to copy.
-	if (this->CopyToContiguousMemory)
-	{
-		// Source
-		std::vector<float> bufferFloat;
-		try
-		{
-			// vector throws a length_error if resized above max_size
-			ISEG_INFO("N = " << N << ", bufferFloat.max_size() = " << bufferFloat.max_size());
-			bufferFloat.resize(N);
-		}
-		catch (std::exception& le)
-		{
-			ISEG_ERROR_MSG(le.what());
-			return 0;
-		}
+	const size_t slice_size = (size_t)width * (size_t)height;
+	const bool slices_contiguous =
+			VolumeStorage::is_contiguous(slicesbmp, nrslices, slice_size) &&
+			VolumeStorage::is_contiguous(sliceswork, nrslices, slice_size) &&
+			VolumeStorage::is_contiguous(slicestissue, nrslices, slice_size);
 
-		size_t n = 0;
-		for (unsigned k = 0; k < nrslices; k++)
-		{
-			size_t pos = 0;
-			for (unsigned j = 0; j < height; j++)
-			{
-				for (unsigned i = 0; i < width; i++, pos++)
-				{
-					bufferFloat[n] = slicesbmp[k][pos];
-					n++;
-				}
-			}
-		}
+	// The slices are already contiguous in memory (e.g. bound to a VolumeStorage), write without copying.
+	if (this->CopyToContiguousMemory && slices_contiguous)
+	{
+		std::vector<HDF5Writer::size_type> dims_flat(1, N);
 
-		if (!writer.write(bufferFloat, "Source"))
+		ScopedTimer timer("Write Source");
+		timer.set_bytes(N * sizeof(float));
+		if (!writer.write(slicesbmp[0], dims_flat, "Source"))
 		{
 			ISEG_ERROR_MSG("writing Source");
 		}
-
-		// Target
-		n = 0;
-		for (unsigned k = 0; k < nrslices; k++)
-		{
-			size_t pos = 0;
-			for (unsigned j = 0; j < height; j++)
-			{
-				for (unsigned i = 0; i < width; i++, pos++)
-				{
-					bufferFloat[n] = sliceswork[k][pos];
-					n++;
-				}
-			}
-		}
-
-		if (!writer.write(bufferFloat, "Target"))
+		timer.new_scope("Write Target");
+		timer.set_bytes(N * sizeof(float));
+		if (!writer.write(sliceswork[0], dims_flat, "Target"))
 		{
 			ISEG_ERROR_MSG("writing Target");
 		}
-
-		bufferFloat.clear();
-
-		// Tissue
-		std::vector<tissues_size_t> bufferTissuesSizeT;
-		try
-		{
-			// vector throws a length_error if resized above max_size
-			ISEG_INFO("N = " << N << ", bufferTissuesSizeT.max_size() = " << bufferTissuesSizeT.max_size());
-			bufferTissuesSizeT.resize(N);
-		}
-		catch (std::exception& le)
-		{
-			ISEG_ERROR_MSG(le.what());
-			return 0;
-		}
-
-		n = 0;
-		for (unsigned k = 0; k < nrslices; k++)
-		{
-			size_t pos = 0;
-			for (unsigned j = 0; j < height; j++)
-			{
-				for (unsigned i = 0; i < width; i++, pos++)
-				{
-					bufferTissuesSizeT[n] = slicestissue[k][pos];
-					n++;
-				}
-			}
-		}
-
-		if (!writer.write(bufferTissuesSizeT, "Tissue"))
+		timer.new_scope("Write Tissue");
+		timer.set_bytes(N * sizeof(tissues_size_t));
+		if (!writer.write(slicestissue[0], dims_flat, "Tissue"))
 		{
 			ISEG_ERROR_MSG("writing Tissue");
 		}
 	}
-	else // write slice-by-slice
+	else // write chunks of several slices, compressed in parallel
 	{
+		// chunks of up to 16 slices, but at most 4MB
+		size_t const max_chunk_bytes = size_t(4) << 20;
+		size_t const slices_per_chunk = std::max<size_t>(1, std::min<size_t>(16, max_chunk_bytes / (slice_size * sizeof(float))));
+
 		ScopedTimer timer("Write Source");
-		if (!writer.write(slicesbmp, nrslices, dims[0] * dims[1], "Source"))
+		timer.set_bytes(N * sizeof(float));
+		if (!writer.writeVolume(slicesbmp, nrslices, slice_size, "Source", slices_per_chunk))
 		{
 			ISEG_ERROR_MSG("writing Source");
 		}
 		timer.new_scope("Write Target");
-		if (!writer.write(sliceswork, nrslices, dims[0] * dims[1], "Target"))
+		timer.set_bytes(N * sizeof(float));
+		if (!writer.writeVolume(sliceswork, nrslices, slice_size, "Target", slices_per_chunk))
 		{
 			ISEG_ERROR_MSG("writing Target");
 		}
 		timer.new_scope("Write Tissue");
-		if (!writer.write(slicestissue, nrslices, dims[0] * dims[1], "Tissue"))
+		timer.set_bytes(N * sizeof(tissues_size_t));
+		if (!writer.writeVolume(slicestissue, nrslices, slice_size, "Tissue", slices_per_chunk))
 		{
 			ISEG_ERROR_MSG("writing Tissue");
 		}
@@ -14,12 +14,16 @@
 
 #include "Data/addLine.h"
 
+#include "Core/ComponentLabeling.h"
+#include "Core/DistanceTransform.h"
 #include "Core/ExpectationMaximization.h"
 #include "Core/ImageForestingTransform.h"
 #include "Core/ImageReader.h"
 #include "Core/KMeans.h"
 #include "Core/MultidimensionalGamma.h"
+#include "Core/SeparableFilter.h"
 #include "Core/SliceProvider.h"
+#include "Core/VolumeStorage.h"
 
 #define cimg_display 0
 #include "AvwReader.h"
@@ -37,6 +41,7 @@
 #include <qimage.h>
 #include <qmessagebox.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <cmath>
@@ -105,6 +110,13 @@ typedef struct /**** Bitmap information structure ****/
 } BITMAPINFO;
 #endif /* !WIN32 */
 
+// tissue slices bound to a VolumeStorage are owned by the slab
+inline void release_tissues(tissues_size_t* tissues)
+{
+	if (!VolumeStorage::owns(tissues))
+		free(tissues);
+}
+
 template<typename T>
 inline void swap_maps(T const*& Tp1, T const*& Tp2)
 {
@@ -160,7 +172,7 @@ bmphandler::~bmphandler()
 		sliceprovide->take_back(help_bits);
 		for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 		{
-			free(tissuelayers[idx]);
+			release_tissues(tissuelayers[idx]);
 		}
 		tissuelayers.clear();
 		//		if(ownsliceprovider)
@@ -242,8 +254,17 @@ void bmphandler::set_bmp(float* bits, unsigned char mode)
 	{
 		if (bmp_bits != bits)
 		{
-			sliceprovide->take_back(bmp_bits);
-			bmp_bits = bits;
+			if (VolumeStorage::owns(bmp_bits))
+			{
+				// keep slice a view into the volume storage
+				std::copy(bits, bits + area, bmp_bits);
+				sliceprovide->take_back(bits);
+			}
+			else
+			{
+				sliceprovide->take_back(bmp_bits);
+				bmp_bits = bits;
+			}
 			mode1 = mode;
 		}
 	}
@@ -254,8 +275,16 @@ void bmphandler::set_work(float* bits, unsigned char mode)
 	{
 		if (work_bits != bits)
 		{
-			sliceprovide->take_back(work_bits);
-			work_bits = bits;
+			if (VolumeStorage::owns(work_bits))
+			{
+				std::copy(bits, bits + area, work_bits);
+				sliceprovide->take_back(bits);
+			}
+			else
+			{
+				sliceprovide->take_back(work_bits);
+				work_bits = bits;
+			}
 			mode2 = mode;
 		}
 	}
@@ -267,8 +296,73 @@ void bmphandler::set_tissue(tissuelayers_size_t idx, tissues_size_t* bits)
 	{
 		if (tissuelayers[idx] != bits)
 		{
-			free(tissuelayers[idx]);
-			tissuelayers[idx] = bits;
+			if (VolumeStorage::owns(tissuelayers[idx]))
+			{
+				std::copy(bits, bits + area, tissuelayers[idx]);
+				release_tissues(bits);
+			}
+			else
+			{
+				release_tissues(tissuelayers[idx]);
+				tissuelayers[idx] = bits;
+			}
+		}
+	}
+}
+
+void bmphandler::bind_storage(float* bmp, float* work, tissues_size_t* tissues, bool copy)
+{
+	if (!loaded)
+		return;
+
+	if (bmp && bmp != bmp_bits)
+	{
+		if (copy)
+			std::copy(bmp_bits, bmp_bits + area, bmp);
+		sliceprovide->take_back(bmp_bits);
+		bmp_bits = bmp;
+	}
+	if (work && work != work_bits)
+	{
+		if (copy)
+			std::copy(work_bits, work_bits + area, work);
+		sliceprovide->take_back(work_bits);
+		work_bits = work;
+	}
+	if (tissues && !tissuelayers.empty() && tissues != tissuelayers[0])
+	{
+		if (copy)
+			std::copy(tissuelayers[0], tissuelayers[0] + area, tissues);
+		release_tissues(tissuelayers[0]);
+		tissuelayers[0] = tissues;
+	}
+}
+
+void bmphandler::unbind_storage(const VolumeStorage* storage)
+{
+	if (!loaded)
+		return;
+
+	auto bound = [storage](const void* p) {
+		return storage ? storage->contains(p) : VolumeStorage::owns(p);
+	};
+
+	for (float** bits : {&bmp_bits, &work_bits, &help_bits})
+	{
+		if (bound(*bits))
+		{
+			float* copy = sliceprovide->give_me();
+			std::copy(*bits, *bits + area, copy);
+			*bits = copy;
+		}
+	}
+	for (auto& tissues : tissuelayers)
+	{
+		if (bound(tissues))
+		{
+			auto copy = (tissues_size_t*)malloc(sizeof(tissues_size_t) * area);
+			std::copy(tissues, tissues + area, copy);
+			tissues = copy;
 		}
 	}
 }
@@ -565,7 +659,7 @@ void bmphandler::newbmp(unsigned short width1, unsigned short height1, bool init
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -624,7 +718,7 @@ void bmphandler::newbmp(unsigned short width1, unsigned short height1,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -666,7 +760,7 @@ void bmphandler::freebmp()
 		sliceprovide->take_back(help_bits);
 		for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 		{
-			free(tissuelayers[idx]);
+			release_tissues(tissuelayers[idx]);
 		}
 		tissuelayers.clear();
 		sliceprovide_installer->uninstall(sliceprovide);
@@ -811,7 +905,7 @@ int bmphandler::LoadDIBitmap(const char* filename) /* I - File to load */
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -1055,7 +1149,7 @@ int bmphandler::LoadDIBitmap(const char* filename, Point p, unsigned short dx,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -1154,7 +1248,7 @@ int bmphandler::LoadDIBitmap(const char* filename, Point p, unsigned short dx,
 		sliceprovide->take_back(help_bits);
 		for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 		{
-			free(tissuelayers[idx]);
+			release_tissues(tissuelayers[idx]);
 		}
 		tissuelayers.clear();
 		free(bits_tmp);
@@ -1172,7 +1266,7 @@ int bmphandler::LoadDIBitmap(const char* filename, Point p, unsigned short dx,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			free(bits_tmp);
@@ -1195,7 +1289,7 @@ int bmphandler::LoadDIBitmap(const char* filename, Point p, unsigned short dx,
 				for (tissuelayers_size_t idx = 0; idx < tissuelayers.size();
 						 ++idx)
 				{
-					free(tissuelayers[idx]);
+					release_tissues(tissuelayers[idx]);
 				}
 				tissuelayers.clear();
 				free(bits_tmp);
@@ -1607,7 +1701,7 @@ int bmphandler::LoadPNGBitmap(const char* filename)
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -1734,7 +1828,7 @@ bool bmphandler::LoadArray(float* bits, unsigned short w1, unsigned short h1)
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -1851,7 +1945,7 @@ bool bmphandler::LoadArray(float* bits, unsigned short w, unsigned short h,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -2005,7 +2099,7 @@ bool bmphandler::LoadDICOM(const char* filename)
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -2143,7 +2237,7 @@ bool bmphandler::LoadDICOM(const char* filename, Point p, unsigned short dx,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -3127,7 +3221,7 @@ int bmphandler::ReadAvw(const char* filename, short unsigned slicenr)
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -3270,7 +3364,7 @@ int bmphandler::ReadRaw(const char* filename, short unsigned w,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -3515,7 +3609,7 @@ int bmphandler::ReadRaw(const char* filename, short unsigned w,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -3764,7 +3858,7 @@ int bmphandler::ReadRawFloat(const char* filename, short unsigned w,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -3902,7 +3996,7 @@ int bmphandler::ReadRawFloat(const char* filename, short unsigned w,
 			sliceprovide->take_back(help_bits);
 			for (tissuelayers_size_t idx = 0; idx < tissuelayers.size(); ++idx)
 			{
-				free(tissuelayers[idx]);
+				release_tissues(tissuelayers[idx]);
 			}
 			tissuelayers.clear();
 			sliceprovide_installer->uninstall(sliceprovide);
@@ -5060,6 +5154,14 @@ float* bmphandler::make_laplacianfilter()
 	return filter;
 }
 
+void bmphandler::convolute_separable(const float* kernel, unsigned n)
+{
+	float* tmp = sliceprovide->give_me();
+	SeparableFilter::ConvolveRows(bmp_bits, tmp, width, height, kernel, n, SeparableFilter::kReplicate);
+	SeparableFilter::ConvolveColumns(tmp, work_bits, width, height, kernel, n, SeparableFilter::kReplicate);
+	sliceprovide->take_back(tmp);
+}
+
 void bmphandler::convolute(float* mask, unsigned short direction)
 {
 	unsigned i, n;
@@ -5067,56 +5169,10 @@ void bmphandler::convolute(float* mask, unsigned short direction)
 	switch (direction)
 	{
 	case 0:
-		n = (unsigned)mask[0];
-		i = 0;
-		for (unsigned j = 0; j < height; j++)
-		{
-			for (unsigned k = 0; k <= width - n; k++)
-			{
-				dummy = 0;
-				for (unsigned l = 0; l < n; l++)
-					dummy += mask[l + 1] * bmp_bits[i + l];
-				work_bits[i + n / 2] = dummy;
-				i++;
-			}
-			i += n - 1;
-		}
-
-		i = 0;
-		for (unsigned j = 0; j < n / 2; j++)
-		{
-			work_bits[i] = 0;
-			i++;
-		}
-		i += width - n + 1;
-		for (unsigned k = 0; k + 1 < height; k++)
-		{
-			for (unsigned j = 0; j < n - 1; j++)
-			{
-				work_bits[i] = 0;
-				i++;
-			}
-			i += width - n + 1;
-		}
-		for (; i < area; i++)
-			work_bits[i] = 0;
+		SeparableFilter::ConvolveRows(bmp_bits, work_bits, width, height, mask + 1, (unsigned)mask[0], SeparableFilter::kClearBorder);
 		break;
 	case 1:
-		n = (unsigned)mask[0];
-		i = 0;
-		for (unsigned j = 0; j < width * (height - n + 1); j++)
-		{
-			dummy = 0;
-			for (unsigned l = 0; l < n; l++)
-				dummy += mask[l + 1] * bmp_bits[i + l * width];
-			work_bits[i + (n / 2) * width] = dummy;
-			i++;
-		}
-
-		for (i = 0; i < (n / 2) * width; i++)
-			work_bits[i] = 0;
-		for (i = area - (n / 2) * width; i < area; i++)
-			work_bits[i] = 0;
+		SeparableFilter::ConvolveColumns(bmp_bits, work_bits, width, height, mask + 1, (unsigned)mask[0], SeparableFilter::kClearBorder);
 		break;
 	case 2:
 		n = (unsigned)mask[0];
@@ -5261,24 +5317,25 @@ void bmphandler::crop_colors()
 
 void bmphandler::gaussian(float sigma)
 {
+	// beyond this kernel size the recursive filter is faster
+	int const kMaxGaussTaps = 15;
+
 	unsigned char dummymode1 = mode1;
 	if (sigma > 0.66f)
 	{
 		int n = int(3 * sigma);
 		if (n % 2 == 0)
 			n++;
-		float* dummy;
-		float* dummy1;
-		convolute(dummy = make_gaussfilter(sigma, n), 0);
-
-		dummy1 = bmp_bits;
-		bmp_bits = sliceprovide->give_me();
-		swap_bmpwork();
-		convolute(dummy, 1);
-		sliceprovide->take_back(bmp_bits);
-		bmp_bits = dummy1;
-
-		free(dummy);
+		if (n > kMaxGaussTaps)
+		{
+			SeparableFilter::RecursiveGaussian(bmp_bits, work_bits, width, height, sigma);
+		}
+		else
+		{
+			float* filter = make_gaussfilter(sigma, n);
+			convolute_separable(filter + 1, n);
+			free(filter);
+		}
 	}
 	else
 	{
@@ -5292,7 +5349,6 @@ void bmphandler::gaussian(float sigma)
 void bmphandler::average(unsigned short n)
 {
 	unsigned char dummymode1 = mode1;
-	float* dummy1;
 
 	if (n % 2 == 0)
 		n++;
@@ -5302,13 +5358,7 @@ void bmphandler::average(unsigned short n)
 	for (short unsigned int i = 1; i <= n; i++)
 		filter[i] = 1.0f / n;
 
-	convolute(filter, 0);
-	dummy1 = bmp_bits;
-	bmp_bits = sliceprovide->give_me();
-	swap_bmpwork();
-	convolute(filter, 1);
-	sliceprovide->take_back(bmp_bits);
-	bmp_bits = dummy1;
+	convolute_separable(filter + 1, n);
 
 	free(filter);
 
@@ -7706,171 +7756,25 @@ void bmphandler::plot_line() // very temporary solution...
 
 void bmphandler::connected_components(bool connectivity)
 {
-	unsigned char dummymode = mode1;
-
-	float* temp = (float*)malloc(sizeof(float) * (area + width + height + 1));
-	std::vector<float> maps;
-	float newest = 0.1f;
-
-	for (unsigned i = 0; i < area; i++)
-		temp[i + i / width + width + 2] = bmp_bits[i];
-	for (unsigned i = width + 1; i <= area + height; i += width + 1)
-		temp[i] = -1e10f;
-	for (unsigned i = 0; i <= width; i++)
-		temp[i] = -2e10f;
-
-	unsigned i1 = width + 2;
-	unsigned i2 = 0;
-
-	for (short j = 0; j < height; j++)
-	{
-		for (short k = 0; k < width; k++)
-		{
-			if (temp[i1] == temp[i1 - 1])
-			{
-				work_bits[i2] = base_connection(work_bits[i2 - 1], &maps);
-				if (temp[i1] == temp[i1 - width - 1])
-				{
-					maps[(int)base_connection(work_bits[i2 - width], &maps)] =
-							work_bits[i2];
-				}
-			}
-			else
-			{
-				if (temp[i1] == temp[i1 - width - 1])
-					work_bits[i2] =
-							base_connection(work_bits[i2 - width], &maps);
-				else if (connectivity && temp[i1] == temp[i1 - width - 2])
-					work_bits[i2] =
-							base_connection(work_bits[i2 - width - 1], &maps);
-				else
-				{
-					maps.push_back(newest);
-					work_bits[i2] = newest;
-					newest++;
-				}
-			}
-
-			if (connectivity && temp[i1 - 1] == temp[i1 - width - 1])
-				maps[(int)base_connection(work_bits[i2 - 1], &maps)] =
-						base_connection(work_bits[i2 - width], &maps);
-
-			i1++;
-			i2++;
-		}
-		i1++;
-	}
-
-	for (unsigned i = 0; i < area; i++)
-		work_bits[i] = base_connection(work_bits[i], &maps);
-
-	newest = 0.0f;
-	for (i1 = 0; i1 < (unsigned)maps.size(); i1++)
-		if ((unsigned)maps[i1] == i1)
-		{
-			maps[i1] = newest;
-			newest++;
-		}
-
-	for (unsigned i = 0; i < area; i++)
-		work_bits[i] = maps[(int)work_bits[i]];
-
-	free(temp);
-
-	mode1 = dummymode;
-	mode2 = 2;
-
-	return;
+	std::set<float> components;
+	connected_components(connectivity, components);
 }
 
 void bmphandler::connected_components(bool connectivity, std::set<float>& components)
 {
 	unsigned char dummymode = mode1;
 
-	float* temp = (float*)malloc(sizeof(float) * (area + width + height + 1));
-	std::vector<float> maps;
-	float newest = 0.1f;
-
-	for (unsigned i = 0; i < area; i++)
-		temp[i + i / width + width + 2] = bmp_bits[i];
-	for (unsigned i = width + 1; i <= area + height; i += width + 1)
-		temp[i] = -1e10f;
-	for (unsigned i = 0; i <= width; i++)
-		temp[i] = -2e10f;
-
-	unsigned i1 = width + 2;
-	unsigned i2 = 0;
-
-	for (short j = 0; j < height; j++)
-	{
-		for (short k = 0; k < width; k++)
-		{
-			if (temp[i1] == temp[i1 - 1])
-			{
-				work_bits[i2] = base_connection(work_bits[i2 - 1], &maps);
-				if (temp[i1] == temp[i1 - width - 1])
-				{
-					maps[(int)base_connection(work_bits[i2 - width], &maps)] =
-							work_bits[i2];
-				}
-			}
-			else
-			{
-				if (temp[i1] == temp[i1 - width - 1])
-					work_bits[i2] =
-							base_connection(work_bits[i2 - width], &maps);
-				else if (connectivity && temp[i1] == temp[i1 - width - 2])
-					work_bits[i2] =
-							base_connection(work_bits[i2 - width - 1], &maps);
-				else
-				{
-					maps.push_back(newest);
-					work_bits[i2] = newest;
-					newest++;
-				}
-			}
-
-			if (connectivity && temp[i1 - 1] == temp[i1 - width - 1])
-				maps[(int)base_connection(work_bits[i2 - 1], &maps)] =
-						base_connection(work_bits[i2 - width], &maps);
-
-			i1++;
-			i2++;
-		}
-		i1++;
-	}
-
-	for (unsigned i = 0; i < area; i++)
-		work_bits[i] = base_connection(work_bits[i], &maps);
-
-	newest = 0.0f;
-	for (i1 = 0; i1 < (unsigned)maps.size(); i1++)
-		if ((unsigned)maps[i1] == i1)
-		{
-			maps[i1] = newest;
-			newest++;
-		}
-
-	for (unsigned i = 0; i < area; i++)
+	ComponentLabeling labeling(bmp_bits, width, height, connectivity ? ComponentLabeling::kEdges : ComponentLabeling::kFaces, [](float v) { return v; });
+	labeling.write_slice(0, work_bits, [](unsigned label) { return float(label); });
+	for (unsigned label = 0; label < labeling.number_of_components(); label++)
 	{
-		work_bits[i] = maps[(int)work_bits[i]];
-		components.insert(work_bits[i]);
+		components.insert(float(label));
 	}
 
-	free(temp);
-
 	mode1 = dummymode;
 	mode2 = 2;
 }
 
-float bmphandler::base_connection(float c, std::vector<float>* maps)
-{
-	if (c == (*maps)[(int)c])
-		return c;
-	else
-		return (*maps)[(int)c] = base_connection((*maps)[(int)c], maps);
-}
-
 void bmphandler::fill_gaps(short unsigned n, bool connectivity)
 {
 	unsigned char dummymode1 = mode1;
@@ -9977,605 +9881,128 @@ void bmphandler::distance_map(bool connectivity, float f,
 	return;
 }
 
-unsigned* bmphandler::dead_reckoning(float f)
+void bmphandler::contour_features(float f)
 {
-	unsigned char dummymode = mode1;
-	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
-
-	for (unsigned i = 0; i < area; i++)
-	{
-		work_bits[i] = float((width + height) * (width + height));
-		P[i] = area;
-	}
-
 	std::vector<std::vector<Point>> vo, vi;
-	std::vector<unsigned>::iterator vuit;
-	std::vector<Point>::iterator vpit;
 
 	swap_bmpwork();
 	get_contours(f, &vo, &vi, 0);
 	swap_bmpwork();
 
-	for (unsigned i = 0; i < (unsigned)vo.size(); i++)
+	std::fill(work_bits, work_bits + area, DistanceTransform::kInfinity);
+	for (auto const* contours : {&vo, &vi})
 	{
-		for (vpit = vo[i].begin(); vpit != vo[i].end(); vpit++)
+		for (auto const& line : *contours)
 		{
-			work_bits[pt2coord(*vpit)] = 0;
-			P[pt2coord(*vpit)] = pt2coord(*vpit);
+			for (auto const& p : line)
+			{
+				work_bits[pt2coord(p)] = 0;
+			}
 		}
-		//		cout << ";"<<vo[i].size();
 	}
-	for (unsigned i = 0; i < (unsigned)vi.size(); i++)
+}
+
+void bmphandler::feature_distance(unsigned* nearest, bool squared)
+{
+	DistanceTransform::SquaredDistance2D(work_bits, width, height, 1.f, 1.f, nearest);
+
+	// pixels without any feature get a distance larger than the slice
+	float const far_away = float((width + height) * (width + height));
+	for (unsigned i = 0; i < area; i++)
 	{
-		for (vpit = vi[i].begin(); vpit != vi[i].end(); vpit++)
-		{
-			work_bits[pt2coord(*vpit)] = 0;
-			P[pt2coord(*vpit)] = pt2coord(*vpit);
-		}
-		//		cout << "."<<vi[i].size();
+		if (!(work_bits[i] < DistanceTransform::kInfinity))
+			work_bits[i] = far_away;
+		else if (!squared)
+			work_bits[i] = std::sqrt(work_bits[i]);
 	}
+}
 
-	unsigned j = 0;
+unsigned* bmphandler::dead_reckoning(float f)
+{
+	unsigned char dummymode = mode1;
+	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
 
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
+	contour_features(f);
+	feature_distance(P, false);
 
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
+	for (unsigned i = 0; i < area; i++)
+		if (bmp_bits[i] != f)
+			work_bits[i] = -work_bits[i];
 
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
+	mode1 = dummymode;
+	mode2 = 1;
 
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
+	return P;
+}
 
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
+void bmphandler::dead_reckoning()
+{
+	unsigned char dummymode = mode1;
 
-			j++;
+	// features are the pixels with a 4-neighbor of different value
+	std::fill(work_bits, work_bits + area, DistanceTransform::kInfinity);
+	unsigned i1 = 0;
+	for (unsigned short h = 0; h < height; h++)
+	{
+		for (unsigned short w = 0; w < width; w++)
+		{
+			if (h + 1 < height && bmp_bits[i1] != bmp_bits[i1 + width])
+				work_bits[i1] = work_bits[i1 + width] = 0;
+			if (w + 1 < width && bmp_bits[i1] != bmp_bits[i1 + 1])
+				work_bits[i1] = work_bits[i1 + 1] = 0;
+			i1++;
 		}
 	}
 
-	j = area - 1;
+	feature_distance(nullptr, false);
 
-	for (int k = height - 1; k >= 0; k--)
-	{
-		for (int l = width - 1; l >= 0; l--)
-		{
-			if ((l + 1) != width && work_bits[j + 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j + 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
+	mode1 = dummymode;
+	mode2 = 1;
+}
 
-			if ((k + 1) != height)
-			{
-				if (l > 0 && work_bits[j - 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
+unsigned* bmphandler::dead_reckoning_squared(float f)
+{
+	unsigned char dummymode = mode1;
+	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
 
-				if (work_bits[j + width] + d1 < work_bits[j])
-				{
-					P[j] = P[j + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			j--;
-		}
-	}
-
-	j = 0;
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
+	contour_features(f);
+	feature_distance(P, true);
 
 	for (unsigned i = 0; i < area; i++)
 		if (bmp_bits[i] != f)
 			work_bits[i] = -work_bits[i];
 
-	/*	for(unsigned i=0;i<(unsigned)vo.size();i++)
-		for(vpit=vo[i].begin();vpit!=vo[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}
-	for(unsigned i=0;i<(unsigned)vi.size();i++)
-		for(vpit=vi[i].begin();vpit!=vi[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}*/
-
 	mode1 = dummymode;
 	mode2 = 1;
 
 	return P;
 }
 
-void bmphandler::dead_reckoning()
+void bmphandler::IFT_distance1(float f)
 {
 	unsigned char dummymode = mode1;
-	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
-
-	for (unsigned i = 0; i < area; i++)
-	{
-		work_bits[i] = float((width + height) * (width + height));
-		P[i] = area;
-	}
 
+	// features are the pixels of value f with a 4-neighbor of different value
+	std::fill(work_bits, work_bits + area, DistanceTransform::kInfinity);
 	unsigned i1 = 0;
-	for (unsigned short h = 0; h < height - 1; h++)
-	{
-		for (unsigned short w = 0; w < width; w++)
-		{
-			if (bmp_bits[i1] != bmp_bits[i1 + width])
-			{
-				work_bits[i1] = work_bits[i1 + width] = 0;
-				P[i1] = i1;
-				P[i1 + width] = i1 + width;
-			}
-			i1++;
-		}
-	}
-
-	i1 = 0;
 	for (unsigned short h = 0; h < height; h++)
 	{
-		for (unsigned short w = 0; w < width - 1; w++)
+		for (unsigned short w = 0; w < width; w++)
 		{
-			if (bmp_bits[i1] != bmp_bits[i1 + 1])
-			{
-				work_bits[i1] = work_bits[i1 + 1] = 0;
-				P[i1] = i1;
-				P[i1 + 1] = i1 + 1;
-			}
+			if (h + 1 < height && (bmp_bits[i1] == f) != (bmp_bits[i1 + width] == f))
+				work_bits[bmp_bits[i1] == f ? i1 : i1 + width] = 0;
+			if (w + 1 < width && (bmp_bits[i1] == f) != (bmp_bits[i1 + 1] == f))
+				work_bits[bmp_bits[i1] == f ? i1 : i1 + 1] = 0;
 			i1++;
 		}
-		i1++;
-	}
-
-	unsigned j = 0;
-
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
-
-	j = area - 1;
-
-	for (int k = height - 1; k >= 0; k--)
-	{
-		for (int l = width - 1; l >= 0; l--)
-		{
-			if ((l + 1) != width && work_bits[j + 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j + 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			if ((k + 1) != height)
-			{
-				if (l > 0 && work_bits[j - 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j + width] + d1 < work_bits[j])
-				{
-					P[j] = P[j + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 + width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			j--;
-		}
-	}
-
-	j = 0;
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-												 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] =
-						sqrt(float((l - P[j] % width) * (l - P[j] % width) +
-											 (k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
 	}
 
-	//	for(unsigned i=0;i<area;i++)
-	//		if(bmp_bits[i]==0) work_bits[i]=-work_bits[i];
-
-	mode1 = dummymode;
-	mode2 = 1;
-
-	free(P);
-	return;
-}
-
-unsigned* bmphandler::dead_reckoning_squared(float f)
-{
-	unsigned char dummymode = mode1;
-	unsigned* P = (unsigned*)malloc(area * sizeof(unsigned));
+	feature_distance(nullptr, false);
 
 	for (unsigned i = 0; i < area; i++)
 	{
-		work_bits[i] = float((width + height) * (width + height));
-		P[i] = area;
-	}
-
-	std::vector<std::vector<Point>> vo, vi;
-	std::vector<Point>::iterator vpit;
-
-	swap_bmpwork();
-	get_contours(f, &vo, &vi, 0);
-	swap_bmpwork();
-
-	for (unsigned i = 0; i < (unsigned)vo.size(); i++)
-	{
-		for (vpit = vo[i].begin(); vpit != vo[i].end(); vpit++)
-		{
-			work_bits[pt2coord(*vpit)] = 0;
-			P[pt2coord(*vpit)] = pt2coord(*vpit);
-		}
-	}
-	for (unsigned i = 0; i < (unsigned)vi.size(); i++)
-	{
-		for (vpit = vi[i].begin(); vpit != vi[i].end(); vpit++)
-		{
-			work_bits[pt2coord(*vpit)] = 0;
-			P[pt2coord(*vpit)] = pt2coord(*vpit);
-		}
-	}
-
-	unsigned j = 0;
-
-	float d1 = 1;
-	float d2 = sqrt(2.0f);
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] = (float((l - P[j] % width) * (l - P[j] % width) +
-															(k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
-
-	j = area - 1;
-
-	for (int k = height - 1; k >= 0; k--)
-	{
-		for (int l = width - 1; l >= 0; l--)
-		{
-			if ((l + 1) != width && work_bits[j + 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j + 1];
-				work_bits[j] = (float((l - P[j] % width) * (l - P[j] % width) +
-															(k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			if ((k + 1) != height)
-			{
-				if (l > 0 && work_bits[j - 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 + width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j + width] + d1 < work_bits[j])
-				{
-					P[j] = P[j + width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 + width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 + width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			j--;
-		}
-	}
-
-	j = 0;
-
-	for (unsigned short k = 0; k < height; k++)
-	{
-		for (unsigned short l = 0; l < width; l++)
-		{
-			if (k > 0)
-			{
-				if (l > 0 && work_bits[j - 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j - 1 - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if (work_bits[j - width] + d1 < work_bits[j])
-				{
-					P[j] = P[j - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-
-				if ((l + 1) != width &&
-						work_bits[j + 1 - width] + d2 < work_bits[j])
-				{
-					P[j] = P[j + 1 - width];
-					work_bits[j] =
-							(float((l - P[j] % width) * (l - P[j] % width) +
-										 (k - P[j] / width) * (k - P[j] / width)));
-				}
-			}
-
-			if (l > 0 && work_bits[j - 1] + d1 < work_bits[j])
-			{
-				P[j] = P[j - 1];
-				work_bits[j] = (float((l - P[j] % width) * (l - P[j] % width) +
-															(k - P[j] / width) * (k - P[j] / width)));
-			}
-
-			j++;
-		}
-	}
-
-	for (unsigned i = 0; i < area; i++)
 		if (bmp_bits[i] != f)
 			work_bits[i] = -work_bits[i];
-
-	/*	for(unsigned i=0;i<(unsigned)vo.size();i++)
-		for(vpit=vo[i].begin();vpit!=vo[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}
-	for(unsigned i=0;i<(unsigned)vi.size();i++)
-		for(vpit=vi[i].begin();vpit!=vi[i].end();vpit++) {
-			work_bits[pt2coord(*vpit)]=255;
-			P[pt2coord(*vpit)]=pt2coord(*vpit);
-		}*/
-
-	mode1 = dummymode;
-	mode2 = 1;
-
-	return P;
-}
-
-void bmphandler::IFT_distance1(float f)
-{
-	unsigned char dummymode = mode1;
-	ImageForestingTransformDistance IFTdist;
-	IFTdist.distance_init(width, height, f, bmp_bits);
-	float* f1 = IFTdist.return_pf();
-	for (unsigned i = 0; i < area; i++)
-	{
-		if (bmp_bits[i] == f)
-			work_bits[i] = f1[i];
-		else
-			work_bits[i] = -f1[i];
 	}
 	mode1 = dummymode;
 	mode2 = 1;
@@ -10803,117 +10230,210 @@ void bmphandler::fill_contour(std::vector<Point>* vp, bool continuous)
 	return;
 }
 
-void bmphandler::add_skin(unsigned i4, float setto)
+namespace {
+/// Calls set(v) for the pixels within 'radius' pixels of a pixel with is_feature(v), except the features
+template<typename T, typename TFeature, typename TSet>
+void add_skin_2d(T* data, unsigned short width, unsigned short height, unsigned radius, TFeature is_feature, TSet set)
 {
-	unsigned i = 0, pos, y, x, j;
-
-	//Create a binary std::vector noTissue/Tissue
-	std::vector<int> s;
-	for (int j = 0; j < height; j++)
+	unsigned const area = unsigned(width) * height;
+	std::vector<float> dist(area);
+	for (unsigned i = 0; i < area; i++)
 	{
-		for (int k = 0; k < width; k++)
-		{
-			if (work_bits[i] == 0)
-				s.push_back(-1);
-			else
-				s.push_back(0);
-			i++;
-		}
+		dist[i] = is_feature(data[i]) ? 0.f : DistanceTransform::kInfinity;
 	}
+	DistanceTransform::SquaredDistance2D(dist.data(), width, height);
 
-	// i4 itetations through  y, -y, x, -x converting, each time a tissue beginning is find, one tissue pixel into skin
-	//!! It is assumed that ix and iy are the same
-	bool convertSkin = true;
-	for (i = 1; i < i4 + 1; i++)
+	float const max_d2 = float(radius) * radius;
+	for (unsigned i = 0; i < area; i++)
 	{
-		for (y = 0; y < height; y++)
-		{
-			pos = y * width;
-			while (pos < (y + 1) * width)
-			{
-				if (s[pos] == 0)
-				{
-					if (convertSkin)
-						s[pos] = 256;
-					convertSkin = false;
-				}
-				else
-					convertSkin = true;
+		if (dist[i] > 0 && dist[i] <= max_d2)
+			set(data[i]);
+	}
+}
+} // namespace
 
-				pos++;
-			}
+void bmphandler::add_skin(unsigned i4, float setto)
+{
+	// skin are the tissue pixels within i4 pixels of the background, pixels outside the slice are not background
+	add_skin_2d(work_bits, width, height, i4, [](float v) { return v == 0; }, [setto](float& v) { v = setto; });
+}
 
-			pos = (y + 1) * width - 1;
-			while (pos > y * width)
-			{
-				if (s[pos] == 0)
-				{
-					if (convertSkin)
-						s[pos] = 256;
-					convertSkin = false;
-				}
-				else
-					convertSkin = true;
+void bmphandler::add_skin_outside(unsigned i4, float setto)
+{
+	// skin are the exterior background pixels within i4 pixels of another pixel
+	float const set_to = (float)123E10;
+	flood_exterior(set_to);
+	add_skin_2d(work_bits, width, height, i4, [set_to](float v) { return v != set_to; }, [setto](float& v) { v = setto; });
+	std::replace(work_bits, work_bits + area, set_to, 0.f);
+}
 
-				pos--;
-			}
-		}
+void bmphandler::add_skintissue(tissuelayers_size_t idx, unsigned i4,
+		tissues_size_t setto)
+{
+	// skin are the unlocked pixels within i4 pixels of the exterior background
+	tissues_size_t const set_to = TISSUES_SIZE_MAX;
+	tissues_size_t* tissues = tissuelayers[idx];
+	flood_exteriortissue(idx, set_to);
+	add_skin_2d(tissues, width, height, i4, [set_to](tissues_size_t v) { return v == set_to; }, [setto](tissues_size_t& v) {
+		if (!TissueInfos::GetTissueLocked(v))
+			v = setto;
+	});
+	std::replace(tissues, tissues + area, set_to, tissues_size_t(0));
+}
 
-		for (x = 0; x < width; x++)
-		{
-			pos = x;
-			while (pos < height * width)
-			{
-				if (s[pos] == 0)
-				{
-					if (convertSkin)
-						s[pos] = 256;
-					convertSkin = false;
-				}
-				else
-					convertSkin = true;
+void bmphandler::add_skintissue_outside(tissuelayers_size_t idx, unsigned i4,
+		tissues_size_t setto)
+{
+	// skin are the exterior background pixels within i4 pixels of a tissue
+	tissues_size_t const set_to = TISSUES_SIZE_MAX;
+	tissues_size_t* tissues = tissuelayers[idx];
+	flood_exteriortissue(idx, set_to);
+	add_skin_2d(tissues, width, height, i4, [set_to](tissues_size_t v) { return v != set_to; }, [setto](tissues_size_t& v) { v = setto; });
+	std::replace(tissues, tissues + area, set_to, tissues_size_t(0));
+}
 
-				pos += width;
-			}
+bool bmphandler::value_at_boundary(float value)
+{
+	// Top
+	float* tmp = &work_bits[0];
+	for (unsigned pos = 0; pos < width; pos++, tmp++)
+	{
+		if (*tmp == value)
+			return true;
+	}
 
-			pos = width * (height - 1) + x;
-			while (pos > width)
-			{
-				if (s[pos] == 0)
-				{
-					if (convertSkin)
-						s[pos] = 256;
-					convertSkin = false;
-				}
-				else
-					convertSkin = true;
+	// Left & right
+	for (unsigned pos = 1; pos < (height - 1); pos++)
+	{
+		if (work_bits[pos * width] == value)
+			return true;
+		else if (work_bits[(pos + 1) * width - 1] == value)
+			return true;
+	}
 
-				pos -= width;
-			}
+	// Bottom
+	tmp = &work_bits[(height - 1) * width];
+	for (unsigned pos = 0; pos < width; pos++, tmp++)
+	{
+		if (*tmp == value)
+			return true;
+	}
+	return false;
+}
+
+bool bmphandler::tissuevalue_at_boundary(tissuelayers_size_t idx,
+		tissues_size_t value)
+{
+	// Top
+	tissues_size_t* tissues = tissuelayers[idx];
+	tissues_size_t* tmp = &(tissues[0]);
+	for (unsigned pos = 0; pos < width; pos++, tmp++)
+	{
+		if (*tmp == value)
+			return true;
+	}
+
+	// Left & right
+	for (unsigned pos = 1; pos < (height - 1); pos++)
+	{
+		if (tissues[pos * width] == value)
+			return true;
+		else if (tissues[(pos + 1) * width - 1] == value)
+			return true;
+	}
+
+	// Bottom
+	tmp = &(tissues[(height - 1) * width]);
+	for (unsigned pos = 0; pos < width; pos++, tmp++)
+	{
+		if (*tmp == value)
+			return true;
+	}
+	return false;
+}
+
+float bmphandler::add_skin(unsigned i)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
+	{
+		setto = p.low;
+		for (unsigned pos = 0; pos < area; pos++)
+		{
+			if (work_bits[pos] != p.high)
+				setto = std::max(setto, work_bits[pos]);
 		}
+		setto = (setto + p.high) / 2;
 	}
 
-	//go over the std::vector and set the skin pixel at the source pointer
-	i = 0;
-	for (j = 0; j < height; j++)
+	add_skin(i, setto);
+	return setto;
+}
+
+float bmphandler::add_skin_outside(unsigned i)
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		for (int k = 0; k < width; k++)
+		setto = p.low;
+		for (unsigned pos = 0; pos < area; pos++)
 		{
-			if (s[i] == 256)
-				work_bits[i] = setto;
-			i++;
+			if (work_bits[pos] != p.high)
+				setto = std::max(setto, work_bits[pos]);
 		}
+		setto = (setto + p.high) / 2;
+	}
+
+	add_skin_outside(i, setto);
+	return setto;
+}
+
+void bmphandler::fill_skin(int thicknessX, int thicknessY,
+		tissues_size_t backgroundID, tissues_size_t skinID)
+{
+	if (thicknessX <= 0 || thicknessY <= 0 || tissuelayers.empty())
+		return;
+
+	//BL recommendation
+	int skinThick = thicknessX;
+	double max_d = skinThick == 1 ? 1.5 * skinThick : 1.2 * skinThick;
+
+	// distance to the tissues other than background and skin, scaled such that the thickness is 1 along x and y
+	tissues_size_t* tissues = tissuelayers[0];
+	for (unsigned i = 0; i < area; i++)
+	{
+		work_bits[i] = (tissues[i] != backgroundID && tissues[i] != skinID) ? 0.f : DistanceTransform::kInfinity;
 	}
+	DistanceTransform::SquaredDistance2D(work_bits, width, height, 1.f / thicknessX, 1.f / thicknessY);
+
+	// preview the background pixels which become skin
+	float const max_d2 = float(max_d * max_d) / (skinThick * skinThick);
+	for (unsigned i = 0; i < area; i++)
+	{
+		work_bits[i] = (tissues[i] == backgroundID && work_bits[i] < max_d2) ? 255.0f : 0.0f;
+	}
+
+	this->set_mode(2, false);
 }
 
-void bmphandler::add_skin_outside(unsigned i4, float setto)
+void bmphandler::flood_exterior(float setto)
 {
 	unsigned char dummymode1 = mode1;
 	unsigned char dummymode2 = mode2;
 	std::vector<int> s;
-	std::vector<int> s1;
-	float* results =
-			(float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
+	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
 
 	int i = width + 3;
 	int i3 = 0;
@@ -10924,10 +10444,7 @@ void bmphandler::add_skin_outside(unsigned i4, float setto)
 			if (work_bits[i3] == 0)
 				results[i] = -1;
 			else
-			{
 				results[i] = 0;
-				s1.push_back(i);
-			}
 			i++;
 			i3++;
 		}
@@ -10976,27 +10493,18 @@ void bmphandler::add_skin_outside(unsigned i4, float setto)
 		}
 	}
 
-	//hysteretic_growth(results,&s,width+2,height+2,false,255.0f);
-	hysteretic_growth(results, &s, width + 2, height + 2, true, 255.0f);
-
-	for (int j = 0; j <= ((int)width + 2) * (height + 2); j++)
-		if (results[j] == 255.0f)
-			results[j] = -1;
-
-	//hysteretic_growth(results,&s1,width+2,height+2,false,255.0f,i4);
-	hysteretic_growth(results, &s1, width + 2, height + 2, true, 255.0f, i4);
+	hysteretic_growth(results, &s, width + 2, height + 2, false, 255.0f);
 
 	i = width + 3;
-	int i2 = 0;
+	i3 = 0;
 	for (int j = 0; j < height; j++)
 	{
 		for (int k = 0; k < width; k++)
 		{
 			if (results[i] == 255.0f)
-				work_bits[i2] = setto;
-			//			work_bits[i2]=results[i];
+				work_bits[i3] = setto;
 			i++;
-			i2++;
+			i3++;
 		}
 
 		i += 2;
@@ -11008,9 +10516,11 @@ void bmphandler::add_skin_outside(unsigned i4, float setto)
 	free(results);
 }
 
-void bmphandler::add_skintissue(tissuelayers_size_t idx, unsigned i4,
+void bmphandler::flood_exteriortissue(tissuelayers_size_t idx,
 		tissues_size_t setto)
 {
+	unsigned char dummymode1 = mode1;
+	unsigned char dummymode2 = mode2;
 	std::vector<int> s;
 	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
 
@@ -11075,132 +10585,65 @@ void bmphandler::add_skintissue(tissuelayers_size_t idx, unsigned i4,
 
 	hysteretic_growth(results, &s, width + 2, height + 2, false, 255.0f);
 
-	unsigned short x, y;
-	unsigned pos;
-	unsigned i1;
-	unsigned w = (unsigned)(width + 2);
-
-	for (y = 1; y < height + 1; y++)
+	i = width + 3;
+	i3 = 0;
+	for (int j = 0; j < height; j++)
 	{
-		pos = y * w;
-		i1 = 0;
-		while (pos < (y + 1) * w)
+		for (int k = 0; k < width; k++)
 		{
-			if (results[pos] == 255.0f)
-				i1 = i4;
-			else
-			{
-				if (i1 > 0)
-				{
-					results[pos] = 256.0f;
-					i1--;
-				}
-			}
-			pos++;
+			if (results[i] == 255.0f)
+				tissues[i3] = setto;
+			i++;
+			i3++;
 		}
-	}
 
-	for (y = 1; y < height + 1; y++)
-	{
-		pos = (y + 1) * w - 1;
-		i1 = 0;
-		while (pos > y * w)
-		{
-			if (results[pos] == 255.0f)
-				i1 = i4;
-			else
-			{
-				if (i1 > 0)
-				{
-					results[pos] = 256.0f;
-					i1--;
-				}
-			}
-			pos--;
-		}
+		i += 2;
 	}
 
-	for (x = 1; x < width + 1; x++)
-	{
-		pos = x;
-		i1 = 0;
-		while (pos < (height + 1) * w)
-		{
-			if (results[pos] == 255.0f)
-				i1 = i4;
-			else
-			{
-				if (i1 > 0)
-				{
-					results[pos] = 256.0f;
-					i1--;
-				}
-			}
-			pos += w;
-		}
-	}
+	mode1 = dummymode1;
+	mode2 = dummymode2;
 
-	for (x = 1; x < width + 1; x++)
-	{
-		pos = w * (height + 1) + x;
-		i1 = 0;
-		while (pos > w)
-		{
-			if (results[pos] == 255.0f)
-				i1 = i4;
-			else
-			{
-				if (i1 > 0)
-				{
-					results[pos] = 256.0f;
-					i1--;
-				}
-			}
-			pos -= w;
-		}
-	}
+	free(results);
+}
 
-	i = width + 3;
-	int i2 = 0;
-	for (int j = 0; j < height; j++)
+void bmphandler::fill_unassigned()
+{
+	Pair p;
+	get_range(&p);
+	float setto;
+	if (p.high <= 254.0f)
+		setto = 255.0f;
+	else if (p.low >= 1.0f)
+		setto = 0.0f;
+	else
 	{
-		for (int k = 0; k < width; k++)
+		setto = p.low;
+		for (unsigned pos = 0; pos < area; pos++)
 		{
-			if (results[i] == 256.0f &&
-					(!TissueInfos::GetTissueLocked(tissues[i2])))
-				tissues[i2] = setto;
-			//			work_bits[i2]=results[i];
-			i++;
-			i2++;
+			if (work_bits[pos] != p.high)
+				setto = std::max(setto, work_bits[pos]);
 		}
-
-		i += 2;
+		setto = (setto + p.high) / 2;
 	}
 
-	free(results);
+	fill_unassigned(setto);
 }
 
-void bmphandler::add_skintissue_outside(tissuelayers_size_t idx, unsigned i4,
-		tissues_size_t setto)
+void bmphandler::fill_unassigned(float setto)
 {
 	std::vector<int> s;
-	std::vector<int> s1;
 	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
 
 	int i = width + 3;
 	int i3 = 0;
-	tissues_size_t* tissues = tissuelayers[idx];
 	for (int j = 0; j < height; j++)
 	{
 		for (int k = 0; k < width; k++)
 		{
-			if (tissues[i3] == 0)
+			if (work_bits[i3] == 0)
 				results[i] = -1;
 			else
-			{
 				results[i] = 0;
-				s1.push_back(i);
-			}
 			i++;
 			i3++;
 		}
@@ -11251,275 +10694,39 @@ void bmphandler::add_skintissue_outside(tissuelayers_size_t idx, unsigned i4,
 
 	hysteretic_growth(results, &s, width + 2, height + 2, false, 255.0f);
 
-	for (int j = 0; j <= ((int)width + 2) * (height + 2); j++)
-		if (results[j] == 255.0f)
-			results[j] = -1;
-
-	hysteretic_growth(results, &s1, width + 2, height + 2, false, 255.0f, i4);
+	unsigned pos = width + 3;
+	unsigned long pos1 = 0;
 
-	i = width + 3;
-	int i2 = 0;
-	for (int j = 0; j < height; j++)
+	for (unsigned short py = 0; py < height; py++)
 	{
-		for (int k = 0; k < width; k++)
+		for (unsigned short px = 0; px < width; px++)
 		{
-			if (results[i] == 255.0f)
-				tissues[i2] = setto;
-			i++;
-			i2++;
+			if (results[pos] != 255.0f && work_bits[pos1] == 0)
+				work_bits[pos1] = setto;
+			pos++;
+			pos1++;
 		}
-
-		i += 2;
+		pos += 2;
 	}
 
 	free(results);
 }
 
-bool bmphandler::value_at_boundary(float value)
-{
-	// Top
-	float* tmp = &work_bits[0];
-	for (unsigned pos = 0; pos < width; pos++, tmp++)
-	{
-		if (*tmp == value)
-			return true;
-	}
-
-	// Left & right
-	for (unsigned pos = 1; pos < (height - 1); pos++)
-	{
-		if (work_bits[pos * width] == value)
-			return true;
-		else if (work_bits[(pos + 1) * width - 1] == value)
-			return true;
-	}
-
-	// Bottom
-	tmp = &work_bits[(height - 1) * width];
-	for (unsigned pos = 0; pos < width; pos++, tmp++)
-	{
-		if (*tmp == value)
-			return true;
-	}
-	return false;
-}
-
-bool bmphandler::tissuevalue_at_boundary(tissuelayers_size_t idx,
-		tissues_size_t value)
-{
-	// Top
-	tissues_size_t* tissues = tissuelayers[idx];
-	tissues_size_t* tmp = &(tissues[0]);
-	for (unsigned pos = 0; pos < width; pos++, tmp++)
-	{
-		if (*tmp == value)
-			return true;
-	}
-
-	// Left & right
-	for (unsigned pos = 1; pos < (height - 1); pos++)
-	{
-		if (tissues[pos * width] == value)
-			return true;
-		else if (tissues[(pos + 1) * width - 1] == value)
-			return true;
-	}
-
-	// Bottom
-	tmp = &(tissues[(height - 1) * width]);
-	for (unsigned pos = 0; pos < width; pos++, tmp++)
-	{
-		if (*tmp == value)
-			return true;
-	}
-	return false;
-}
-
-float bmphandler::add_skin(unsigned i)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-		for (unsigned pos = 0; pos < area; pos++)
-		{
-			if (work_bits[pos] != p.high)
-				setto = std::max(setto, work_bits[pos]);
-		}
-		setto = (setto + p.high) / 2;
-	}
-
-	add_skin(i, setto);
-	return setto;
-}
-
-float bmphandler::add_skin_outside(unsigned i)
-{
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-		for (unsigned pos = 0; pos < area; pos++)
-		{
-			if (work_bits[pos] != p.high)
-				setto = std::max(setto, work_bits[pos]);
-		}
-		setto = (setto + p.high) / 2;
-	}
-
-	add_skin_outside(i, setto);
-	return setto;
-}
-
-void bmphandler::fill_skin(int thicknessX, int thicknessY,
-		tissues_size_t backgroundID, tissues_size_t skinID)
-{
-	//BL recommendation
-	int skinThick = thicknessX;
-
-	std::vector<int> dims;
-	dims.push_back(width);
-	dims.push_back(height);
-
-	//int backgroundID = (bmp_bits[0]==bmp_bits[area-1]) ? bmp_bits[0] : 0;
-
-	double max_d = skinThick == 1 ? 1.5 * skinThick : 1.2 * skinThick;
-	std::vector<int> offsets;
-
-	//Create the relative neighborhood
-	for (int j = -skinThick; j <= skinThick; j++)
-	{
-		for (int i = -skinThick; i <= skinThick; i++)
-		{
-			if (sqrt(i * i + j * j) < max_d)
-			{
-				int shift = i + j * dims[0];
-				if (shift != 0)
-				{
-					offsets.push_back(shift);
-				}
-			}
-		}
-	}
-
-	tissues_size_t* tissues;
-	if (tissuelayers.size() > 0)
-		tissues = tissuelayers[0];
-
-	bool previewWay = true;
-
-	if (previewWay)
-	{
-		float* bmp1 = this->return_bmp();
-
-		tissues_size_t* tissue1 = this->return_tissues(0);
-		this->pushstack_bmp();
-
-		for (unsigned int i = 0; i < area; i++)
-		{
-			bmp1[i] = (float)tissue1[i];
-		}
-		this->dead_reckoning((float)0);
-		bmp1 = this->return_work();
-
-		for (int j = skinThick; j + skinThick < dims[1]; j++)
-		{
-			for (int i = skinThick; i + skinThick < dims[0]; i++)
-			{
-				int pos = i + j * dims[0];
-				if (tissues[pos] == backgroundID)
-				{
-					//iterate through neighbors of pixel
-					//if any of these are not
-					for (int l = 0; l < offsets.size(); l++)
-					{
-						int idx = pos + offsets[l];
-						assert(idx >= 0 && idx < area);
-						/*
-						if( tissues[idx] != backgroundID && 
-							tissues[idx] != skinID )
-						{
-							if( tissues[idx] != backgroundID && 
-								tissues[idx] != skinID )
-								work_bits[pos]=255.0f;
-							else
-								work_bits[pos]=0.0f;
-						}
-						*/
-						if (tissues[idx] != backgroundID &&
-								tissues[idx] != skinID)
-							work_bits[pos] = 255.0f;
-					}
-				}
-			}
-		}
-		for (unsigned i = 0; i < area; i++)
-		{
-			if (bmp1[i] < 0)
-				bmp1[i] = 0;
-			else
-				bmp1[i] = 255.0f;
-		}
-
-		this->set_mode(2, false);
-		this->popstack_bmp();
-	}
-
-	else
-	{
-		for (int j = skinThick; j + skinThick < dims[1]; j++)
-		{
-			for (int i = skinThick; i + skinThick < dims[0]; i++)
-			{
-				int pos = i + j * dims[0];
-				if (tissues[pos] == backgroundID)
-				{
-					//iterate through neighbors of pixel
-					//if any of these are not
-					for (int l = 0; l < offsets.size(); l++)
-					{
-						int idx = pos + offsets[l];
-						assert(idx >= 0 && idx < area);
-
-						if (tissues[idx] != backgroundID &&
-								tissues[idx] != skinID)
-						{
-							tissues[pos] = skinID;
-							break;
-						}
-					}
-				}
-			}
-		}
-	}
-}
-
-void bmphandler::flood_exterior(float setto)
+void bmphandler::fill_unassignedtissue(tissuelayers_size_t idx,
+		tissues_size_t setto)
 {
-	unsigned char dummymode1 = mode1;
-	unsigned char dummymode2 = mode2;
 	std::vector<int> s;
-	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
+	float* results =
+			(float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
 
 	int i = width + 3;
 	int i3 = 0;
+	tissues_size_t* tissues = tissuelayers[idx];
 	for (int j = 0; j < height; j++)
 	{
 		for (int k = 0; k < width; k++)
 		{
-			if (work_bits[i3] == 0)
+			if (tissues[i3] == 0)
 				results[i] = -1;
 			else
 				results[i] = 0;
@@ -11573,474 +10780,189 @@ void bmphandler::flood_exterior(float setto)
 
 	hysteretic_growth(results, &s, width + 2, height + 2, false, 255.0f);
 
-	i = width + 3;
-	i3 = 0;
-	for (int j = 0; j < height; j++)
+	unsigned pos = width + 3;
+	unsigned long pos1 = 0;
+
+	for (unsigned short py = 0; py < height; py++)
 	{
-		for (int k = 0; k < width; k++)
+		for (unsigned short px = 0; px < width; px++)
 		{
-			if (results[i] == 255.0f)
-				work_bits[i3] = setto;
-			i++;
-			i3++;
+			if (results[pos] != 255.0f && tissues[pos1] == 0)
+				tissues[pos1] = setto;
+			pos++;
+			pos1++;
 		}
-
-		i += 2;
+		pos += 2;
 	}
 
-	mode1 = dummymode1;
-	mode2 = dummymode2;
-
 	free(results);
 }
 
-void bmphandler::flood_exteriortissue(tissuelayers_size_t idx,
-		tissues_size_t setto)
+void bmphandler::adaptive_fuzzy(Point p, float m1, float s1, float s2, float /* thresh */)
 {
-	unsigned char dummymode1 = mode1;
-	unsigned char dummymode2 = mode2;
-	std::vector<int> s;
-	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
-
-	int i = width + 3;
-	int i3 = 0;
-	tissues_size_t* tissues = tissuelayers[idx];
-	for (int j = 0; j < height; j++)
+	ImageForestingTransformAdaptFuzzy af;
+	af.fuzzy_init(width, height, bmp_bits, p, m1, s1, s2);
+	float* pf = af.return_pf();
+	for (unsigned i = 0; i < area; i++)
 	{
-		for (int k = 0; k < width; k++)
-		{
-			if (tissues[i3] == 0)
-				results[i] = -1;
-			else
-				results[i] = 0;
-			i++;
-			i3++;
-		}
-
-		i += 2;
+		/*		if(pf[i]<1-thresh) work_bits[i]=255;
+		else work_bits[i]=0;*/
+		work_bits[i] = pf[i] * 255;
 	}
+	mode2 = 1;
+	return;
+}
 
-	for (int j = 0; j < width + 2; j++)
-		results[j] = results[j + ((unsigned)width + 2) * (height + 1)] = 0;
-	for (int j = 0; j <= ((int)width + 2) * (height + 1); j += width + 2)
-		results[j] = results[j + width + 1] = 0;
+void bmphandler::fast_marching(Point p, float sigma, float thresh)
+{
+	unsigned char dummymode = mode1;
+	ImageForestingTransformFastMarching fm;
 
-	for (int j = width + 3; j < 2 * width + 3; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = area + 2 * height + 1;
-			 j < area + width + 2 * height + 1; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * width + 5; j <= area + 2 * height + 1;
-			 j += width + 2)
+	float* dummy;
+	float* lbl = sliceprovide->give_me();
+	gaussian(sigma);
+	dummy = lbl;
+	lbl = bmp_bits;
+	bmp_bits = dummy;
+	swap_bmpwork();
+	sobel();
+	dummy = lbl;
+	lbl = bmp_bits;
+	bmp_bits = dummy;
+
+	for (unsigned i = 0; i < area; i++)
 	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
+		work_bits[i] = exp(-work_bits[i] / thresh);
+		lbl[i] = 0;
 	}
-	for (unsigned int j = 3 * width + 4; j <= area + width + 2 * height;
-			 j += width + 2)
+	lbl[pt2coord(p)] = 1;
+
+	fm.fastmarch_init(width, height, work_bits, lbl);
+	float* pf = fm.return_pf();
+	for (unsigned i = 0; i < area; i++)
 	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
+		work_bits[i] = pf[i];
 	}
+	Pair p1;
+	get_range(&p1);
+	//	cout << p1.high << " " << p1.low << endl;
+	//	scale_colors(p1);
 
-	hysteretic_growth(results, &s, width + 2, height + 2, false, 255.0f);
+	sliceprovide->take_back(lbl);
 
-	i = width + 3;
-	i3 = 0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			if (results[i] == 255.0f)
-				tissues[i3] = setto;
-			i++;
-			i3++;
-		}
+	mode1 = dummymode;
+	mode2 = 1;
 
-		i += 2;
+	return;
+}
+
+ImageForestingTransformFastMarching*
+		bmphandler::fastmarching_init(Point p, float sigma, float thresh)
+{
+	unsigned char dummymode1 = mode1;
+	unsigned char dummymode2 = mode2;
+	ImageForestingTransformFastMarching* fm =
+			new ImageForestingTransformFastMarching;
+
+	float* dummy;
+	float* work_store = work_bits;
+	work_bits = sliceprovide->give_me();
+	gaussian(sigma);
+	float* lbl = bmp_bits;
+	bmp_bits = sliceprovide->give_me();
+	swap_bmpwork();
+	sobel();
+	dummy = lbl;
+	lbl = bmp_bits;
+	bmp_bits = dummy;
+
+	for (unsigned i = 0; i < area; i++)
+	{
+		work_bits[i] = exp(-work_bits[i] / thresh);
+		lbl[i] = 0;
 	}
+	lbl[pt2coord(p)] = 1;
+
+	fm->fastmarch_init(width, height, work_bits, lbl);
+
+	sliceprovide->take_back(lbl);
+	sliceprovide->take_back(work_bits);
+	work_bits = work_store;
 
 	mode1 = dummymode1;
 	mode2 = dummymode2;
 
-	free(results);
+	return fm;
 }
 
-void bmphandler::fill_unassigned()
+float bmphandler::extract_feature(Point p1, Point p2)
 {
-	Pair p;
-	get_range(&p);
-	float setto;
-	if (p.high <= 254.0f)
-		setto = 255.0f;
-	else if (p.low >= 1.0f)
-		setto = 0.0f;
-	else
-	{
-		setto = p.low;
-		for (unsigned pos = 0; pos < area; pos++)
-		{
-			if (work_bits[pos] != p.high)
-				setto = std::max(setto, work_bits[pos]);
-		}
-		setto = (setto + p.high) / 2;
-	}
-
-	fill_unassigned(setto);
+	fextract.init(bmp_bits, p1, p2, width, height);
+	return fextract.return_average();
 }
 
-void bmphandler::fill_unassigned(float setto)
+float bmphandler::extract_featurework(Point p1, Point p2)
 {
-	std::vector<int> s;
-	float* results = (float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
+	fextract.init(work_bits, p1, p2, width, height);
+	return fextract.return_average();
+}
 
-	int i = width + 3;
-	int i3 = 0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			if (work_bits[i3] == 0)
-				results[i] = -1;
-			else
-				results[i] = 0;
-			i++;
-			i3++;
-		}
+float bmphandler::return_stdev()
+{
+	return fextract.return_stddev();
+	;
+}
 
-		i += 2;
-	}
+Pair bmphandler::return_extrema()
+{
+	Pair p;
+	fextract.return_extrema(&p);
+	return p;
+}
 
-	for (int j = 0; j < width + 2; j++)
-		results[j] = results[j + ((unsigned)width + 2) * (height + 1)] = 0;
-	for (int j = 0; j <= ((int)width + 2) * (height + 1); j += width + 2)
-		results[j] = results[j + width + 1] = 0;
+void bmphandler::classify(short nrclasses, short dim, float** bits,
+		float* weights, float* centers, float maxdist)
+{
+	short k;
+	float dist, distmin;
+	maxdist = maxdist * maxdist;
+	short unsigned cindex;
 
-	for (int j = width + 3; j < 2 * width + 3; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = area + 2 * height + 1;
-			 j < area + width + 2 * height + 1; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * width + 5; j <= area + 2 * height + 1;
-			 j += width + 2)
+	for (unsigned i = 0; i < area; i++)
 	{
-		if (results[j] == -1)
+		k = 0;
+		distmin = 0;
+		cindex = 0;
+		for (short m = 0; m < dim; m++)
 		{
-			results[j] = 255.0f;
-			s.push_back(j);
+			distmin += (bits[m][i] - centers[cindex]) *
+								 (bits[m][i] - centers[cindex]) * weights[m];
+			cindex++;
 		}
-	}
-	for (unsigned int j = 3 * width + 4; j <= area + width + 2 * height;
-			 j += width + 2)
-	{
-		if (results[j] == -1)
+		for (short l = 1; l < nrclasses; l++)
 		{
-			results[j] = 255.0f;
-			s.push_back(j);
+			dist = 0;
+			for (short m = 0; m < dim; m++)
+			{
+				dist += (bits[m][i] - centers[cindex]) *
+								(bits[m][i] - centers[cindex]) * weights[m];
+				cindex++;
+			}
+			if (dist < distmin)
+			{
+				distmin = dist;
+				k = l;
+			}
 		}
+		if (distmin < maxdist)
+			work_bits[i] = 255.0f * (k + 1) / nrclasses;
+		else
+			work_bits[i] = 0;
 	}
 
-	hysteretic_growth(results, &s, width + 2, height + 2, false, 255.0f);
-
-	unsigned pos = width + 3;
-	unsigned long pos1 = 0;
-
-	for (unsigned short py = 0; py < height; py++)
-	{
-		for (unsigned short px = 0; px < width; px++)
-		{
-			if (results[pos] != 255.0f && work_bits[pos1] == 0)
-				work_bits[pos1] = setto;
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
+	mode2 = 2;
 
-	free(results);
-}
-
-void bmphandler::fill_unassignedtissue(tissuelayers_size_t idx,
-		tissues_size_t setto)
-{
-	std::vector<int> s;
-	float* results =
-			(float*)malloc(sizeof(float) * (area + 2 * width + 2 * height + 4));
-
-	int i = width + 3;
-	int i3 = 0;
-	tissues_size_t* tissues = tissuelayers[idx];
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			if (tissues[i3] == 0)
-				results[i] = -1;
-			else
-				results[i] = 0;
-			i++;
-			i3++;
-		}
-
-		i += 2;
-	}
-
-	for (int j = 0; j < width + 2; j++)
-		results[j] = results[j + ((unsigned)width + 2) * (height + 1)] = 0;
-	for (int j = 0; j <= ((int)width + 2) * (height + 1); j += width + 2)
-		results[j] = results[j + width + 1] = 0;
-
-	for (int j = width + 3; j < 2 * width + 3; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = area + 2 * height + 1;
-			 j < area + width + 2 * height + 1; j++)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * width + 5; j <= area + 2 * height + 1;
-			 j += width + 2)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * width + 4; j <= area + width + 2 * height;
-			 j += width + 2)
-	{
-		if (results[j] == -1)
-		{
-			results[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-
-	hysteretic_growth(results, &s, width + 2, height + 2, false, 255.0f);
-
-	unsigned pos = width + 3;
-	unsigned long pos1 = 0;
-
-	for (unsigned short py = 0; py < height; py++)
-	{
-		for (unsigned short px = 0; px < width; px++)
-		{
-			if (results[pos] != 255.0f && tissues[pos1] == 0)
-				tissues[pos1] = setto;
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	free(results);
-}
-
-void bmphandler::adaptive_fuzzy(Point p, float m1, float s1, float s2, float /* thresh */)
-{
-	ImageForestingTransformAdaptFuzzy af;
-	af.fuzzy_init(width, height, bmp_bits, p, m1, s1, s2);
-	float* pf = af.return_pf();
-	for (unsigned i = 0; i < area; i++)
-	{
-		/*		if(pf[i]<1-thresh) work_bits[i]=255;
-		else work_bits[i]=0;*/
-		work_bits[i] = pf[i] * 255;
-	}
-	mode2 = 1;
-	return;
-}
-
-void bmphandler::fast_marching(Point p, float sigma, float thresh)
-{
-	unsigned char dummymode = mode1;
-	ImageForestingTransformFastMarching fm;
-
-	float* dummy;
-	float* lbl = sliceprovide->give_me();
-	gaussian(sigma);
-	dummy = lbl;
-	lbl = bmp_bits;
-	bmp_bits = dummy;
-	swap_bmpwork();
-	sobel();
-	dummy = lbl;
-	lbl = bmp_bits;
-	bmp_bits = dummy;
-
-	for (unsigned i = 0; i < area; i++)
-	{
-		work_bits[i] = exp(-work_bits[i] / thresh);
-		lbl[i] = 0;
-	}
-	lbl[pt2coord(p)] = 1;
-
-	fm.fastmarch_init(width, height, work_bits, lbl);
-	float* pf = fm.return_pf();
-	for (unsigned i = 0; i < area; i++)
-	{
-		work_bits[i] = pf[i];
-	}
-	Pair p1;
-	get_range(&p1);
-	//	cout << p1.high << " " << p1.low << endl;
-	//	scale_colors(p1);
-
-	sliceprovide->take_back(lbl);
-
-	mode1 = dummymode;
-	mode2 = 1;
-
-	return;
-}
-
-ImageForestingTransformFastMarching*
-		bmphandler::fastmarching_init(Point p, float sigma, float thresh)
-{
-	unsigned char dummymode1 = mode1;
-	unsigned char dummymode2 = mode2;
-	ImageForestingTransformFastMarching* fm =
-			new ImageForestingTransformFastMarching;
-
-	float* dummy;
-	float* work_store = work_bits;
-	work_bits = sliceprovide->give_me();
-	gaussian(sigma);
-	float* lbl = bmp_bits;
-	bmp_bits = sliceprovide->give_me();
-	swap_bmpwork();
-	sobel();
-	dummy = lbl;
-	lbl = bmp_bits;
-	bmp_bits = dummy;
-
-	for (unsigned i = 0; i < area; i++)
-	{
-		work_bits[i] = exp(-work_bits[i] / thresh);
-		lbl[i] = 0;
-	}
-	lbl[pt2coord(p)] = 1;
-
-	fm->fastmarch_init(width, height, work_bits, lbl);
-
-	sliceprovide->take_back(lbl);
-	sliceprovide->take_back(work_bits);
-	work_bits = work_store;
-
-	mode1 = dummymode1;
-	mode2 = dummymode2;
-
-	return fm;
-}
-
-float bmphandler::extract_feature(Point p1, Point p2)
-{
-	fextract.init(bmp_bits, p1, p2, width, height);
-	return fextract.return_average();
-}
-
-float bmphandler::extract_featurework(Point p1, Point p2)
-{
-	fextract.init(work_bits, p1, p2, width, height);
-	return fextract.return_average();
-}
-
-float bmphandler::return_stdev()
-{
-	return fextract.return_stddev();
-	;
-}
-
-Pair bmphandler::return_extrema()
-{
-	Pair p;
-	fextract.return_extrema(&p);
-	return p;
-}
-
-void bmphandler::classify(short nrclasses, short dim, float** bits,
-		float* weights, float* centers, float maxdist)
-{
-	short k;
-	float dist, distmin;
-	maxdist = maxdist * maxdist;
-	short unsigned cindex;
-
-	for (unsigned i = 0; i < area; i++)
-	{
-		k = 0;
-		distmin = 0;
-		cindex = 0;
-		for (short m = 0; m < dim; m++)
-		{
-			distmin += (bits[m][i] - centers[cindex]) *
-								 (bits[m][i] - centers[cindex]) * weights[m];
-			cindex++;
-		}
-		for (short l = 1; l < nrclasses; l++)
-		{
-			dist = 0;
-			for (short m = 0; m < dim; m++)
-			{
-				dist += (bits[m][i] - centers[cindex]) *
-								(bits[m][i] - centers[cindex]) * weights[m];
-				cindex++;
-			}
-			if (dist < distmin)
-			{
-				distmin = dist;
-				k = l;
-			}
-		}
-		if (distmin < maxdist)
-			work_bits[i] = 255.0f * (k + 1) / nrclasses;
-		else
-			work_bits[i] = 0;
-	}
-
-	mode2 = 2;
-
-	return;
+	return;
 }
 
 void bmphandler::kmeans(short nrtissues, short dim, float** bits,
@@ -14054,1205 +12976,152 @@ void bmphandler::correct_outlinetissue(tissuelayers_size_t idx,
 
 template<typename T, typename F>
 void bmphandler::_brush(T* data, T f, Point p, int radius, bool draw, T f1,
-		F is_locked)
-{
-	unsigned short dist = radius * radius;
-
-	int xmin, xmax, ymin, ymax, d;
-	if (p.px < radius)
-		xmin = 0;
-	else
-		xmin = int(p.px - radius);
-	if (p.px + radius >= width)
-		xmax = int(width - 1);
-	else
-		xmax = int(p.px + radius);
-
-	for (int x = xmin; x <= xmax; x++)
-	{
-		d = int(floor(sqrt(float(dist - (x - p.px) * (x - p.px)))));
-		ymin = std::max(0, int(p.py) - d);
-		ymax = std::min(int(height - 1), d + p.py);
-
-		for (int y = ymin; y <= ymax; y++)
-		{
-			// don't modify locked pixels
-			if (is_locked(data[y * unsigned(width) + x]))
-				continue;
-
-			if (draw)
-			{
-				data[y * unsigned(width) + x] = f;
-			}
-			else
-			{
-				if (data[y * unsigned(width) + x] == f)
-					data[y * unsigned(width) + x] = f1;
-			}
-		}
-	}
-}
-
-template<typename T, typename F>
-void bmphandler::_brush(T* data, T f, Point p, float const radius, float dx,
-		float dy, bool draw, T f1, F is_locked)
-{
-	float const radius_corrected = dx > dy
-																		 ? std::floor(radius / dx + 0.5f) * dx
-																		 : std::floor(radius / dy + 0.5f) * dy;
-	float const radius_corrected2 = radius_corrected * radius_corrected;
-
-	int const xradius = std::ceil(radius_corrected / dx);
-	int const yradius = std::ceil(radius_corrected / dy);
-	for (int x = std::max(0, p.px - xradius); x <= std::min(static_cast<int>(width) - 1, p.px + xradius); x++)
-	{
-		for (int y = std::max(0, p.py - yradius); y <= std::min(static_cast<int>(height) - 1, p.py + yradius); y++)
-		{
-			// don't modify locked pixels
-			if (is_locked(data[y * unsigned(width) + x]))
-				continue;
-
-			if (std::pow(dx * (p.px - x), 2.f) + std::pow(dy * (p.py - y), 2.f) <= radius_corrected2)
-			{
-				if (draw)
-				{
-					data[y * unsigned(width) + x] = f;
-				}
-				else
-				{
-					if (data[y * unsigned(width) + x] == f)
-						data[y * unsigned(width) + x] = f1;
-				}
-			}
-		}
-	}
-}
-
-void bmphandler::brush(float f, Point p, int radius, bool draw)
-{
-	_brush(work_bits, f, p, radius, draw, 0.f, [](float v) { return false; });
-}
-
-void bmphandler::brush(float f, Point p, float radius, float dx, float dy, bool draw)
-{
-	_brush(work_bits, f, p, radius, dx, dy, draw, 0.f,
-			[](float v) { return false; });
-}
-
-void bmphandler::brushtissue(tissuelayers_size_t idx, tissues_size_t f, Point p,
-		int radius, bool draw, tissues_size_t f1)
-{
-	_brush(tissuelayers[idx], f, p, radius, draw, f1,
-			[](tissues_size_t v) { return TissueInfos::GetTissueLocked(v); });
-}
-
-void bmphandler::brushtissue(tissuelayers_size_t idx, tissues_size_t f, Point p,
-		float radius, float dx, float dy, bool draw,
-		tissues_size_t f1)
-{
-	_brush(tissuelayers[idx], f, p, radius, dx, dy, draw, f1,
-			[](tissues_size_t v) { return TissueInfos::GetTissueLocked(v); });
-}
-
-void bmphandler::fill_holes(float f, int minsize)
-{
-	std::vector<std::vector<Point>> inner_line;
-	minsize = 2 * minsize;
-	float bubble_size;
-	float linelength;
-	short directionchange;
-
-	float* tmp_bits =
-			(float*)malloc(sizeof(float) * (width + 2) * (height + 2));
-	bool* visited = (bool*)malloc(sizeof(bool) * (width + 2) * (height + 2));
-	for (unsigned i = 0; i < unsigned(width + 2) * (height + 2); i++)
-		visited[i] = false;
-
-	unsigned pos = width + 3;
-	unsigned pos1 = 0;
-	unsigned pos2;
-	unsigned possecond;
-	bool done;
-	short inner; //1 for outer, 7 for inner border
-	short direction,
-			directionold; // 0:rechts, 1:rechts oben, 2:oben, ... 7:rechts unten.
-	Point p;
-
-	std::vector<Point> vec_pt;
-	int offset[8] = {1, width + 3, width + 2, width + 1,
-			-1, -width - 3, -width - 2, -width - 1};
-	float dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
-	float dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
-	float bordervolume[8] = {1, 0.75f, 0.5f, 0.25f, 2, 1.75f, 1.5f, 1.25f};
-
-	for (unsigned i = 0; i < height; i++)
-	{
-		for (unsigned j = 0; j < width; j++)
-		{
-			tmp_bits[pos] = work_bits[pos1];
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	for (unsigned i = 0; i < unsigned(width + 2); i++)
-		tmp_bits[i] = unvisited;
-	for (unsigned i = unsigned(width + 2) * (height + 1);
-			 i < unsigned(width + 2) * (height + 2); i++)
-		tmp_bits[i] = unvisited;
-	for (unsigned i = 0; i < unsigned(width + 2) * (height + 2);
-			 i += (width + 2))
-		tmp_bits[i] = unvisited;
-	for (unsigned i = width + 1; i < unsigned(width + 2) * (height + 2);
-			 i += (width + 2))
-		tmp_bits[i] = unvisited;
-
-	pos = width + 2;
-	while (pos < unsigned(width + 2) * (height + 1))
-	{
-		while ((tmp_bits[pos] != f || tmp_bits[pos - 1] == f || visited[pos]) &&
-					 pos < unsigned(width + 2) * (height + 1))
-			pos++;
-
-		if (pos < unsigned(width + 2) * (height + 1))
-		{
-			pos1 = pos;
-			vec_pt.clear();
-			p.px = short(pos % (width + 2) - 1);
-			p.py = short(pos / (width + 2) - 1);
-			//			vec_pt.push_back(p);
-
-			if (tmp_bits[pos + 1] != f && tmp_bits[pos + width + 3] != f &&
-					tmp_bits[pos + width + 2] != f &&
-					tmp_bits[pos + width + 1] != f &&
-					tmp_bits[pos - width - 1] != f &&
-					tmp_bits[pos - width - 2] != f &&
-					tmp_bits[pos - width - 3] != f)
-			{
-				visited[pos] = true;
-			}
-			else
-			{
-				if (tmp_bits[pos - width - 3] == f)
-				{						 // tricky criteria
-					inner = 7; // inner line
-					directionold = direction = 1;
-				}
-				else
-				{
-					inner = 1; // outer line
-					directionold = direction = 7;
-				}
-
-				bubble_size = 0;
-				linelength = 0;
-
-				direction = (direction + 5 * inner) % 8;
-				done = false;
-				directionchange = 5 * inner;
-				while (!done)
-				{
-					directionchange += inner;
-					direction = (direction + inner) % 8;
-					pos2 = pos1 + offset[direction];
-					if (tmp_bits[pos2] == f)
-						done = true;
-				}
-
-				possecond = pos2;
-
-				do
-				{
-					vec_pt.push_back(p);
-					if (tmp_bits[pos1 - 1] == f ||
-							(inner == 7 &&
-									!(((direction + 6) % 8 > 2 && directionold > 3 &&
-												(directionchange + 5) % 8 > 2) ||
-											(direction == 5 && directionold == 3))) ||
-							(inner == 1 && !(((direction + 4) % 8 > 2 &&
-																	 (directionold + 7) % 8 < 4 &&
-																	 (directionchange + 5) % 8 > 2) ||
-																 (direction == 3 && directionold == 5)))
-							//					 (inner==1&&!(||(direction==3&&directionold==5)))
-					)
-						visited[pos1] = true;
-					pos1 = pos2;
-					p.px = short(pos1 % (width + 2) - 1);
-					p.py = short(pos1 / (width + 2) - 1);
-					//					vec_pt.push_back(p);
-					bubble_size += dy[direction] * (2 * p.px - dx[direction]);
-					bubble_size -= bordervolume[directionchange % 8];
-					linelength += 2;
-					//					work_bits[p.px+p.py*width]=255;
-					directionold = direction;
-					direction = (direction + 5 * inner) % 8;
-					done = false;
-					directionchange = 5 * inner;
-					while (!done)
-					{
-						directionchange += inner;
-						direction = (direction + inner) % 8;
-						pos2 = pos1 + offset[direction];
-						if (tmp_bits[pos2] == f)
-							done = true;
-					}
-				} while (pos1 != pos || pos2 != possecond); // end do while
-
-				if (inner == 7)
-				{
-					if (bubble_size < (float)minsize)
-						inner_line.push_back(vec_pt);
-				}
-			}
-			pos++;
-		}
-	}
-
-	free(visited);
-
-	std::vector<int> s;
-
-	int i4 = width + 3;
-	int i1 = 0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			tmp_bits[i4] = -1;
-			i4++;
-			i1++;
-		}
-
-		i4 += 2;
-	}
-
-	for (auto& it1 : inner_line)
-	{
-		for (const Point& it : it1)
-		{
-			tmp_bits[it.px + 1 + (it.py + 1) * (width + 2)] = 1;
-		}
-	}
-
-	for (int j = 0; j < width + 2; j++)
-		tmp_bits[j] = tmp_bits[j + ((unsigned)width + 2) * (height + 1)] = 0;
-	for (int j = 0; j <= ((int)width + 2) * (height + 1); j += width + 2)
-		tmp_bits[j] = tmp_bits[j + width + 1] = 0;
-
-	for (int j = width + 3; j < 2 * width + 3; j++)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = area + 2 * height + 1;
-			 j < area + width + 2 * height + 1; j++)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * width + 5; j <= area + 2 * height + 1;
-			 j += width + 2)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * width + 4; j <= area + width + 2 * height;
-			 j += width + 2)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-
-	hysteretic_growth(tmp_bits, &s, width + 2, height + 2, false, 255.0f);
-
-	i4 = width + 3;
-	int i2 = 0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			if (tmp_bits[i4] == 0)
-				work_bits[i2] = f;
-			//			work_bits[i2]=tmp_bits[i4];
-			i4++;
-			i2++;
-		}
-
-		i4 += 2;
-	}
-
-	free(tmp_bits);
-
-	return;
-}
-
-void bmphandler::fill_holestissue(tissuelayers_size_t idx, tissues_size_t f,
-		int minsize)
-{
-	std::vector<std::vector<Point>> inner_line;
-	minsize = 2 * minsize;
-	float bubble_size;
-	float linelength;
-	short directionchange;
-
-	tissues_size_t* tmp_bits = (tissues_size_t*)malloc(
-			sizeof(tissues_size_t) * (width + 2) * (height + 2));
-	bool* visited = (bool*)malloc(sizeof(bool) * (width + 2) * (height + 2));
-	for (unsigned i = 0; i < unsigned(width + 2) * (height + 2); i++)
-		visited[i] = false;
-
-	unsigned pos = width + 3;
-	unsigned pos1 = 0;
-	unsigned pos2;
-	unsigned possecond;
-	bool done;
-	short inner; //1 for outer, 7 for inner border
-	short direction,
-			directionold; // 0:rechts, 1:rechts oben, 2:oben, ... 7:rechts unten.
-	Point p;
-
-	std::vector<Point> vec_pt;
-	int offset[8] = {1, width + 3, width + 2, width + 1,
-			-1, -width - 3, -width - 2, -width - 1};
-	float dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
-	float dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
-	float bordervolume[8] = {1, 0.75f, 0.5f, 0.25f, 2, 1.75f, 1.5f, 1.25f};
-
-	tissues_size_t* tissues = tissuelayers[idx];
-	for (unsigned i = 0; i < height; i++)
-	{
-		for (unsigned j = 0; j < width; j++)
-		{
-			tmp_bits[pos] = tissues[pos1];
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	tissues_size_t unvis = f + 1;
-	if (f == TISSUES_SIZE_MAX)
-		unvis = 0;
-	for (unsigned i = 0; i < unsigned(width + 2); i++)
-		tmp_bits[i] = unvis;
-	for (unsigned i = unsigned(width + 2) * (height + 1);
-			 i < unsigned(width + 2) * (height + 2); i++)
-		tmp_bits[i] = unvis;
-	for (unsigned i = 0; i < unsigned(width + 2) * (height + 2);
-			 i += (width + 2))
-		tmp_bits[i] = unvis;
-	for (unsigned i = width + 1; i < unsigned(width + 2) * (height + 2);
-			 i += (width + 2))
-		tmp_bits[i] = unvis;
-
-	pos = width + 2;
-	while (pos < unsigned(width + 2) * (height + 1))
-	{
-		while ((tmp_bits[pos] != f || tmp_bits[pos - 1] == f || visited[pos]) &&
-					 pos < unsigned(width + 2) * (height + 1))
-			pos++;
-
-		if (pos < unsigned(width + 2) * (height + 1))
-		{
-			pos1 = pos;
-			vec_pt.clear();
-			p.px = short(pos % (width + 2) - 1);
-			p.py = short(pos / (width + 2) - 1);
-			//			vec_pt.push_back(p);
-
-			if (tmp_bits[pos + 1] != f && tmp_bits[pos + width + 3] != f &&
-					tmp_bits[pos + width + 2] != f &&
-					tmp_bits[pos + width + 1] != f &&
-					tmp_bits[pos - width - 1] != f &&
-					tmp_bits[pos - width - 2] != f &&
-					tmp_bits[pos - width - 3] != f)
-			{
-				visited[pos] = true;
-			}
-			else
-			{
-				if (tmp_bits[pos - width - 3] == f)
-				{						 // tricky criteria
-					inner = 7; // inner line
-					directionold = direction = 1;
-				}
-				else
-				{
-					/*					if(tmp_bits[pos-width-2]==f){
-						inner=7; // inner line
-						direction=2;
-					}
-					else{*/
-					inner = 1; // outer line
-					directionold = direction = 7;
-					//					}
-				}
-
-				bubble_size = 0;
-				linelength = 0;
-
-				direction = (direction + 5 * inner) % 8;
-				done = false;
-				directionchange = 5 * inner;
-				while (!done)
-				{
-					directionchange += inner;
-					direction = (direction + inner) % 8;
-					pos2 = pos1 + offset[direction];
-					if (tmp_bits[pos2] == f)
-						done = true;
-				}
-
-				possecond = pos2;
-
-				do
-				{
-					vec_pt.push_back(p);
-					//					if(inner==1)
-					//						bmp_bits[p.px+(unsigned)width*p.py]=255-bmp_bits[p.px+(unsigned)width*p.py];//xxxxxxxxxxxxxxxxxx
-					//					if(direction<5||inner==1||tmp_bits[pos1-1]==f||directionold<4)
-					if (tmp_bits[pos1 - 1] == f ||
-							(inner == 7 &&
-									!(((direction + 6) % 8 > 2 && directionold > 3 &&
-												(directionchange + 5) % 8 > 2) ||
-											(direction == 5 && directionold == 3))) ||
-							(inner == 1 && !(((direction + 4) % 8 > 2 &&
-																	 (directionold + 7) % 8 < 4 &&
-																	 (directionchange + 5) % 8 > 2) ||
-																 (direction == 3 && directionold == 5)))
-							//					 (inner==1&&!(||(direction==3&&directionold==5)))
-					)
-						visited[pos1] = true;
-					pos1 = pos2;
-					p.px = short(pos1 % (width + 2) - 1);
-					p.py = short(pos1 / (width + 2) - 1);
-					//					vec_pt.push_back(p);
-					bubble_size += dy[direction] * (2 * p.px - dx[direction]);
-					bubble_size -= bordervolume[directionchange % 8];
-					linelength += 2;
-					//					work_bits[p.px+p.py*width]=255;
-					directionold = direction;
-					direction = (direction + 5 * inner) % 8;
-					done = false;
-					directionchange = 5 * inner;
-					while (!done)
-					{
-						directionchange += inner;
-						direction = (direction + inner) % 8;
-						pos2 = pos1 + offset[direction];
-						if (tmp_bits[pos2] == f)
-							done = true;
-					}
-				}
-				//				while(pos1!=pos||(inner==1&&pos2!=possecond));
-				while (pos1 != pos || pos2 != possecond);
-				//				while(pos1!=pos||(inner==1&&!visited[pos2]));
-				//				while(pos1!=pos);
-				//				vec_pt.pop_back();
-
-				if (inner == 7)
-				{
-					if (bubble_size < (float)minsize)
-						inner_line.push_back(vec_pt);
-				}
-			}
-			pos++;
-		}
-	}
-
-	free(visited);
-
-	std::vector<int> s;
-
-	int i4 = width + 3;
-	//int i1=0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			tmp_bits[i4] = 2;
-			i4++;
-		}
-
-		i4 += 2;
-	}
-
-	for (std::vector<std::vector<Point>>::iterator it1 = inner_line.begin();
-			 it1 != inner_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			tmp_bits[it->px + 1 + (it->py + 1) * (width + 2)] = 1;
-		}
-	}
-
-	for (int j = 0; j < width + 2; j++)
-		tmp_bits[j] = tmp_bits[j + ((unsigned)width + 2) * (height + 1)] = 0;
-	for (int j = 0; j <= ((int)width + 2) * (height + 1); j += width + 2)
-		tmp_bits[j] = tmp_bits[j + width + 1] = 0;
-
-	for (int j = width + 3; j < 2 * width + 3; j++)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = area + 2 * height + 1;
-			 j < area + width + 2 * height + 1; j++)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * width + 5; j <= area + 2 * height + 1;
-			 j += width + 2)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * width + 4; j <= area + width + 2 * height;
-			 j += width + 2)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-
-	while (!s.empty())
-	{
-		i4 = s.back();
-		s.pop_back();
-		if (tmp_bits[i4 - 1] == 2)
-		{
-			tmp_bits[i4 - 1] = TISSUES_SIZE_MAX;
-			s.push_back(i4 - 1);
-		}
-		if (tmp_bits[i4 + 1] == 2)
-		{
-			tmp_bits[i4 + 1] = TISSUES_SIZE_MAX;
-			s.push_back(i4 + 1);
-		}
-		if (tmp_bits[i4 - width - 2] == 2)
-		{
-			tmp_bits[i4 - width - 2] = TISSUES_SIZE_MAX;
-			s.push_back(i4 - width - 2);
-		}
-		if (tmp_bits[i4 + width + 2] == 2)
-		{
-			tmp_bits[i4 + width + 2] = TISSUES_SIZE_MAX;
-			s.push_back(i4 + width + 2);
-		}
-	}
-
-	i4 = width + 3;
-	int i2 = 0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			if (tmp_bits[i4] == 2)
-				tissues[i2] = f;
-			i4++;
-			i2++;
-		}
-
-		i4 += 2;
-	}
-
-	free(tmp_bits);
-
-	return;
-}
-
-void bmphandler::remove_islands(float f, int minsize)
-{
-	std::vector<std::vector<Point>> outer_line;
-	minsize = 2 * minsize;
-	float bubble_size;
-	float linelength;
-	short directionchange;
-
-	float* tmp_bits =
-			(float*)malloc(sizeof(float) * (width + 2) * (height + 2));
-	bool* visited = (bool*)malloc(sizeof(bool) * (width + 2) * (height + 2));
-	for (unsigned i = 0; i < unsigned(width + 2) * (height + 2); i++)
-		visited[i] = false;
-
-	unsigned pos = width + 3;
-	unsigned pos1 = 0;
-	unsigned pos2;
-	unsigned possecond;
-	bool done;
-	short inner; //1 for outer, 7 for inner border
-	short direction,
-			directionold; // 0:rechts, 1:rechts oben, 2:oben, ... 7:rechts unten.
-	Point p;
-
-	std::vector<Point> vec_pt;
-	int offset[8] = {1, width + 3, width + 2, width + 1,
-			-1, -width - 3, -width - 2, -width - 1};
-	float dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
-	float dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
-	float bordervolume[8] = {1, 0.75f, 0.5f, 0.25f, 2, 1.75f, 1.5f, 1.25f};
-
-	for (unsigned i = 0; i < height; i++)
-	{
-		for (unsigned j = 0; j < width; j++)
-		{
-			tmp_bits[pos] = work_bits[pos1];
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
-
-	for (unsigned i = 0; i < unsigned(width + 2); i++)
-		tmp_bits[i] = unvisited;
-	for (unsigned i = unsigned(width + 2) * (height + 1);
-			 i < unsigned(width + 2) * (height + 2); i++)
-		tmp_bits[i] = unvisited;
-	for (unsigned i = 0; i < unsigned(width + 2) * (height + 2);
-			 i += (width + 2))
-		tmp_bits[i] = unvisited;
-	for (unsigned i = width + 1; i < unsigned(width + 2) * (height + 2);
-			 i += (width + 2))
-		tmp_bits[i] = unvisited;
-
-	pos = width + 2;
-	while (pos < unsigned(width + 2) * (height + 1))
-	{
-		while ((tmp_bits[pos] != f || tmp_bits[pos - 1] == f || visited[pos]) &&
-					 pos < unsigned(width + 2) * (height + 1))
-			pos++;
-
-		if (pos < unsigned(width + 2) * (height + 1))
-		{
-			pos1 = pos;
-			vec_pt.clear();
-			p.px = short(pos % (width + 2) - 1);
-			p.py = short(pos / (width + 2) - 1);
-			//			vec_pt.push_back(p);
-
-			if (tmp_bits[pos + 1] != f && tmp_bits[pos + width + 3] != f &&
-					tmp_bits[pos + width + 2] != f &&
-					tmp_bits[pos + width + 1] != f &&
-					tmp_bits[pos - width - 1] != f &&
-					tmp_bits[pos - width - 2] != f &&
-					tmp_bits[pos - width - 3] != f)
-			{
-				visited[pos] = true;
-				vec_pt.push_back(p);
-				if (1 < minsize)
-					outer_line.push_back(vec_pt);
-			}
-			else
-			{
-				if (tmp_bits[pos - width - 3] == f)
-				{						 // tricky criteria
-					inner = 7; // inner line
-					directionold = direction = 1;
-				}
-				else
-				{
-					/*					if(tmp_bits[pos-width-2]==f){
-						inner=7; // inner line
-						direction=2;
-					}
-					else{*/
-					inner = 1; // outer line
-					directionold = direction = 7;
-					//					}
-				}
-
-				bubble_size = 0;
-				linelength = 0;
-
-				direction = (direction + 5 * inner) % 8;
-				done = false;
-				directionchange = 5 * inner;
-				while (!done)
-				{
-					directionchange += inner;
-					direction = (direction + inner) % 8;
-					pos2 = pos1 + offset[direction];
-					if (tmp_bits[pos2] == f)
-						done = true;
-				}
-
-				possecond = pos2;
-
-				do
-				{
-					vec_pt.push_back(p);
-					//					if(inner==1)
-					//						bmp_bits[p.px+(unsigned)width*p.py]=255-bmp_bits[p.px+(unsigned)width*p.py];//xxxxxxxxxxxxxxxxxx
-					//					if(direction<5||inner==1||tmp_bits[pos1-1]==f||directionold<4)
-					if (tmp_bits[pos1 - 1] == f ||
-							(inner == 7 &&
-									!(((direction + 6) % 8 > 2 && directionold > 3 &&
-												(directionchange + 5) % 8 > 2) ||
-											(direction == 5 && directionold == 3))) ||
-							(inner == 1 && !(((direction + 4) % 8 > 2 &&
-																	 (directionold + 7) % 8 < 4 &&
-																	 (directionchange + 5) % 8 > 2) ||
-																 (direction == 3 && directionold == 5)))
-							//					 (inner==1&&!(||(direction==3&&directionold==5)))
-					)
-						visited[pos1] = true;
-					pos1 = pos2;
-					p.px = short(pos1 % (width + 2) - 1);
-					p.py = short(pos1 / (width + 2) - 1);
-					//					vec_pt.push_back(p);
-					bubble_size += dy[direction] * (2 * p.px - dx[direction]);
-					bubble_size -= bordervolume[directionchange % 8];
-					linelength += 2;
-					//					work_bits[p.px+p.py*width]=255;
-					directionold = direction;
-					direction = (direction + 5 * inner) % 8;
-					done = false;
-					directionchange = 5 * inner;
-					while (!done)
-					{
-						directionchange += inner;
-						direction = (direction + inner) % 8;
-						pos2 = pos1 + offset[direction];
-						if (tmp_bits[pos2] == f)
-							done = true;
-					}
-				}
-				//				while(pos1!=pos||(inner==1&&pos2!=possecond));
-				while (pos1 != pos || pos2 != possecond);
-				//				while(pos1!=pos||(inner==1&&!visited[pos2]));
-				//				while(pos1!=pos);
-				//				vec_pt.pop_back();
-
-				if (inner == 1)
-				{
-					if (bubble_size + linelength < (float)minsize)
-						outer_line.push_back(vec_pt);
-				}
-			}
-			pos++;
-		}
-	}
-
-	free(visited);
-
-	std::vector<int> s;
-
-	int i4 = width + 3;
-	int i1 = 0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			tmp_bits[i4] = -1;
-			i4++;
-			i1++;
-		}
-
-		i4 += 2;
-	}
-
-	for (std::vector<std::vector<Point>>::iterator it1 = outer_line.begin();
-			 it1 != outer_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			tmp_bits[it->px + 1 + (it->py + 1) * (width + 2)] = 1;
-		}
-	}
-
-	for (int j = 0; j < width + 2; j++)
-		tmp_bits[j] = tmp_bits[j + ((unsigned)width + 2) * (height + 1)] = 0;
-	for (int j = 0; j <= ((int)width + 2) * (height + 1); j += width + 2)
-		tmp_bits[j] = tmp_bits[j + width + 1] = 0;
-
-	for (int j = width + 3; j < 2 * width + 3; j++)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = area + 2 * height + 1;
-			 j < area + width + 2 * height + 1; j++)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * width + 5; j <= area + 2 * height + 1;
-			 j += width + 2)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * width + 4; j <= area + width + 2 * height;
-			 j += width + 2)
-	{
-		if (tmp_bits[j] == -1)
-		{
-			tmp_bits[j] = 255.0f;
-			s.push_back(j);
-		}
-	}
-
-	hysteretic_growth(tmp_bits, &s, width + 2, height + 2, false, 255.0f);
-
-	i4 = width + 3;
-	int i2 = 0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			if (tmp_bits[i4] == 0)
-				work_bits[i2] = 0;
-			//			work_bits[i2]=tmp_bits[i4];
-			i4++;
-			i2++;
-		}
-
-		i4 += 2;
-	}
-	for (std::vector<std::vector<Point>>::iterator it1 = outer_line.begin();
-			 it1 != outer_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			work_bits[it->px + it->py * width] = 0;
-		}
-	}
-
-	free(tmp_bits);
-
-	return;
-}
-
-void bmphandler::remove_islandstissue(tissuelayers_size_t idx, tissues_size_t f,
-		int minsize)
-{
-	std::vector<std::vector<Point>> outer_line;
-	minsize = 2 * minsize;
-	float bubble_size;
-	float linelength;
-	short directionchange;
-
-	tissues_size_t* tmp_bits = (tissues_size_t*)malloc(
-			sizeof(tissues_size_t) * (width + 2) * (height + 2));
-	bool* visited = (bool*)malloc(sizeof(bool) * (width + 2) * (height + 2));
-	for (unsigned i = 0; i < unsigned(width + 2) * (height + 2); i++)
-		visited[i] = false;
-
-	unsigned pos = width + 3;
-	unsigned pos1 = 0;
-	unsigned pos2;
-	unsigned possecond;
-	bool done;
-	short inner; //1 for outer, 7 for inner border
-	short direction,
-			directionold; // 0:rechts, 1:rechts oben, 2:oben, ... 7:rechts unten.
-	Point p;
-
-	std::vector<Point> vec_pt;
-	int offset[8] = {1, width + 3, width + 2, width + 1,
-			-1, -width - 3, -width - 2, -width - 1};
-	float dy[8] = {0, 1, 1, 1, 0, -1, -1, -1};
-	float dx[8] = {1, 1, 0, -1, -1, -1, 0, 1};
-	float bordervolume[8] = {1, 0.75f, 0.5f, 0.25f, 2, 1.75f, 1.5f, 1.25f};
-
-	tissues_size_t* tissues = tissuelayers[idx];
-	for (unsigned i = 0; i < height; i++)
-	{
-		for (unsigned j = 0; j < width; j++)
-		{
-			tmp_bits[pos] = tissues[pos1];
-			pos++;
-			pos1++;
-		}
-		pos += 2;
-	}
+		F is_locked)
+{
+	unsigned short dist = radius * radius;
 
-	tissues_size_t unvis = f + 1;
-	if (f == TISSUES_SIZE_MAX)
-		unvis = 0;
-	for (unsigned i = 0; i < unsigned(width + 2); i++)
-		tmp_bits[i] = unvis;
-	for (unsigned i = unsigned(width + 2) * (height + 1);
-			 i < unsigned(width + 2) * (height + 2); i++)
-		tmp_bits[i] = unvis;
-	for (unsigned i = 0; i < unsigned(width + 2) * (height + 2);
-			 i += (width + 2))
-		tmp_bits[i] = unvis;
-	for (unsigned i = width + 1; i < unsigned(width + 2) * (height + 2);
-			 i += (width + 2))
-		tmp_bits[i] = unvis;
+	int xmin, xmax, ymin, ymax, d;
+	if (p.px < radius)
+		xmin = 0;
+	else
+		xmin = int(p.px - radius);
+	if (p.px + radius >= width)
+		xmax = int(width - 1);
+	else
+		xmax = int(p.px + radius);
 
-	pos = width + 2;
-	while (pos < unsigned(width + 2) * (height + 1))
+	for (int x = xmin; x <= xmax; x++)
 	{
-		while ((tmp_bits[pos] != f || tmp_bits[pos - 1] == f || visited[pos]) &&
-					 pos < unsigned(width + 2) * (height + 1))
-			pos++;
+		d = int(floor(sqrt(float(dist - (x - p.px) * (x - p.px)))));
+		ymin = std::max(0, int(p.py) - d);
+		ymax = std::min(int(height - 1), d + p.py);
 
-		if (pos < unsigned(width + 2) * (height + 1))
+		for (int y = ymin; y <= ymax; y++)
 		{
-			pos1 = pos;
-			vec_pt.clear();
-			p.px = short(pos % (width + 2) - 1);
-			p.py = short(pos / (width + 2) - 1);
-			//			vec_pt.push_back(p);
+			// don't modify locked pixels
+			if (is_locked(data[y * unsigned(width) + x]))
+				continue;
 
-			if (tmp_bits[pos + 1] != f && tmp_bits[pos + width + 3] != f &&
-					tmp_bits[pos + width + 2] != f &&
-					tmp_bits[pos + width + 1] != f &&
-					tmp_bits[pos - width - 1] != f &&
-					tmp_bits[pos - width - 2] != f &&
-					tmp_bits[pos - width - 3] != f)
+			if (draw)
 			{
-				visited[pos] = true;
-				vec_pt.push_back(p);
-				if (1 < minsize)
-					outer_line.push_back(vec_pt);
+				data[y * unsigned(width) + x] = f;
 			}
 			else
 			{
-				if (tmp_bits[pos - width - 3] == f)
-				{						 // tricky criteria
-					inner = 7; // inner line
-					directionold = direction = 1;
-				}
-				else
-				{
-					/*					if(tmp_bits[pos-width-2]==f){
-						inner=7; // inner line
-						direction=2;
-					}
-					else{*/
-					inner = 1; // outer line
-					directionold = direction = 7;
-					//					}
-				}
-
-				bubble_size = 0;
-				linelength = 0;
+				if (data[y * unsigned(width) + x] == f)
+					data[y * unsigned(width) + x] = f1;
+			}
+		}
+	}
+}
 
-				direction = (direction + 5 * inner) % 8;
-				done = false;
-				directionchange = 5 * inner;
-				while (!done)
-				{
-					directionchange += inner;
-					direction = (direction + inner) % 8;
-					pos2 = pos1 + offset[direction];
-					if (tmp_bits[pos2] == f)
-						done = true;
-				}
+template<typename T, typename F>
+void bmphandler::_brush(T* data, T f, Point p, float const radius, float dx,
+		float dy, bool draw, T f1, F is_locked)
+{
+	float const radius_corrected = dx > dy
+																		 ? std::floor(radius / dx + 0.5f) * dx
+																		 : std::floor(radius / dy + 0.5f) * dy;
+	float const radius_corrected2 = radius_corrected * radius_corrected;
 
-				possecond = pos2;
+	int const xradius = std::ceil(radius_corrected / dx);
+	int const yradius = std::ceil(radius_corrected / dy);
+	for (int x = std::max(0, p.px - xradius); x <= std::min(static_cast<int>(width) - 1, p.px + xradius); x++)
+	{
+		for (int y = std::max(0, p.py - yradius); y <= std::min(static_cast<int>(height) - 1, p.py + yradius); y++)
+		{
+			// don't modify locked pixels
+			if (is_locked(data[y * unsigned(width) + x]))
+				continue;
 
-				do
+			if (std::pow(dx * (p.px - x), 2.f) + std::pow(dy * (p.py - y), 2.f) <= radius_corrected2)
+			{
+				if (draw)
 				{
-					vec_pt.push_back(p);
-					//					if(inner==1)
-					//						bmp_bits[p.px+(unsigned)width*p.py]=255-bmp_bits[p.px+(unsigned)width*p.py];//xxxxxxxxxxxxxxxxxx
-					//					if(direction<5||inner==1||tmp_bits[pos1-1]==f||directionold<4)
-					if (tmp_bits[pos1 - 1] == f ||
-							(inner == 7 &&
-									!(((direction + 6) % 8 > 2 && directionold > 3 &&
-												(directionchange + 5) % 8 > 2) ||
-											(direction == 5 && directionold == 3))) ||
-							(inner == 1 && !(((direction + 4) % 8 > 2 &&
-																	 (directionold + 7) % 8 < 4 &&
-																	 (directionchange + 5) % 8 > 2) ||
-																 (direction == 3 && directionold == 5)))
-							//					 (inner==1&&!(||(direction==3&&directionold==5)))
-					)
-						visited[pos1] = true;
-					pos1 = pos2;
-					p.px = short(pos1 % (width + 2) - 1);
-					p.py = short(pos1 / (width + 2) - 1);
-					//					vec_pt.push_back(p);
-					bubble_size += dy[direction] * (2 * p.px - dx[direction]);
-					bubble_size -= bordervolume[directionchange % 8];
-					linelength += 2;
-					//					work_bits[p.px+p.py*width]=255;
-					directionold = direction;
-					direction = (direction + 5 * inner) % 8;
-					done = false;
-					directionchange = 5 * inner;
-					while (!done)
-					{
-						directionchange += inner;
-						direction = (direction + inner) % 8;
-						pos2 = pos1 + offset[direction];
-						if (tmp_bits[pos2] == f)
-							done = true;
-					}
+					data[y * unsigned(width) + x] = f;
 				}
-				//				while(pos1!=pos||(inner==1&&pos2!=possecond));
-				while (pos1 != pos || pos2 != possecond);
-				//				while(pos1!=pos||(inner==1&&!visited[pos2]));
-				//				while(pos1!=pos);
-				//				vec_pt.pop_back();
-
-				if (inner == 1)
+				else
 				{
-					if (bubble_size + linelength < (float)minsize)
-						outer_line.push_back(vec_pt);
+					if (data[y * unsigned(width) + x] == f)
+						data[y * unsigned(width) + x] = f1;
 				}
 			}
-			pos++;
 		}
 	}
+}
 
-	free(visited);
-
-	std::vector<int> s;
+void bmphandler::brush(float f, Point p, int radius, bool draw)
+{
+	_brush(work_bits, f, p, radius, draw, 0.f, [](float v) { return false; });
+}
 
-	int i4 = width + 3;
-	//int i1=0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			tmp_bits[i4] = 2;
-			i4++;
-		}
+void bmphandler::brush(float f, Point p, float radius, float dx, float dy, bool draw)
+{
+	_brush(work_bits, f, p, radius, dx, dy, draw, 0.f,
+			[](float v) { return false; });
+}
 
-		i4 += 2;
-	}
+void bmphandler::brushtissue(tissuelayers_size_t idx, tissues_size_t f, Point p,
+		int radius, bool draw, tissues_size_t f1)
+{
+	_brush(tissuelayers[idx], f, p, radius, draw, f1,
+			[](tissues_size_t v) { return TissueInfos::GetTissueLocked(v); });
+}
 
-	for (std::vector<std::vector<Point>>::iterator it1 = outer_line.begin();
-			 it1 != outer_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			tmp_bits[it->px + 1 + (it->py + 1) * (width + 2)] = 1;
-		}
-	}
+void bmphandler::brushtissue(tissuelayers_size_t idx, tissues_size_t f, Point p,
+		float radius, float dx, float dy, bool draw,
+		tissues_size_t f1)
+{
+	_brush(tissuelayers[idx], f, p, radius, dx, dy, draw, f1,
+			[](tissues_size_t v) { return TissueInfos::GetTissueLocked(v); });
+}
 
-	for (int j = 0; j < width + 2; j++)
-		tmp_bits[j] = tmp_bits[j + ((unsigned)width + 2) * (height + 1)] = 0;
-	for (int j = 0; j <= ((int)width + 2) * (height + 1); j += width + 2)
-		tmp_bits[j] = tmp_bits[j + width + 1] = 0;
+template<typename T>
+void bmphandler::remove_small_components(T* data, T f, bool holes, int minsize, T setto)
+{
+	// islands of f are 8-connected, the holes in them 4-connected
+	ComponentLabeling labeling(data, width, height, holes ? ComponentLabeling::kFaces : ComponentLabeling::kEdges, [f](T v) { return v == f; });
 
-	for (int j = width + 3; j < 2 * width + 3; j++)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = area + 2 * height + 1;
-			 j < area + width + 2 * height + 1; j++)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 2 * width + 5; j <= area + 2 * height + 1;
-			 j += width + 2)
-	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
-	}
-	for (unsigned int j = 3 * width + 4; j <= area + width + 2 * height;
-			 j += width + 2)
+	std::size_t const max_size = static_cast<std::size_t>(std::max(minsize, 0));
+	std::vector<unsigned char> remove(labeling.number_of_components(), 0);
+	for (unsigned label = 0; label < labeling.number_of_components(); label++)
 	{
-		if (tmp_bits[j] == 2)
-		{
-			tmp_bits[j] = TISSUES_SIZE_MAX;
-			s.push_back(j);
-		}
+		auto const& c = labeling.component(label);
+		bool const is_f = (data[c.offset] == f);
+		remove[label] = c.size < max_size && (holes ? (!is_f && !c.at_border) : is_f);
 	}
 
-	while (!s.empty())
+	for (unsigned short y = 0; y < height; y++)
 	{
-		i4 = s.back();
-		s.pop_back();
-		if (tmp_bits[i4 - 1] == 2)
-		{
-			tmp_bits[i4 - 1] = TISSUES_SIZE_MAX;
-			s.push_back(i4 - 1);
-		}
-		if (tmp_bits[i4 + 1] == 2)
-		{
-			tmp_bits[i4 + 1] = TISSUES_SIZE_MAX;
-			s.push_back(i4 + 1);
-		}
-		if (tmp_bits[i4 - width - 2] == 2)
-		{
-			tmp_bits[i4 - width - 2] = TISSUES_SIZE_MAX;
-			s.push_back(i4 - width - 2);
-		}
-		if (tmp_bits[i4 + width + 2] == 2)
+		T* row = data + unsigned(y) * width;
+		for (auto run = labeling.runs_begin(0, y); run != labeling.runs_end(0, y); ++run)
 		{
-			tmp_bits[i4 + width + 2] = TISSUES_SIZE_MAX;
-			s.push_back(i4 + width + 2);
+			if (remove[run->label])
+				std::fill(row + run->begin, row + run->end, setto);
 		}
 	}
+}
 
-	i4 = width + 3;
-	int i2 = 0;
-	for (int j = 0; j < height; j++)
-	{
-		for (int k = 0; k < width; k++)
-		{
-			if (tmp_bits[i4] == 2)
-				tissues[i2] = 0;
-			i4++;
-			i2++;
-		}
+void bmphandler::fill_holes(float f, int minsize)
+{
+	remove_small_components(work_bits, f, true, minsize, f);
+}
 
-		i4 += 2;
-	}
-	for (std::vector<std::vector<Point>>::iterator it1 = outer_line.begin();
-			 it1 != outer_line.end(); it1++)
-	{
-		for (std::vector<Point>::iterator it = it1->begin(); it != it1->end(); it++)
-		{
-			tissues[it->px + it->py * width] = 0;
-		}
-	}
+void bmphandler::fill_holestissue(tissuelayers_size_t idx, tissues_size_t f,
+		int minsize)
+{
+	remove_small_components(tissuelayers[idx], f, true, minsize, f);
+}
 
-	free(tmp_bits);
+void bmphandler::remove_islands(float f, int minsize)
+{
+	remove_small_components(work_bits, f, false, minsize, 0.f);
+}
 
-	return;
+void bmphandler::remove_islandstissue(tissuelayers_size_t idx, tissues_size_t f,
+		int minsize)
+{
+	remove_small_components(tissuelayers[idx], f, false, minsize, tissues_size_t(0));
 }
 
 /*void bmphandler::add_skin(unsigned i)
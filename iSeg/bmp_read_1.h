@@ -27,6 +27,7 @@ class ImageForestingTransformLivewire;
 class ImageForestingTransformFastMarching;
 class SliceProvider;
 class SliceProviderInstaller;
+class VolumeStorage;
 
 const unsigned int unvisited = 222222;
 const float f_tol = 0.00001f;
@@ -105,6 +106,10 @@ public:
 	float* swap_bmp_pointer(float* bits);
 	float* swap_work_pointer(float* bits);
 	tissues_size_t* swap_tissues_pointer(tissuelayers_size_t idx, tissues_size_t* bits);
+	/// Make source, target and tissue layer 0 views into external memory (e.g. a VolumeStorage), copying the current content unless 'copy' is false
+	void bind_storage(float* bmp, float* work, tissues_size_t* tissues, bool copy = true);
+	/// Copy data owned by 'storage' (or by any VolumeStorage if nullptr) into slice-owned buffers
+	void unbind_storage(const VolumeStorage* storage = nullptr);
 	void copy2bmp(float* bits, unsigned char mode);
 	void copy2work(float* bits, unsigned char mode);
 	void copy2work(float* bits, bool* mask, unsigned char mode);
@@ -417,6 +422,12 @@ protected:
 	inline unsigned int pt2coord(Point p);
 	float* make_gaussfilter(float sigma, int n);
 	float* make_laplacianfilter();
+	/// Filters bmp_bits with kernel[0..n-1] along x and y into work_bits, borders are replicated
+	void convolute_separable(const float* kernel, unsigned n);
+	/// Sets work_bits to 0 on the contours of the regions with value f in bmp_bits, and to DistanceTransform::kInfinity elsewhere
+	void contour_features(float f);
+	/// Replaces the features in work_bits by the exact (squared) Euclidean distance to them, see DistanceTransform
+	void feature_distance(unsigned* nearest, bool squared);
 	unsigned deepest_con_bas(unsigned k);
 	void cond_merge(unsigned m, unsigned h);
 	unsigned label_lookup(unsigned i, unsigned* wshed);
@@ -424,12 +435,14 @@ protected:
 	int SaveRaw(const char* filename, float* p_bits);
 	void bucketsort(std::vector<unsigned int>* sorted, float* p_bits);
 	void set_marker(unsigned* wshed);
-	float base_connection(float c, std::vector<float>* maps);
 	void hysteretic_growth(float* pict, std::vector<int>* s, unsigned short w,
 			unsigned short h, bool connectivity, float set_to);
 	void hysteretic_growth(float* pict, std::vector<int>* s, unsigned short w,
 			unsigned short h, bool connectivity, float set_to,
 			int nr);
+	/// Sets the islands of f (or the holes in them, not at the border) with less than minsize pixels to setto
+	template<typename T>
+	void remove_small_components(T* data, T f, bool holes, int minsize, T setto);
 	template<typename T, typename F>
 	void _brush(T* data, T f, Point p, int radius, bool draw, T f1, F);
 	template<typename T, typename F>
@@ -39,8 +39,10 @@
 #define vtkNew(type, name) vtkSmartPointer<type> name = vtkSmartPointer<type>::New()
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <list>
+#include <map>
 #include <set>
 
 #include "predicates.h"
@@ -156,7 +158,9 @@ vtkEdgeCollapse::vtkEdgeCollapse()
 	this->MaximumEdgeLength = VTK_DOUBLE_MAX;
 	this->MeshIsManifold = 0;
 	this->DomainLabelName = 0;
+	this->FixedPointsArrayName = 0;
 	this->IntersectionCheckLevel = 2;
+	this->BatchCollapse = 0;
 	this->NumberOfClosestPoints = 30; // currently not used
 	this->Loud = 0;
 
@@ -183,6 +187,10 @@ vtkEdgeCollapse::~vtkEdgeCollapse()
 	{
 		delete[] this->DomainLabelName;
 	}
+	if (this->FixedPointsArrayName != 0)
+	{
+		delete[] this->FixedPointsArrayName;
+	}
 }
 
 //----------------------------------------------------------------------------
@@ -270,47 +278,27 @@ int vtkEdgeCollapse::RequestData(vtkInformation* vtkNotUsed(request),
 	}
 	numTris = this->Mesh->GetNumberOfPolys();
 	numPts = this->Mesh->GetNumberOfPoints();
-	this->UpdateProgress(0.1);
 
-	// Compute edges and priority for each edge
-	this->Edges->InitEdgeInsertion(numPts, 1); // storing edge id as attribute
-	this->EdgeCosts->Allocate(this->Mesh->GetPolys()->GetNumberOfCells() * 3);
-	for (i = 0; i < this->Mesh->GetNumberOfCells(); i++)
+	// Points which must not be removed
+	isfixed.clear();
+	if (FixedPointsArrayName != 0 && strlen(FixedPointsArrayName) > 0)
 	{
-		if (this->Mesh->GetCellType(i) != VTK_TRIANGLE)
-			continue;
-		this->Mesh->GetCellPoints(i, npts, pts);
-
-		for (j = 0; j < 3; j++)
+		vtkDataArray* fixed = input->GetPointData()->GetArray(FixedPointsArrayName);
+		if (fixed && fixed->GetNumberOfTuples() == numPts)
 		{
-			if (this->Edges->IsEdge(pts[j], pts[(j + 1) % 3]) == -1)
+			isfixed.resize(numPts, false);
+			for (i = 0; i < numPts; i++)
 			{
-				// If this edge has not been processed, get an id for it, add it to
-				// the edge list (Edges), and add its endpoints to the EndPoint1List
-				// and EndPoint2List (the 2 endpoints to different lists).
-				edgeId = this->Edges->GetNumberOfEdges();
-				this->Edges->InsertEdge(pts[j], pts[(j + 1) % 3], edgeId);
-				this->EndPoint1List->InsertId(edgeId, pts[j]);
-				this->EndPoint2List->InsertId(edgeId, pts[(j + 1) % 3]);
+				isfixed[i] = (fixed->GetTuple1(i) != 0);
 			}
 		}
-	}
-
-	// Compute the cost of and target point for collapsing each edge.
-	for (i = 0; i < this->Edges->GetNumberOfEdges(); i++)
-	{
-		endPtIds[0] = this->EndPoint1List->GetId(i);
-		endPtIds[1] = this->EndPoint2List->GetId(i);
-
-		this->Mesh->GetPoint(endPtIds[0], x1);
-		this->Mesh->GetPoint(endPtIds[1], x2);
-		cost = vtkMath::Distance2BetweenPoints(x1, x2);
-		if (cost < MinLength2)
+		else
 		{
-			this->EdgeCosts->Insert(cost, i);
+			std::cerr << "WARNING: could not locate point data array "
+					  << FixedPointsArrayName << std::endl;
 		}
 	}
-	this->UpdateProgress(0.15);
+	this->UpdateProgress(0.1);
 
 	// Compute normals, used to detect how much surface changes after collapse
 	this->ComputeNormals(input);
@@ -320,54 +308,104 @@ int vtkEdgeCollapse::RequestData(vtkInformation* vtkNotUsed(request),
 
 	this->UpdateProgress(0.2);
 
-	// OK collapse edges until desired reduction is reached
-	if (Loud)
-		cout << "Starting edge collapse" << endl;
-	int numEdgesToCollapse = this->EdgeCosts->GetNumberOfItems() * 0.5;
-	int abort = 0, processed = 0;
-	edgeId = this->EdgeCosts->Pop(0, cost);
-	while (!abort && edgeId >= 0)
+	int abort = 0;
+	if (this->BatchCollapse)
 	{
-		if (!(processed++ % 1000))
+		if (Loud)
+			cout << "Starting batch edge collapse" << endl;
+		numDeletedTris = this->CollapseEdgesInBatches(numTris);
+		abort = this->GetAbortExecute();
+	}
+	else
+	{
+		// Compute edges and priority for each edge
+		this->Edges->InitEdgeInsertion(numPts, 1); // storing edge id as attribute
+		this->EdgeCosts->Allocate(this->Mesh->GetPolys()->GetNumberOfCells() * 3);
+		for (i = 0; i < this->Mesh->GetNumberOfCells(); i++)
 		{
-			double myprogress =
-				std::min(1.0, 0.25 + 0.75 * processed / numEdgesToCollapse);
-			printf("\rProgress = %3f", myprogress);
-			this->UpdateProgress(myprogress);
-			abort = this->GetAbortExecute();
+			if (this->Mesh->GetCellType(i) != VTK_TRIANGLE)
+				continue;
+			this->Mesh->GetCellPoints(i, npts, pts);
+
+			for (j = 0; j < 3; j++)
+			{
+				if (this->Edges->IsEdge(pts[j], pts[(j + 1) % 3]) == -1)
+				{
+					// If this edge has not been processed, get an id for it, add it to
+					// the edge list (Edges), and add its endpoints to the EndPoint1List
+					// and EndPoint2List (the 2 endpoints to different lists).
+					edgeId = this->Edges->GetNumberOfEdges();
+					this->Edges->InsertEdge(pts[j], pts[(j + 1) % 3], edgeId);
+					this->EndPoint1List->InsertId(edgeId, pts[j]);
+					this->EndPoint2List->InsertId(edgeId, pts[(j + 1) % 3]);
+				}
+			}
 		}
 
-		endPtIds[0] = this->EndPoint1List->GetId(edgeId);
-		endPtIds[1] = this->EndPoint2List->GetId(edgeId);
+		// Compute the cost of and target point for collapsing each edge.
+		for (i = 0; i < this->Edges->GetNumberOfEdges(); i++)
+		{
+			endPtIds[0] = this->EndPoint1List->GetId(i);
+			endPtIds[1] = this->EndPoint2List->GetId(i);
 
-		// Keep node endPtIds[0] (later remove unused node endPtIds[1])
-		if (isboundary[endPtIds[1]])
-			std::swap(endPtIds[0], endPtIds[1]);
+			this->Mesh->GetPoint(endPtIds[0], x1);
+			this->Mesh->GetPoint(endPtIds[1], x2);
+			cost = vtkMath::Distance2BetweenPoints(x1, x2);
+			if (cost < MinLength2)
+			{
+				this->EdgeCosts->Insert(cost, i);
+			}
+		}
 
-		if (this->IsCollapseLegal(endPtIds[0], endPtIds[1]))
+		// OK collapse edges until desired reduction is reached
+		if (Loud)
+			cout << "Starting edge collapse" << endl;
+		int numEdgesToCollapse = this->EdgeCosts->GetNumberOfItems() * 0.5;
+		int processed = 0;
+		edgeId = this->EdgeCosts->Pop(0, cost);
+		while (!abort && edgeId >= 0)
 		{
-			this->NumberOfEdgeCollapses++;
+			if (!(processed++ % 1000))
+			{
+				double myprogress =
+					std::min(1.0, 0.25 + 0.75 * processed / numEdgesToCollapse);
+				printf("\rProgress = %3f", myprogress);
+				this->UpdateProgress(myprogress);
+				abort = this->GetAbortExecute();
+			}
 
-			this->UpdateEdgeData(endPtIds[0], endPtIds[1]);
+			endPtIds[0] = this->EndPoint1List->GetId(edgeId);
+			endPtIds[1] = this->EndPoint2List->GetId(edgeId);
 
-			// Update the output triangles.
-			numDeletedTris += this->CollapseEdge(endPtIds[0], endPtIds[1]);
-			this->ActualReduction = (double)numDeletedTris / numTris;
-		}
-		else if (this->IsCollapseLegal(endPtIds[1], endPtIds[0]))
-		{
-			this->NumberOfEdgeCollapses++;
+			// Keep node endPtIds[0] (later remove unused node endPtIds[1])
+			if (isboundary[endPtIds[1]])
+				std::swap(endPtIds[0], endPtIds[1]);
 
-			this->UpdateEdgeData(endPtIds[1], endPtIds[0]);
+			if (this->IsCollapseLegal(endPtIds[0], endPtIds[1]))
+			{
+				this->NumberOfEdgeCollapses++;
 
-			// Update the output triangles.
-			numDeletedTris += this->CollapseEdge(endPtIds[1], endPtIds[0]);
-			this->ActualReduction = (double)numDeletedTris / numTris;
-		}
+				this->UpdateEdgeData(endPtIds[0], endPtIds[1]);
 
-		edgeId = this->EdgeCosts->Pop(0, cost);
+				// Update the output triangles.
+				numDeletedTris += this->CollapseEdge(endPtIds[0], endPtIds[1]);
+				this->ActualReduction = (double)numDeletedTris / numTris;
+			}
+			else if (this->IsCollapseLegal(endPtIds[1], endPtIds[0]))
+			{
+				this->NumberOfEdgeCollapses++;
+
+				this->UpdateEdgeData(endPtIds[1], endPtIds[0]);
+
+				// Update the output triangles.
+				numDeletedTris += this->CollapseEdge(endPtIds[1], endPtIds[0]);
+				this->ActualReduction = (double)numDeletedTris / numTris;
+			}
+
+			edgeId = this->EdgeCosts->Pop(0, cost);
+		}
+		printf("\n");
 	}
-	printf("\n");
 
 	// Perform flipping to improve the angles
 	if (this->FlipEdges && !abort)
@@ -706,6 +744,178 @@ int vtkEdgeCollapse::CollapseEdge(vtkIdType pt0Id, vtkIdType pt1Id)
 	return numDeleted;
 }
 
+//----------------------------------------------------------------------------
+int vtkEdgeCollapse::CollapseEdgesInBatches(vtkIdType numTris)
+{
+	struct ShortEdge
+	{
+		double cost;
+		vtkIdType p0, p1;
+		bool operator<(const ShortEdge& rhs) const
+		{
+			if (cost != rhs.cost)
+				return cost < rhs.cost;
+			return p0 < rhs.p0 || (p0 == rhs.p0 && p1 < rhs.p1);
+		}
+		bool operator==(const ShortEdge& rhs) const
+		{
+			return p0 == rhs.p0 && p1 == rhs.p1;
+		}
+	};
+	typedef std::pair<vtkIdType, vtkIdType> Edge;
+
+	vtkIdType const numPts = this->Mesh->GetNumberOfPoints();
+	vtkIdType const numCells = this->Mesh->GetNumberOfCells();
+	vtkIdType npts, *pts;
+	unsigned short ncells;
+	vtkIdType* cells;
+	double x1[3], x2[3];
+
+	// With IntersectionCheckLevel >= 4 the self-intersection test includes all
+	// triangles in a bounding box, which can overlap with other collapses of the
+	// same batch. Then the tests are done serially, right before each collapse.
+	bool const parallel_checks = (this->IntersectionCheckLevel < 4);
+
+	// Pass in which the 1-ring of a point was claimed by a selected edge
+	std::vector<int> claimed(numPts, -1);
+	// Pass in which the edges at a point changed (point was kept by a collapse)
+	std::vector<int> modified(numPts, -1);
+	// Pass in which a collapse was found to be illegal. As in the sequential
+	// algorithm, it is only tested again if one of the end points is modified.
+	std::map<Edge, int> rejected;
+
+	auto ring_is_free = [&](vtkIdType p, int pass) {
+		this->Mesh->GetPointCells(p, ncells, cells);
+		for (unsigned short k = 0; k < ncells; k++)
+		{
+			this->Mesh->GetCellPoints(cells[k], npts, pts);
+			if (claimed[pts[0]] == pass || claimed[pts[1]] == pass ||
+				claimed[pts[2]] == pass)
+				return false;
+		}
+		return true;
+	};
+	auto claim_ring = [&](vtkIdType p, int pass) {
+		this->Mesh->GetPointCells(p, ncells, cells);
+		for (unsigned short k = 0; k < ncells; k++)
+		{
+			this->Mesh->GetCellPoints(cells[k], npts, pts);
+			claimed[pts[0]] = claimed[pts[1]] = claimed[pts[2]] = pass;
+		}
+	};
+	// Returns the point to remove, or -1 if the edge cannot be collapsed
+	auto choose_collapse = [this](vtkIdType p0, vtkIdType p1) -> vtkIdType {
+		// Keep node p0 (remove p1)
+		if (isboundary[p1])
+			std::swap(p0, p1);
+		if (this->IsCollapseLegal(p0, p1))
+			return p1;
+		if (this->IsCollapseLegal(p1, p0))
+			return p0;
+		return -1;
+	};
+
+	int numDeleted = 0;
+	size_t numInitialCandidates = 0;
+	std::vector<ShortEdge> candidates, batch;
+	std::vector<vtkIdType> removed;
+	for (int pass = 0; !this->GetAbortExecute(); pass++)
+	{
+		// Collect the short edges of the current mesh
+		candidates.clear();
+		for (vtkIdType c = 0; c < numCells; c++)
+		{
+			if (this->Mesh->GetCellType(c) != VTK_TRIANGLE)
+				continue;
+			this->Mesh->GetCellPoints(c, npts, pts);
+			for (int j = 0; j < 3; j++)
+			{
+				ShortEdge e;
+				e.p0 = std::min(pts[j], pts[(j + 1) % 3]);
+				e.p1 = std::max(pts[j], pts[(j + 1) % 3]);
+				this->Mesh->GetPoint(e.p0, x1);
+				this->Mesh->GetPoint(e.p1, x2);
+				e.cost = vtkMath::Distance2BetweenPoints(x1, x2);
+				if (e.cost >= MinLength2)
+					continue;
+
+				std::map<Edge, int>::const_iterator r =
+					rejected.find(Edge(e.p0, e.p1));
+				if (r != rejected.end() && modified[e.p0] <= r->second &&
+					modified[e.p1] <= r->second)
+					continue;
+				candidates.push_back(e);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()),
+						 candidates.end());
+		if (pass == 0)
+			numInitialCandidates = candidates.size();
+
+		// Select shortest edges first, such that the closed 1-rings of the
+		// selected edges are disjoint. A collapse then only changes triangles
+		// which are not seen by the checks of the other edges in the batch.
+		batch.clear();
+		for (size_t k = 0; k < candidates.size(); k++)
+		{
+			ShortEdge const& e = candidates[k];
+			if (ring_is_free(e.p0, pass) && ring_is_free(e.p1, pass))
+			{
+				claim_ring(e.p0, pass);
+				claim_ring(e.p1, pass);
+				batch.push_back(e);
+			}
+		}
+		if (batch.empty())
+			break;
+
+		removed.assign(batch.size(), -1);
+		if (parallel_checks)
+		{
+			std::int64_t const num_batch = static_cast<std::int64_t>(batch.size());
+#pragma omp parallel for schedule(dynamic, 16)
+			for (std::int64_t k = 0; k < num_batch; k++)
+			{
+				removed[k] = choose_collapse(batch[k].p0, batch[k].p1);
+			}
+		}
+
+		for (size_t k = 0; k < batch.size(); k++)
+		{
+			if (!parallel_checks)
+			{
+				removed[k] = choose_collapse(batch[k].p0, batch[k].p1);
+			}
+
+			if (removed[k] < 0)
+			{
+				rejected[Edge(batch[k].p0, batch[k].p1)] = pass;
+				continue;
+			}
+
+			vtkIdType kept = (removed[k] == batch[k].p0) ? batch[k].p1 : batch[k].p0;
+			this->NumberOfEdgeCollapses++;
+			numDeleted += this->CollapseEdge(kept, removed[k]);
+			modified[kept] = pass;
+		}
+		this->ActualReduction = (double)numDeleted / numTris;
+
+		double myprogress = 1.0;
+		if (numInitialCandidates > 0)
+		{
+			myprogress = 0.25 + 0.75 * (1.0 - (double)candidates.size() / numInitialCandidates);
+		}
+		this->UpdateProgress(std::max(0.25, std::min(1.0, myprogress)));
+
+		if (Loud)
+			cout << "Pass " << pass << ": " << candidates.size()
+				 << " candidates, " << batch.size() << " selected" << endl;
+	}
+
+	return numDeleted;
+}
+
 //----------------------------------------------------------------------------
 // FIXME: memory allocation clean up
 void vtkEdgeCollapse::UpdateEdgeData(vtkIdType pt0Id, vtkIdType pt1Id)
@@ -921,21 +1131,37 @@ void vtkEdgeCollapse::ComputeManifoldedness()
 //----------------------------------------------------------------------------
 bool vtkEdgeCollapse::IsCollapseLegal(vtkIdType i1, vtkIdType i2)
 { // Assumption is that i2 will be removed (moved to i1)
+	// Note: the neighborhoods are read directly from the cell links (no shared
+	// vtkIdList), i.e. the test only reads the mesh and can be evaluated for
+	// several edges concurrently (except for IntersectionCheckLevel >= 4).
 	vtkIdType* pts;
 	vtkIdType npts;
+	unsigned short ncells1, ncells2;
+	vtkIdType *cells1, *cells2;
+
+	if (i1 == i2)
+		return false;
+
 	// Check if either i1 or i2 is deleted, i.e. has no cells
-	this->Mesh->GetPointCells(i1, this->Neighbors);
-	if (this->Neighbors->GetNumberOfIds() == 0)
+	this->Mesh->GetPointCells(i1, ncells1, cells1);
+	if (ncells1 == 0)
 		return false;
-	this->Mesh->GetPointCells(i2, this->Neighbors);
-	if (this->Neighbors->GetNumberOfIds() == 0)
+	this->Mesh->GetPointCells(i2, ncells2, cells2);
+	if (ncells2 == 0)
 		return false;
 
-	if (i1 == i2)
+	// Fixed points are kept
+	if (!isfixed.empty() && isfixed[i2])
 		return false;
 
-	this->Mesh->GetCellEdgeNeighbors(-1, i1, i2, this->CollapseCellIds);
-	int edge_tris = this->CollapseCellIds->GetNumberOfIds();
+	// Count the triangles at the edge i1,i2
+	int edge_tris = 0;
+	for (unsigned short k = 0; k < ncells2; k++)
+	{
+		this->Mesh->GetCellPoints(cells2[k], npts, pts);
+		if (pts[0] == i1 || pts[1] == i1 || pts[2] == i1)
+			edge_tris++;
+	}
 	if (edge_tris == 0)
 		return false;
 
@@ -947,16 +1173,15 @@ bool vtkEdgeCollapse::IsCollapseLegal(vtkIdType i1, vtkIdType i2)
 	//
 	// There should only be 2 degenerate triangles (if mesh is manifold)
 	//
-	// this->Mesh->GetPointCells(i2, this->Neighbors); called above
 	int countDegenerate = 0;
 	double normal_new[3];
 	double normal[3];
-	std::list<vtkIdType> degenerate;
-	for (int k = 0; k < this->Neighbors->GetNumberOfIds(); k++)
+	std::vector<vtkIdType> degenerate;
+	for (unsigned short k = 0; k < ncells2; k++)
 	{
-		vtkIdType cellId = this->Neighbors->GetId(k);
-		this->Mesh->GetCellPoints(cellId, this->PointIds);
-		vtkIdType* ids = this->PointIds->GetPointer(0);
+		vtkIdType cellId = cells2[k];
+		this->Mesh->GetCellPoints(cellId, npts, pts);
+		vtkIdType ids[3] = {pts[0], pts[1], pts[2]};
 		assert(!this->IsDegenerateTriangle(ids[0], ids[1], ids[2]));
 		for (int i = 0; i < 3; i++)
 			if (ids[i] == i2)
@@ -969,39 +1194,18 @@ bool vtkEdgeCollapse::IsCollapseLegal(vtkIdType i1, vtkIdType i2)
 		else
 		{
 			// Compute area
-			vtkPolygon::ComputeNormal(this->Mesh->GetPoints(), 3,
-									  this->PointIds->GetPointer(0),
+			vtkPolygon::ComputeNormal(this->Mesh->GetPoints(), 3, ids,
 									  normal_new);
 
 			// The normals of the new triangles should point
 			// more or less in the same direction as the old triangles
-			/*
-			this->Mesh->GetPoint(this->PointIds->GetId(0), x0);
-			this->Mesh->GetPoint(this->PointIds->GetId(1), x1);
-			this->Mesh->GetPoint(this->PointIds->GetId(2), x2);
-			for (int k=0; k<3; k++)
-				center[k] = 0.333 * (x0[k] + x1[k] + x2[k]);
-
-			if (GetOriginalNormal(center, normal))
-			{
-			*/
-			//TODO: clean-up this code
 			// Assumes that the cell ids don't change ordering
 			// (deleted cells are left in same position)
 			this->Normals->GetTuple(cellId, normal);
-			if ((true))
-			{
-				double cost = vtkMath::Dot(normal, normal_new);
-				if (cost < NormalDotProductThreshold)
-				{
-					// angle deviation is larger than MaximumNormalAngleDeviation
-					return false;
-				}
-			}
-			else
+			double cost = vtkMath::Dot(normal, normal_new);
+			if (cost < NormalDotProductThreshold)
 			{
-				cout << "Could not find closest point on original surface"
-					 << endl;
+				// angle deviation is larger than MaximumNormalAngleDeviation
 				return false;
 			}
 		}
@@ -1016,49 +1220,26 @@ bool vtkEdgeCollapse::IsCollapseLegal(vtkIdType i1, vtkIdType i2)
 	//
 	// Test if not exactly 2 nodes are connected to the edge i1,i2
 	//
-	/* Why does this code not work, but the one below does?
-	std::set<vtkIdType> inter;
-	this->PointIds->Reset();
-	this->PointIds->InsertNextId(i1);
-	this->PointIds->InsertNextId(i2);
-	this->Mesh->GetCellNeighbors(-1, this->PointIds, this->Neighbors);
-	for (int k=0; k<this->Neighbors->GetNumberOfIds(); k++)
-	{
-		vtkIdType cellId = this->Neighbors->GetId(k);
-		this->Mesh->GetCellPoints(cellId, this->PointIds);
-		inter.insert(this->PointIds->GetId(0));
-		inter.insert(this->PointIds->GetId(1));
-		inter.insert(this->PointIds->GetId(2));
-	}
-	if (inter.size() != 2+edge_tris)
-	{
-		if(Loud>1) cout << "inter.size() = " << inter.size() << endl;
-		return false;
-	}
-	*/
-	std::list<vtkIdType> nodes_i1, nodes_i2;
-	this->Mesh->GetPointCells(i1, this->Neighbors);
-	for (int k = 0; k < this->Neighbors->GetNumberOfIds(); k++)
+	std::vector<vtkIdType> nodes_i1, nodes_i2;
+	nodes_i1.reserve(3 * ncells1);
+	for (unsigned short k = 0; k < ncells1; k++)
 	{
-		this->Mesh->GetCellPoints(this->Neighbors->GetId(k), npts, pts);
-		nodes_i1.push_back(pts[0]);
-		nodes_i1.push_back(pts[1]);
-		nodes_i1.push_back(pts[2]);
+		this->Mesh->GetCellPoints(cells1[k], npts, pts);
+		nodes_i1.insert(nodes_i1.end(), pts, pts + 3);
 	}
-	this->Mesh->GetPointCells(i2, this->Neighbors);
-	for (int k = 0; k < this->Neighbors->GetNumberOfIds(); k++)
+	nodes_i2.reserve(3 * ncells2);
+	for (unsigned short k = 0; k < ncells2; k++)
 	{
-		this->Mesh->GetCellPoints(this->Neighbors->GetId(k), npts, pts);
-		nodes_i2.push_back(pts[0]);
-		nodes_i2.push_back(pts[1]);
-		nodes_i2.push_back(pts[2]);
+		this->Mesh->GetCellPoints(cells2[k], npts, pts);
+		nodes_i2.insert(nodes_i2.end(), pts, pts + 3);
 	}
-	nodes_i1.sort();
-	nodes_i2.sort();
-	std::list<vtkIdType> inter;
+	std::sort(nodes_i1.begin(), nodes_i1.end());
+	nodes_i1.erase(std::unique(nodes_i1.begin(), nodes_i1.end()), nodes_i1.end());
+	std::sort(nodes_i2.begin(), nodes_i2.end());
+	nodes_i2.erase(std::unique(nodes_i2.begin(), nodes_i2.end()), nodes_i2.end());
+	std::vector<vtkIdType> inter;
 	std::set_intersection(nodes_i1.begin(), nodes_i1.end(), nodes_i2.begin(),
 						  nodes_i2.end(), std::back_inserter(inter));
-	inter.unique();
 	if (inter.size() != 2 + edge_tris)
 	{
 		if (Loud > 1)
@@ -1066,17 +1247,13 @@ bool vtkEdgeCollapse::IsCollapseLegal(vtkIdType i1, vtkIdType i2)
 		return false;
 	}
 
-	//
-	// Surface approximation: if normal at center of collapsed edge changes, don't allow collapse
-	//
-
 	//
 	// Self-Intersection Checks
 	//
 	if (IntersectionCheckLevel > 0)
 	{
-		std::list<vtkIdType> nodes_i;
-		std::list<vtkIdType>::iterator it;
+		std::vector<vtkIdType> nodes_i;
+		std::vector<vtkIdType>::iterator it;
 		unsigned short ncells;
 		vtkIdType* cells;
 		std::set<vtkIdType> triangles_after_collapse;
@@ -1085,11 +1262,7 @@ bool vtkEdgeCollapse::IsCollapseLegal(vtkIdType i1, vtkIdType i2)
 		{
 		case 1:
 		{
-			this->Mesh->GetPointCells(i2, ncells, cells);
-			for (int k = 0; k < this->Neighbors->GetNumberOfIds(); k++)
-			{
-				triangles_after_collapse.insert(cells, cells + ncells);
-			}
+			triangles_after_collapse.insert(cells2, cells2 + ncells2);
 		}
 		break;
 		case 2:
@@ -1097,26 +1270,18 @@ bool vtkEdgeCollapse::IsCollapseLegal(vtkIdType i1, vtkIdType i2)
 			for (it = inter.begin(); it != inter.end(); ++it)
 			{
 				this->Mesh->GetPointCells(*it, ncells, cells);
-				for (int k = 0; k < this->Neighbors->GetNumberOfIds(); k++)
-				{
-					triangles_after_collapse.insert(cells, cells + ncells);
-				}
+				triangles_after_collapse.insert(cells, cells + ncells);
 			}
 		}
 		break;
 		case 3:
 		{
-			nodes_i1.unique(); // TODO: is this necessary
-			nodes_i2.unique();
-			set_union(nodes_i1.begin(), nodes_i1.end(), nodes_i2.begin(),
-					  nodes_i2.end(), std::back_inserter(nodes_i));
+			std::set_union(nodes_i1.begin(), nodes_i1.end(), nodes_i2.begin(),
+						   nodes_i2.end(), std::back_inserter(nodes_i));
 			for (it = nodes_i.begin(); it != nodes_i.end(); ++it)
 			{
 				this->Mesh->GetPointCells(*it, ncells, cells);
-				for (int k = 0; k < this->Neighbors->GetNumberOfIds(); k++)
-				{
-					triangles_after_collapse.insert(cells, cells + ncells);
-				}
+				triangles_after_collapse.insert(cells, cells + ncells);
 			}
 		}
 		break;
@@ -1147,10 +1312,11 @@ bool vtkEdgeCollapse::IsCollapseLegal(vtkIdType i1, vtkIdType i2)
 				}
 			}
 
+			// uses the shared Neighbors list -> not thread-safe
 			this->CellLocator->FindCellsWithinBounds(bounds, this->Neighbors);
 			for (int i = 0; i < this->Neighbors->GetNumberOfIds(); i++)
 			{
-				if (this->CellLocator->GetDataSet()->GetCellType(i) ==
+				if (this->Mesh->GetCellType(this->Neighbors->GetId(i)) ==
 					VTK_TRIANGLE)
 				{
 					triangles_after_collapse.insert(this->Neighbors->GetId(i));
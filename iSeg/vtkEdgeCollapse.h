@@ -43,6 +43,11 @@ Options:
 
 - IntersectionCheckLevel: self-intersections can occur due to collapsing/flipping edges. This can be avoided by increasing this parameter.
 
+- FixedPointsArrayName: optional point data array, points with non-zero value keep their position (e.g. seams between pieces of a mesh)
+
+- BatchCollapse: instead of a priority queue, collapse the short edges in passes. Each pass selects the
+  shortest edges with disjoint 1-rings, tests them in parallel and then collapses the legal ones.
+
  */
 class vtkEdgeCollapse : public vtkPolyDataAlgorithm
 {
@@ -97,6 +102,19 @@ public:
 	vtkSetStringMacro(DomainLabelName);
 	vtkGetStringMacro(DomainLabelName);
 
+	// Points with a non-zero value in this point data array are not removed,
+	// i.e. edges are only collapsed onto them. This is used to keep the seams
+	// between meshes, which are decimated separately, identical.
+	vtkSetStringMacro(FixedPointsArrayName);
+	vtkGetStringMacro(FixedPointsArrayName);
+
+	// Collapse independent sets of short edges in passes (checks are done in parallel)
+	// instead of one edge at a time from the priority queue. The same legality
+	// checks are performed, but the order of the collapses is slightly different.
+	vtkSetMacro(BatchCollapse, int);
+	vtkGetMacro(BatchCollapse, int);
+	vtkBooleanMacro(BatchCollapse, int);
+
 	// Get some information after running the filter
 	vtkGetMacro(NumberOfEdgeCollapses, int);
 	vtkGetMacro(NumberOfEdgeFlips, int);
@@ -128,6 +146,10 @@ protected:
 	// Do edge collapse (p2Id is removed)
 	int CollapseEdge(vtkIdType p1Id, vtkIdType p2Id);
 
+	// Collapse short edges in batches of edges with disjoint 1-rings,
+	// returns the number of deleted triangles
+	int CollapseEdgesInBatches(vtkIdType numTris);
+
 	// Helper function
 	bool IsDegenerateTriangle(vtkIdType i0, vtkIdType i1, vtkIdType i2);
 
@@ -172,6 +194,8 @@ protected:
 	int IntersectionCheckLevel;
 	int NumberOfClosestPoints;
 	char *DomainLabelName;
+	char *FixedPointsArrayName;
+	int BatchCollapse;
 	int NumberOfEdgeCollapses;
 	int NumberOfEdgeFlips;
 	int NumberOfEdgeDivisions;
@@ -196,6 +220,7 @@ protected:
 
 	//BTX
 	std::vector<bool> isboundary;
+	std::vector<bool> isfixed;
 	typedef std::pair<int, int> DuplicateLabel;
 	typedef std::map<DuplicateLabel, int> LabelMapType;
 	typedef std::map<int, DuplicateLabel> InverseLabelMapType;
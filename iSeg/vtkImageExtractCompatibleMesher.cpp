@@ -13,10 +13,13 @@
 #include "vtkTemplateTriangulator.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
 #include <ctime>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <vector>
@@ -38,9 +41,7 @@
 
 #include <vtkEdgeTable.h>
 #include <vtkGenericCell.h>
-#include <vtkIncrementalOctreePointLocator.h>
 #include <vtkMath.h>
-#include <vtkMergePoints.h>
 #include <vtkOrderedTriangulator.h>
 #include <vtkPriorityQueue.h>
 
@@ -49,6 +50,11 @@
 #include <vtkTimerLog.h>
 
 #include <vtkSmartPointer.h>
+
+#ifndef NO_OPENMP_SUPPORT
+#	include <omp.h>
+#endif
+
 #define vtkNew(type, name)                                                     \
 	vtkSmartPointer<type> name = vtkSmartPointer<type>::New()
 
@@ -56,7 +62,12 @@ template<int Id> class Timer
 {
 public:
 	Timer() { c0 = clock(); }
-	~Timer() { total_clocks += (clock() - c0); }
+	~Timer()
+	{
+		double const c = static_cast<double>(clock() - c0);
+#pragma omp atomic
+		total_clocks += c;
+	}
 	static double EllapsedTime() { return total_clocks / CLOCKS_PER_SEC; }
 	static void Reset() { total_clocks = 0; }
 
@@ -174,6 +185,215 @@ public:
 private:
 	IDType cell0, cell1, cell2, cell3;
 };
+// hash of three 32 bit integers
+inline size_t HashKey(std::uint32_t a, std::uint32_t b, std::uint32_t c)
+{
+	std::uint64_t h = a;
+	h = h * 0x9E3779B97F4A7C15ull + b;
+	h = h * 0x9E3779B97F4A7C15ull + c;
+	return static_cast<size_t>(h ^ (h >> 29));
+}
+// welds points by their position on a lattice with kDivisions steps per voxel
+//
+// All points created by the triangulation are averages of voxel corners (edge,
+// face and tetrahedron centers, Steiner points of prisms and hexahedra), whose
+// lattice coordinates are integer, i.e. rounding only removes round-off. The
+// lattice keys also define a vertex order independent of the insertion order.
+class LatticePointMap
+{
+public:
+	enum { kDivisions = 60480 }; // 2^6 * 3^3 * 5 * 7
+
+	struct Key
+	{
+		bool operator<(const Key& rhs) const
+		{
+			if (q[2] != rhs.q[2])
+				return q[2] < rhs.q[2];
+			if (q[1] != rhs.q[1])
+				return q[1] < rhs.q[1];
+			return q[0] < rhs.q[0];
+		}
+		bool operator==(const Key& rhs) const
+		{
+			return q[0] == rhs.q[0] && q[1] == rhs.q[1] && q[2] == rhs.q[2];
+		}
+		std::uint32_t q[3];
+	};
+
+	LatticePointMap(const double origin[3], const double spacing[3],
+					vtkPoints* points, size_t estimatedSize)
+		: Points(points)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			Origin[i] = origin[i];
+			Scale[i] = kDivisions / spacing[i];
+		}
+		size_t capacity = 1024;
+		while (capacity < 2 * estimatedSize)
+			capacity *= 2;
+		Table.assign(capacity, kEmpty);
+		Keys.reserve(estimatedSize);
+	}
+
+	// returns true if the point was inserted, else id is the existing point
+	bool InsertUniquePoint(const double x[3], vtkIdType& id)
+	{
+		Key key;
+		for (int i = 0; i < 3; i++)
+		{
+			double const q = std::floor((x[i] - Origin[i]) * Scale[i] + 0.5);
+			assert(q >= 0 && q <= VTK_UNSIGNED_INT_MAX);
+			key.q[i] = static_cast<std::uint32_t>(q);
+		}
+
+		size_t const mask = Table.size() - 1;
+		size_t slot = HashKey(key.q[0], key.q[1], key.q[2]) & mask;
+		while (Table[slot] != kEmpty)
+		{
+			if (Keys[Table[slot]] == key)
+			{
+				id = Table[slot];
+				return false;
+			}
+			slot = (slot + 1) & mask;
+		}
+
+		id = Points->InsertNextPoint(x);
+		assert(static_cast<size_t>(id) == Keys.size());
+		Keys.push_back(key);
+		Table[slot] = static_cast<IDType>(id);
+		if (2 * Keys.size() > Table.size())
+			Rehash(2 * Table.size());
+		return true;
+	}
+
+	bool IsLess(vtkIdType v0, vtkIdType v1) const { return Keys[v0] < Keys[v1]; }
+
+private:
+	enum : IDType { kEmpty = VTK_UNSIGNED_INT_MAX };
+
+	void Rehash(size_t capacity)
+	{
+		Table.assign(capacity, kEmpty);
+		size_t const mask = capacity - 1;
+		for (size_t id = 0; id < Keys.size(); id++)
+		{
+			const Key& key = Keys[id];
+			size_t slot = HashKey(key.q[0], key.q[1], key.q[2]) & mask;
+			while (Table[slot] != kEmpty)
+				slot = (slot + 1) & mask;
+			Table[slot] = static_cast<IDType>(id);
+		}
+	}
+
+	vtkPoints* Points;
+	double Origin[3];
+	double Scale[3];
+	std::vector<Key> Keys;	 // per point
+	std::vector<IDType> Table; // open addressing, linear probing
+};
+// open addressing hash map from sorted triangle to tetrahedron id
+class TriangleMap
+{
+public:
+	explicit TriangleMap(size_t estimatedSize) : Size(0), Used(0)
+	{
+		size_t capacity = 1024;
+		while (capacity < 2 * estimatedSize)
+			capacity *= 2;
+		Slots.resize(capacity);
+		for (auto& s : Slots)
+			s.cell = kEmpty;
+	}
+
+	size_t size() const { return Size; }
+
+	// returns the tetrahedron id or kNotFound
+	IDType find(const Triangle& tri) const
+	{
+		size_t const slot = FindSlot(tri);
+		return Slots[slot].cell == kEmpty ? kNotFound : Slots[slot].cell;
+	}
+
+	void insert(const Triangle& tri, IDType cellId)
+	{
+		assert(cellId < kDeleted);
+		if (2 * (Used + 1) > Slots.size())
+			Rehash(Size + 1 > Slots.size() / 4 ? 2 * Slots.size() : Slots.size());
+
+		size_t const mask = Slots.size() - 1;
+		size_t slot = Hash(tri) & mask;
+		while (Slots[slot].cell != kEmpty && Slots[slot].cell != kDeleted)
+			slot = (slot + 1) & mask;
+		if (Slots[slot].cell == kEmpty)
+			Used++;
+		Slots[slot].tri = tri;
+		Slots[slot].cell = cellId;
+		Size++;
+	}
+
+	void erase(const Triangle& tri)
+	{
+		size_t const slot = FindSlot(tri);
+		if (Slots[slot].cell != kEmpty)
+		{
+			Slots[slot].cell = kDeleted;
+			Size--;
+		}
+	}
+
+	enum : IDType { kNotFound = VTK_UNSIGNED_INT_MAX };
+
+private:
+	enum : IDType { kEmpty = VTK_UNSIGNED_INT_MAX,
+		kDeleted = VTK_UNSIGNED_INT_MAX - 1 };
+
+	struct Slot
+	{
+		Triangle tri;
+		IDType cell;
+	};
+
+	static size_t Hash(const Triangle& tri) { return HashKey(tri.n1, tri.n2, tri.n3); }
+
+	// slot holding 'tri' or the empty slot ending the probe sequence
+	size_t FindSlot(const Triangle& tri) const
+	{
+		size_t const mask = Slots.size() - 1;
+		size_t slot = Hash(tri) & mask;
+		while (Slots[slot].cell != kEmpty &&
+			   (Slots[slot].cell == kDeleted || !(Slots[slot].tri == tri)))
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	// drops the deleted slots
+	void Rehash(size_t capacity)
+	{
+		std::vector<Slot> old(capacity);
+		old.swap(Slots);
+		for (auto& s : Slots)
+			s.cell = kEmpty;
+		size_t const mask = capacity - 1;
+		Used = 0;
+		for (const auto& s : old)
+		{
+			if (s.cell == kEmpty || s.cell == kDeleted)
+				continue;
+			size_t slot = Hash(s.tri) & mask;
+			while (Slots[slot].cell != kEmpty)
+				slot = (slot + 1) & mask;
+			Slots[slot] = s;
+			Used++;
+		}
+	}
+
+	size_t Size; // number of triangles
+	size_t Used; // triangles and deleted slots
+	std::vector<Slot> Slots;
+};
 // store the tetrahedra and neighborhood information
 class TetContainer
 {
@@ -230,153 +450,48 @@ public:
 		}
 
 		// iterate through tetrahedra and create neighbors
-		typedef std::map<Triangle, IDType> triangle_id_map;
-		triangle_id_map tmap;
-		triangle_id_map::iterator tmap_it;
-		//std::vector<IDType> t1(3), t2(3), t3(3), t4(3);
-		Triangle t1, t2, t3, t4;
-		std::vector<const Triangle*> faces(4);
+		TriangleMap tmap(tetra.size() / 2);
+		Triangle faces[4];
 		IDType NC = static_cast<IDType>(tetra.size());
 		for (IDType cellId = 0; cellId < NC; cellId++)
 		{
-			const Tetrahedron& tet = tetra[cellId];
 			// get four triangle faces
-			t1.n1 = tet[tet_faces[0][0]];
-			t1.n2 = tet[tet_faces[0][1]];
-			t1.n3 = tet[tet_faces[0][2]];
-			t1.Sort();
-
-			t2.n1 = tet[tet_faces[1][0]];
-			t2.n2 = tet[tet_faces[1][1]];
-			t2.n3 = tet[tet_faces[1][2]];
-			t2.Sort();
-
-			t3.n1 = tet[tet_faces[2][0]];
-			t3.n2 = tet[tet_faces[2][1]];
-			t3.n3 = tet[tet_faces[2][2]];
-			t3.Sort();
-
-			t4.n1 = tet[tet_faces[3][0]];
-			t4.n2 = tet[tet_faces[3][1]];
-			t4.n3 = tet[tet_faces[3][2]];
-			t4.Sort();
-
-			//t1
-			tmap_it = tmap.find(t1);
-			if (tmap_it == tmap.end())
-			{ // add first
-				tmap[t1] = cellId;
-			}
-			else
-			{ //found second
-				assert(tmap_it->second != cellId);
-				const IDType neighborId = tmap_it->second;
-				const int j = tetra[neighborId].WhichTriangle(t1);
-				assert(j >= 0);
-				neighbors[cellId].SetNeighbor(0, neighborId);
-				neighbors[neighborId].SetNeighbor(j, cellId);
-				tmap.erase(tmap_it);
-			}
-
-			// t2
-			tmap_it = tmap.find(t2);
-			if (tmap_it == tmap.end())
-			{ // add first
-				tmap[t2] = cellId;
-			}
-			else
-			{ //found second
-				assert(tmap_it->second != cellId);
-				const IDType neighborId = tmap_it->second;
-				const int j = tetra[neighborId].WhichTriangle(t2);
-				assert(j >= 0);
-				neighbors[cellId].SetNeighbor(1, neighborId);
-				neighbors[neighborId].SetNeighbor(j, cellId);
-				tmap.erase(tmap_it);
-			}
-
-			// t3
-			tmap_it = tmap.find(t3);
-			if (tmap_it == tmap.end())
-			{ // add first
-				tmap[t3] = cellId;
-			}
-			else
-			{ //found second
-				assert(tmap_it->second != cellId);
-				const IDType neighborId = tmap_it->second;
-				const int j = tetra[neighborId].WhichTriangle(t3);
-				assert(j >= 0);
-				neighbors[cellId].SetNeighbor(2, neighborId);
-				neighbors[neighborId].SetNeighbor(j, cellId);
-				tmap.erase(tmap_it);
-			}
-
-			// t4
-			tmap_it = tmap.find(t4);
-			if (tmap_it == tmap.end())
-			{ // add first
-				tmap[t4] = cellId;
-			}
-			else
-			{ //found second
-				assert(tmap_it->second != cellId);
-				const IDType neighborId = tmap_it->second;
-				const int j = tetra[neighborId].WhichTriangle(t4);
-				assert(j >= 0);
-				neighbors[cellId].SetNeighbor(3, neighborId);
-				neighbors[neighborId].SetNeighbor(j, cellId);
-				tmap.erase(tmap_it);
+			GetFaces(tetra[cellId], faces);
+			for (int k = 0; k < 4; k++)
+			{
+				const IDType neighborId = tmap.find(faces[k]);
+				if (neighborId == TriangleMap::kNotFound)
+				{ // add first
+					tmap.insert(faces[k], cellId);
+				}
+				else
+				{ //found second
+					assert(neighborId != cellId);
+					const int j = tetra[neighborId].WhichTriangle(faces[k]);
+					assert(j >= 0);
+					neighbors[cellId].SetNeighbor(k, neighborId);
+					neighbors[neighborId].SetNeighbor(j, cellId);
+					tmap.erase(faces[k]);
+				}
 			}
 		}
 
 		std::cerr << "tmap size: " << tmap.size() << std::endl;
-		for (IDType cellId = 0; cellId < NC; cellId++)
+		for (IDType cellId = 0; cellId < NC && tmap.size() > 0; cellId++)
 		{
-			const Tetrahedron& tet = tetra[cellId];
-			// get four triangle faces
-			t1.n1 = tet[tet_faces[0][0]];
-			t1.n2 = tet[tet_faces[0][1]];
-			t1.n3 = tet[tet_faces[0][2]];
-			t1.Sort();
-
-			t2.n1 = tet[tet_faces[1][0]];
-			t2.n2 = tet[tet_faces[1][1]];
-			t2.n3 = tet[tet_faces[1][2]];
-			t2.Sort();
-
-			t3.n1 = tet[tet_faces[2][0]];
-			t3.n2 = tet[tet_faces[2][1]];
-			t3.n3 = tet[tet_faces[2][2]];
-			t3.Sort();
-
-			t4.n1 = tet[tet_faces[3][0]];
-			t4.n2 = tet[tet_faces[3][1]];
-			t4.n3 = tet[tet_faces[3][2]];
-			t4.Sort();
-
-			faces[0] = &t1;
-			faces[1] = &t2;
-			faces[2] = &t3;
-			faces[3] = &t4;
-
-			triangle_id_map::iterator tmap_it;
+			GetFaces(tetra[cellId], faces);
 			for (int j = 0; j < 4; j++)
 			{
 				// internal triangles were already removed from map above
-				if ((tmap_it = tmap.find(*faces[j])) == tmap.end())
+				IDType tid1 = tmap.find(faces[j]);
+				if (tid1 == TriangleMap::kNotFound)
 					continue;
 
-				IDType tid1 = tmap_it->second;
 				assert(tid1 >= 0 && tid1 < NC);
 				if (tid1 != cellId)
 				{
 					neighbors[cellId].SetNeighbor(j, tid1);
 				}
-				else
-				{
-					assert(tid1 == cellId);
-				}
 			}
 		}
 
@@ -384,6 +499,17 @@ public:
 	}
 
 private:
+	static void GetFaces(const Tetrahedron& tet, Triangle faces[4])
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			faces[k].n1 = tet[tet_faces[k][0]];
+			faces[k].n2 = tet[tet_faces[k][1]];
+			faces[k].n3 = tet[tet_faces[k][2]];
+			faces[k].Sort();
+		}
+	}
+
 	size_t ExtensionSize;
 	std::vector<Tetrahedron> tetra;
 	std::vector<TetNeighbors> neighbors;
@@ -417,6 +543,12 @@ public:
 		return ptId;
 	}
 
+	/// Override: order by position, since ids depend on the slab
+	virtual bool IsLess(vtkIdType v0, vtkIdType v1) override
+	{
+		return Locator->IsLess(v0, v1);
+	}
+
 	/// Override
 	virtual void AddTetrahedron(vtkIdType v1, vtkIdType v2, vtkIdType v3,
 								vtkIdType v4, int domain) override
@@ -429,7 +561,7 @@ public:
 		CellDomainArray->InsertNextValue(domain);
 	}
 
-	vtkIncrementalPointLocator* Locator;
+	LatticePointMap* Locator;
 	vtkPoints* Points;
 	TetContainer* Tetrahedra;
 	vtkShortArray* CellDomainArray;
@@ -441,6 +573,58 @@ protected:
 
 vtkStandardNewMacro(vtkTriangulatorImpl);
 
+// points and tetrahedra of a range of voxel layers, which is tetrahedralized
+// independently of the other layers
+class MesherSlab
+{
+public:
+	MesherSlab(const double origin[3], const double spacing[3],
+			   size_t estimatedSize, bool useTemplates)
+		: Points(vtkPoints::New()),
+		  Locator(origin, spacing, Points, estimatedSize / 2),
+		  Tetrahedra(estimatedSize, estimatedSize / 2)
+	{
+		// double precision, such that new points are exactly on the lattice
+		Points->SetDataTypeToDouble();
+		PointDomainArray = vtkShortArray::New();
+		CellDomainArray = vtkShortArray::New();
+		CellDomainArray->SetNumberOfComponents(1);
+		Connectivity = vtkCellArray::New();
+		Triangulator = vtkOrderedTriangulator::New();
+		Triangulator->PreSortedOn();
+		Triangulator->UseTwoSortIdsOn();
+		Triangulator->SetUseTemplates(useTemplates);
+
+		MyTriangulator = vtkTriangulatorImpl::New();
+		MyTriangulator->CellDomainArray = CellDomainArray;
+		MyTriangulator->Locator = &Locator;
+		MyTriangulator->Points = Points;
+		MyTriangulator->Tetrahedra = &Tetrahedra;
+	}
+	~MesherSlab()
+	{
+		MyTriangulator->Delete();
+		Triangulator->Delete();
+		Connectivity->Delete();
+		CellDomainArray->Delete();
+		PointDomainArray->Delete();
+		Points->Delete();
+	}
+
+	vtkPoints* Points;
+	LatticePointMap Locator;
+	TetContainer Tetrahedra;
+	vtkShortArray* PointDomainArray;
+	vtkShortArray* CellDomainArray;
+	vtkCellArray* Connectivity;
+	vtkOrderedTriangulator* Triangulator;
+	vtkTriangulatorImpl* MyTriangulator;
+
+private:
+	MesherSlab(const MesherSlab&) = delete;
+	MesherSlab& operator=(const MesherSlab&) = delete;
+};
+
 //----------------------------------------------------------------------------
 vtkStandardNewMacro(vtkImageExtractCompatibleMesher);
 
@@ -456,7 +640,6 @@ vtkImageExtractCompatibleMesher::vtkImageExtractCompatibleMesher()
 	this->MaxNumberOfIterations = 10;
 	this->BackgroundLabel = 0;
 	this->UseTemplates = true;
-	this->UseOctreeLocator = true;
 	this->OutputScalarName = 0;
 	this->SetOutputScalarName("Material");
 	this->GenerateTetMeshOutput = false;
@@ -466,12 +649,9 @@ vtkImageExtractCompatibleMesher::vtkImageExtractCompatibleMesher()
 	//this->Grid = nullptr;
 	this->Points = nullptr;
 	this->ClipScalars = nullptr;
-	this->Triangulator = nullptr;
-	this->Locator = nullptr;
-	this->Connectivity = nullptr;
 	this->PointDomainArray = nullptr;
+	this->CellDomainArray = nullptr;
 	this->Tetrahedra = nullptr;
-	this->MyTriangulator = nullptr;
 
 	// by default process active point scalars
 	this->SetInputArrayToProcess(0, 0, 0,
@@ -545,55 +725,12 @@ int vtkImageExtractCompatibleMesher::ContourSurface(
 	{
 		estimatedSize = 1024;
 	}
-	this->Points = vtkPoints::New();
-	Points->SetDataTypeToFloat();
-	Points->Allocate(estimatedSize / 2, estimatedSize / 2);
-	if (this->UseOctreeLocator)
-	{
-		vtkIncrementalOctreePointLocator* loc =
-			vtkIncrementalOctreePointLocator::New();
-		loc->SetTolerance(0.0);
-		loc->SetMaxLevel(12); // does this have any effect?
-		// loc->SetMaxPointsPerLeaf(128);
-		this->Locator = loc;
-	}
-	else
-	{
-		vtkMergePoints* loc = vtkMergePoints::New();
-		int div[3];
-		this->Input->GetDimensions(div);
-		div[0] = std::max(div[0] / 7, 50);
-		div[1] = std::max(div[1] / 7, 50);
-		div[2] = std::max(div[2] / 7, 50);
-		loc->SetDivisions(div);
-		loc->SetMaxLevel(12); // does this have any effect?
-		this->Locator = loc;
-	}
-	this->Locator->InitPointInsertion(Points, this->Input->GetBounds());
-	this->Connectivity = vtkCellArray::New();
-	this->Tetrahedra = new TetContainer(estimatedSize, estimatedSize / 2);
-
-	this->CellDomainArray = vtkShortArray::New();
-	this->CellDomainArray->SetName(this->OutputScalarName);
-	this->CellDomainArray->SetNumberOfComponents(1);
-	this->PointDomainArray = vtkShortArray::New();
-	this->PointDomainArray->SetName(this->OutputScalarName);
-	this->Triangulator = vtkOrderedTriangulator::New();
-	this->Triangulator->PreSortedOn();
-	this->Triangulator->UseTwoSortIdsOn();
-	this->Triangulator->SetUseTemplates(this->UseTemplates);
-
-	MyTriangulator = vtkTriangulatorImpl::New();
-	MyTriangulator->CellDomainArray = CellDomainArray;
-	MyTriangulator->Locator = Locator;
-	MyTriangulator->Points = Points;
-	MyTriangulator->Tetrahedra = Tetrahedra;
-
 	int dims[3];
-	double spacing[3], origin[3];
+	double spacing[3], bounds[6];
 	this->Input->GetDimensions(dims);
-	this->Input->GetOrigin(origin);
 	this->Input->GetSpacing(spacing);
+	this->Input->GetBounds(bounds);
+	double const latticeOrigin[3] = {bounds[0], bounds[2], bounds[4]};
 
 	vtkIdType numICells = dims[0] - 1;
 	vtkIdType numJCells = dims[1] - 1;
@@ -603,9 +740,6 @@ int vtkImageExtractCompatibleMesher::ContourSurface(
 						  this->Input->GetExtent()[2] +
 						  this->Input->GetExtent()[4];
 
-	vtkPoints* cellPts;
-	vtkIdList* cellIds;
-	vtkGenericCell* cell = vtkGenericCell::New();
 	this->ClipScalars = this->GetInputArrayToProcess(0, inputVector);
 	if (!this->ClipScalars)
 	{
@@ -617,76 +751,140 @@ int vtkImageExtractCompatibleMesher::ContourSurface(
 			return 1;
 		}
 	}
-	vtkShortArray* cellScalars = vtkShortArray::New();
-	cellScalars->SetNumberOfComponents(1);
-	cellScalars->SetNumberOfTuples(8);
+
+	// The voxel layers are split into slabs, which are tetrahedralized in
+	// parallel. The diagonals are chosen by position, i.e. the tetrahedra at
+	// the slab boundaries are compatible and the result does not depend on the
+	// number of slabs.
+	int numSlabs = 1;
+#ifndef NO_OPENMP_SUPPORT
+	numSlabs = static_cast<int>(std::max<vtkIdType>(1, std::min<vtkIdType>(omp_get_max_threads(), numKCells / 4)));
+#endif
+	std::vector<std::unique_ptr<MesherSlab>> slabs(numSlabs);
+	std::atomic<bool> abort(false);
 
 	// Traverse through all all voxels, compute tetrahedra on the go
-	int abort = 0;
-	for (vtkIdType k = 0; k < numKCells && !abort; k++)
+#pragma omp parallel for schedule(static, 1)
+	for (int s = 0; s < numSlabs; s++)
 	{
-		// Check for progress and abort on every z-slice
-		this->UpdateProgress(static_cast<double>(k) / numKCells);
-		abort = this->GetAbortExecute();
-		for (vtkIdType j = 0; j < numJCells; j++)
+		slabs[s].reset(new MesherSlab(latticeOrigin, spacing,
+				estimatedSize / numSlabs, this->UseTemplates));
+		MesherSlab& slab = *slabs[s];
+
+		vtkPoints* cellPts;
+		vtkIdList* cellIds;
+		vtkGenericCell* cell = vtkGenericCell::New();
+		vtkShortArray* cellScalars = vtkShortArray::New();
+		cellScalars->SetNumberOfComponents(1);
+		cellScalars->SetNumberOfTuples(8);
+
+		vtkIdType const k0 = numKCells * s / numSlabs;
+		vtkIdType const k1 = numKCells * (s + 1) / numSlabs;
+		for (vtkIdType k = k0; k < k1 && !abort; k++)
 		{
-			for (vtkIdType i = 0; i < numICells; i++)
+			// Check for progress and abort on every z-slice of the first slab
+			if (s == 0)
 			{
-				int flip = (extOffset + i + j + k) & 0x1;
-				vtkIdType cellId = i + j * numICells + k * sliceSize;
-
-				this->Input->GetCell(cellId, cell);
-				if (cell->GetCellType() == VTK_EMPTY_CELL)
+				this->UpdateProgress(static_cast<double>(k - k0) / (k1 - k0));
+				abort = (this->GetAbortExecute() != 0);
+			}
+			for (vtkIdType j = 0; j < numJCells; j++)
+			{
+				for (vtkIdType i = 0; i < numICells; i++)
 				{
-					continue;
-				}
-				cellPts = cell->GetPoints();
-				cellIds = cell->GetPointIds();
+					int flip = (extOffset + i + j + k) & 0x1;
+					vtkIdType cellId = i + j * numICells + k * sliceSize;
 
-				// Check if this cell is at surface/interface
-				bool isClipped = false;
-				int s0 = this->ClipScalars->GetComponent(cellIds->GetId(0), 0);
-				for (int ii = 0; ii < 8; ii++)
-				{
-					int s =
-						this->ClipScalars->GetComponent(cellIds->GetId(ii), 0);
-					cellScalars->SetValue(ii, s);
-					if (s != s0)
+					this->Input->GetCell(cellId, cell);
+					if (cell->GetCellType() == VTK_EMPTY_CELL)
 					{
-						isClipped = true;
+						continue;
 					}
-				}
+					cellPts = cell->GetPoints();
+					cellIds = cell->GetPointIds();
 
-				//
-				if (isClipped == true)
-				{
-					this->ClipVoxel(cellScalars, flip, spacing, cellIds,
-									cellPts);
-				}
-				else if (s0 != this->BackgroundLabel)
-				{
-					this->TriangulateVoxel(s0, flip, spacing, cellIds, cellPts);
+					// Check if this cell is at surface/interface
+					bool isClipped = false;
+					int s0 = this->ClipScalars->GetComponent(cellIds->GetId(0), 0);
+					for (int ii = 0; ii < 8; ii++)
+					{
+						int s =
+							this->ClipScalars->GetComponent(cellIds->GetId(ii), 0);
+						cellScalars->SetValue(ii, s);
+						if (s != s0)
+						{
+							isClipped = true;
+						}
+					}
+
+					//
+					if (isClipped == true)
+					{
+						this->ClipVoxel(slab, cellScalars, flip, spacing, cellIds,
+										cellPts);
+					}
+					else if (s0 != this->BackgroundLabel)
+					{
+						this->TriangulateVoxel(slab, s0, flip, spacing, cellIds,
+											   cellPts);
+					}
 				}
 			}
 		}
-		if (k % 10 == 0)
-		{
-			std::cerr << "Time for full voxels: " << Timer<1>::EllapsedTime()
-					  << std::endl;
-			std::cerr << "Time for clipped voxels: " << Timer<2>::EllapsedTime()
-					  << std::endl;
-		}
+
+		cell->Delete();
+		cellScalars->Delete();
 	}
 	std::cerr << "Final Time for full voxels: " << Timer<1>::EllapsedTime()
 			  << std::endl;
 	std::cerr << "Final Time for clipped voxels: " << Timer<2>::EllapsedTime()
 			  << std::endl;
 
-	// Start cleaning up
-	this->Triangulator->Delete();
-	this->Locator->Delete();
-	cell->Delete();
-	cellScalars->Delete();
+	// Merge the slabs, points on the slab boundaries are welded
+	this->Points = vtkPoints::New();
+	Points->SetDataTypeToFloat();
+	Points->Allocate(estimatedSize / 2, estimatedSize / 2);
+	LatticePointMap locator(latticeOrigin, spacing, this->Points,
+							estimatedSize / 2);
+	this->Tetrahedra = new TetContainer(estimatedSize, estimatedSize / 2);
+	this->CellDomainArray = vtkShortArray::New();
+	this->CellDomainArray->SetName(this->OutputScalarName);
+	this->CellDomainArray->SetNumberOfComponents(1);
+	this->PointDomainArray = vtkShortArray::New();
+	this->PointDomainArray->SetName(this->OutputScalarName);
+
+	std::vector<IDType> ptIdMap;
+	double x[3];
+	for (auto& slab : slabs)
+	{
+		vtkIdType const numPts = slab->Points->GetNumberOfPoints();
+		vtkIdType const numDomains = slab->PointDomainArray->GetNumberOfTuples();
+		ptIdMap.resize(numPts);
+		for (vtkIdType i = 0; i < numPts; i++)
+		{
+			vtkIdType id;
+			slab->Points->GetPoint(i, x);
+			if (locator.InsertUniquePoint(x, id) && i < numDomains)
+			{
+				this->PointDomainArray->InsertValue(
+					id, slab->PointDomainArray->GetValue(i));
+			}
+			ptIdMap[i] = static_cast<IDType>(id);
+		}
+
+		size_t const numTets = slab->Tetrahedra.GetNumberOfTetrahedra();
+		for (size_t i = 0; i < numTets; i++)
+		{
+			const Tetrahedron& tet = slab->Tetrahedra.GetTetrahedron(i);
+			this->Tetrahedra->push_back(ptIdMap[tet[0]], ptIdMap[tet[1]],
+										ptIdMap[tet[2]], ptIdMap[tet[3]]);
+			this->CellDomainArray->InsertNextValue(
+				slab->CellDomainArray->GetValue(static_cast<vtkIdType>(i)));
+		}
+
+		// release memory early
+		slab.reset();
+	}
 
 	std::cerr << "Number of tetra: "
 			  << this->Tetrahedra->GetNumberOfTetrahedra() << std::endl;
@@ -712,10 +910,16 @@ int vtkImageExtractCompatibleMesher::ContourSurface(
 	// Cleanup
 	this->Input = nullptr;
 	this->Points->Delete();
-	this->Connectivity->Delete();
 	this->CellDomainArray->Delete();
+	this->CellDomainArray = nullptr;
+	if (this->PointDomainArray)
+	{
+		this->PointDomainArray->Delete();
+		this->PointDomainArray = nullptr;
+	}
 	this->ClipScalars = nullptr;
 	delete this->Tetrahedra;
+	this->Tetrahedra = nullptr;
 
 	return 1;
 }
@@ -727,7 +931,7 @@ int vtkImageExtractCompatibleMesher::ContourSurface(
 // triangulation. The ordering controls the orientation of any face
 // diagonals.
 void vtkImageExtractCompatibleMesher::ClipVoxel_not_used(
-	vtkShortArray* cellScalars, int flip, double spacing[3], vtkIdList* cellIds,
+	MesherSlab& slab, vtkShortArray* cellScalars, int flip, double spacing[3], vtkIdList* cellIds,
 	vtkPoints* cellPts)
 {
 	Timer<2> timer;
@@ -754,7 +958,7 @@ void vtkImageExtractCompatibleMesher::ClipVoxel_not_used(
 
 	// Initialize Delaunay insertion process with voxel triangulation.
 	// No more than 21 points (8 corners + 12 edges + 1 center) may be inserted.
-	this->Triangulator->InitTriangulation(bounds, 21);
+	slab.Triangulator->InitTriangulation(bounds, 21);
 
 	// Inject ordered voxel corner points into triangulation. Recall
 	// that the PreSortedOn() flag was set in the triangulator.
@@ -782,11 +986,11 @@ void vtkImageExtractCompatibleMesher::ClipVoxel_not_used(
 
 		labelset.insert(s1);
 		cellPts->GetPoint(ptId, x);
-		if (this->Locator->InsertUniquePoint(x, id))
+		if (slab.Locator.InsertUniquePoint(x, id))
 		{
-			this->PointDomainArray->InsertValue(id, s1);
+			slab.PointDomainArray->InsertValue(id, s1);
 		}
-		this->Triangulator->InsertPoint(id, id, s1, x, x, type);
+		slab.Triangulator->InsertPoint(id, id, s1, x, x, type);
 	} //for eight voxel corner points
 
 	// For each edge intersection point, insert into triangulation. Edge
@@ -807,15 +1011,15 @@ void vtkImageExtractCompatibleMesher::ClipVoxel_not_used(
 			}
 
 			// Incorporate point into output and interpolate edge data as necessary
-			if (this->Locator->InsertUniquePoint(x, ptId))
+			if (slab.Locator.InsertUniquePoint(x, ptId))
 			{
-				this->PointDomainArray->InsertValue(
+				slab.PointDomainArray->InsertValue(
 					ptId,
 					SURFACE_DOMAIN); // reuse background for interface/surface label
 			}
 
 			//Insert into Delaunay triangulation (type 2 = "boundary")
-			this->Triangulator->InsertPoint(ptId, ptId, 0, x, x, 2);
+			slab.Triangulator->InsertPoint(ptId, ptId, 0, x, x, 2);
 		} //if edge intersects value
 	}	 //for all edges
 
@@ -832,36 +1036,37 @@ void vtkImageExtractCompatibleMesher::ClipVoxel_not_used(
 		}
 
 		// Incorporate point into output and interpolate edge data as necessary
-		if (this->Locator->InsertUniquePoint(x, ptId))
+		if (slab.Locator.InsertUniquePoint(x, ptId))
 		{
-			this->PointDomainArray->InsertValue(
+			slab.PointDomainArray->InsertValue(
 				ptId,
 				SURFACE_DOMAIN); // reuse background for interface/surface label
 		}
 
 		//Insert into Delaunay triangulation (type 2 = "boundary")
-		this->Triangulator->InsertPoint(ptId, ptId, 0, x, x, 2);
+		slab.Triangulator->InsertPoint(ptId, ptId, 0, x, x, 2);
 	}
 
 	// triangulate the points
-	this->Triangulator->Triangulate();
-	//this->Triangulator->TemplateTriangulate(cellType, numPts, numEdges);
+	slab.Triangulator->Triangulate();
+	//slab.Triangulator->TemplateTriangulate(cellType, numPts, numEdges);
 
 	// Add the triangulation to the mesh
-	this->Connectivity->Initialize();
-	this->Triangulator->AddTetras(0, this->Connectivity);
-	vtkIdType numNew = this->Connectivity->GetNumberOfCells();
+	slab.Connectivity->Initialize();
+	slab.Triangulator->AddTetras(0, slab.Connectivity);
+	vtkIdType numNew = slab.Connectivity->GetNumberOfCells();
 
 	vtkIdType npts, *pts;
-	this->Connectivity->InitTraversal();
+	slab.Connectivity->InitTraversal();
 	for (vtkIdType i = 0; i < numNew; i++)
 	{
-		this->Connectivity->GetNextCell(npts, pts);
-		this->Tetrahedra->push_back(pts[0], pts[1], pts[2], pts[3]);
+		slab.Connectivity->GetNextCell(npts, pts);
+		slab.Tetrahedra.push_back(pts[0], pts[1], pts[2], pts[3]);
 	}
 }
 
-void vtkImageExtractCompatibleMesher::ClipVoxel(vtkShortArray* cellScalars,
+void vtkImageExtractCompatibleMesher::ClipVoxel(MesherSlab& slab,
+												vtkShortArray* cellScalars,
 												int flip, double spacing[3],
 												vtkIdList* cellIds,
 												vtkPoints* cellPts)
@@ -887,7 +1092,7 @@ void vtkImageExtractCompatibleMesher::ClipVoxel(vtkShortArray* cellScalars,
 
 	// Initialize Delaunay insertion process with voxel triangulation.
 	// No more than 8 points (8 corners) may be inserted.
-	this->Triangulator->InitTriangulation(bounds, 8);
+	slab.Triangulator->InitTriangulation(bounds, 8);
 
 	// Inject ordered voxel corner points into triangulation. Recall
 	// that the PreSortedOn() flag was set in the triangulator.
@@ -899,42 +1104,43 @@ void vtkImageExtractCompatibleMesher::ClipVoxel(vtkShortArray* cellScalars,
 			ptId = order_noflip[numPts];
 
 		cellPts->GetPoint(ptId, x);
-		if (this->Locator->InsertUniquePoint(x, id))
+		if (slab.Locator.InsertUniquePoint(x, id))
 		{
-			this->PointDomainArray->InsertValue(id,
+			slab.PointDomainArray->InsertValue(id,
 												cellScalars->GetValue(ptId));
 		}
-		this->Triangulator->InsertPoint(id, id, 0 /*cellScalar*/, x, x, 0);
+		slab.Triangulator->InsertPoint(id, id, 0 /*cellScalar*/, x, x, 0);
 	}
 
 	// triangulate the points
 	if (UseTemplates)
-		this->Triangulator->TemplateTriangulate(VTK_NUMBER_OF_CELL_TYPES + flip,
+		slab.Triangulator->TemplateTriangulate(VTK_NUMBER_OF_CELL_TYPES + flip,
 												8, 12);
 	else
-		this->Triangulator->Triangulate();
+		slab.Triangulator->Triangulate();
 
 	// Add the triangulation to the mesh
-	this->Connectivity->Initialize();
-	this->Triangulator->AddTetras(0, this->Connectivity);
-	vtkIdType numNew = this->Connectivity->GetNumberOfCells();
+	slab.Connectivity->Initialize();
+	slab.Triangulator->AddTetras(0, slab.Connectivity);
+	vtkIdType numNew = slab.Connectivity->GetNumberOfCells();
 
 	vtkIdType npts, *pts;
-	this->Connectivity->InitTraversal();
+	slab.Connectivity->InitTraversal();
 	for (vtkIdType i = 0; i < numNew; i++)
 	{
-		this->Connectivity->GetNextCell(npts, pts);
+		slab.Connectivity->GetNextCell(npts, pts);
 
 		// now check colors at nodes and subdivide the tetrahedra accordingly
-		int doms[4] = {PointDomainArray->GetValue(pts[0]),
-					   PointDomainArray->GetValue(pts[1]),
-					   PointDomainArray->GetValue(pts[2]),
-					   PointDomainArray->GetValue(pts[3])};
-		MyTriangulator->AddMultipleDomainTetrahedron(pts, doms);
+		int doms[4] = {slab.PointDomainArray->GetValue(pts[0]),
+					   slab.PointDomainArray->GetValue(pts[1]),
+					   slab.PointDomainArray->GetValue(pts[2]),
+					   slab.PointDomainArray->GetValue(pts[3])};
+		slab.MyTriangulator->AddMultipleDomainTetrahedron(pts, doms);
 	}
 }
 
-void vtkImageExtractCompatibleMesher::TriangulateVoxel(int cellScalar, int flip,
+void vtkImageExtractCompatibleMesher::TriangulateVoxel(MesherSlab& slab,
+													   int cellScalar, int flip,
 													   double spacing[3],
 													   vtkIdList* cellIds,
 													   vtkPoints* cellPts)
@@ -960,7 +1166,7 @@ void vtkImageExtractCompatibleMesher::TriangulateVoxel(int cellScalar, int flip,
 
 	// Initialize Delaunay insertion process with voxel triangulation.
 	// No more than 8 points (8 corners) may be inserted.
-	this->Triangulator->InitTriangulation(bounds, 8);
+	slab.Triangulator->InitTriangulation(bounds, 8);
 
 	// Inject ordered voxel corner points into triangulation. Recall
 	// that the PreSortedOn() flag was set in the triangulator.
@@ -972,33 +1178,33 @@ void vtkImageExtractCompatibleMesher::TriangulateVoxel(int cellScalar, int flip,
 			ptId = order_noflip[numPts];
 
 		cellPts->GetPoint(ptId, x);
-		if (this->Locator->InsertUniquePoint(x, id))
+		if (slab.Locator.InsertUniquePoint(x, id))
 		{
-			this->PointDomainArray->InsertValue(id, cellScalar);
+			slab.PointDomainArray->InsertValue(id, cellScalar);
 		}
-		this->Triangulator->InsertPoint(id, id, cellScalar, x, x, 0);
+		slab.Triangulator->InsertPoint(id, id, cellScalar, x, x, 0);
 	} //for eight voxel corner points
 
 	// triangulate the points
 	if (UseTemplates)
-		this->Triangulator->TemplateTriangulate(VTK_NUMBER_OF_CELL_TYPES + flip,
+		slab.Triangulator->TemplateTriangulate(VTK_NUMBER_OF_CELL_TYPES + flip,
 												8, 12);
 	else
-		this->Triangulator->Triangulate();
+		slab.Triangulator->Triangulate();
 
 	// Add the triangulation to the mesh
-	this->Connectivity->Initialize();
-	this->Triangulator->AddTetras(0, this->Connectivity);
-	vtkIdType numNew = this->Connectivity->GetNumberOfCells();
+	slab.Connectivity->Initialize();
+	slab.Triangulator->AddTetras(0, slab.Connectivity);
+	vtkIdType numNew = slab.Connectivity->GetNumberOfCells();
 
 	vtkIdType npts, *pts;
 	int doms[4] = {cellScalar, cellScalar, cellScalar, cellScalar};
-	this->Connectivity->InitTraversal();
+	slab.Connectivity->InitTraversal();
 	for (vtkIdType i = 0; i < numNew; i++)
 	{
-		this->Connectivity->GetNextCell(npts, pts);
-		// this->Tetrahedra->push_back(pts[0],pts[1],pts[2],pts[3]);
-		MyTriangulator->AddMultipleDomainTetrahedron(pts, doms);
+		slab.Connectivity->GetNextCell(npts, pts);
+		// slab.Tetrahedra.push_back(pts[0],pts[1],pts[2],pts[3]);
+		slab.MyTriangulator->AddMultipleDomainTetrahedron(pts, doms);
 	}
 }
 
@@ -1135,6 +1341,7 @@ int vtkImageExtractCompatibleMesher::LabelTetra_not_used()
 			NumberOfUnassignedLabels++;
 	}
 	this->PointDomainArray->Delete();
+	this->PointDomainArray = nullptr;
 
 	// Neighborhood based labeling
 	int dom;
@@ -15,15 +15,12 @@
 
 class vtkImageData;
 class vtkUnstructuredGrid;
-class vtkOrderedTriangulator;
-class vtkIncrementalPointLocator;
-class vtkCellArray;
 class vtkShortArray;
 class vtkIdList;
 class vtkPoints;
 //BTX
 class TetContainer;
-class vtkTriangulatorImpl;
+class MesherSlab;
 //ETX
 
 /**	\brief Extract compatible multi-domain surface mesh from label field
@@ -36,6 +33,10 @@ class vtkTriangulatorImpl;
 	templates. It uses a leaner data-structure (unsigned int for indices, different technique 
 	for tet neighbor computation).
 
+	Points are welded by hashing their position on a lattice, which is exact
+	since all points are averages of voxel corners. The voxel layers are
+	tetrahedralized in parallel slabs, which are merged at the end.
+
 	\note You should set the output name of the scalars. It will be used to differentiate
 	between different materials (e.g. in vtkEdgeCollapse)
 
@@ -71,10 +72,6 @@ public:
 	vtkSetMacro(UseTemplates, bool) vtkGetMacro(UseTemplates, bool);
 	vtkBooleanMacro(UseTemplates, bool);
 
-	// Use octree point locator: Default On
-	vtkSetMacro(UseOctreeLocator, bool) vtkGetMacro(UseOctreeLocator, bool);
-	vtkBooleanMacro(UseOctreeLocator, bool);
-
 	// Generate tetrahedral in second output: Default Off
 	// Attention: this will consume lots of memory
 	vtkSetMacro(GenerateTetMeshOutput, bool);
@@ -101,12 +98,12 @@ protected:
 	// to extract the surfaces between different material regions
 	int ContourSurface(vtkInformationVector**, vtkInformationVector*);
 
-	void ClipVoxel(vtkShortArray* cellScalars, int flip, double spacing[3],
-			vtkIdList* cellIds, vtkPoints* cellPts);
+	void ClipVoxel(MesherSlab& slab, vtkShortArray* cellScalars, int flip,
+			double spacing[3], vtkIdList* cellIds, vtkPoints* cellPts);
 
 	// Helper function for ContourSurface
-	void TriangulateVoxel(int cellScalar, int flip, double spacing[3],
-			vtkIdList* cellIds, vtkPoints* cellPts);
+	void TriangulateVoxel(MesherSlab& slab, int cellScalar, int flip,
+			double spacing[3], vtkIdList* cellIds, vtkPoints* cellPts);
 
 	// Helper function for ContourSurface
 	int EvaluateLabel(double x[3]);
@@ -129,7 +126,6 @@ protected:
 	bool CreateVoxelCenterPoint;
 	int BackgroundLabel;
 	bool UseTemplates;
-	bool UseOctreeLocator;
 	char* OutputScalarName;
 	bool GenerateTetMeshOutput;
 	int MaxNumberOfIterations;
@@ -138,14 +134,10 @@ protected:
 	vtkImageData* Input;
 	vtkDataArray* ClipScalars;
 	vtkPoints* Points;
-	vtkOrderedTriangulator* Triangulator;
-	vtkIncrementalPointLocator* Locator;
-	vtkCellArray* Connectivity;
 	vtkShortArray* PointDomainArray;
 	vtkShortArray* CellDomainArray;
 	//BTX
 	TetContainer* Tetrahedra;
-	vtkTriangulatorImpl* MyTriangulator;
 	//ETX
 
 	int NumberOfUnassignedLabels;
@@ -160,7 +152,7 @@ private:
 			const vtkImageExtractCompatibleMesher&);						// Not implemented
 	void operator=(const vtkImageExtractCompatibleMesher&); // Not implemented
 
-	void ClipVoxel_not_used(vtkShortArray* cellScalars, int flip,
+	void ClipVoxel_not_used(MesherSlab& slab, vtkShortArray* cellScalars, int flip,
 			double spacing[3], vtkIdList* cellIds,
 			vtkPoints* cellPts);
 	int LabelTetra_not_used();
@@ -112,7 +112,7 @@ int vtkTemplateTriangulator::AddPyramid(vtkIdType v1, vtkIdType v2,
 										vtkIdType v5, int dom)
 {
 	int numTets = 2;
-	bool lookUpTable = (std::max(v1, v3) < std::max(v2, v4));
+	bool lookUpTable = IsLess(MaxVertex(v1, v3), MaxVertex(v2, v4));
 
 	// diagonal v1,v3
 	if (lookUpTable)
@@ -142,9 +142,9 @@ int vtkTemplateTriangulator::AddPrism(vtkIdType v1, vtkIdType v2, vtkIdType v3,
 {
 	int numTets = 0;
 
-	bool lookUpTable[] = {(std::max(v2, v4) < std::max(v1, v5)),
-						  (std::max(v1, v6) < std::max(v4, v3)),
-						  (std::max(v3, v5) < std::max(v2, v6))};
+	bool lookUpTable[] = {IsLess(MaxVertex(v2, v4), MaxVertex(v1, v5)),
+						  IsLess(MaxVertex(v1, v6), MaxVertex(v4, v3)),
+						  IsLess(MaxVertex(v3, v5), MaxVertex(v2, v6))};
 	/*
 	bool lookUpTable[] = {
 		(std::min(v2, v4) < std::min(v1, v5)),
@@ -365,8 +365,8 @@ int vtkTemplateTriangulator::AddHexahedron(vtkIdType v0, vtkIdType v1,
 
 		// diagonal never is connected to largest id (since this is the last added
 		// in the point insertion Delaunay algorithm used by vtkOrderedTriangulator)
-		lookupTable[k] = (std::max(vi[face[0]], vi[face[2]]) <
-						  std::max(vi[face[1]], vi[face[3]]));
+		lookupTable[k] = IsLess(MaxVertex(vi[face[0]], vi[face[2]]),
+								MaxVertex(vi[face[1]], vi[face[3]]));
 
 		/*
 		// alternative definition:
@@ -53,6 +53,11 @@ protected:
 	virtual vtkIdType AddPoint(double x, double y, double z) = 0;
 	vtkIdType AddPoint(double p[3]) { return AddPoint(p[0], p[1], p[2]); }
 
+	/// Order of the vertices, used to choose the diagonals of quads. It must be
+	/// the same for all elements sharing a quad. Default: by id
+	virtual bool IsLess(vtkIdType v0, vtkIdType v1) { return v0 < v1; }
+	vtkIdType MaxVertex(vtkIdType v0, vtkIdType v1) { return IsLess(v0, v1) ? v1 : v0; }
+
 	/// Add tetrahedron to mesh
 	virtual void AddTetrahedron(vtkIdType v0, vtkIdType v1, vtkIdType v2,
 															vtkIdType v3, int domain) = 0;